@@ -0,0 +1,435 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+#include "Arduino.h"
+
+#include "FlashPartition.h"
+#include "System.h"
+#include "Profiler.h"
+#include "Trace.h"
+
+
+#if FLASH_PARTITION_RAM
+	namespace
+	{
+		uint32_t ram[MOTION_PARTITION_SIZE / PLEN2::FlashPartition::WORD_SIZE];
+		bool     ram_erased = false; //!< The RAM is erased at the first init(), and kept as the flash over reboots.
+	}
+#else
+	extern "C" uint32_t _SPIFFS_start;
+#endif
+
+
+bool          PLEN2::FlashPartition::m_available  = false;
+unsigned long PLEN2::FlashPartition::m_erasures   = 0;
+unsigned long PLEN2::FlashPartition::m_programs   = 0;
+unsigned long PLEN2::FlashPartition::m_reads      = 0;
+unsigned long PLEN2::FlashPartition::m_bytes_read = 0;
+uint32_t      PLEN2::FlashPartition::m_sector[PLEN2::FlashPartition::SECTOR_WORDS];
+
+
+bool PLEN2::FlashPartition::init()
+{
+	m_available  = false;
+	m_erasures   = 0;
+	m_programs   = 0;
+	m_reads      = 0;
+	m_bytes_read = 0;
+
+	#if !USE_MOTION_PARTITION
+		return false;
+	#elif FLASH_PARTITION_RAM
+		if (!ram_erased)
+		{
+			memset(ram, 0xFF, sizeof(ram));
+			ram_erased = true;
+		}
+
+		m_available = true;
+	#else
+		const unsigned long spiffs_begin = reinterpret_cast<unsigned long>(&_SPIFFS_start) - 0x40200000UL;
+		const unsigned long sketch_end   = (ESP.getSketchSize() + SECTOR_SIZE - 1) & ~static_cast<unsigned long>(SECTOR_SIZE - 1);
+		const unsigned long end          = MOTION_PARTITION_BEGIN + MOTION_PARTITION_SIZE;
+
+		/*!
+			@note
+			An update is written to the end of the space under SPIFFS,
+			so an update as big as the sketch must fit between the partition and SPIFFS.
+		*/
+		m_available = (
+			   ((MOTION_PARTITION_BEGIN % SECTOR_SIZE) == 0)
+			&& (sketch_end <= MOTION_PARTITION_BEGIN)
+			&& ((end + sketch_end) <= spiffs_begin)
+			&& (end <= ESP.getFlashChipRealSize())
+		);
+
+		#if DEBUG
+			System::debugSerial().print(F(">>> motion partition : "));
+			System::debugSerial().println(m_available? F("used") : F("no room, so SPIFFS is used"));
+		#endif
+	#endif
+
+	return m_available;
+}
+
+
+bool PLEN2::FlashPartition::read(unsigned long offset, unsigned char data[], unsigned long size)
+{
+	TRACE_SCOPE("FlashPartition::read()");
+
+	if (!m_available || (offset > MOTION_PARTITION_SIZE) || (size > (MOTION_PARTITION_SIZE - offset)))
+	{
+		return false;
+	}
+
+	uint32_t words[CHUNK_WORDS];
+
+	while (size != 0)
+	{
+		const unsigned long address = offset & ~static_cast<unsigned long>(WORD_SIZE - 1);
+		const unsigned long skip    = offset - address;
+		unsigned long length = (skip + size + WORD_SIZE - 1) & ~static_cast<unsigned long>(WORD_SIZE - 1);
+
+		if (length > sizeof(words))
+		{
+			length = sizeof(words);
+		}
+
+		if (!m_readWords(address, words, length))
+		{
+			return false;
+		}
+
+		const unsigned long count = ((length - skip) < size)? (length - skip) : size;
+
+		memcpy(data, reinterpret_cast<const unsigned char*>(words) + skip, count);
+
+		data   += count;
+		offset += count;
+		size   -= count;
+	}
+
+	return true;
+}
+
+
+bool PLEN2::FlashPartition::write(unsigned long offset, const unsigned char data[], unsigned long size)
+{
+	TRACE_SCOPE("FlashPartition::write()");
+
+	if (!m_available || (offset > MOTION_PARTITION_SIZE) || (size > (MOTION_PARTITION_SIZE - offset)))
+	{
+		return false;
+	}
+
+	unsigned char* bytes = reinterpret_cast<unsigned char*>(m_sector);
+
+	while (size != 0)
+	{
+		const unsigned long sector = offset & ~static_cast<unsigned long>(SECTOR_SIZE - 1);
+		const unsigned long begin  = offset - sector;
+		const unsigned long length = ((SECTOR_SIZE - begin) < size)? (SECTOR_SIZE - begin) : size;
+		const unsigned long word_begin = begin & ~static_cast<unsigned long>(WORD_SIZE - 1);
+		const unsigned long word_end   = (begin + length + WORD_SIZE - 1) & ~static_cast<unsigned long>(WORD_SIZE - 1);
+
+		// Only the words written are read, unless the sector has to be erased.
+		if (!m_readWords(sector + word_begin, m_sector + word_begin / WORD_SIZE, word_end - word_begin))
+		{
+			return false;
+		}
+
+		bool changed      = false;
+		bool programmable = true;
+
+		for (unsigned long index = 0; index < length; index++)
+		{
+			const unsigned char old = bytes[begin + index];
+
+			changed      |= (old != data[index]);
+			programmable &= ((old & data[index]) == data[index]);
+		}
+
+		if (changed && programmable)
+		{
+			memcpy(bytes + begin, data, length);
+
+			if (!m_programWords(sector + word_begin, m_sector + word_begin / WORD_SIZE, word_end - word_begin))
+			{
+				return false;
+			}
+		}
+		else if (changed)
+		{
+			if (!m_readWords(sector, m_sector, SECTOR_SIZE))
+			{
+				return false;
+			}
+
+			memcpy(bytes + begin, data, length);
+
+			if (!m_writeSector(sector))
+			{
+				return false;
+			}
+		}
+
+		data   += length;
+		offset += length;
+		size   -= length;
+	}
+
+	return true;
+}
+
+
+bool PLEN2::FlashPartition::program(unsigned long offset, const unsigned char data[], unsigned long size)
+{
+	TRACE_SCOPE("FlashPartition::program()");
+
+	// write() only programs the bytes that are programmable.
+	return (m_programmable(offset, data, size) && write(offset, data, size));
+}
+
+
+bool PLEN2::FlashPartition::erased(unsigned long begin, unsigned long end)
+{
+	if (!m_available || (begin > end) || (end > MOTION_PARTITION_SIZE))
+	{
+		return false;
+	}
+
+	uint32_t words[CHUNK_WORDS];
+
+	// A sector is aligned to words, so the words out of the range are read and skipped.
+	while (begin < end)
+	{
+		const unsigned long address = begin & ~static_cast<unsigned long>(WORD_SIZE - 1);
+		const unsigned long skip    = begin - address;
+		unsigned long length = (end - address + WORD_SIZE - 1) & ~static_cast<unsigned long>(WORD_SIZE - 1);
+
+		if (length > sizeof(words))
+		{
+			length = sizeof(words);
+		}
+
+		if (!m_readWords(address, words, length))
+		{
+			return false;
+		}
+
+		const unsigned long count = ((length - skip) < (end - begin))? (length - skip) : (end - begin);
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(words) + skip;
+
+		for (unsigned long index = 0; index < count; index++)
+		{
+			if (bytes[index] != 0xFF)
+			{
+				return false;
+			}
+		}
+
+		begin += count;
+	}
+
+	return true;
+}
+
+
+bool PLEN2::FlashPartition::erase(unsigned long begin, unsigned long end)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("FlashPartition::erase()"));
+	#endif
+
+	if (!m_available || (begin > end) || (end > MOTION_PARTITION_SIZE))
+	{
+		return false;
+	}
+
+	unsigned char* bytes = reinterpret_cast<unsigned char*>(m_sector);
+
+	while (begin < end)
+	{
+		const unsigned long sector = begin & ~static_cast<unsigned long>(SECTOR_SIZE - 1);
+		const unsigned long from   = begin - sector;
+		const unsigned long to     = ((end - sector) < SECTOR_SIZE)? (end - sector) : static_cast<unsigned long>(SECTOR_SIZE);
+
+		if (!m_readWords(sector, m_sector, SECTOR_SIZE))
+		{
+			return false;
+		}
+
+		bool erased = true;
+
+		for (unsigned long index = from; index < to; index++)
+		{
+			erased &= (bytes[index] == 0xFF);
+		}
+
+		if (!erased)
+		{
+			memset(bytes + from, 0xFF, to - from);
+
+			if (!m_writeSector(sector))
+			{
+				return false;
+			}
+		}
+
+		begin = sector + to;
+
+		// Erasing a sector takes tens of milliseconds, so the watchdog is fed between them.
+		yield();
+	}
+
+	return true;
+}
+
+
+bool PLEN2::FlashPartition::move(unsigned long from, unsigned long to, unsigned long size)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("FlashPartition::move()"));
+	#endif
+
+	if (!m_available || (to > from) || (from > MOTION_PARTITION_SIZE) || (size > (MOTION_PARTITION_SIZE - from)))
+	{
+		return false;
+	}
+
+	unsigned char* bytes = reinterpret_cast<unsigned char*>(m_sector);
+
+	while (size != 0)
+	{
+		const unsigned long sector = to & ~static_cast<unsigned long>(SECTOR_SIZE - 1);
+		const unsigned long begin  = to - sector;
+		const unsigned long length = ((SECTOR_SIZE - begin) < size)? (SECTOR_SIZE - begin) : size;
+
+		/*!
+			@note
+			The bytes are moved toward the beginning, so the bytes to move are in the sector
+			or after it, that were not written yet. They are read from the flash as they are.
+		*/
+		if (   !m_readWords(sector, m_sector, SECTOR_SIZE)
+			|| !read(from, bytes + begin, length)
+			|| !m_writeSector(sector)
+		)
+		{
+			return false;
+		}
+
+		from += length;
+		to   += length;
+		size -= length;
+
+		yield();
+	}
+
+	return true;
+}
+
+
+bool PLEN2::FlashPartition::m_programmable(unsigned long offset, const unsigned char data[], unsigned long size)
+{
+	if (!m_available || (offset > MOTION_PARTITION_SIZE) || (size > (MOTION_PARTITION_SIZE - offset)))
+	{
+		return false;
+	}
+
+	unsigned char old[CHUNK_WORDS * WORD_SIZE];
+
+	while (size != 0)
+	{
+		const unsigned long length = (size < sizeof(old))? size : sizeof(old);
+
+		if (!read(offset, old, length))
+		{
+			return false;
+		}
+
+		for (unsigned long index = 0; index < length; index++)
+		{
+			if ((old[index] & data[index]) != data[index])
+			{
+				return false;
+			}
+		}
+
+		data   += length;
+		offset += length;
+		size   -= length;
+	}
+
+	return true;
+}
+
+
+bool PLEN2::FlashPartition::m_readWords(unsigned long address, uint32_t words[], unsigned long size)
+{
+	m_reads++;
+	m_bytes_read += size;
+
+	#if FLASH_PARTITION_RAM
+		memcpy(words, ram + address / WORD_SIZE, size);
+
+		return true;
+	#else
+		return ESP.flashRead(MOTION_PARTITION_BEGIN + address, words, size);
+	#endif
+}
+
+
+bool PLEN2::FlashPartition::m_programWords(unsigned long address, const uint32_t words[], unsigned long size)
+{
+	m_programs++;
+
+	#if FLASH_PARTITION_RAM
+		// Programming only clears bits, as the flash does.
+		for (unsigned long index = 0; index < size / WORD_SIZE; index++)
+		{
+			ram[address / WORD_SIZE + index] &= words[index];
+		}
+
+		return true;
+	#else
+		return ESP.flashWrite(MOTION_PARTITION_BEGIN + address, const_cast<uint32_t*>(words), size);
+	#endif
+}
+
+
+bool PLEN2::FlashPartition::m_eraseSector(unsigned long address)
+{
+	m_erasures++;
+
+	#if FLASH_PARTITION_RAM
+		memset(ram + address / WORD_SIZE, 0xFF, SECTOR_SIZE);
+
+		return true;
+	#else
+		return ESP.flashEraseSector((MOTION_PARTITION_BEGIN + address) / SECTOR_SIZE);
+	#endif
+}
+
+
+bool PLEN2::FlashPartition::m_writeSector(unsigned long address)
+{
+	if (!m_eraseSector(address))
+	{
+		return false;
+	}
+
+	// The words left erased are not programmed.
+	unsigned long size = SECTOR_SIZE;
+
+	while ((size != 0) && (m_sector[size / WORD_SIZE - 1] == 0xFFFFFFFFUL))
+	{
+		size -= WORD_SIZE;
+	}
+
+	return ((size == 0) || m_programWords(address, m_sector, size));
+}
@@ -0,0 +1,189 @@
+/*!
+	@file      FlashPartition.h
+	@brief     Direct access to a flash partition of motions, beside SPIFFS.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef PLEN2_FLASH_PARTITION_H
+#define PLEN2_FLASH_PARTITION_H
+
+#include <stdint.h>
+
+
+/*!
+	@note
+	If you want to keep the motions in SPIFFS, set the macro to "false".
+	(The partition is used only if the flash layout has room for it. Refer to FlashPartition::init().)
+*/
+#define USE_MOTION_PARTITION true
+
+#define MOTION_PARTITION_BEGIN 0x100000L //!< Flash address of the partition.
+#define MOTION_PARTITION_SIZE  0x100000L
+
+/*!
+	@note
+	Builds without the ESP8266 core (e.g. on a host) keep the partition in RAM,
+	that behaves as NOR flash, so the store is tested and measured without a board.
+*/
+#if !defined(ESP8266)
+	#define FLASH_PARTITION_RAM true
+#else
+	#define FLASH_PARTITION_RAM false
+#endif
+
+
+namespace PLEN2
+{
+	class FlashPartition;
+}
+
+/*!
+	@brief Direct access to a flash partition of motions, beside SPIFFS
+
+	SPIFFS walks the page chain of a file at every seek, so reading a frame of a long motion
+	costs more than decoding it. The partition is a raw range of the flash, read by spi_flash_read()
+	at computed offsets. (The flash cache maps the first megabyte only, that the sketch occupies.)
+	SPIFFS stays for the configurations and the web assets.
+
+	The partition is outside both SPIFFS and the sketch.
+	An update over HTTP writes the new sketch under SPIFFS, so the layout must keep the sketch
+	under the partition and the update over it. (e.g. "4M (1M SPIFFS)": the sketch is under 1 MB,
+	the partition is [1 MB, 2 MB), and the update is [2 MB, 3 MB).)
+
+	Writing follows NOR flash: a byte is programmed only from 1 to 0, so a sector is erased
+	and written again if the bytes cannot be programmed. Please write the bytes that change often
+	to the erased area, to spare the erasing.
+
+	@attention
+	The class is not guarded against interruptions, so please use it from the main loop only.
+*/
+class PLEN2::FlashPartition
+{
+public:
+	enum {
+		SECTOR_SIZE = 4096, //!< Erasable unit of the flash.
+		WORD_SIZE   = 4     //!< Programmable unit of the flash, and alignment of the accesses.
+	};
+
+	/*!
+		@brief Decide the partition is usable on the flash layout
+
+		@return Result (false if it overlaps the sketch, the update or SPIFFS.)
+	*/
+	static bool init();
+
+	//! @brief Decide init() accepted the partition
+	static bool available() { return m_available; }
+
+	//! @brief Get size of the partition (bytes)
+	static unsigned long size() { return MOTION_PARTITION_SIZE; }
+
+	/*!
+		@brief Read bytes
+
+		@param [in]  offset Offset in the partition.
+		@param [out] data[] Please set buffer of size bytes.
+		@param [in]  size   Bytes to read.
+
+		@return Result
+	*/
+	static bool read(unsigned long offset, unsigned char data[], unsigned long size);
+
+	/*!
+		@brief Write bytes
+
+		The bytes are programmed if they can be, and the sector is erased and written again otherwise.
+
+		@param [in] offset Offset in the partition.
+		@param [in] data[] Bytes to write.
+		@param [in] size   Bytes to write.
+
+		@return Result
+	*/
+	static bool write(unsigned long offset, const unsigned char data[], unsigned long size);
+
+	/*!
+		@brief Program bytes without erasing
+
+		@param [in] offset Offset in the partition.
+		@param [in] data[] Bytes to write.
+		@param [in] size   Bytes to write.
+
+		@return false if a sector had to be erased for them (Nothing is written.)
+	*/
+	static bool program(unsigned long offset, const unsigned char data[], unsigned long size);
+
+	//! @brief Decide all bytes of a range are erased
+	static bool erased(unsigned long begin, unsigned long end);
+
+	/*!
+		@brief Erase a range, so the bytes in it are programmed without erasing later
+
+		The bytes out of the range in the sectors at its ends are kept.
+		A sector that is erased already is not erased again.
+
+		@param [in] begin Offset of the beginning.
+		@param [in] end   Offset of the ending.
+
+		@return Result
+	*/
+	static bool erase(unsigned long begin, unsigned long end);
+
+	/*!
+		@brief Move bytes toward the beginning
+
+		A sector is erased once for all bytes moved to it,
+		instead of once for every write() of a piece.
+
+		@param [in] from Offset of the bytes.
+		@param [in] to   Offset to move the bytes to. (It must not be after from.)
+		@param [in] size Bytes to move.
+
+		@return Result
+	*/
+	static bool move(unsigned long from, unsigned long to, unsigned long size);
+
+	//! @brief Get count of sectors erased after init() (It tells wear of the flash.)
+	static unsigned long erasures() { return m_erasures; }
+
+	//! @brief Get count of programming bursts after init()
+	static unsigned long programs() { return m_programs; }
+
+	//! @brief Get count of read bursts after init() (A burst sends a command and an address to the flash.)
+	static unsigned long reads() { return m_reads; }
+
+	//! @brief Get count of bytes read after init() (Whole words, as the flash is read.)
+	static unsigned long bytesRead() { return m_bytes_read; }
+
+private:
+	enum {
+		SECTOR_WORDS = SECTOR_SIZE / WORD_SIZE,
+		CHUNK_WORDS  = 16 //!< Words read at once by read().
+	};
+
+	/*
+		Accesses of the backend, that is the flash or the RAM.
+		address and size are aligned to WORD_SIZE. (A word is uint32_t, as spi_flash_read() takes.)
+	*/
+	static bool m_readWords(unsigned long address, uint32_t words[], unsigned long size);
+	static bool m_programWords(unsigned long address, const uint32_t words[], unsigned long size);
+	static bool m_eraseSector(unsigned long address);
+
+	//! @brief Decide bytes are programmed over the flash, without erasing
+	static bool m_programmable(unsigned long offset, const unsigned char data[], unsigned long size);
+
+	//! @brief Erase the sector, and write m_sector to it
+	static bool m_writeSector(unsigned long address);
+
+	static bool          m_available;
+	static unsigned long m_erasures;
+	static unsigned long m_programs;
+	static unsigned long m_reads;
+	static unsigned long m_bytes_read;
+	static uint32_t      m_sector[SECTOR_WORDS]; //!< Buffer of a sector written again.
+};
+
+#endif // PLEN2_FLASH_PARTITION_H
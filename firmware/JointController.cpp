@@ -1,577 +1,1754 @@
-/*
-	Copyright (c) 2015,
-	- Kazuyuki TAKASE - https://github.com/junbowu
-	- PLEN Project Company Inc. - https://plen.jp
-
-	This software is released under the MIT License.
-	(See also : http://opensource.org/licenses/mit-license.php)
-*/
-#include "Arduino.h"
-#include <Wire.h>
-#include <Servo.h>
-#include <Ticker.h>
-#include <Adafruit_PWMServoDriver.h>
-#include <ESP8266WebServer.h>
-#include "Pin.h"
-#include "Profiler.h"
-#include "System.h"
-#include "JointController.h"
-#include "ExternalFs.h"
-#include "Motion.h"
-
-Adafruit_PWMServoDriver pwm;
-Servo GPIO12SERVO;
-Servo GPIO14SERVO;
-Servo EyeOut;
-Ticker flipper;
-Ticker flipper_second;
-extern WiFiServer tcp_server;
-extern File fp_config;
-/*!
-	@note
-	If you want to apply the firmware to PLEN1.4, set the macro to false.
-*/
-#define PLEN2_JOINTCONTROLLER_PWM_OUT_00_07_REGISTER OCR1C
-#define PLEN2_JOINTCONTROLLER_PWM_OUT_08_15_REGISTER OCR1B
-#define PLEN2_JOINTCONTROLLER_PWM_OUT_16_23_REGISTER OCR1A
-
-volatile bool PLEN2::JointController::m_1cycle_finished = false;
-int PLEN2::JointController::m_pwms[PLEN2::JointController::SUM];
-
-//eyes control
-int _enable;
-int _eye_count_step;
-uint8_t _eye_count;
-
-namespace
-{
-	namespace Shared
-	{
-		using namespace PLEN2;
-
-		PROGMEM const int m_SETTINGS_INITIAL[] =
-		{
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  -40, // [01] Left : Shoulder Pitch
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  245, // [02] Left : Thigh Yaw
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  470, // [03] Left : Shoulder Roll
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -100, // [04] Left : Elbow Roll
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -205, // [05] Left : Thigh Roll
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,   50, // [06] Left : Thigh Pitch
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  445, // [07] Left : Knee Pitch
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  245, // [08] Left : Foot Pitch
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  -75, // [09] Left : Foot Roll
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL,
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL,
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL,
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,   15, // [10] Right : Shoulder Pitch
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  -70, // [11] Right : Thigh Yaw
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -390, // [12] Right : Shoulder Roll
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  250, // [13] Right : Elbow Roll
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  195, // [14] Right : Thigh Roll
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -105, // [15] Right : Thigh Pitch
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -510, // [16] Right : Knee Pitch
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -305, // [17] Right : Foot Pitch
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX,   60, // [18] Right : Foot Roll
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL,
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL,
-			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL
-		};
-
-		const int ERROR_LVALUE = -32768;
-	}
-}
-
-
-void PLEN2::JointController::Init()
-{
-	pwm = Adafruit_PWMServoDriver();
-
-    pinMode(Pin::PCA9685_ENABLE(), OUTPUT);
-    digitalWrite(Pin::PCA9685_ENABLE(), LOW);
-    pinMode(Pin::LED(),OUTPUT);
-    digitalWrite(Pin::LED(),HIGH);
-    GPIO12SERVO.attach(Pin::PWM_OUT_12());
-    GPIO14SERVO.attach(Pin::PWM_OUT_14());
-    _enable = true;
-    _eye_count = 3;
-  //  EyeOut.attach(Pin::LED_OUT(), 200, 15000);
-//
-//    pinMode(Pin::PCA9685_ENABLE(), OUTPUT);
-//    digitalWrite(Pin::PCA9685_ENABLE(), LOW);
-
-    // Initialize I2C
-    Wire.begin(4, 5);
-
-    // PWMServoDriver
-    pwm.begin();
-    pwm.setPWMFreq(PWM_FREQ());   // servos run at 300Hz updates
-
-    delay(500);
-    
-	for (char joint_id = 0; joint_id < SUM; joint_id++)
-	{
-		m_SETTINGS[joint_id].MIN  = Shared::m_SETTINGS_INITIAL[joint_id * 3];
-		m_SETTINGS[joint_id].MAX  = Shared::m_SETTINGS_INITIAL[joint_id * 3 + 1];
-		m_SETTINGS[joint_id].HOME = Shared::m_SETTINGS_INITIAL[joint_id * 3 + 2];
-		setAngle(joint_id, m_SETTINGS[joint_id].HOME);
-	}
-}
-PLEN2::JointController::JointController()
-{
-
-}
-
-
-void PLEN2::JointController::loadSettings()
-{
-	#if DEBUG
-		volatile Utility::Profiler p(F("JointController::loadSettings()"));
-	#endif
-
-	unsigned char* filler = reinterpret_cast<unsigned char*>(m_SETTINGS);
-	
-	if (ExternalFs::readByte(INIT_FLAG_ADDRESS(), fp_config) != INIT_FLAG_VALUE())
-	{
-		ExternalFs::writeByte(INIT_FLAG_ADDRESS(), INIT_FLAG_VALUE(), fp_config);
-        ExternalFs::write(SETTINGS_HEAD_ADDRESS(), sizeof(m_SETTINGS), filler, fp_config);
-		System::debugSerial().println(F("reset config\n"));
-	}
-	else
-	{
-		ExternalFs::read(SETTINGS_HEAD_ADDRESS(), sizeof(m_SETTINGS), filler, fp_config);
-		System::debugSerial().println(F("read config"));
-	}
-
-	for (char joint_id = 0; joint_id < SUM; joint_id++)
-	{
-		setAngle(joint_id, m_SETTINGS[joint_id].HOME);
-	}
-
-    flipper.attach_ms(Motion::Frame::UPDATE_INTERVAL_MS, PLEN2::JointController::updateAngle);
-    flipper_second.attach(1, PLEN2::JointController::updateEyes);
-}
-
-
-void PLEN2::JointController::resetSettings()
-{
-	#if DEBUG
-		volatile Utility::Profiler p(F("JointController::resetSettings()"));
-	#endif
-	
-    ExternalFs::writeByte(INIT_FLAG_ADDRESS(), INIT_FLAG_VALUE(), fp_config);
-
-	for (char joint_id = 0; joint_id < SUM; joint_id++)
-	{
-		m_SETTINGS[joint_id].MIN  = Shared::m_SETTINGS_INITIAL[joint_id * 3];
-		m_SETTINGS[joint_id].MAX  = Shared::m_SETTINGS_INITIAL[joint_id * 3 + 1];
-		m_SETTINGS[joint_id].HOME = Shared::m_SETTINGS_INITIAL[joint_id * 3 + 2];
-
-		setAngle(joint_id, m_SETTINGS[joint_id].HOME);
-	}
-	
-    ExternalFs::write(SETTINGS_HEAD_ADDRESS(), sizeof(m_SETTINGS), 
-                    reinterpret_cast<const unsigned char*>(m_SETTINGS), fp_config);
-}
-
-
-const int& PLEN2::JointController::getMinAngle(unsigned char joint_id)
-{
-	#if DEBUG
-		volatile Utility::Profiler p(F("JointController::getMinAngle()"));
-	#endif
-
-	if (joint_id >= SUM)
-	{
-		#if DEBUG
-			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
-			System::debugSerial().println(static_cast<int>(joint_id));
-		#endif
-
-		return Shared::ERROR_LVALUE;
-	}
-
-	return m_SETTINGS[joint_id].MIN;
-}
-
-
-const int& PLEN2::JointController::getMaxAngle(unsigned char joint_id)
-{
-	#if DEBUG
-		volatile Utility::Profiler p(F("JointController::getMaxAngle()"));
-	#endif
-
-	if (joint_id >= SUM)
-	{
-		#if DEBUG
-			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
-			System::debugSerial().println(static_cast<int>(joint_id));
-		#endif
-
-		return Shared::ERROR_LVALUE;
-	}
-
-	return m_SETTINGS[joint_id].MAX;
-}
-
-
-const int& PLEN2::JointController::getHomeAngle(unsigned char joint_id)
-{
-	#if DEBUG
-		volatile Utility::Profiler p(F("JointController::getHomeAngle()"));
-	#endif
-
-	if (joint_id >= SUM)
-	{
-		#if DEBUG
-			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
-			System::debugSerial().println(static_cast<int>(joint_id));
-		#endif
-
-		return Shared::ERROR_LVALUE;
-	}
-
-	return m_SETTINGS[joint_id].HOME;
-}
-
-
-bool PLEN2::JointController::setMinAngle(unsigned char joint_id, int angle)
-{
-	#if DEBUG
-		volatile Utility::Profiler p(F("JointController::setMinAngle()"));
-	#endif
-
-	if (joint_id >= SUM)
-	{
-		#if DEBUG
-			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
-			System::debugSerial().println(static_cast<int>(joint_id));
-		#endif
-
-		return false;
-	}
-
-	if (   (angle >= m_SETTINGS[joint_id].MAX)
-		|| (angle <  ANGLE_MIN) )
-	{
-		#if DEBUG
-			System::debugSerial().print(F(">>> bad argment! : angle = "));
-			System::debugSerial().println(angle);
-		#endif
-
-		return false;
-	}
-
-
-	m_SETTINGS[joint_id].MIN = angle;
-
-	unsigned char* filler = reinterpret_cast<unsigned char*>(&(m_SETTINGS[joint_id].MIN));
-	int address_offset    = reinterpret_cast<int>(filler) - reinterpret_cast<int>(m_SETTINGS);
-
-	#if DEBUG
-		System::debugSerial().print(F(">>> address_offset : "));
-		System::debugSerial().println(address_offset);
-	#endif
-
-	ExternalFs::write(SETTINGS_HEAD_ADDRESS() + address_offset, sizeof(m_SETTINGS[joint_id].MIN), filler, fp_config);
-
-	return true;
-}
-
-
-bool PLEN2::JointController::setMaxAngle(unsigned char joint_id, int angle)
-{
-	#if DEBUG
-		volatile Utility::Profiler p(F("JointController::setMaxAngle()"));
-	#endif
-
-	if (joint_id >= SUM)
-	{
-		#if DEBUG
-			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
-			System::debugSerial().println(static_cast<int>(joint_id));
-		#endif
-
-		return false;
-	}
-
-	if (   (angle <= m_SETTINGS[joint_id].MIN)
-		|| (angle >  ANGLE_MAX) )
-	{
-		#if DEBUG
-			System::debugSerial().print(F(">>> bad argment! : angle = "));
-			System::debugSerial().println(angle);
-		#endif
-
-		return false;
-	}
-
-
-	m_SETTINGS[joint_id].MAX = angle;
-
-	unsigned char* filler = reinterpret_cast<unsigned char*>(&(m_SETTINGS[joint_id].MAX));
-	int address_offset    = reinterpret_cast<int>(filler) - reinterpret_cast<int>(m_SETTINGS);
-
-	#if DEBUG
-		System::debugSerial().print(F(">>> address_offset : "));
-		System::debugSerial().println(address_offset);
-	#endif
-
-	ExternalFs::write(SETTINGS_HEAD_ADDRESS() + address_offset, sizeof(m_SETTINGS[joint_id].MAX), filler, fp_config);
-
-	return true;
-}
-
-
-bool PLEN2::JointController::setHomeAngle(unsigned char joint_id, int angle)
-{
-	#if DEBUG
-		volatile Utility::Profiler p(F("JointController::setHomeAngle()"));
-	#endif
-
-	if (joint_id >= SUM)
-	{
-		#if DEBUG
-			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
-			System::debugSerial().println(static_cast<int>(joint_id));
-		#endif
-
-		return false;
-	}
-
-	if (   (angle < m_SETTINGS[joint_id].MIN)
-		|| (angle > m_SETTINGS[joint_id].MAX) )
-	{
-		#if DEBUG
-			System::debugSerial().print(F(">>> bad argment! : angle = "));
-			System::debugSerial().println(angle);
-		#endif
-
-		return false;
-	}
-
-
-	m_SETTINGS[joint_id].HOME = angle;
-
-	unsigned char* filler = reinterpret_cast<unsigned char*>(&(m_SETTINGS[joint_id].HOME));
-	int address_offset    = reinterpret_cast<int>(filler) - reinterpret_cast<int>(m_SETTINGS);
-
-	#if DEBUG
-		System::debugSerial().print(F(">>> address_offset : "));
-		System::debugSerial().println(address_offset);
-	#endif
-
-	ExternalFs::write(SETTINGS_HEAD_ADDRESS() + address_offset, sizeof(m_SETTINGS[joint_id].HOME), filler, fp_config);
-
-	return true;
-}
-
-//设置角度
-bool PLEN2::JointController::setAngle(unsigned char joint_id, int angle)
-{
-	#if DEBUG_HARD
-		volatile Utility::Profiler p(F("JointController::setAngle()"));
-	#endif
-
-	if (joint_id >= SUM)
-	{
-		#if DEBUG_HARD
-			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
-			System::debugSerial().println(static_cast<int>(joint_id));
-		#endif
-
-		return false;
-	}
-
-
-	angle = constrain(angle, m_SETTINGS[joint_id].MIN, m_SETTINGS[joint_id].MAX);
-	if(joint_id  == 0 || joint_id == 12)
-	{
-		#if CLOCK_WISE
-			m_pwms[joint_id] = 90 + angle / 10;
-		#else
-			m_pwms[joint_id] = 90 - angle / 10;
-		#endif
-	}
-	else
-	{
-		m_pwms[joint_id] = map(
-			angle,
-			PLEN2::JointController::ANGLE_MIN, PLEN2::JointController::ANGLE_MAX,
-
-			#if CLOCK_WISE
-				PLEN2::JointController::PWM_MIN(), PLEN2::JointController::PWM_MAX()
-			#else
-				PLEN2::JointController::PWM_MAX(), PLEN2::JointController::PWM_MIN()
-			#endif
-		);
-	}
-#if DEBUG_LESS
-	System::debugSerial().print(F(": joint_id = "));
-	System::debugSerial().print(static_cast<int>(joint_id));
-	System::debugSerial().print(F(": angle = "));
-	System::debugSerial().print(static_cast<int>(angle));
-	System::debugSerial().print(F(": pwm = "));
-	System::debugSerial().print(static_cast<int>(m_pwms[joint_id]));
-#endif
-	return true;
-}
-
-//设置角度差
-bool PLEN2::JointController::setAngleDiff(unsigned char joint_id, int angle_diff)
-{
-	#if DEBUG_HARD
-		volatile Utility::Profiler p(F("JointController::setAngleDiff()"));
-	#endif
-
-	if (joint_id >= SUM)
-	{
-		#if DEBUG_HARD
-			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
-			System::debugSerial().println(static_cast<int>(joint_id));
-		#endif
-
-		return false;
-	}
-
-
-	int angle = constrain(
-		angle_diff + m_SETTINGS[joint_id].HOME,
-		m_SETTINGS[joint_id].MIN, m_SETTINGS[joint_id].MAX
-	);
-
-	if(joint_id  == 0 || joint_id == 12)
-	{
-		#if CLOCK_WISE
-			m_pwms[joint_id] = 90 + angle / 10;
-		#else
-			m_pwms[joint_id] = 90 - angle / 10;
-		#endif
-	}
-	else
-	{
-		m_pwms[joint_id] = map(
-			angle,
-			PLEN2::JointController::ANGLE_MIN, PLEN2::JointController::ANGLE_MAX,
-
-			#if CLOCK_WISE
-				PLEN2::JointController::PWM_MIN(), PLEN2::JointController::PWM_MAX()
-			#else
-				PLEN2::JointController::PWM_MAX(), PLEN2::JointController::PWM_MIN()
-			#endif
-		);
-	}
-
-	return true;
-}
-
-
-void PLEN2::JointController::dump()
-{
-	#if DEBUG
-		volatile Utility::Profiler p(F("JointController::dump()"));
-	#endif
-	System::outputSerial().println(F("["));
-
-	for (char joint_id = 0; joint_id < SUM; joint_id++)
-	{
-		System::outputSerial().println(F("\t{"));
-
-		System::outputSerial().print(F("\t\t\"max\": "));
-		System::outputSerial().print(m_SETTINGS[joint_id].MAX);
-		System::outputSerial().println(F(","));
-
-		System::outputSerial().print(F("\t\t\"min\": "));
-		System::outputSerial().print(m_SETTINGS[joint_id].MIN);
-		System::outputSerial().println(F(","));
-
-		System::outputSerial().print(F("\t\t\"home\": "));
-		System::outputSerial().println(m_SETTINGS[joint_id].HOME);
-    tcp_server.write(m_SETTINGS[joint_id].HOME);
-
-		System::outputSerial().print(F("\t}"));
-
-		if (joint_id != (SUM - 1))
-		{
-			System::outputSerial().println(F(","));
-		}
-		else
-		{
-			System::outputSerial().println();
-		}
-	}
-
-	System::outputSerial().println(F("]"));
-	System::outputSerial().println(F("\r\n"));
-}
-
-
-/*
-	@brief Timer 1 overflow interruption vector
-
-	The interruption vector runs at the moment TCNT1 overflowed.
-	In the firmware, 16[MHz] clock source is prescaled by 64, and using 10bit mode,
-	so interruption interval is (16,000,000 / (64 * 1,024))^-1 * 1,000 = 4.096[msec].
-
-	The value is too smaller than servo's PWM acceptable interval,
-	so the firmware can control 24 servos by outputting PWM once in 8 times
-	and changing output line at each interruption timing.
-
-	@attention
-	Please add volatile prefix to all editable instance of the vector,
-	for countermeasure of optimization.
-
-	The MCU outputs PWM with double-buffering so joint selection should look ahead next joint.
-	If fail to do the procedure, controlling plural servos is not to be you intended.
-*/
-/*
- * TODO: update angle
- */
-const unsigned char servo_map[PLEN2::JointController::SUM] = {16, 7, 6, 5, 4, 3, 2, 1, 0, 18, 19, 20, 17, 8, 9, 10, 11, 12, 13, 14, 15, 21, 22, 23};
-void PLEN2::JointController::updateAngle()
-{
-    for (int joint_id = 0; joint_id < SUM; joint_id++)
-    {
-        if (servo_map[joint_id] < 16)
-	    {
-	        pwm.setPWM(servo_map[joint_id], 0, m_pwms[joint_id]);
-	    }
-        else if (servo_map[joint_id] == 16)
-        {
-           GPIO12SERVO.write(m_pwms[joint_id]);
-           
-        }
-        else if (servo_map[joint_id] == 17)
-        {
-            GPIO14SERVO.write(m_pwms[joint_id]);
-        }
-    }
-	PLEN2::JointController::m_1cycle_finished = true;
-}
-
-void PLEN2::JointController::updateEyes()
-{
-    unsigned int led_pwm = 0;
-
-
-        if (PLEN2::System::tcp_connected()||PLEN2::System::SystemSerial().available())
-        {
-            //connected
-            if (_enable&&_eye_count>0)
-            {
-             digitalWrite(Pin::LED(),LOW);
-             _eye_count--;
-             _enable=false;
-            }else if(_eye_count>0)
-            {
-              digitalWrite(Pin::LED(),HIGH);
-              _enable=true;
-              }
-
-        }
-        else if (!PLEN2::System::tcp_connected()&&!PLEN2::System::SystemSerial().available())
-        {
-        	_eye_count=3;
-        	_enable=true;
-        }
-      
-}
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+#include "Arduino.h"
+#include <Wire.h>
+#include <Servo.h>
+#include <Ticker.h>
+#include <Adafruit_PWMServoDriver.h>
+#include <ESP8266WebServer.h>
+#include "Pin.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "System.h"
+#include "JointController.h"
+#include "ExternalFs.h"
+#include "Motion.h"
+
+Adafruit_PWMServoDriver pwm;
+Servo GPIO12SERVO;
+Servo GPIO14SERVO;
+Servo EyeOut;
+Ticker flipper;
+Ticker flipper_motion;
+Ticker flipper_second;
+extern WiFiServer tcp_server;
+extern File fp_config;
+/*!
+	@note
+	If you want to apply the firmware to PLEN1.4, set the macro to false.
+*/
+#define PLEN2_JOINTCONTROLLER_PWM_OUT_00_07_REGISTER OCR1C
+#define PLEN2_JOINTCONTROLLER_PWM_OUT_08_15_REGISTER OCR1B
+#define PLEN2_JOINTCONTROLLER_PWM_OUT_16_23_REGISTER OCR1A
+
+volatile bool PLEN2::JointController::m_1cycle_finished = false;
+short PLEN2::JointController::m_indexes[PLEN2::JointController::SUM];
+unsigned long PLEN2::JointController::m_dirty_joints = 0;
+PLEN2::JointController::TargetFrame PLEN2::JointController::m_frames[PLEN2::JointController::FRAMEBUFFER_LENGTH];
+unsigned char PLEN2::JointController::m_frame_back  = 0;
+unsigned char PLEN2::JointController::m_frame_front = 1;
+volatile unsigned char PLEN2::JointController::m_frame_ready = 2;
+volatile bool PLEN2::JointController::m_frame_fresh = false;
+bool PLEN2::JointController::m_relax_pending = false;
+PLEN2::JointController::OutputProfile PLEN2::JointController::m_profiles[PLEN2::JointController::PROFILE_SUM];
+unsigned char PLEN2::JointController::m_profile_sum = 0;
+PLEN2::JointController::ActiveJoint PLEN2::JointController::m_active_joints[PLEN2::JointController::SUM];
+unsigned char PLEN2::JointController::m_active_sum = 0;
+unsigned int  PLEN2::JointController::m_output_rate_hz = 1000 / PLEN2::Motion::Frame::UPDATE_INTERVAL_MS;
+unsigned long PLEN2::JointController::m_output_last_us = 0;
+Utility::TimingStatistics PLEN2::JointController::m_output_intervals;
+Utility::TimingStatistics PLEN2::JointController::m_output_durations;
+PLEN2::JointController::SlewState PLEN2::JointController::m_slew_states[PLEN2::JointController::SUM];
+PLEN2::JointController::SlewLimit PLEN2::JointController::m_slew_limits[PLEN2::JointController::SUM];
+unsigned long PLEN2::JointController::m_slewing_joints = 0;
+unsigned long PLEN2::JointController::m_slew_resets = ~0UL;
+int PLEN2::JointController::m_output_pwms[PLEN2::JointController::SUM];
+unsigned long PLEN2::JointController::m_writes_issued  = 0;
+unsigned long PLEN2::JointController::m_writes_skipped = 0;
+
+//eyes control
+int _enable;
+int _eye_count_step;
+uint8_t _eye_count;
+
+namespace
+{
+	namespace Shared
+	{
+		using namespace PLEN2;
+
+		PROGMEM const int m_SETTINGS_INITIAL[] =
+		{
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  -40, // [01] Left : Shoulder Pitch
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  245, // [02] Left : Thigh Yaw
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  470, // [03] Left : Shoulder Roll
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -100, // [04] Left : Elbow Roll
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -205, // [05] Left : Thigh Roll
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,   50, // [06] Left : Thigh Pitch
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  445, // [07] Left : Knee Pitch
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  245, // [08] Left : Foot Pitch
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  -75, // [09] Left : Foot Roll
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL,
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL,
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL,
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,   15, // [10] Right : Shoulder Pitch
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  -70, // [11] Right : Thigh Yaw
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -390, // [12] Right : Shoulder Roll
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  250, // [13] Right : Elbow Roll
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,  195, // [14] Right : Thigh Roll
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -105, // [15] Right : Thigh Pitch
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -510, // [16] Right : Knee Pitch
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, -305, // [17] Right : Foot Pitch
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,   60, // [18] Right : Foot Roll
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL,
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL,
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::ANGLE_NEUTRAL
+		};
+
+		/*!
+			@brief Default channel map
+
+			Pairs of output kind and channel. (GPIO servo's channel 0 is GPIO12, 1 is GPIO14.)
+		*/
+		PROGMEM const unsigned char m_CHANNELS_INITIAL[] =
+		{
+			JointController::OUTPUT_GPIO_SERVO,  0, // [01] Left : Shoulder Pitch
+			JointController::OUTPUT_PCA9685,     7, // [02] Left : Thigh Yaw
+			JointController::OUTPUT_PCA9685,     6, // [03] Left : Shoulder Roll
+			JointController::OUTPUT_PCA9685,     5, // [04] Left : Elbow Roll
+			JointController::OUTPUT_PCA9685,     4, // [05] Left : Thigh Roll
+			JointController::OUTPUT_PCA9685,     3, // [06] Left : Thigh Pitch
+			JointController::OUTPUT_PCA9685,     2, // [07] Left : Knee Pitch
+			JointController::OUTPUT_PCA9685,     1, // [08] Left : Foot Pitch
+			JointController::OUTPUT_PCA9685,     0, // [09] Left : Foot Roll
+			JointController::OUTPUT_NONE,        0,
+			JointController::OUTPUT_NONE,        0,
+			JointController::OUTPUT_NONE,        0,
+			JointController::OUTPUT_GPIO_SERVO,  1, // [10] Right : Shoulder Pitch
+			JointController::OUTPUT_PCA9685,     8, // [11] Right : Thigh Yaw
+			JointController::OUTPUT_PCA9685,     9, // [12] Right : Shoulder Roll
+			JointController::OUTPUT_PCA9685,    10, // [13] Right : Elbow Roll
+			JointController::OUTPUT_PCA9685,    11, // [14] Right : Thigh Roll
+			JointController::OUTPUT_PCA9685,    12, // [15] Right : Thigh Pitch
+			JointController::OUTPUT_PCA9685,    13, // [16] Right : Knee Pitch
+			JointController::OUTPUT_PCA9685,    14, // [17] Right : Foot Pitch
+			JointController::OUTPUT_PCA9685,    15, // [18] Right : Foot Roll
+			JointController::OUTPUT_NONE,        0,
+			JointController::OUTPUT_NONE,        0,
+			JointController::OUTPUT_NONE,        0
+		};
+
+		//! @brief Output range of GPIO servos (degree)
+		const short GPIO_SERVO_MIN = 10;
+		const short GPIO_SERVO_MAX = 170;
+
+		const int ERROR_LVALUE = -32768;
+
+		const JointController::ChannelSetting ERROR_CHANNEL = { JointController::OUTPUT_NONE, 0, 1, 0, 0, 0 };
+
+		Servo* const GPIO_SERVOS[JointController::GPIO_SERVO_SUM] = { &GPIO12SERVO, &GPIO14SERVO };
+		const int GPIO_SERVO_PINS[JointController::GPIO_SERVO_SUM] = { Pin::PWM_OUT_12(), Pin::PWM_OUT_14() };
+
+		/*!
+			@brief Integer square root (floor)
+		*/
+		unsigned long squareRoot(unsigned long long value)
+		{
+			unsigned long long root = 0;
+			unsigned long long bit  = 1ULL << 62;
+
+			while (bit > value)
+			{
+				bit >>= 2;
+			}
+
+			while (bit != 0)
+			{
+				if (value >= root + bit)
+				{
+					value -= root + bit;
+					root   = (root >> 1) + bit;
+				}
+				else
+				{
+					root >>= 1;
+				}
+
+				bit >>= 2;
+			}
+
+			return root;
+		}
+
+		void defaultChannel(unsigned char joint_id, JointController::ChannelSetting& channel)
+		{
+			channel.KIND      = pgm_read_byte(m_CHANNELS_INITIAL + joint_id * 2);
+			channel.CHANNEL   = pgm_read_byte(m_CHANNELS_INITIAL + joint_id * 2 + 1);
+			channel.DIRECTION = CLOCK_WISE? 1 : -1;
+			channel.RESERVED  = 0;
+
+			if (channel.KIND == JointController::OUTPUT_GPIO_SERVO)
+			{
+				channel.PWM_MIN = GPIO_SERVO_MIN;
+				channel.PWM_MAX = GPIO_SERVO_MAX;
+			}
+			else
+			{
+				channel.PWM_MIN = JointController::PWM_MIN();
+				channel.PWM_MAX = JointController::PWM_MAX();
+			}
+		}
+
+		const unsigned long ALL_JOINTS = (1UL << JointController::SUM) - 1;
+	}
+}
+
+
+void PLEN2::JointController::Init()
+{
+	pwm = Adafruit_PWMServoDriver();
+
+    pinMode(Pin::PCA9685_ENABLE(), OUTPUT);
+    digitalWrite(Pin::PCA9685_ENABLE(), LOW);
+    pinMode(Pin::LED(),OUTPUT);
+    digitalWrite(Pin::LED(),HIGH);
+    GPIO12SERVO.attach(Pin::PWM_OUT_12());
+    GPIO14SERVO.attach(Pin::PWM_OUT_14());
+    _enable = true;
+    _eye_count = 3;
+  //  EyeOut.attach(Pin::LED_OUT(), 200, 15000);
+//
+//    pinMode(Pin::PCA9685_ENABLE(), OUTPUT);
+//    digitalWrite(Pin::PCA9685_ENABLE(), LOW);
+
+    // Initialize I2C
+    Wire.begin(4, 5);
+
+    // PWMServoDriver
+    pwm.begin();
+    pwm.setPWMFreq(PWM_FREQ());   // servos run at 300Hz updates
+    Wire.setClock(PCA9685::I2C_CLOCK());
+
+    delay(500);
+
+	m_defaultChannels();
+	m_applyChannels();
+	m_defaultSettings();
+    
+	for (char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		m_calibrate(joint_id);
+	}
+
+	m_dirty_joints = Shared::ALL_JOINTS;
+	applyHomePose();
+}
+PLEN2::JointController::JointController()
+	: m_dirty_settings(0)
+	, m_dirty_channels(0)
+	, m_config_formatted(false)
+	, m_settings_modified(0)
+	, m_config_writes(0)
+{
+
+}
+
+
+void PLEN2::JointController::loadSettings()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::loadSettings()"));
+	#endif
+
+	// Changes in the cache must not be lost by reading.
+	commitSettings();
+
+	unsigned char init_flag = ExternalFs::readByte(INIT_FLAG_ADDRESS(), fp_config);
+
+	if (   (init_flag != INIT_FLAG_VALUE())
+		&& (init_flag != UNCHECKED_INIT_FLAG_VALUE()) )
+	{
+		/*!
+			@note
+			A formatting torn between the checksum and the flags leaves the valid settings
+			without the flag, so they are carried over as unchecked. (Refer to commitSettings().)
+		*/
+		ExternalFs::read(SETTINGS_HEAD_ADDRESS(), sizeof(m_SETTINGS), reinterpret_cast<unsigned char*>(m_SETTINGS), fp_config);
+		ExternalFs::read(CHANNELS_HEAD_ADDRESS(), sizeof(m_CHANNELS), reinterpret_cast<unsigned char*>(m_CHANNELS), fp_config);
+
+		unsigned short checksum = 0;
+		ExternalFs::read(CHECKSUM_ADDRESS(), sizeof(checksum), reinterpret_cast<unsigned char*>(&checksum), fp_config);
+
+		if (checksum == m_checksum())
+		{
+			init_flag = UNCHECKED_INIT_FLAG_VALUE();
+		}
+		else
+		{
+			m_defaultSettings();
+		}
+	}
+	
+	if (   (init_flag == INIT_FLAG_VALUE())
+		|| (init_flag == UNCHECKED_INIT_FLAG_VALUE()) )
+	{
+		ExternalFs::read(SETTINGS_HEAD_ADDRESS(), sizeof(m_SETTINGS), reinterpret_cast<unsigned char*>(m_SETTINGS), fp_config);
+
+		if (ExternalFs::readByte(CHANNELS_FLAG_ADDRESS(), fp_config) == CHANNELS_FLAG_VALUE())
+		{
+			ExternalFs::read(CHANNELS_HEAD_ADDRESS(), sizeof(m_CHANNELS), reinterpret_cast<unsigned char*>(m_CHANNELS), fp_config);
+		}
+		else
+		{
+			m_defaultChannels();
+			m_dirty_channels = Shared::ALL_JOINTS;
+		}
+
+		unsigned short checksum = 0;
+		ExternalFs::read(CHECKSUM_ADDRESS(), sizeof(checksum), reinterpret_cast<unsigned char*>(&checksum), fp_config);
+
+		if (init_flag == UNCHECKED_INIT_FLAG_VALUE())
+		{
+			// The settings are carried over, and the checksum is written for them.
+			m_dirty_settings = Shared::ALL_JOINTS;
+			m_dirty_channels = Shared::ALL_JOINTS;
+
+			System::debugSerial().println(F("read config"));
+		}
+		else if ((m_dirty_channels == 0) && (checksum != m_checksum()))
+		{
+			m_defaultSettings();
+			m_defaultChannels();
+			m_dirty_settings = Shared::ALL_JOINTS;
+			m_dirty_channels = Shared::ALL_JOINTS;
+
+			System::debugSerial().println(F("broken config, reset config\n"));
+		}
+		else
+		{
+			m_config_formatted = true;
+
+			System::debugSerial().println(F("read config"));
+		}
+	}
+	else
+	{
+		if (init_flag == LEGACY_INIT_FLAG_VALUE())
+		{
+			/*!
+				@note
+				The former settings have only min, max and home angles,
+				so they are carried over and the slew limits are left unlimited.
+			*/
+			int legacy_setting[3];
+
+			for (char joint_id = 0; joint_id < SUM; joint_id++)
+			{
+				ExternalFs::read(SETTINGS_HEAD_ADDRESS() + joint_id * sizeof(legacy_setting), sizeof(legacy_setting),
+					reinterpret_cast<unsigned char*>(legacy_setting), fp_config);
+
+				m_SETTINGS[joint_id].MIN  = legacy_setting[0];
+				m_SETTINGS[joint_id].MAX  = legacy_setting[1];
+				m_SETTINGS[joint_id].HOME = legacy_setting[2];
+			}
+		}
+
+		// The layout is changed, so the channel map after the settings is not valid.
+		m_defaultChannels();
+		m_dirty_settings = Shared::ALL_JOINTS;
+		m_dirty_channels = Shared::ALL_JOINTS;
+
+		System::debugSerial().println(F("reset config\n"));
+	}
+
+	commitSettings();
+
+	m_applyChannels();
+
+	for (char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		m_calibrate(joint_id);
+	}
+
+	m_dirty_joints = Shared::ALL_JOINTS;
+	applyHomePose();
+
+    flipper.attach_ms(1000 / m_output_rate_hz, PLEN2::JointController::updateAngle);
+    flipper_motion.attach_ms(Motion::Frame::UPDATE_INTERVAL_MS, PLEN2::JointController::m_motionTick);
+    flipper_second.attach(1, PLEN2::JointController::updateEyes);
+}
+
+
+void PLEN2::JointController::resetSettings()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::resetSettings()"));
+	#endif
+
+	m_defaultSettings();
+
+	for (char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		m_calibrate(joint_id);
+	}
+
+	applyHomePose();
+
+	m_dirty_settings = Shared::ALL_JOINTS;
+	commitSettings();
+}
+
+
+const int& PLEN2::JointController::getMinAngle(unsigned char joint_id)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::getMinAngle()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return Shared::ERROR_LVALUE;
+	}
+
+	return m_SETTINGS[joint_id].MIN;
+}
+
+
+const int& PLEN2::JointController::getMaxAngle(unsigned char joint_id)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::getMaxAngle()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return Shared::ERROR_LVALUE;
+	}
+
+	return m_SETTINGS[joint_id].MAX;
+}
+
+
+const int& PLEN2::JointController::getHomeAngle(unsigned char joint_id)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::getHomeAngle()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return Shared::ERROR_LVALUE;
+	}
+
+	return m_SETTINGS[joint_id].HOME;
+}
+
+
+bool PLEN2::JointController::setMinAngle(unsigned char joint_id, int angle)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::setMinAngle()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return false;
+	}
+
+	if (   (angle >= m_SETTINGS[joint_id].MAX)
+		|| (angle <  ANGLE_MIN) )
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : angle = "));
+			System::debugSerial().println(angle);
+		#endif
+
+		return false;
+	}
+
+
+	m_SETTINGS[joint_id].MIN = angle;
+	m_calibrate(joint_id);
+	m_markSetting(joint_id);
+
+	return true;
+}
+
+
+bool PLEN2::JointController::setMaxAngle(unsigned char joint_id, int angle)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::setMaxAngle()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return false;
+	}
+
+	if (   (angle <= m_SETTINGS[joint_id].MIN)
+		|| (angle >  ANGLE_MAX) )
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : angle = "));
+			System::debugSerial().println(angle);
+		#endif
+
+		return false;
+	}
+
+
+	m_SETTINGS[joint_id].MAX = angle;
+	m_calibrate(joint_id);
+	m_markSetting(joint_id);
+
+	return true;
+}
+
+
+bool PLEN2::JointController::setHomeAngle(unsigned char joint_id, int angle)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::setHomeAngle()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return false;
+	}
+
+	if (   (angle < m_SETTINGS[joint_id].MIN)
+		|| (angle > m_SETTINGS[joint_id].MAX) )
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : angle = "));
+			System::debugSerial().println(angle);
+		#endif
+
+		return false;
+	}
+
+
+	m_SETTINGS[joint_id].HOME = angle;
+	m_calibrate(joint_id);
+	m_markSetting(joint_id);
+
+	return true;
+}
+
+
+const int& PLEN2::JointController::getSpeedLimit(unsigned char joint_id)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::getSpeedLimit()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return Shared::ERROR_LVALUE;
+	}
+
+	return m_SETTINGS[joint_id].SPEED;
+}
+
+
+const int& PLEN2::JointController::getAccelLimit(unsigned char joint_id)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::getAccelLimit()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return Shared::ERROR_LVALUE;
+	}
+
+	return m_SETTINGS[joint_id].ACCEL;
+}
+
+
+bool PLEN2::JointController::setSpeedLimit(unsigned char joint_id, int speed)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::setSpeedLimit()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return false;
+	}
+
+	if (   (speed < 0)
+		|| (speed > SPEED_LIMIT_MAX()) )
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : speed = "));
+			System::debugSerial().println(speed);
+		#endif
+
+		return false;
+	}
+
+
+	m_SETTINGS[joint_id].SPEED = speed;
+	m_calibrate(joint_id);
+	m_markSetting(joint_id);
+
+	return true;
+}
+
+
+bool PLEN2::JointController::setAccelLimit(unsigned char joint_id, int accel)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::setAccelLimit()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return false;
+	}
+
+	if (   (accel < 0)
+		|| (accel > ACCEL_LIMIT_MAX()) )
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : accel = "));
+			System::debugSerial().println(accel);
+		#endif
+
+		return false;
+	}
+
+
+	m_SETTINGS[joint_id].ACCEL = accel;
+	m_calibrate(joint_id);
+	m_markSetting(joint_id);
+
+	return true;
+}
+
+
+unsigned char PLEN2::JointController::m_findProfile(const ChannelSetting& channel, ChannelLayout& layout)
+{
+	OutputProfile profile;
+	profile.kind = channel.KIND;
+
+	if (channel.DIRECTION < 0)
+	{
+		profile.pwm_begin = channel.PWM_MAX;
+		profile.pwm_end   = channel.PWM_MIN;
+	}
+	else
+	{
+		profile.pwm_begin = channel.PWM_MIN;
+		profile.pwm_end   = channel.PWM_MAX;
+	}
+
+	for (unsigned char index = 0; index < layout.profile_sum; index++)
+	{
+		if (   (layout.profiles[index].kind      == profile.kind)
+			&& (layout.profiles[index].pwm_begin == profile.pwm_begin)
+			&& (layout.profiles[index].pwm_end   == profile.pwm_end) )
+		{
+			return index;
+		}
+	}
+
+	if (layout.profile_sum == PROFILE_SUM)
+	{
+		return PROFILE_SUM;
+	}
+
+	const long range = static_cast<long>(profile.pwm_end) - profile.pwm_begin;
+
+	profile.falling = (range < 0);
+	profile.slope   = ((static_cast<unsigned long long>(abs(range)) << SLOPE_FRACTION_BITS) + (ANGLE_MAX - ANGLE_MIN) - 1)
+		/ (ANGLE_MAX - ANGLE_MIN);
+
+	if (profile.kind == OUTPUT_GPIO_SERVO)
+	{
+		/*!
+			@note
+			The shoulders have been output as 90 +/- angle / 10 degree,
+			which rounds toward the center, but map() rounds toward ANGLE_MIN.
+		*/
+		profile.origin = (profile.pwm_begin + profile.pwm_end) / 2;
+		profile.pivot  = -ANGLE_MIN;
+	}
+	else
+	{
+		profile.origin = profile.pwm_begin;
+		profile.pivot  = 0;
+	}
+
+	layout.profiles[layout.profile_sum] = profile;
+
+	return layout.profile_sum++;
+}
+
+
+int PLEN2::JointController::m_pwm(const OutputProfile& profile, short index)
+{
+	const int offset = index - profile.pivot;
+	const int step   = (static_cast<unsigned long long>(abs(offset)) * profile.slope) >> SLOPE_FRACTION_BITS;
+
+	return ((offset < 0) != profile.falling)? (profile.origin - step) : (profile.origin + step);
+}
+
+
+void PLEN2::JointController::m_layoutChannels(const ChannelSetting channels[SUM], ChannelLayout& layout)
+{
+	unsigned int  pca9685_used    = 0;
+	unsigned char gpio_servo_used = 0;
+
+	layout.profile_sum = 0;
+
+	for (unsigned char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		const ChannelSetting& channel = channels[joint_id];
+
+		bool valid;
+		int  range_max;
+
+		switch (channel.KIND)
+		{
+			case OUTPUT_PCA9685:
+			{
+				valid     = (channel.CHANNEL < PCA9685::CHANNEL_SUM) && !(pca9685_used & (1U << channel.CHANNEL));
+				range_max = 4095;
+
+				break;
+			}
+
+			case OUTPUT_GPIO_SERVO:
+			{
+				valid     = (channel.CHANNEL < GPIO_SERVO_SUM) && !(gpio_servo_used & (1U << channel.CHANNEL));
+				range_max = 180;
+
+				break;
+			}
+
+			default:
+			{
+				valid     = false;
+				range_max = 0;
+
+				break;
+			}
+		}
+
+		valid = valid
+			&& (channel.PWM_MIN >= 0) && (channel.PWM_MAX <= range_max)
+			&& (channel.PWM_MIN < channel.PWM_MAX);
+
+		const unsigned char profile = valid? m_findProfile(channel, layout) : static_cast<unsigned char>(PROFILE_SUM);
+		layout.joint_profiles[joint_id] = profile;
+
+		if (profile == PROFILE_SUM)
+		{
+			continue;
+		}
+
+		if (channel.KIND == OUTPUT_PCA9685)
+		{
+			pca9685_used |= (1U << channel.CHANNEL);
+		}
+		else
+		{
+			gpio_servo_used |= (1U << channel.CHANNEL);
+		}
+	}
+}
+
+
+void PLEN2::JointController::m_applyChannels()
+{
+	ChannelLayout layout;
+	m_layoutChannels(m_CHANNELS, layout);
+
+	for (unsigned char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		if ((layout.joint_profiles[joint_id] == PROFILE_SUM) && (m_CHANNELS[joint_id].KIND != OUTPUT_NONE))
+		{
+			#if DEBUG
+				System::debugSerial().print(F(">>> bad channel! : joint_id = "));
+				System::debugSerial().println(static_cast<int>(joint_id));
+			#endif
+
+			// The cache must match the file that the checksum is written for.
+			m_CHANNELS[joint_id].KIND = OUTPUT_NONE;
+			m_markChannel(joint_id);
+		}
+	}
+
+	ActiveJoint active_joints[SUM];
+	unsigned char active_sum = 0;
+
+	for (unsigned char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		const unsigned char profile = layout.joint_profiles[joint_id];
+
+		if (profile == PROFILE_SUM)
+		{
+			m_calibration[joint_id].profile = 0;
+
+			continue;
+		}
+
+		m_calibration[joint_id].profile = profile;
+
+		ActiveJoint& active_joint = active_joints[active_sum++];
+		active_joint.joint_id = joint_id;
+		active_joint.kind     = m_CHANNELS[joint_id].KIND;
+		active_joint.channel  = m_CHANNELS[joint_id].CHANNEL;
+		active_joint.profile  = profile;
+	}
+
+	/*!
+		@note
+		The output vector reads the active joints and the profiles,
+		so they are planned before and only copied while it must not run.
+	*/
+	noInterrupts();
+
+	memcpy(m_profiles, layout.profiles, sizeof(m_profiles));
+	memcpy(m_active_joints, active_joints, sizeof(m_active_joints));
+	m_profile_sum = layout.profile_sum;
+	m_active_sum  = active_sum;
+
+	m_slew_resets = ~0UL;
+
+	interrupts();
+}
+
+
+void PLEN2::JointController::m_calibrate(unsigned char joint_id)
+{
+	JointCalibration& calibration = m_calibration[joint_id];
+
+	/*!
+		@note
+		The settings might be read from a broken file,
+		so the indexes are trimmed not to run over the range of the outputs.
+	*/
+	calibration.index_min  = constrain(m_SETTINGS[joint_id].MIN  - ANGLE_MIN, 0, ANGLE_RANGE - 1);
+	calibration.index_max  = constrain(m_SETTINGS[joint_id].MAX  - ANGLE_MIN, 0, ANGLE_RANGE - 1);
+	calibration.index_home = m_SETTINGS[joint_id].HOME - ANGLE_MIN;
+
+	SlewLimit& limit = m_slew_limits[joint_id];
+
+	limit.speed = constrain(m_SETTINGS[joint_id].SPEED, 0, SPEED_LIMIT_MAX());
+	limit.accel = constrain(m_SETTINGS[joint_id].ACCEL, 0, ACCEL_LIMIT_MAX());
+	m_scaleSlewLimit(joint_id);
+}
+
+
+void PLEN2::JointController::m_scaleSlewLimit(unsigned char joint_id)
+{
+	SlewLimit& limit = m_slew_limits[joint_id];
+	const unsigned long long rate = m_output_rate_hz;
+
+	/*!
+		@note
+		A limit never rounds down to 0, because 0 means unlimited.
+	*/
+	limit.velocity_max     = (static_cast<unsigned long long>(limit.speed) << SLEW_FRACTION_BITS) / rate;
+	limit.acceleration_max = (static_cast<unsigned long long>(limit.accel) << SLEW_FRACTION_BITS) / (rate * rate);
+
+	if ((limit.speed != 0) && (limit.velocity_max == 0))
+	{
+		limit.velocity_max = 1;
+	}
+
+	if ((limit.accel != 0) && (limit.acceleration_max == 0))
+	{
+		limit.acceleration_max = 1;
+	}
+}
+
+
+void PLEN2::JointController::m_storeIndex(unsigned char joint_id, short index)
+{
+	if (m_indexes[joint_id] != index)
+	{
+		m_indexes[joint_id] = index;
+		m_dirty_joints |= (1UL << joint_id);
+	}
+}
+
+
+//设置角度
+bool PLEN2::JointController::setAngle(unsigned char joint_id, int angle)
+{
+	TRACE_SCOPE("JointController::setAngle()");
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG_HARD
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return false;
+	}
+
+
+	const JointCalibration& calibration = m_calibration[joint_id];
+	int index = constrain(angle - ANGLE_MIN, calibration.index_min, calibration.index_max);
+
+	m_storeIndex(joint_id, index);
+
+#if DEBUG_LESS
+	System::debugSerial().print(F(": joint_id = "));
+	System::debugSerial().print(static_cast<int>(joint_id));
+	System::debugSerial().print(F(": angle = "));
+	System::debugSerial().print(index + ANGLE_MIN);
+	System::debugSerial().print(F(": pwm = "));
+	System::debugSerial().print(m_pwm(m_profiles[calibration.profile], index));
+#endif
+	return true;
+}
+
+//设置角度差
+bool PLEN2::JointController::setAngleDiff(unsigned char joint_id, int angle_diff)
+{
+	TRACE_SCOPE("JointController::setAngleDiff()");
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG_HARD
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return false;
+	}
+
+
+	m_storeIndex(joint_id, angleDiffIndex(joint_id, angle_diff));
+
+	return true;
+}
+
+
+short PLEN2::JointController::angleDiffIndex(unsigned char joint_id, int angle_diff) const
+{
+	const JointCalibration& calibration = m_calibration[joint_id];
+
+	return constrain(angle_diff + calibration.index_home, calibration.index_min, calibration.index_max);
+}
+
+
+bool PLEN2::JointController::setIndex(unsigned char joint_id, short index)
+{
+	if (joint_id >= SUM)
+	{
+		#if DEBUG_HARD
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return false;
+	}
+
+	m_storeIndex(joint_id, index);
+
+	return true;
+}
+
+
+const PLEN2::JointController::ChannelSetting& PLEN2::JointController::getChannel(unsigned char joint_id)
+{
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return Shared::ERROR_CHANNEL;
+	}
+
+	return m_CHANNELS[joint_id];
+}
+
+
+bool PLEN2::JointController::setChannel(unsigned char joint_id, const ChannelSetting& channel)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::setChannel()"));
+	#endif
+
+	if (joint_id >= SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : joint_id = "));
+			System::debugSerial().println(static_cast<int>(joint_id));
+		#endif
+
+		return false;
+	}
+
+	/*!
+		@note
+		The map is laid out with the setting before anything is changed,
+		because a conflict or a full pool drops the output of another joint too, not only of this one.
+	*/
+	ChannelSetting channels[SUM];
+	ChannelLayout  layout;
+
+	memcpy(channels, m_CHANNELS, sizeof(channels));
+	channels[joint_id] = channel;
+	m_layoutChannels(channels, layout);
+
+	for (unsigned char index = 0; index < SUM; index++)
+	{
+		const bool output = (layout.joint_profiles[index] != PROFILE_SUM);
+
+		if (output != (channels[index].KIND != OUTPUT_NONE))
+		{
+			#if DEBUG
+				System::debugSerial().print(F(">>> bad channel! : joint_id = "));
+				System::debugSerial().println(static_cast<int>(index));
+			#endif
+
+			return false;
+		}
+	}
+
+	m_CHANNELS[joint_id] = channel;
+	m_applyChannels();
+
+	setAngle(joint_id, m_SETTINGS[joint_id].HOME);
+	m_dirty_joints |= (1UL << joint_id);
+	publish();
+
+	m_markChannel(joint_id);
+
+	return true;
+}
+
+
+void PLEN2::JointController::resetChannels()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::resetChannels()"));
+	#endif
+
+	m_defaultChannels();
+	m_applyChannels();
+
+	m_dirty_joints = Shared::ALL_JOINTS;
+	applyHomePose();
+
+	m_dirty_channels = Shared::ALL_JOINTS;
+	commitSettings();
+}
+
+
+bool PLEN2::JointController::commitSettings()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::commitSettings()"));
+	#endif
+
+	if ((m_dirty_settings == 0) && (m_dirty_channels == 0))
+	{
+		return false;
+	}
+
+	m_writeDirty(m_dirty_settings, SETTINGS_HEAD_ADDRESS(),
+		reinterpret_cast<const unsigned char*>(m_SETTINGS), sizeof(JointSetting));
+	m_writeDirty(m_dirty_channels, CHANNELS_HEAD_ADDRESS(),
+		reinterpret_cast<const unsigned char*>(m_CHANNELS), sizeof(ChannelSetting));
+
+	/*!
+		@note
+		The checksum is written last, so a writing torn before it is detected by loadSettings().
+	*/
+	const unsigned short checksum = m_checksum();
+	m_writeConfig(CHECKSUM_ADDRESS(), sizeof(checksum), reinterpret_cast<const unsigned char*>(&checksum));
+
+	/*!
+		@note
+		The flags are written after the checksum, so a formatting torn before them
+		leaves the former flag, and loadSettings() formats the config file again.
+	*/
+	if (!m_config_formatted)
+	{
+		const unsigned char init_flag     = INIT_FLAG_VALUE();
+		const unsigned char channels_flag = CHANNELS_FLAG_VALUE();
+
+		m_writeConfig(CHANNELS_FLAG_ADDRESS(), sizeof(channels_flag), &channels_flag);
+		m_writeConfig(INIT_FLAG_ADDRESS(), sizeof(init_flag), &init_flag);
+		m_config_formatted = true;
+	}
+
+	m_dirty_settings = 0;
+	m_dirty_channels = 0;
+
+	return true;
+}
+
+
+void PLEN2::JointController::updateSettings()
+{
+	if (   ((m_dirty_settings != 0) || (m_dirty_channels != 0))
+		&& (millis() - m_settings_modified >= COMMIT_DELAY_MS()) )
+	{
+		commitSettings();
+	}
+}
+
+
+unsigned long PLEN2::JointController::configWrites()
+{
+	return m_config_writes;
+}
+
+
+void PLEN2::JointController::m_defaultSettings()
+{
+	for (char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		m_SETTINGS[joint_id].MIN   = Shared::m_SETTINGS_INITIAL[joint_id * 3];
+		m_SETTINGS[joint_id].MAX   = Shared::m_SETTINGS_INITIAL[joint_id * 3 + 1];
+		m_SETTINGS[joint_id].HOME  = Shared::m_SETTINGS_INITIAL[joint_id * 3 + 2];
+		m_SETTINGS[joint_id].SPEED = 0;
+		m_SETTINGS[joint_id].ACCEL = 0;
+	}
+}
+
+
+void PLEN2::JointController::m_defaultChannels()
+{
+	for (char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		Shared::defaultChannel(joint_id, m_CHANNELS[joint_id]);
+	}
+}
+
+
+void PLEN2::JointController::m_markSetting(unsigned char joint_id)
+{
+	m_dirty_settings   |= (1UL << joint_id);
+	m_settings_modified = millis();
+}
+
+
+void PLEN2::JointController::m_markChannel(unsigned char joint_id)
+{
+	m_dirty_channels   |= (1UL << joint_id);
+	m_settings_modified = millis();
+}
+
+
+void PLEN2::JointController::m_writeDirty(
+	unsigned long dirty_joints,
+	int head_address,
+	const unsigned char entries[],
+	unsigned int entry_size
+)
+{
+	if (dirty_joints == 0)
+	{
+		return;
+	}
+
+	unsigned char joint_begin = 0;
+	unsigned char joint_end   = SUM;
+
+	while (!(dirty_joints & (1UL << joint_begin)))
+	{
+		joint_begin++;
+	}
+
+	while (!(dirty_joints & (1UL << (joint_end - 1))))
+	{
+		joint_end--;
+	}
+
+	m_writeConfig(head_address + joint_begin * entry_size, (joint_end - joint_begin) * entry_size, entries + joint_begin * entry_size);
+}
+
+
+void PLEN2::JointController::m_writeConfig(int address, unsigned int size, const unsigned char data[])
+{
+	ExternalFs::write(address, size, data, fp_config);
+	m_config_writes++;
+}
+
+
+unsigned short PLEN2::JointController::m_checksum()
+{
+	unsigned short crc = 0xFFFF;
+
+	const unsigned char* blocks[] = {
+		reinterpret_cast<const unsigned char*>(m_SETTINGS),
+		reinterpret_cast<const unsigned char*>(m_CHANNELS)
+	};
+	const unsigned int block_sizes[] = { sizeof(m_SETTINGS), sizeof(m_CHANNELS) };
+
+	for (int block = 0; block < 2; block++)
+	{
+		for (unsigned int index = 0; index < block_sizes[block]; index++)
+		{
+			crc ^= static_cast<unsigned short>(blocks[block][index]) << 8;
+
+			for (int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc & 0x8000)? ((crc << 1) ^ 0x1021) : (crc << 1);
+			}
+		}
+	}
+
+	return crc;
+}
+
+
+unsigned char PLEN2::JointController::activeJointSum()
+{
+	return m_active_sum;
+}
+
+
+void PLEN2::JointController::applyHomePose()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::applyHomePose()"));
+	#endif
+
+	for (unsigned char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		const JointCalibration& calibration = m_calibration[joint_id];
+
+		m_storeIndex(joint_id, constrain(calibration.index_home, calibration.index_min, calibration.index_max));
+	}
+
+	publish();
+}
+
+
+void PLEN2::JointController::applyPose(const int angles[SUM])
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::applyPose()"));
+	#endif
+
+	for (unsigned char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		const JointCalibration& calibration = m_calibration[joint_id];
+
+		m_storeIndex(joint_id, constrain(angles[joint_id] - ANGLE_MIN, calibration.index_min, calibration.index_max));
+	}
+
+	publish();
+}
+
+
+void PLEN2::JointController::relaxAll()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::relaxAll()"));
+	#endif
+
+	/*!
+		@note
+		The changes not published yet are kept for the next frame,
+		and the next frame outputs all joints because they are turned off.
+	*/
+	const unsigned long dirty_joints = m_dirty_joints;
+
+	m_dirty_joints   = 0;
+	m_relax_pending  = true;
+	publish();
+
+	m_dirty_joints = dirty_joints | Shared::ALL_JOINTS;
+}
+
+
+void PLEN2::JointController::dump()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("JointController::dump()"));
+	#endif
+	System::outputSerial().println(F("["));
+
+	for (char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		System::outputSerial().println(F("\t{"));
+
+		System::outputSerial().print(F("\t\t\"max\": "));
+		System::outputSerial().print(m_SETTINGS[joint_id].MAX);
+		System::outputSerial().println(F(","));
+
+		System::outputSerial().print(F("\t\t\"min\": "));
+		System::outputSerial().print(m_SETTINGS[joint_id].MIN);
+		System::outputSerial().println(F(","));
+
+		System::outputSerial().print(F("\t\t\"home\": "));
+		System::outputSerial().println(m_SETTINGS[joint_id].HOME);
+    tcp_server.write(m_SETTINGS[joint_id].HOME);
+
+		System::outputSerial().print(F("\t}"));
+
+		if (joint_id != (SUM - 1))
+		{
+			System::outputSerial().println(F(","));
+		}
+		else
+		{
+			System::outputSerial().println();
+		}
+	}
+
+	System::outputSerial().println(F("]"));
+	System::outputSerial().println(F("\r\n"));
+}
+
+
+/*!
+	@brief Write a run of PCA9685 channels by auto-increment bursts
+
+	The registers of the run are written from the first channel on in a transaction,
+	that is split only where the buffer of Wire is full.
+*/
+void PLEN2::JointController::m_burstWrite(
+	unsigned char channel_begin,
+	unsigned char channel_length,
+	const int channel_pwms[]
+)
+{
+	/*!
+		@note
+		A transaction carries the register address (= 1 byte) and 4 bytes per channel,
+		so the channels sent at once are limited by the buffer size of Wire.
+	*/
+	enum { BURST_CHANNELS = (BUFFER_LENGTH - 1) / PCA9685::CHANNEL_BYTES };
+
+	while (channel_length > 0)
+	{
+		unsigned char burst_length = (channel_length < BURST_CHANNELS)?
+			channel_length : static_cast<unsigned char>(BURST_CHANNELS);
+
+		Wire.beginTransmission(PCA9685::ADDRESS());
+		Wire.write(PCA9685::LED0_ON_L() + PCA9685::CHANNEL_BYTES * channel_begin);
+
+		for (unsigned char index = 0; index < burst_length; index++)
+		{
+			Wire.write(0);    // ON_L
+			Wire.write(0);    // ON_H
+			Wire.write(lowByte(channel_pwms[index]));  // OFF_L
+			Wire.write(highByte(channel_pwms[index])); // OFF_H
+		}
+
+		Wire.endTransmission();
+
+		channel_begin  += burst_length;
+		channel_length -= burst_length;
+		channel_pwms   += burst_length;
+	}
+}
+
+
+void PLEN2::JointController::publish()
+{
+	TRACE_SCOPE("JointController::publish()");
+
+	TargetFrame& frame = m_frames[m_frame_back];
+
+	memcpy(frame.indexes, m_indexes, sizeof(frame.indexes));
+	frame.dirty_joints = m_dirty_joints;
+	frame.relax        = m_relax_pending;
+	m_dirty_joints  = 0;
+	m_relax_pending = false;
+
+	/*!
+		@note
+		Only exchanging the indexes needs to be atomic, and it takes a few instructions.
+		If the vector has not taken the ready frame, its changes are carried over to the new frame,
+		because the vector will never see the frame. (A relaxing frame discards them.)
+	*/
+	noInterrupts();
+
+	if (m_frame_fresh && !frame.relax)
+	{
+		frame.dirty_joints |= m_frames[m_frame_ready].dirty_joints;
+		frame.relax        |= m_frames[m_frame_ready].relax;
+	}
+
+	m_frame_back  = m_frame_ready;
+	m_frame_ready = &frame - m_frames;
+	m_frame_fresh = true;
+
+	interrupts();
+}
+
+
+void PLEN2::JointController::updateAngle()
+{
+	TRACE_SCOPE("JointController::updateAngle()");
+
+	const unsigned long begin_us = micros();
+
+	if (m_output_last_us != 0)
+	{
+		m_output_intervals.sample(begin_us - m_output_last_us);
+	}
+
+	m_output_last_us = begin_us;
+
+	int channel_pwms[PCA9685::CHANNEL_SUM];
+	unsigned int channel_mask = 0;
+	unsigned long dirty_joints = 0;
+	bool relax = false;
+
+	noInterrupts();
+
+	if (m_frame_fresh)
+	{
+		unsigned char frame_index = m_frame_ready;
+
+		m_frame_ready = m_frame_front;
+		m_frame_front = frame_index;
+		m_frame_fresh = false;
+
+		dirty_joints = m_frames[m_frame_front].dirty_joints;
+		relax        = m_frames[m_frame_front].relax;
+	}
+
+	interrupts();
+
+	if (relax)
+	{
+		m_relaxOutputs();
+	}
+
+	const short* targets = m_frames[m_frame_front].indexes;
+
+	/*!
+		@note
+		Joints still slewing are advanced even if their targets are not changed.
+		A dirty joint is always written, so the output is refreshed after settings are applied.
+	*/
+	const unsigned long updated_joints = dirty_joints | m_slewing_joints;
+
+	for (unsigned char index = 0; index < m_active_sum; index++)
+	{
+		const ActiveJoint& active_joint = m_active_joints[index];
+		const unsigned long joint_bit = 1UL << active_joint.joint_id;
+
+		if (!(updated_joints & joint_bit))
+		{
+			m_writes_skipped++;
+
+			continue;
+		}
+
+		const int pwm = m_pwm(m_profiles[active_joint.profile], m_slew(active_joint.joint_id, targets[active_joint.joint_id]));
+
+		if (!(dirty_joints & joint_bit) && (pwm == m_output_pwms[active_joint.joint_id]))
+		{
+			m_writes_skipped++;
+
+			continue;
+		}
+
+		m_output_pwms[active_joint.joint_id] = pwm;
+		m_writes_issued++;
+
+		if (active_joint.kind == OUTPUT_PCA9685)
+		{
+			channel_pwms[active_joint.channel] = pwm;
+			channel_mask |= (1U << active_joint.channel);
+		}
+		else
+		{
+			Servo& servo = *Shared::GPIO_SERVOS[active_joint.channel];
+
+			if (!servo.attached())
+			{
+				servo.attach(Shared::GPIO_SERVO_PINS[active_joint.channel]);
+			}
+
+			servo.write(pwm);
+		}
+	}
+
+	/*!
+		@note
+		Each run of contiguous dirty channels is sent by one auto-increment transaction,
+		so a full frame costs a transaction instead of 16 setPWM() calls, and an idle frame costs nothing.
+	*/
+	unsigned char channel = 0;
+
+	while (channel < PCA9685::CHANNEL_SUM)
+	{
+		if (!(channel_mask & (1U << channel)))
+		{
+			channel++;
+
+			continue;
+		}
+
+		unsigned char channel_begin = channel;
+
+		while ((channel < PCA9685::CHANNEL_SUM) && (channel_mask & (1U << channel)))
+		{
+			channel++;
+		}
+
+		m_burstWrite(channel_begin, channel - channel_begin, channel_pwms + channel_begin);
+	}
+
+	m_output_durations.sample(micros() - begin_us);
+}
+
+
+void PLEN2::JointController::m_relaxOutputs()
+{
+	// Setting full-off bit of ALL_LED_OFF_H turns off all channels by a transaction.
+	Wire.beginTransmission(PCA9685::ADDRESS());
+	Wire.write(PCA9685::ALL_LED_ON_L());
+	Wire.write(0);                    // ALL_LED_ON_L
+	Wire.write(0);                    // ALL_LED_ON_H
+	Wire.write(0);                    // ALL_LED_OFF_L
+	Wire.write(PCA9685::LED_FULL());  // ALL_LED_OFF_H
+	Wire.endTransmission();
+
+	for (unsigned char index = 0; index < GPIO_SERVO_SUM; index++)
+	{
+		Shared::GPIO_SERVOS[index]->detach();
+	}
+
+	// Positions of relaxed servos are unknown.
+	m_slew_resets    = ~0UL;
+	m_slewing_joints = 0;
+}
+
+
+short PLEN2::JointController::m_slew(unsigned char joint_id, short target)
+{
+	SlewState& state       = m_slew_states[joint_id];
+	const SlewLimit& limit = m_slew_limits[joint_id];
+	const unsigned long joint_bit = 1UL << joint_id;
+	const long target_fixed = static_cast<long>(target) << SLEW_FRACTION_BITS;
+
+	if (   (m_slew_resets & joint_bit)
+		|| ((limit.velocity_max == 0) && (limit.acceleration_max == 0)) )
+	{
+		state.position = target_fixed;
+		state.velocity = 0;
+		m_slew_resets    &= ~joint_bit;
+		m_slewing_joints &= ~joint_bit;
+
+		return target;
+	}
+
+	const long error    = target_fixed - state.position;
+	const long distance = (error < 0)? -error : error;
+	long speed = distance;
+
+	if ((limit.velocity_max != 0) && (speed > limit.velocity_max))
+	{
+		speed = limit.velocity_max;
+	}
+
+	if (limit.acceleration_max != 0)
+	{
+		/*!
+			@note
+			Stopping from velocity v by acceleration a in discrete steps takes v^2 / 2a + v / 2,
+			so the speed that can still stop at the target is sqrt(2ad + a^2 / 4) - a / 2.
+		*/
+		const unsigned long long acceleration = limit.acceleration_max;
+		const long braking_speed = Shared::squareRoot(
+			2ULL * acceleration * distance + ((acceleration * acceleration) >> 2)
+		) - limit.acceleration_max / 2;
+
+		if (braking_speed < speed)
+		{
+			speed = braking_speed;
+		}
+
+		state.velocity = constrain(
+			(error < 0)? -speed : speed,
+			state.velocity - limit.acceleration_max,
+			state.velocity + limit.acceleration_max
+		);
+	}
+	else
+	{
+		state.velocity = (error < 0)? -speed : speed;
+	}
+
+	// The joint arrives when the step reaches the target, so it never overshoots.
+	if ((error >= 0)? (state.velocity >= error) : (state.velocity <= error))
+	{
+		state.position = target_fixed;
+		state.velocity = 0;
+		m_slewing_joints &= ~joint_bit;
+
+		return target;
+	}
+
+	state.position += state.velocity;
+	m_slewing_joints |= joint_bit;
+
+	return constrain((state.position + (1L << (SLEW_FRACTION_BITS - 1))) >> SLEW_FRACTION_BITS, 0, ANGLE_RANGE - 1);
+}
+
+
+void PLEN2::JointController::m_motionTick()
+{
+	m_1cycle_finished = true;
+}
+
+
+unsigned long PLEN2::JointController::writesIssued()
+{
+	return m_writes_issued;
+}
+
+
+unsigned long PLEN2::JointController::writesSkipped()
+{
+	return m_writes_skipped;
+}
+
+
+bool PLEN2::JointController::setOutputRate(int rate_hz)
+{
+	if (   (rate_hz < OUTPUT_RATE_MIN())
+		|| (rate_hz > OUTPUT_RATE_MAX()) )
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment! : rate_hz = "));
+			System::debugSerial().println(rate_hz);
+		#endif
+
+		return false;
+	}
+
+	m_output_rate_hz = rate_hz;
+
+	for (unsigned char joint_id = 0; joint_id < SUM; joint_id++)
+	{
+		m_scaleSlewLimit(joint_id);
+	}
+
+	if (flipper.active())
+	{
+		flipper.attach_ms(1000 / m_output_rate_hz, PLEN2::JointController::updateAngle);
+	}
+
+	resetOutputStatistics();
+
+	return true;
+}
+
+
+unsigned int PLEN2::JointController::outputRate()
+{
+	return m_output_rate_hz;
+}
+
+
+const Utility::TimingStatistics& PLEN2::JointController::outputIntervals()
+{
+	return m_output_intervals;
+}
+
+
+const Utility::TimingStatistics& PLEN2::JointController::outputDurations()
+{
+	return m_output_durations;
+}
+
+
+void PLEN2::JointController::resetOutputStatistics()
+{
+	noInterrupts();
+
+	m_output_last_us = 0;
+	m_output_intervals.reset();
+	m_output_durations.reset();
+
+	interrupts();
+}
+
+
+void PLEN2::JointController::updateEyes()
+{
+    unsigned int led_pwm = 0;
+
+
+        if (PLEN2::System::tcp_connected()||PLEN2::System::SystemSerial().available())
+        {
+            //connected
+            if (_enable&&_eye_count>0)
+            {
+             digitalWrite(Pin::LED(),LOW);
+             _eye_count--;
+             _enable=false;
+            }else if(_eye_count>0)
+            {
+              digitalWrite(Pin::LED(),HIGH);
+              _enable=true;
+              }
+
+        }
+        else if (!PLEN2::System::tcp_connected()&&!PLEN2::System::SystemSerial().available())
+        {
+        	_eye_count=3;
+        	_enable=true;
+        }
+      
+}
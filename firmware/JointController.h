@@ -1,290 +1,947 @@
-/*!
-	@file      JointController.h
-	@brief     Management class of joints.
-	@author    Kazuyuki TAKASE
-	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
-*/
-
-#ifndef PLEN2_JOINT_CONTROLLER_H
-#define PLEN2_JOINT_CONTROLLER_H
-
-#define USE_DIGTAL_SERVO 0
-namespace PLEN2
-{
-	class JointController;
-}
-
-/*!
-	@brief Management class of joints
-
-	In Atmega32u4, one timer can output 3 PWM signals at a time.
-	The MCU can control 24 servos by connecting 3bit multiplexer in each signal output lines.
-
-	@note
-	There is information about PLEN1.4's configuration below.
-	@code
-	enum {
-		SUM = 24, //!< Summation of the servos controllable.
-
-		ANGLE_MIN     = -600, //!< Min angle of the servos.
-		ANGLE_MAX     =  600, //!< Max angle of the servos.
-		ANGLE_NEUTRAL =    0  //!< Neutral angle of the servos.
-	};
-
-	//! @brief PWM width that to make min angle
-	inline static const int PWM_MIN()     { return 492;  }
-
-	//! @brief PWM width that to make max angle
-	inline static const int PWM_MAX()     { return 816;  }
-
-	//! @brief PWM width that to make neutral angle
-	inline static const int PWM_NEUTRAL() { return 654;  }
-	@endcode
-*/
-class PLEN2::JointController
-{
-public:
-	enum {
-		SUM = 24, //!< Summation of the servos controllable.
-
-		ANGLE_MIN     = -800, //!< Min angle of the servos.
-		ANGLE_MAX     =  800, //!< Max angle of the servos.
-		ANGLE_NEUTRAL =    0  //!< Neutral angle of the servos.
-	};
-
-private:
-	//! @brief Initialized flag's address on internal EEPROM
-	inline static const int INIT_FLAG_ADDRESS()     { return 0; }
-
-	//! @brief Initialized flag's value
-	inline static const unsigned char INIT_FLAG_VALUE()       { return 2; }
-
-	//! @brief Head-address of joint settings on internal EEPROM
-	inline static const int SETTINGS_HEAD_ADDRESS() { return 1; }
-
-	/*!
-		@brief Management class of joint setting
-	*/
-	class JointSetting
-	{
-	public:
-		int MIN;  //!< Setting about min angle.
-		int MAX;  //!< Setting about max angle.
-		int HOME; //!< Setting about home angle.
-
-		/*!
-			@brief Constructor
-		*/
-		JointSetting()
-			: MIN(ANGLE_MIN)
-			, MAX(ANGLE_MAX)
-			, HOME(ANGLE_NEUTRAL)
-		{
-			// noop.
-		}
-	};
-
-	JointSetting m_SETTINGS[SUM];
-public:
-	/*!
-		@brief Management class (as namespace) of multiplexer
-
-		@note
-		The methods the class has are more accurate that there are in the namespace named Multiplexer,
-		but C++'s idiom doesn't accept syntax that described before.
-	*/
-	class Multiplexer {
-	public:
-		//! @brief Summation of multiplexers
-		inline static const int SUM()              { return 3; }
-
-		//! @brief Number of controllable lines by a multiplexer
-		inline static const int SELECTABLE_LINES() { return 8; }
-	};
-#if USE_DIGTAL_SERVO
-    inline static const int PWM_FREQ()    { return 320;  }
-
-	//! @brief PWM width that to make min angle
-	inline static const int PWM_MIN()     { return 1100;  }
-
-	//! @brief PWM width that to make max angle
-	inline static const int PWM_MAX()     { return 2700;  }
-
-	//! @brief PWM width that to make neutral angle
-	inline static const int PWM_NEUTRAL() { return 1900;  }
-#else
-    inline static const int PWM_FREQ()    { return 60;  }
-
-	//! @brief PWM width that to make min angle
-	inline static const int PWM_MIN()     { return 175;  }
-
-	//! @brief PWM width that to make max angle
-	inline static const int PWM_MAX()     { return 575;  }
-
-	//! @brief PWM width that to make neutral angle
-	inline static const int PWM_NEUTRAL() { return 375;  }
-#endif
-    
-	/*!
-		@brief Finished flag of PWM output procedure 1 cycle
-
-		@attention
-		The instance should be a private member normally.
-		It is a public member because it is only way to access from Timer 1 overflow interruption vector,
-		so you must not access it from other functions basically.
-	*/
-	volatile static bool m_1cycle_finished;
-
-	/*!
-		@brief PWM buffer
-
-		@attention
-		The instance should be a private member normally.
-		It is a public member because it is only way to access from Timer 1 overflow interruption vector,
-		so you must not access it from other functions basically.
-	*/
-	static int m_pwms[SUM];
-
-	/*!
-		@brief Constructor
-	*/
-	JointController();
-
-	void Init();
-
-	/*!
-		@brief Load the joint settings
-
-		The method reads joint settings from internal EEPROM.
-		If the EEPROM has no settings, the method also writes the default values.
-
-		@sa
-		JointController.cpp::Shared::m_SETTINGS_INITIAL
-
-		@attention
-		The method should call in constructor normally,
-		but initialized timing of any interruption is indefinite, so might get deadlock.
-		(The method uses serial communication and internal EEPROM accessing, so it happens interruption.)
-	*/
-	void loadSettings();
-
-	/*!
-		@brief Reset the joint settings
-
-		Write default settings to internal EEPROM.
-	*/
-	void resetSettings();
-
-	/*!
-		@brief Get min angle of the joint given
-
-		@param [in] joint_id Please set joint id you want to get min angle.
-
-		@return Reference of min angle a joint expressed by **joint_id** has.
-		@retval -32768 Argument error. (**joint_id** is invalid.)
-	*/
-	const int& getMinAngle(unsigned char joint_id);
-
-	/*!
-		@brief Get max angle of the joint given
-
-		@param [in] joint_id Please set joint id you want to get max angle.
-
-		@return Reference of max angle a joint expressed by **joint_id** has.
-		@retval -32768 Argument error. (**joint_id** is invalid.)
-	*/
-	const int& getMaxAngle(unsigned char joint_id);
-
-	/*!
-		@brief Get home angle of the joint given
-
-		@param [in] joint_id Please set joint id you want to get home angle.
-
-		@return Reference of home angle a joint expressed by **joint_id** has.
-		@retval -32768 Argument error. (**joint_id** is invalid.)
-	*/
-	const int& getHomeAngle(unsigned char joint_id);
-
-	/*!
-		@brief Set min angle of the joint given
-
-		@param [in] joint_id Please set joint id you want to define min angle.
-		@param [in] angle    Please set angle that has steps of degree 1/10.
-
-		@return Result
-	*/
-	bool setMinAngle(unsigned char joint_id, int angle);
-
-	/*!
-		@brief Set max angle of the joint given
-
-		@param [in] joint_id Please set joint id you want to define max angle.
-		@param [in] angle    Please set angle that has steps of degree 1/10.
-
-		@return Result
-	*/
-	bool setMaxAngle(unsigned char joint_id, int angle);
-
-	/*!
-		@brief Set home angle of the joint given
-
-		@param [in] joint_id Please set joint id you want to define home angle.
-		@param [in] angle    Please set angle that has steps of degree 1/10.
-
-		@return Result
-	*/
-	bool setHomeAngle(unsigned char joint_id, int angle);
-
-	/*!
-		@brief Set angle of the joint given
-
-		@param [in] joint_id Please set joint id you want to set angle.
-		@param [in] angle    Please set angle that has steps of degree 1/10.
-
-		@return Result
-
-		@attention
-		<b>angle</b> might not be setting actually.
-		It is setting after trimming by user defined min-max value or servo's range,
-		so please consider it when writing a unit test.
-	*/
-	bool setAngle(unsigned char joint_id, int angle);
-
-	/*!
-		@brief Set angle to "angle-diff + home-angle" of the joint given
-
-		@param [in] joint_id   Please set joint id you want to set angle-diff.
-		@param [in] angle_diff Please set angle-diff that has steps of degree 1/10.
-
-		@return Result
-
-		@attention
-		<b>angle_diff</b> might not be setting actually.
-		It is setting after trimming by user defined min-max value or servo's range,
-		so please consider it when writing a unit test.
-	*/
-	bool setAngleDiff(unsigned char joint_id, int angle_diff);
-
-	/*!
-		@brief Dump the joint settings
-
-		Output result like JSON format below.
-		@code
-		[
-			{
-				"max": <integer>,
-				"min": <integer>,
-				"home": <integer>
-			},
-			...
-		]
-		@endcode
-	*/
-	void dump();
-
-    static void updateAngle();
-
-    static void updateEyes();
-};
-
-#endif // PLEN2_JOINT_CONTROLLER_H
+/*!
+	@file      JointController.h
+	@brief     Management class of joints.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef PLEN2_JOINT_CONTROLLER_H
+#define PLEN2_JOINT_CONTROLLER_H
+
+#define USE_DIGTAL_SERVO 0
+
+#include "TimingStatistics.h"
+
+namespace PLEN2
+{
+	class JointController;
+}
+
+/*!
+	@brief Management class of joints
+
+	In Atmega32u4, one timer can output 3 PWM signals at a time.
+	The MCU can control 24 servos by connecting 3bit multiplexer in each signal output lines.
+
+	@note
+	There is information about PLEN1.4's configuration below.
+	@code
+	enum {
+		SUM = 24, //!< Summation of the servos controllable.
+
+		ANGLE_MIN     = -600, //!< Min angle of the servos.
+		ANGLE_MAX     =  600, //!< Max angle of the servos.
+		ANGLE_NEUTRAL =    0  //!< Neutral angle of the servos.
+	};
+
+	//! @brief PWM width that to make min angle
+	inline static const int PWM_MIN()     { return 492;  }
+
+	//! @brief PWM width that to make max angle
+	inline static const int PWM_MAX()     { return 816;  }
+
+	//! @brief PWM width that to make neutral angle
+	inline static const int PWM_NEUTRAL() { return 654;  }
+	@endcode
+*/
+class PLEN2::JointController
+{
+public:
+	enum {
+		SUM = 24, //!< Summation of the servos controllable.
+
+		ANGLE_MIN     = -800, //!< Min angle of the servos.
+		ANGLE_MAX     =  800, //!< Max angle of the servos.
+		ANGLE_NEUTRAL =    0, //!< Neutral angle of the servos.
+
+		ANGLE_RANGE = ANGLE_MAX - ANGLE_MIN + 1 //!< Count of the angles the servos can take.
+	};
+
+	/*!
+		@brief Output kinds of a joint
+	*/
+	enum {
+		OUTPUT_NONE,       //!< The joint doesn't exist.
+		OUTPUT_PCA9685,    //!< A channel of PCA9685. (Value is PWM width.)
+		OUTPUT_GPIO_SERVO, //!< A GPIO driven by Servo library. (Value is degree.)
+		OUTPUT_KIND_SUM    //!< Summation of the output kinds.
+	};
+
+	enum {
+		GPIO_SERVO_SUM = 2 //!< Summation of the GPIO servos. (GPIO12 and GPIO14)
+	};
+
+	/*!
+		@brief Management class of channel setting
+
+		The setting describes where and how a joint is output, and is stored in the config file after the joint settings.
+		The output value is mapped linearly from PWM_MIN (at ANGLE_MIN) to PWM_MAX (at ANGLE_MAX),
+		and they are swapped when DIRECTION is negative.
+		GPIO servos are mapped around the center of the range instead, rounding toward the center.
+	*/
+	class ChannelSetting
+	{
+	public:
+		unsigned char KIND;      //!< Output kind.
+		unsigned char CHANNEL;   //!< PCA9685's channel or index of GPIO servos.
+		signed char   DIRECTION; //!< 1 or -1.
+		unsigned char RESERVED;  //!< Padding.
+		short         PWM_MIN;   //!< Output value of an end.
+		short         PWM_MAX;   //!< Output value of the other end.
+	};
+
+private:
+	//! @brief Initialized flag's address on internal EEPROM
+	inline static const int INIT_FLAG_ADDRESS()     { return 0; }
+
+	//! @brief Initialized flag's value
+	inline static const unsigned char INIT_FLAG_VALUE()       { return 4; }
+
+	//! @brief Initialized flag's value of the settings that have no checksum
+	inline static const unsigned char UNCHECKED_INIT_FLAG_VALUE() { return 3; }
+
+	//! @brief Initialized flag's value of the former settings, that have no slew limits
+	inline static const unsigned char LEGACY_INIT_FLAG_VALUE() { return 2; }
+
+	//! @brief Head-address of joint settings on internal EEPROM
+	inline static const int SETTINGS_HEAD_ADDRESS() { return 1; }
+
+	//! @brief Channel map's initialized flag's address, that follows the joint settings
+	inline static const int CHANNELS_FLAG_ADDRESS() { return SETTINGS_HEAD_ADDRESS() + SUM * sizeof(JointSetting); }
+
+	//! @brief Channel map's initialized flag's value
+	inline static const unsigned char CHANNELS_FLAG_VALUE() { return 1; }
+
+	//! @brief Head-address of channel settings
+	inline static const int CHANNELS_HEAD_ADDRESS() { return CHANNELS_FLAG_ADDRESS() + 1; }
+
+	//! @brief Address of CRC-16 of the joint settings and the channel map, that follows the channel map
+	inline static const int CHECKSUM_ADDRESS() { return CHANNELS_HEAD_ADDRESS() + SUM * sizeof(ChannelSetting); }
+
+	//! @brief Quiet period after the last change, that the changed settings are committed (msec)
+	inline static const unsigned long COMMIT_DELAY_MS() { return 2000UL; }
+
+	/*!
+		@brief Management class of joint setting
+	*/
+	class JointSetting
+	{
+	public:
+		int MIN;  //!< Setting about min angle.
+		int MAX;  //!< Setting about max angle.
+		int HOME; //!< Setting about home angle.
+		int SPEED; //!< Setting about max speed. (degree 1/10 per second, 0 is unlimited.)
+		int ACCEL; //!< Setting about max acceleration. (degree 1/10 per second^2, 0 is unlimited.)
+
+		/*!
+			@brief Constructor
+		*/
+		JointSetting()
+			: MIN(ANGLE_MIN)
+			, MAX(ANGLE_MAX)
+			, HOME(ANGLE_NEUTRAL)
+			, SPEED(0)
+			, ACCEL(0)
+		{
+			// noop.
+		}
+	};
+
+	/*!
+		@brief Management class (as namespace) of PCA9685 registers
+
+		@sa
+		PCA9685's datasheet -> https://www.nxp.com/docs/en/data-sheet/PCA9685.pdf
+	*/
+	class PCA9685 {
+	public:
+		enum {
+			CHANNEL_SUM   = 16, //!< Summation of the PWM channels.
+			CHANNEL_BYTES =  4  //!< Register bytes per channel. (ON_L, ON_H, OFF_L, OFF_H)
+		};
+
+		//! @brief 7bit slave address of the driver
+		inline static const int ADDRESS()   { return 0x40; }
+
+		//! @brief Register address of LED0_ON_L, the head of the channel registers
+		inline static const int LED0_ON_L() { return 0x06; }
+
+		//! @brief Register address of ALL_LED_ON_L, that writes all channels at once
+		inline static const int ALL_LED_ON_L() { return 0xFA; }
+
+		//! @brief Bit of LEDn_ON_H and LEDn_OFF_H, that makes the output always on or off
+		inline static const int LED_FULL() { return 0x10; }
+
+		//! @brief I2C clock of fast mode
+		inline static const long I2C_CLOCK() { return 400000L; }
+	};
+
+	/*!
+		@brief Write contiguous PCA9685 channels with auto-increment transactions
+
+		@param [in] channel_begin  Please set the first channel to write.
+		@param [in] channel_length Please set count of the channels.
+		@param [in] channel_pwms[] Please set PWM values ordered by channel.
+
+		@attention
+		The method relies on MODE1's auto-increment bit, that is enabled by Adafruit_PWMServoDriver::setPWMFreq().
+	*/
+	static void m_burstWrite(unsigned char channel_begin, unsigned char channel_length, const int channel_pwms[]);
+
+	/*!
+		@brief Store a target, and mark the joint dirty if the target is changed
+
+		@param [in] joint_id Please set joint id you want to set the target.
+		@param [in] index    Please set index of the angles. (angle - ANGLE_MIN)
+	*/
+	static void m_storeIndex(unsigned char joint_id, short index);
+
+	/*!
+		@brief Target buffer that the setters write (Indexes of the angles)
+
+		The buffer is owned by the main loop, and handed to the output vector by publish().
+	*/
+	static short m_indexes[SUM];
+
+	//! @brief Dirty flags of target buffer (Bit N is set when m_indexes[N] is changed after last publishing.)
+	static unsigned long m_dirty_joints;
+
+	/*!
+		@brief Frame of targets handed from the main loop to the output vector
+	*/
+	class TargetFrame
+	{
+	public:
+		short indexes[SUM];         //!< Targets of all joints.
+		unsigned long dirty_joints; //!< Joints changed after the frame that was output last.
+		bool relax;                 //!< All outputs are turned off before the joints are output.
+	};
+
+	//! @brief The frame published next relaxes all outputs.
+	static bool m_relax_pending;
+
+	/*!
+		@brief Turn off all outputs
+
+		The method is called from the output vector.
+	*/
+	static void m_relaxOutputs();
+
+	enum {
+		/*!
+			@brief Length of frame buffer
+
+			@note
+			Triple-buffering lets the writer always have a free frame,
+			so publishing never waits for the output vector and vice versa.
+		*/
+		FRAMEBUFFER_LENGTH = 3
+	};
+
+	static TargetFrame m_frames[FRAMEBUFFER_LENGTH];
+	static unsigned char m_frame_back;           //!< Frame the writer fills. (Owned by the writer.)
+	static unsigned char m_frame_front;          //!< Frame the output vector reads. (Owned by the vector.)
+	volatile static unsigned char m_frame_ready; //!< Frame published latest. (Exchanged by the both.)
+	volatile static bool m_frame_fresh;          //!< The ready frame has not been taken by the vector yet.
+
+	/*!
+		@brief Set the flag of the motion tick
+
+		The method runs at Motion::Frame::UPDATE_INTERVAL_MS independently of the output rate.
+	*/
+	static void m_motionTick();
+
+	static unsigned int  m_output_rate_hz; //!< Rate of the output vector.
+	static unsigned long m_output_last_us; //!< Timestamp of the last output.
+	static Utility::TimingStatistics m_output_intervals; //!< Intervals between outputs. [usec]
+	static Utility::TimingStatistics m_output_durations; //!< Time spent inside updateAngle(). [usec]
+
+	enum {
+		SLEW_FRACTION_BITS = 12 //!< Fraction bits of the slew limiter's fixed points.
+	};
+
+	/*!
+		@brief State of slew limiter (Fixed points of index of the angles, owned by the output vector)
+	*/
+	class SlewState
+	{
+	public:
+		long position; //!< Position output.
+		long velocity; //!< Velocity per output. (signed)
+	};
+
+	/*!
+		@brief Limits of slew limiter
+
+		The limits are converted from the joint setting into units of an output, so the vector never divides.
+	*/
+	class SlewLimit
+	{
+	public:
+		int  speed;            //!< Max speed. (degree 1/10 per second)
+		int  accel;            //!< Max acceleration. (degree 1/10 per second^2)
+		long velocity_max;     //!< Max velocity per output. (0 is unlimited.)
+		long acceleration_max; //!< Max change of velocity per output. (0 is unlimited.)
+	};
+
+	static SlewState m_slew_states[SUM];
+	static SlewLimit m_slew_limits[SUM];
+	static unsigned long m_slewing_joints; //!< Joints that have not reached to the targets.
+	static unsigned long m_slew_resets;    //!< Joints that jump to the next targets. (Their positions are unknown.)
+	static int m_output_pwms[SUM];         //!< PWM values that are output last.
+
+	/*!
+		@brief Convert slew limits of the joint given for the output rate
+
+		@param [in] joint_id Please set joint id you want to update.
+	*/
+	static void m_scaleSlewLimit(unsigned char joint_id);
+
+	/*!
+		@brief Advance the slew limiter of the joint given by an output
+
+		The joint accelerates toward the target, runs at max speed,
+		and decelerates so as to stop at the target without overshooting.
+
+		@param [in] joint_id Please set joint id.
+		@param [in] target   Please set index of the target.
+
+		@return Index that should be output now
+	*/
+	static short m_slew(unsigned char joint_id, short target);
+
+	static unsigned long m_writes_issued;  //!< Count of servo outputs that are written.
+	static unsigned long m_writes_skipped; //!< Count of servo outputs that are skipped because unchanged.
+
+	enum {
+		/*!
+			@brief Summation of the output profiles
+
+			@note
+			A profile is shared by all joints that have the same output range and direction,
+			so the default channel map needs 2 profiles. (PCA9685 and Servo library)
+		*/
+		PROFILE_SUM = 3,
+
+		/*!
+			@brief Fraction bits of the slopes of the output profiles
+
+			@note
+			A slope is rounded up, and its error over the whole range stays below 1 / (ANGLE_MAX - ANGLE_MIN),
+			so the quotient truncated is exact while (ANGLE_MAX - ANGLE_MIN)^2 < 2^SLOPE_FRACTION_BITS.
+		*/
+		SLOPE_FRACTION_BITS = 22
+	};
+
+	/*!
+		@brief Output range and its mapping from angles
+
+		An output value is origin +/- (|index - pivot| * slope) >> SLOPE_FRACTION_BITS,
+		that truncates toward the pivot as map() for PCA9685's channels (pivot is ANGLE_MIN)
+		and as 90 +/- angle / 10 for GPIO servos (pivot is angle 0) did.
+	*/
+	class OutputProfile
+	{
+	public:
+		unsigned char kind;  //!< Output kind, that decides the pivot.
+		bool  falling;       //!< The output value decreases as the angle increases.
+		short pwm_begin;     //!< Output value at ANGLE_MIN.
+		short pwm_end;       //!< Output value at ANGLE_MAX.
+		short origin;        //!< Output value at the pivot.
+		short pivot;         //!< Index of the pivot.
+		unsigned long slope; //!< |pwm_end - pwm_begin| / (ANGLE_MAX - ANGLE_MIN), rounded up. (Fixed point)
+	};
+
+	/*!
+		@brief Calibration of a joint expressed by indexes of the angles
+
+		The instance folds the joint setting and the output profile together,
+		so getting PWM value needs only to clamp an index and to map it by the profile.
+	*/
+	class JointCalibration
+	{
+	public:
+		short index_min;       //!< Index of min angle.
+		short index_max;       //!< Index of max angle.
+		short index_home;      //!< Index of home angle.
+		unsigned char profile; //!< Output profile of the joint.
+	};
+
+	/*!
+		@brief Output of a joint that exists
+
+		The update loop iterates the instances densely, so joints having no output cost nothing.
+	*/
+	class ActiveJoint
+	{
+	public:
+		unsigned char joint_id; //!< Joint id.
+		unsigned char kind;     //!< Output kind. (OUTPUT_PCA9685 or OUTPUT_GPIO_SERVO)
+		unsigned char channel;  //!< PCA9685's channel or index of GPIO servos.
+		unsigned char profile;  //!< Output profile of the joint.
+	};
+
+	/*!
+		@brief Profiles and outputs that a channel map is laid out to
+
+		The layout is planned apart from the active state,
+		so a channel setting can be checked before it changes any output.
+	*/
+	class ChannelLayout
+	{
+	public:
+		OutputProfile profiles[PROFILE_SUM]; //!< Profiles in the order of the joints that use them first.
+		unsigned char profile_sum;           //!< Summation of the profiles used.
+		unsigned char joint_profiles[SUM];   //!< Profile of each joint. (PROFILE_SUM means no output.)
+	};
+
+	static OutputProfile m_profiles[PROFILE_SUM];
+	static unsigned char m_profile_sum;
+
+	static ActiveJoint m_active_joints[SUM];
+	static unsigned char m_active_sum;
+
+	/*!
+		@brief Get the profile that the channel setting given needs
+
+		If the layout has no matched profile, the method adds it to the layout.
+
+		@param [in]     channel Please set channel setting.
+		@param [in,out] layout  Please set layout planned so far.
+
+		@return Index of the profile
+		@retval PROFILE_SUM The pool is full.
+	*/
+	static unsigned char m_findProfile(const ChannelSetting& channel, ChannelLayout& layout);
+
+	/*!
+		@brief Get output value of the index given
+
+		@param [in] profile Please set output profile.
+		@param [in] index   Please set index of the angles.
+
+		@return Output value, bit-identical to the former per-call mapping
+	*/
+	static int m_pwm(const OutputProfile& profile, short index);
+
+	/*!
+		@brief Lay out the channel map given, without changing any output
+
+		A joint has no output in the layout if its setting is broken,
+		its output is used by a joint before it, or the pool has no profile left for it.
+
+		@param [in]  channels Please set channel map.
+		@param [out] layout   Please set instance that the layout is stored to.
+	*/
+	static void m_layoutChannels(const ChannelSetting channels[SUM], ChannelLayout& layout);
+
+	/*!
+		@brief Apply the channel map to the profiles and the active joints
+
+		Broken or conflicted channel settings are turned into OUTPUT_NONE and marked as uncommitted,
+		because the map might be read from a broken file.
+	*/
+	void m_applyChannels();
+
+	/*!
+		@brief Apply the joint setting to the calibration of the joint given
+
+		@param [in] joint_id Please set joint id you want to update.
+	*/
+	void m_calibrate(unsigned char joint_id);
+
+	/*!
+		@brief Fill the joint settings with the default values
+	*/
+	void m_defaultSettings();
+
+	/*!
+		@brief Fill the channel map with the default values
+	*/
+	void m_defaultChannels();
+
+	/*!
+		@brief Mark the joint setting given as uncommitted
+
+		@param [in] joint_id Please set joint id that is changed.
+	*/
+	void m_markSetting(unsigned char joint_id);
+
+	/*!
+		@brief Mark the channel setting given as uncommitted
+
+		@param [in] joint_id Please set joint id that is changed.
+	*/
+	void m_markChannel(unsigned char joint_id);
+
+	/*!
+		@brief Write entries between the first and the last dirty joints at once
+
+		@param [in] dirty_joints Please set dirty flags of the entries.
+		@param [in] head_address Please set address of the first entry in the config file.
+		@param [in] entries      Please set the entries.
+		@param [in] entry_size   Please set size of an entry.
+	*/
+	void m_writeDirty(unsigned long dirty_joints, int head_address, const unsigned char entries[], unsigned int entry_size);
+
+	/*!
+		@brief Write the config file, and count the writing
+
+		@param [in] address Please set address in the config file.
+		@param [in] size    Please set size of data.
+		@param [in] data    Please set data.
+	*/
+	void m_writeConfig(int address, unsigned int size, const unsigned char data[]);
+
+	/*!
+		@brief Calculate CRC-16 of the joint settings and the channel map
+
+		@return CRC-16/CCITT-FALSE
+	*/
+	unsigned short m_checksum();
+
+	JointSetting m_SETTINGS[SUM];
+	ChannelSetting m_CHANNELS[SUM];
+	JointCalibration m_calibration[SUM];
+
+	unsigned long m_dirty_settings;    //!< Joint settings that are not committed.
+	unsigned long m_dirty_channels;    //!< Channel settings that are not committed.
+	bool          m_config_formatted;  //!< The flags of the config file are valid.
+	unsigned long m_settings_modified; //!< Time of the last change. (msec)
+	unsigned long m_config_writes;     //!< Count of writings to the config file.
+public:
+	/*!
+		@brief Management class (as namespace) of multiplexer
+
+		@note
+		The methods the class has are more accurate that there are in the namespace named Multiplexer,
+		but C++'s idiom doesn't accept syntax that described before.
+	*/
+	class Multiplexer {
+	public:
+		//! @brief Summation of multiplexers
+		inline static const int SUM()              { return 3; }
+
+		//! @brief Number of controllable lines by a multiplexer
+		inline static const int SELECTABLE_LINES() { return 8; }
+	};
+#if USE_DIGTAL_SERVO
+    inline static const int PWM_FREQ()    { return 320;  }
+
+	//! @brief PWM width that to make min angle
+	inline static const int PWM_MIN()     { return 1100;  }
+
+	//! @brief PWM width that to make max angle
+	inline static const int PWM_MAX()     { return 2700;  }
+
+	//! @brief PWM width that to make neutral angle
+	inline static const int PWM_NEUTRAL() { return 1900;  }
+#else
+    inline static const int PWM_FREQ()    { return 60;  }
+
+	//! @brief PWM width that to make min angle
+	inline static const int PWM_MIN()     { return 175;  }
+
+	//! @brief PWM width that to make max angle
+	inline static const int PWM_MAX()     { return 575;  }
+
+	//! @brief PWM width that to make neutral angle
+	inline static const int PWM_NEUTRAL() { return 375;  }
+#endif
+    
+	//! @brief Min rate of the output vector (Hz)
+	inline static const int OUTPUT_RATE_MIN() { return 1; }
+
+	//! @brief Max rate of the output vector (Hz), that servos can follow
+	inline static const int OUTPUT_RATE_MAX() { return PWM_FREQ(); }
+
+	//! @brief Max value of speed limit (degree 1/10 per second)
+	inline static const int SPEED_LIMIT_MAX() { return 30000; }
+
+	//! @brief Max value of acceleration limit (degree 1/10 per second^2)
+	inline static const int ACCEL_LIMIT_MAX() { return 300000; }
+
+	/*!
+		@brief Finished flag of motion tick 1 cycle
+
+		The flag is set every Motion::Frame::UPDATE_INTERVAL_MS, and cleared when a motion frame is updated.
+
+		@attention
+		The instance should be a private member normally.
+		It is a public member because it is only way to access from Timer 1 overflow interruption vector,
+		so you must not access it from other functions basically.
+	*/
+	volatile static bool m_1cycle_finished;
+
+	/*!
+		@brief Constructor
+	*/
+	JointController();
+
+	void Init();
+
+	/*!
+		@brief Load the joint settings
+
+		The method reads joint settings from internal EEPROM.
+		If the EEPROM has no settings or their checksum is broken, the method also writes the default values.
+		Uncommitted changes are committed before reading.
+
+		@sa
+		JointController.cpp::Shared::m_SETTINGS_INITIAL
+
+		@attention
+		The method should call in constructor normally,
+		but initialized timing of any interruption is indefinite, so might get deadlock.
+		(The method uses serial communication and internal EEPROM accessing, so it happens interruption.)
+	*/
+	void loadSettings();
+
+	/*!
+		@brief Reset the joint settings
+
+		Write default settings to internal EEPROM.
+	*/
+	void resetSettings();
+
+	/*!
+		@brief Get min angle of the joint given
+
+		@param [in] joint_id Please set joint id you want to get min angle.
+
+		@return Reference of min angle a joint expressed by **joint_id** has.
+		@retval -32768 Argument error. (**joint_id** is invalid.)
+	*/
+	const int& getMinAngle(unsigned char joint_id);
+
+	/*!
+		@brief Get max angle of the joint given
+
+		@param [in] joint_id Please set joint id you want to get max angle.
+
+		@return Reference of max angle a joint expressed by **joint_id** has.
+		@retval -32768 Argument error. (**joint_id** is invalid.)
+	*/
+	const int& getMaxAngle(unsigned char joint_id);
+
+	/*!
+		@brief Get home angle of the joint given
+
+		@param [in] joint_id Please set joint id you want to get home angle.
+
+		@return Reference of home angle a joint expressed by **joint_id** has.
+		@retval -32768 Argument error. (**joint_id** is invalid.)
+	*/
+	const int& getHomeAngle(unsigned char joint_id);
+
+	/*!
+		@brief Set min angle of the joint given
+
+		@param [in] joint_id Please set joint id you want to define min angle.
+		@param [in] angle    Please set angle that has steps of degree 1/10.
+
+		@return Result
+	*/
+	bool setMinAngle(unsigned char joint_id, int angle);
+
+	/*!
+		@brief Set max angle of the joint given
+
+		@param [in] joint_id Please set joint id you want to define max angle.
+		@param [in] angle    Please set angle that has steps of degree 1/10.
+
+		@return Result
+	*/
+	bool setMaxAngle(unsigned char joint_id, int angle);
+
+	/*!
+		@brief Set home angle of the joint given
+
+		@param [in] joint_id Please set joint id you want to define home angle.
+		@param [in] angle    Please set angle that has steps of degree 1/10.
+
+		@return Result
+	*/
+	bool setHomeAngle(unsigned char joint_id, int angle);
+
+	/*!
+		@brief Get speed limit of the joint given
+
+		@param [in] joint_id Please set joint id you want to get speed limit.
+
+		@return Reference of speed limit a joint expressed by **joint_id** has.
+		@retval -32768 Argument error. (**joint_id** is invalid.)
+	*/
+	const int& getSpeedLimit(unsigned char joint_id);
+
+	/*!
+		@brief Get acceleration limit of the joint given
+
+		@param [in] joint_id Please set joint id you want to get acceleration limit.
+
+		@return Reference of acceleration limit a joint expressed by **joint_id** has.
+		@retval -32768 Argument error. (**joint_id** is invalid.)
+	*/
+	const int& getAccelLimit(unsigned char joint_id);
+
+	/*!
+		@brief Set speed limit of the joint given
+
+		@param [in] joint_id Please set joint id you want to define speed limit.
+		@param [in] speed    Please set speed that has steps of degree 1/10 per second. (0 is unlimited.)
+
+		@return Result
+	*/
+	bool setSpeedLimit(unsigned char joint_id, int speed);
+
+	/*!
+		@brief Set acceleration limit of the joint given
+
+		@param [in] joint_id Please set joint id you want to define acceleration limit.
+		@param [in] accel    Please set acceleration that has steps of degree 1/10 per second^2. (0 is unlimited.)
+
+		@return Result
+	*/
+	bool setAccelLimit(unsigned char joint_id, int accel);
+
+	/*!
+		@brief Set angle of the joint given
+
+		@param [in] joint_id Please set joint id you want to set angle.
+		@param [in] angle    Please set angle that has steps of degree 1/10.
+
+		@return Result
+
+		@attention
+		<b>angle</b> might not be setting actually.
+		It is setting after trimming by user defined min-max value or servo's range,
+		so please consider it when writing a unit test.
+		The angle is a target; the output vector approaches it under the joint's slew limits.
+	*/
+	bool setAngle(unsigned char joint_id, int angle);
+
+	/*!
+		@brief Set angle to "angle-diff + home-angle" of the joint given
+
+		@param [in] joint_id   Please set joint id you want to set angle-diff.
+		@param [in] angle_diff Please set angle-diff that has steps of degree 1/10.
+
+		@return Result
+
+		@attention
+		<b>angle_diff</b> might not be setting actually.
+		It is setting after trimming by user defined min-max value or servo's range,
+		so please consider it when writing a unit test.
+	*/
+	bool setAngleDiff(unsigned char joint_id, int angle_diff);
+
+	/*!
+		@brief Get index of the angles that setAngleDiff() stores for an angle-diff
+
+		@param [in] joint_id   Please set joint id in [0, SUM).
+		@param [in] angle_diff Please set angle-diff that has steps of degree 1/10.
+
+		@return Index trimmed by user defined min-max value
+	*/
+	short angleDiffIndex(unsigned char joint_id, int angle_diff) const;
+
+	/*!
+		@brief Set index of the angles of the joint given directly
+
+		@param [in] joint_id Please set joint id you want to set index.
+		@param [in] index    Please set index got by angleDiffIndex().
+
+		@return Result
+
+		@attention
+		The index is not trimmed, so please pass only indexes made under settingsChecksum() now.
+	*/
+	bool setIndex(unsigned char joint_id, short index);
+
+	/*!
+		@brief Get checksum of the joint settings and the channel map in the cache
+
+		Anything made from the calibration can be checked with it to be still valid.
+
+		@return CRC-16/CCITT-FALSE
+	*/
+	unsigned short settingsChecksum() { return m_checksum(); }
+
+	/*!
+		@brief Move all joints to their home angles
+
+		The pose is published as one frame, so it is output by a tick without accessing the config file.
+	*/
+	void applyHomePose();
+
+	/*!
+		@brief Move all joints to the angles given
+
+		@param [in] angles Please set angles of all joints that have steps of degree 1/10.
+
+		@attention
+		The angles are trimmed by user defined min-max value or servo's range.
+	*/
+	void applyPose(const int angles[SUM]);
+
+	/*!
+		@brief Turn off all servo outputs
+
+		PCA9685's channels are turned off by a writing to ALL_LED registers, and GPIO servos are detached.
+		The joints are output again by the next frame published.
+	*/
+	static void relaxAll();
+
+	/*!
+		@brief Get channel setting of the joint given
+
+		@param [in] joint_id Please set joint id you want to get channel setting.
+
+		@return Reference of channel setting a joint expressed by **joint_id** has.
+		(If **joint_id** is invalid, the setting's kind is OUTPUT_NONE.)
+	*/
+	const ChannelSetting& getChannel(unsigned char joint_id);
+
+	/*!
+		@brief Set channel setting of the joint given
+
+		The joint is moved to its home angle on the new output.
+
+		@param [in] joint_id Please set joint id you want to define channel setting.
+		@param [in] channel  Please set channel setting.
+
+		@return Result
+		@retval false The setting is invalid, the output is used by another joint, or no output profile is left.
+		(Nothing is changed then, and the setting never takes the output of another joint.)
+	*/
+	bool setChannel(unsigned char joint_id, const ChannelSetting& channel);
+
+	/*!
+		@brief Reset the channel map
+
+		Write the default channel map (PLEN2's 18 joints) to the config file.
+	*/
+	void resetChannels();
+
+	/*!
+		@brief Commit the changed settings to the config file
+
+		Changed joint settings and channel settings are written in a batch, and followed by the checksum.
+		The setters only change the cache, and the checksum lets loadSettings() detect a torn writing.
+
+		@return Result
+		@retval false There is no change.
+	*/
+	bool commitSettings();
+
+	/*!
+		@brief Commit the changed settings if they are left unchanged for COMMIT_DELAY_MS()
+
+		@attention
+		Please call the method from the main loop.
+	*/
+	void updateSettings();
+
+	/*!
+		@brief Get count of writings to the config file
+
+		@return Count since boot
+	*/
+	unsigned long configWrites();
+
+	/*!
+		@brief Get count of the joints that have an output
+
+		@return Count of the joints
+	*/
+	static unsigned char activeJointSum();
+
+	/*!
+		@brief Dump the joint settings
+
+		Output result like JSON format below.
+		@code
+		[
+			{
+				"max": <integer>,
+				"min": <integer>,
+				"home": <integer>
+			},
+			...
+		]
+		@endcode
+	*/
+	void dump();
+
+	/*!
+		@brief Publish the angles set after last publishing
+
+		The method hands all joints to the output vector as one consistent frame,
+		so the vector never outputs a frame that is updated partially.
+		It never blocks; if the vector has not taken the previous frame yet, the frame is replaced.
+
+		@attention
+		The setters only change the buffer of the main loop,
+		so please call the method after setting angles of a frame.
+	*/
+	static void publish();
+
+	/*!
+		@brief Output the frame published latest (= The output vector)
+
+		The vector is called by the ticker "flipper" at outputRate().
+
+		@note
+		The ticker is a software timer, not timer1, for two reasons:
+		timer1 is taken by the waveform generator that Servo drives the GPIO servos with,
+		and the I2C bursts cannot run inside an interruption.
+		So the vector runs from the SDK's timer task, between passes of loop(), and it is late
+		by the pass running when it is due (e.g. httpServer.handleClient() or WiFi work), up to the longest pass.
+		outputIntervals() shows the lateness as jitter of the intervals.
+	*/
+	static void updateAngle();
+
+	/*!
+		@brief Get count of servo outputs that are written
+
+		@return Count since boot
+	*/
+	static unsigned long writesIssued();
+
+	/*!
+		@brief Get count of servo outputs that are skipped because unchanged
+
+		@return Count since boot
+	*/
+	static unsigned long writesSkipped();
+
+	/*!
+		@brief Set rate of the output vector
+
+		The rate is independent of the rate of motion interpolation.
+
+		@param [in] rate_hz Please set rate. (e.g. 50, 100, 200 with digital servos)
+
+		@return Result
+
+		@attention
+		The ticker has resolution of 1[msec], so the actual interval is 1000 / **rate_hz** truncated.
+	*/
+	static bool setOutputRate(int rate_hz);
+
+	//! @brief Get rate of the output vector (Hz)
+	static unsigned int outputRate();
+
+	//! @brief Get statistics of intervals between outputs (usec)
+	static const Utility::TimingStatistics& outputIntervals();
+
+	//! @brief Get statistics of time spent inside updateAngle() (usec)
+	static const Utility::TimingStatistics& outputDurations();
+
+	//! @brief Clear statistics of the output vector
+	static void resetOutputStatistics();
+
+    static void updateEyes();
+};
+
+#endif // PLEN2_JOINT_CONTROLLER_H
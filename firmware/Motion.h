@@ -1,153 +1,265 @@
-/*!
-	@file      Motion.h
-	@brief     Provide motion components.
-	@author    Kazuyuki TAKASE
-	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
-*/
-
-#pragma once
-
-#ifndef PLEN2_MOTION_H
-#define PLEN2_MOTION_H
-
-#include "JointController.h"
-
-
-namespace PLEN2
-{
-	namespace Motion
-	{
-		enum {
-			SLOT_BEGIN =  0, //!< Beginning value of slots.
-			SLOT_END   = 90  //!< Ending value of slots.
-		};
-
-		class Header;
-		class Frame;
-	}
-}
-
-
-/*!
-	@brief Class of a motion header
-
-	@attention
-	The firmware backs up memory allocation of an instance to external EEPROM,
-	so if you change the order of member instances, PLEN does not work properly
-	if you did not re-install all motions.
-*/
-class PLEN2::Motion::Header
-{
-public:
-	enum {
-		/*!
-			@brief Length of a motion name.
-
-			@attention
-			Regard end of a string as '\0', so the actual length is 20 bytes.
-		*/
-		NAME_LENGTH     = 21,
-
-		FRAMELENGTH_MIN =  1, //!< Minimum value of frame length. 
-		FRAMELENGTH_MAX = 20  //!< Maximum value of frame length.
-	};
-
-	void init();
-
-	/*!
-		@brief Write the header to external EEPROM
-
-		@return Result
-	*/
-	bool set();
-
-	/*!
-		@brief Read the header from external EEPROM
-
-		@return Result
-	*/
-	bool get();
-
-
-	unsigned char slot;              //!< Slot number of a motion.
-	char          name[NAME_LENGTH]; //!< Motion name.
-	unsigned char frame_length;      //!< Frame length of a motion.
-
-	unsigned char NON_RESERVED : 5;  //!< Undefined area. (It is reserved for future changes.)
-	unsigned char use_extra    : 1;  //!< Selector for to enable "extra".
-	unsigned char use_jump     : 1;  //!< Selector for to enable "jump".
-	unsigned char use_loop     : 1;  //!< Selector for to enable "loop".
-
-	unsigned char loop_begin;        //!< Frame number of loop's beginning.
-	unsigned char loop_end;          //!< Frame number of loop's ending.
-
-	unsigned char loop_count;        //!< Loop count. (Using 255 as infinity.)
-	unsigned char jump_slot;         //!< Slot number that is used for jumpping when play the motion finished.
-
-	/*!
-		@brief Array of stop flags
-
-		@todo
-		Currently, the definition is uint8_t 2 bytes array,
-		but in the future, it should be uint32_t variable.
-		<br><br>
-		Thus, the authors need to refactor I2C libraries.
-	*/
-	unsigned char stop_flags[2];
-};
-
-
-/*!
-	@brief Class of a motion frame
-
-	@attention
-	The firmware backs up memory allocation of an instance to external EEPROM,
-	so if you change the order of member instances, PLEN does not work properly
-	if you did not re-install all motions.
-*/
-class PLEN2::Motion::Frame
-{
-public:
-	enum {
-		/*!
-			@brief Update interval between frames
-
-			@sa
-			Refer to ISR(TIMER1_OVF_vect), in JointController.cpp.
-		*/
-    #if USE_DIGTAL_SERVO
-        UPDATE_INTERVAL_MS = 32,
-    #else
-		UPDATE_INTERVAL_MS = 40,
-    #endif
-
-		FRAME_BEGIN =  0, //!< Beginning value of frames.
-		FRAME_END   = 20  //!< Ending value of frames.
-	};
-
-	/*!
-		@brief Write the frame to external EEPROM
-
-		@param [in] slot Slot number of a motion.
-
-		@return Result
-	*/
-	bool set(unsigned char slot);
-
-	/*!
-		@brief Read the frame from external EEPROM
-
-		@param [in] slot Slot number of a motion.
-
-		@return Result
-	*/
-	bool get(unsigned char slot);
-
-
-	unsigned char index;                             //!< Index of a frame.
-	unsigned int  transition_time_ms;                //!< Time of transit to the frame.
-	int           joint_angle[JointController::SUM]; //!< Angles.
-	unsigned char device_value[8];                   //!< Output values.
-};
-
-#endif // PLEN2_MOTION_H
+/*!
+	@file      Motion.h
+	@brief     Provide motion components.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef PLEN2_MOTION_H
+#define PLEN2_MOTION_H
+
+#include "JointController.h"
+
+
+namespace PLEN2
+{
+	namespace Motion
+	{
+		enum {
+			SLOT_BEGIN =   0, //!< Beginning value of slots.
+			SLOT_END   = 255  //!< Ending value of slots. (It also means "no slot", so a slot fits a byte.)
+		};
+
+		class Header;
+		class Frame;
+		class Installation;
+	}
+}
+
+
+/*!
+	@brief Class of a motion header
+
+	@attention
+	The firmware backs up memory allocation of an instance to external EEPROM,
+	so if you change the order of member instances, PLEN does not work properly
+	if you did not re-install all motions.
+*/
+class PLEN2::Motion::Header
+{
+public:
+	enum {
+		/*!
+			@brief Length of a motion name.
+
+			@attention
+			Regard end of a string as '\0', so the actual length is 20 bytes.
+		*/
+		NAME_LENGTH     = 21,
+
+		FRAMELENGTH_MIN = 1,     //!< Minimum value of frame length. 
+		FRAMELENGTH_MAX = 0xFFFF //!< Maximum value of frame length. (Motions are limited by the flash rather than it.)
+	};
+
+	/*!
+		@brief Interpolation profiles between frames
+
+		@sa
+		Refer to MotionController::updateFrame().
+	*/
+	enum {
+		INTERPOLATION_LINEAR,       //!< Constant velocity. (Compatible with old motions.)
+		INTERPOLATION_SMOOTHSTEP,   //!< Ease-in-out that stops at every frame. (3t^2 - 2t^3)
+		INTERPOLATION_MINIMUM_JERK, //!< Ease-in-out with zero acceleration at every frame. (10t^3 - 15t^4 + 6t^5)
+		INTERPOLATION_CATMULL_ROM,  //!< Spline through the frames, that keeps velocity at every frame.
+		INTERPOLATION_SUM
+	};
+
+	void init();
+
+	//! @brief Decide frame_events is written with the frames (It is not in motions of old firmware.)
+	bool eventsValid() const { return (frame_events_check == static_cast<unsigned char>(~frame_events)); }
+
+	/*!
+		@brief Gather Frame::events of all frames into frame_events
+
+		Please call set() after the method to write the result.
+
+		@return Result
+	*/
+	bool gatherEvents();
+
+	/*!
+		@brief Write the header to external EEPROM
+
+		@return Result
+	*/
+	bool set();
+
+	/*!
+		@brief Read the header from external EEPROM
+
+		@return Result
+	*/
+	bool get();
+
+
+	unsigned char  slot;              //!< Slot number of a motion.
+	char           name[NAME_LENGTH]; //!< Motion name.
+	unsigned short frame_length;      //!< Frame length of a motion.
+
+	unsigned char NON_RESERVED  : 3; //!< Undefined area. (It is reserved for future changes.)
+	unsigned char interpolation : 2; //!< Interpolation profile. (INTERPOLATION_*)
+	unsigned char use_extra    : 1;  //!< Selector for to enable "extra".
+	unsigned char use_jump     : 1;  //!< Selector for to enable "jump".
+	unsigned char use_loop     : 1;  //!< Selector for to enable "loop".
+
+	unsigned short loop_begin;       //!< Frame number of loop's beginning.
+	unsigned short loop_end;         //!< Frame number of loop's ending.
+
+	unsigned char loop_count;        //!< Loop count. (Using 255 as infinity.)
+	unsigned char jump_slot;         //!< Slot number that is used for jumpping when play the motion finished.
+
+	/*!
+		@brief Union of Frame::events of all frames
+
+		It lets a stop request know in O(1) whether the motion has a stop point.
+		The bytes were "stop_flags" of old firmware, that wrote 0x00 or 0xFF to both,
+		so the union is valid only when frame_events_check is its complement.
+	*/
+	unsigned char frame_events;
+	unsigned char frame_events_check; //!< Complement of frame_events.
+};
+
+
+/*!
+	@brief Class of a motion frame
+
+	@attention
+	The firmware backs up memory allocation of an instance to external EEPROM,
+	so if you change the order of member instances, PLEN does not work properly
+	if you did not re-install all motions.
+*/
+class PLEN2::Motion::Frame
+{
+public:
+	enum {
+		/*!
+			@brief Update interval between frames
+
+			@sa
+			Refer to ISR(TIMER1_OVF_vect), in JointController.cpp.
+		*/
+    #if USE_DIGTAL_SERVO
+        UPDATE_INTERVAL_MS = 32,
+    #else
+		UPDATE_INTERVAL_MS = 40,
+    #endif
+
+		FRAME_BEGIN = 0,     //!< Beginning value of frames.
+		FRAME_END   = 0xFFFF //!< Ending value of frames.
+	};
+
+	/*!
+		@brief Events of a frame, that happen when a motion arrives at it
+
+		@sa
+		Refer to MotionController::updatingFinished().
+	*/
+	enum {
+		EVENT_STOP        = 0x01, //!< Safe point that a stop request takes effect at.
+		EVENT_SYNC        = 0x02, //!< Hold the frame until MotionController::release().
+		EVENT_EMIT        = 0x04, //!< Send event_code to the host.
+		EVENT_WAIT_SENSOR = 0x08, //!< Hold the frame until the sensor meets the condition.
+		EVENT_ALL         = 0x0F
+	};
+
+	/*!
+		@brief Conditions of EVENT_WAIT_SENSOR
+	*/
+	enum {
+		SENSOR_GREATER,       //!< value > sensor_threshold
+		SENSOR_LESS,          //!< value < sensor_threshold
+		SENSOR_ABS_LESS,      //!< |value| < sensor_threshold (e.g. The body has settled.)
+		SENSOR_CONDITION_SUM
+	};
+
+	/*!
+		@brief Write the frame to external EEPROM
+
+		@param [in] slot Slot number of a motion.
+
+		@return Result
+	*/
+	bool set(unsigned char slot);
+
+	/*!
+		@brief Read the frame from external EEPROM
+
+		@param [in] slot Slot number of a motion.
+
+		@return Result
+	*/
+	bool get(unsigned char slot);
+
+
+	unsigned short index;                             //!< Index of a frame.
+	unsigned int   transition_time_ms;                //!< Time of transit to the frame.
+	int            joint_angle[JointController::SUM]; //!< Angles.
+
+	/*
+		The following 8 bytes were "device_value", that was never used and written as 0,
+		so frames of old firmware have no event.
+	*/
+	unsigned char  events;           //!< Events of the frame. (EVENT_*)
+	unsigned char  event_code;       //!< Code sent to the host by EVENT_EMIT.
+	unsigned char  sensor_id;        //!< Sensor that EVENT_WAIT_SENSOR waits for. (Acc X, Y, Z, gyro roll, pitch, yaw)
+	unsigned char  sensor_condition; //!< Condition of the sensor. (SENSOR_*)
+	short          sensor_threshold; //!< Threshold of the condition.
+	unsigned short hold_timeout_ms;  //!< Max time to hold the frame, or 0 to hold until released.
+};
+
+
+/*!
+	@brief Installation of a motion, that replaces the motion of its slot at once
+
+	The header and the frames are staged, and the slot is switched to them after the last frame arrived,
+	so an installation broken halfway (e.g. A connection dropped, or power loss.) leaves the old motion.
+	Header::set() and Frame::set() still edit a motion installed in place.
+*/
+class PLEN2::Motion::Installation
+{
+public:
+	/*!
+		@brief Begin an installation
+
+		An installation begun before is discarded.
+
+		@param [in] header Header of the motion.
+
+		@return Result
+	*/
+	static bool begin(const Header& header);
+
+	/*!
+		@brief Append a frame to the installation
+
+		@param [in] frame Please set the frames in order from 0.
+
+		@return Result
+	*/
+	static bool append(const Frame& frame);
+
+	/*!
+		@brief Switch the slot to the motion installed
+
+		@return false if the frames have not arrived, or the motion was not written correctly
+	*/
+	static bool commit();
+
+	//! @brief Discard the installation
+	static void discard();
+
+	//! @brief Get slot of the installation, or SLOT_END
+	static unsigned char slot();
+
+	//! @brief Get count of the frames appended
+	static unsigned short count();
+
+	//! @brief Get frame length of the installation
+	static unsigned short length();
+};
+
+#endif // PLEN2_MOTION_H
@@ -0,0 +1,836 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+#include "Arduino.h"
+#include "FS.h"
+
+#include "MotionBake.h"
+#include "Profiler.h"
+#include "System.h"
+#include "Trace.h"
+
+
+namespace
+{
+	enum {
+		MAGIC_0 = 'P',
+		MAGIC_1 = 'B',
+
+		BLOCK_HEADER_SIZE = 9,
+		MASK_SIZE         = 3,
+		RECORD_SIZE_MAX   = MASK_SIZE + 3 * PLEN2::JointController::SUM,
+		ESCAPE            = 0x80, //!< int8 difference escaped to int16.
+
+		NO_REPEAT = 0xFFFF,
+		PATH_LENGTH = 16
+	};
+
+	//! @brief Mask of all joints
+	const unsigned long JOINT_MASK_ALL = (1UL << PLEN2::JointController::SUM) - 1;
+
+	inline void writeShort(unsigned char data[], unsigned short value)
+	{
+		data[0] = lowByte(value);
+		data[1] = highByte(value);
+	}
+
+	inline unsigned short readShort(const unsigned char data[])
+	{
+		return data[0] | (data[1] << 8);
+	}
+}
+
+
+unsigned char PLEN2::MotionBake::m_baked[PLEN2::MotionBake::DEPENDENCY_SIZE];
+unsigned char PLEN2::MotionBake::m_dependencies[PLEN2::MotionBake::DEPENDENCY_SIZE];
+unsigned char PLEN2::MotionBake::m_generation = 0;
+
+
+void PLEN2::MotionBake::init()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionBake::init()"));
+	#endif
+
+	for (unsigned char index = 0; index < DEPENDENCY_SIZE; index++)
+	{
+		m_baked[index] = 0;
+	}
+
+	Dir dir = SPIFFS.openDir("/bake_");
+
+	while (dir.next())
+	{
+		const String name = dir.fileName();
+		const char* path = name.c_str();
+
+		// "/bake_NN.bin" or "/bake_NNN.bin"
+		if (strncmp(path, "/bake_", 6) != 0)
+		{
+			continue;
+		}
+
+		unsigned int slot = 0;
+		unsigned char digits = 0;
+
+		while (isDigit(path[6 + digits]) && (digits < 3))
+		{
+			slot = slot * 10 + (path[6 + digits] - '0');
+			digits++;
+		}
+
+		if ((digits < 2) || (strcmp(path + 6 + digits, ".bin") != 0))
+		{
+			continue;
+		}
+
+		if (slot < Motion::SLOT_END)
+		{
+			m_baked[slot / 8] |= (1 << (slot % 8));
+		}
+	}
+
+	m_updateDependencies();
+}
+
+
+bool PLEN2::MotionBake::bake(unsigned char slot, JointController& joint_ctrl)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionBake::bake()"));
+	#endif
+
+	if (slot >= Motion::SLOT_END)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment : slot = "));
+			System::debugSerial().println(static_cast<int>(slot));
+		#endif
+
+		return false;
+	}
+
+	remove(slot);
+
+	Motion::Frame first;
+	first.index = 0;
+	first.get(slot);
+
+	/*!
+		@note
+		The walk begins where a live track is entered first, at the boundary of the first frame,
+		so the transition from the pose before the motion is always played live.
+	*/
+	const long interval_us = static_cast<long>(Motion::Frame::UPDATE_INTERVAL_MS) * 1000;
+	unsigned long now_us   = static_cast<unsigned long>(first.transition_time_ms) * 1000;
+	MotionTrack track;
+
+	track.play(slot, first.joint_angle, 0);
+	track.sample(now_us, MotionTrack::RATE_ONE());
+
+	if (!track.nextFrameLoadable() || !track.loadNextFrame())
+	{
+		return false;
+	}
+
+	char path[PATH_LENGTH];
+	m_path(slot, path);
+
+	File file = SPIFFS.open(path, "w");
+
+	if (!file)
+	{
+		return false;
+	}
+
+	unsigned char data[(static_cast<unsigned int>(HEADER_SIZE) > static_cast<unsigned int>(RECORD_SIZE_MAX))? static_cast<unsigned int>(HEADER_SIZE) : static_cast<unsigned int>(RECORD_SIZE_MAX)];
+	short indexes[JointController::SUM];
+
+	for (unsigned char index = 0; index < HEADER_SIZE; index++)
+	{
+		data[index] = 0;
+	}
+
+	for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		indexes[joint_id] = joint_ctrl.angleDiffIndex(joint_id, first.joint_angle[joint_id]);
+		writeShort(data + INDEXES_OFFSET + 2 * joint_id, indexes[joint_id]);
+	}
+
+	// The header is written again after the walk, with its counts.
+	bool written = (file.write(data, HEADER_SIZE) == HEADER_SIZE);
+
+	WalkState states[BLOCK_MAX];
+	unsigned long offsets[BLOCK_MAX];
+	unsigned char dependencies[DEPENDENCY_SIZE] = { 0 };
+	unsigned short block_sum     = 0;
+	unsigned short repeat_block  = NO_REPEAT;
+	unsigned long  repeat_offset = 0;
+	unsigned long  offset        = HEADER_SIZE;
+	unsigned char  previous_slot  = Motion::SLOT_END;
+	unsigned short previous_index = 0;
+
+	while (written)
+	{
+		// A full ring makes the state of the walk independent of when frames were read.
+		while (track.prefetch())
+		{
+			// noop.
+		}
+
+		WalkState state;
+		m_capture(track, previous_slot, previous_index, state);
+
+		for (unsigned short block = 0; block < block_sum; block++)
+		{
+			if (memcmp(&states[block], &state, sizeof(WalkState)) == 0)
+			{
+				repeat_block  = block;
+				repeat_offset = offsets[block];
+
+				break;
+			}
+		}
+
+		if ((repeat_block != NO_REPEAT) || (block_sum == BLOCK_MAX))
+		{
+			break;
+		}
+
+		for (unsigned char buffered = 0; buffered < track.m_buffer_length; buffered++)
+		{
+			const unsigned char read_slot = track.m_bufferedFrame(buffered).slot;
+			dependencies[read_slot / 8] |= (1 << (read_slot % 8));
+		}
+
+		dependencies[track.m_header.slot / 8] |= (1 << (track.m_header.slot % 8));
+
+		states[block_sum]  = state;
+		offsets[block_sum] = offset;
+
+		const long transition_us    = track.transitionUs();
+		const unsigned int record_sum = (transition_us == 0) ? 1 : (transition_us + interval_us - 1) / interval_us;
+
+		data[0] = track.currentSlot();
+		writeShort(data + 1, track.currentFrame().index);
+		data[3] = track.nextSlot();
+		writeShort(data + 4, track.nextFrame().index);
+		writeShort(data + 6, record_sum);
+
+		// Catmull-Rom of the first transition is shaped by the pose before the motion.
+		data[8] = (
+			   (block_sum == 0)
+			&& (track.m_interpolation == Motion::Header::INTERPOLATION_CATMULL_ROM)
+		) ? BLOCK_LIVE : 0;
+
+		written = (file.write(data, BLOCK_HEADER_SIZE) == BLOCK_HEADER_SIZE);
+		offset += BLOCK_HEADER_SIZE;
+
+		for (unsigned int record = 1; written && (record <= record_sum); record++)
+		{
+			const long position_us = min(static_cast<long>(record) * interval_us, transition_us);
+			unsigned long changed_mask = 0;
+			unsigned char length = MASK_SIZE;
+
+			track.sample(now_us + position_us, MotionTrack::RATE_ONE());
+
+			for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+			{
+				const short index = joint_ctrl.angleDiffIndex(joint_id, track.angle(joint_id));
+				const int   diff  = index - indexes[joint_id];
+
+				if (diff == 0)
+				{
+					continue;
+				}
+
+				changed_mask |= (1UL << joint_id);
+				indexes[joint_id] = index;
+
+				if ((diff > -128) && (diff < 128))
+				{
+					data[length++] = static_cast<unsigned char>(diff);
+				}
+				else
+				{
+					data[length++] = ESCAPE;
+					writeShort(data + length, diff);
+					length += 2;
+				}
+			}
+
+			data[0] = (changed_mask      ) & 0xFF;
+			data[1] = (changed_mask >>  8) & 0xFF;
+			data[2] = (changed_mask >> 16) & 0xFF;
+
+			written = (file.write(data, length) == length);
+			offset += length;
+		}
+
+		now_us += transition_us;
+		previous_slot  = track.currentSlot();
+		previous_index = track.currentFrame().index;
+		block_sum++;
+
+		if (!track.nextFrameLoadable() || !track.loadNextFrame())
+		{
+			break;
+		}
+	}
+
+	if (written)
+	{
+		data[0] = MAGIC_0;
+		data[1] = MAGIC_1;
+		data[2] = FORMAT_VERSION;
+		data[3] = Motion::Frame::UPDATE_INTERVAL_MS;
+		writeShort(data + 4, joint_ctrl.settingsChecksum());
+		writeShort(data + 6, block_sum);
+		writeShort(data + 8, repeat_block);
+		writeShort(data + 10, repeat_offset & 0xFFFF);
+		writeShort(data + 12, repeat_offset >> 16);
+
+		for (unsigned char index = 0; index < DEPENDENCY_SIZE; index++)
+		{
+			data[DEPENDENCY_OFFSET + index] = dependencies[index];
+		}
+
+		written = file.seek(0, SeekSet) && (file.write(data, INDEXES_OFFSET) == INDEXES_OFFSET);
+	}
+
+	file.close();
+
+	if (!written)
+	{
+		SPIFFS.remove(path);
+
+		return false;
+	}
+
+	m_baked[slot / 8] |= (1 << (slot % 8));
+
+	for (unsigned char index = 0; index < DEPENDENCY_SIZE; index++)
+	{
+		m_dependencies[index] |= dependencies[index];
+	}
+
+	#if DEBUG
+		System::debugSerial().print(F(">>> baked : blocks = "));
+		System::debugSerial().print(block_sum);
+		System::debugSerial().print(F(", bytes = "));
+		System::debugSerial().println(offset);
+	#endif
+
+	return true;
+}
+
+
+void PLEN2::MotionBake::remove(unsigned char slot)
+{
+	if (!baked(slot))
+	{
+		return;
+	}
+
+	m_delete(slot);
+	m_updateDependencies();
+}
+
+
+void PLEN2::MotionBake::invalidate(unsigned char slot)
+{
+	if ((slot >= Motion::SLOT_END) || !(m_dependencies[slot / 8] & (1 << (slot % 8))))
+	{
+		return;
+	}
+
+	unsigned char dependencies[DEPENDENCY_SIZE];
+
+	for (unsigned char baked_slot = 0; baked_slot < Motion::SLOT_END; baked_slot++)
+	{
+		if (!baked(baked_slot))
+		{
+			continue;
+		}
+
+		if (   !m_readDependencies(baked_slot, dependencies)
+			|| (dependencies[slot / 8] & (1 << (slot % 8)))
+		)
+		{
+			m_delete(baked_slot);
+		}
+	}
+
+	m_updateDependencies();
+}
+
+
+bool PLEN2::MotionBake::baked(unsigned char slot)
+{
+	if (slot >= Motion::SLOT_END)
+	{
+		return false;
+	}
+
+	return (m_baked[slot / 8] & (1 << (slot % 8)));
+}
+
+
+void PLEN2::MotionBake::m_capture(MotionTrack& track, unsigned char previous_slot, unsigned short previous_index, WalkState& state)
+{
+	for (unsigned char offset = 0; offset < MotionTrack::FRAMEBUFFER_LENGTH; offset++)
+	{
+		if (offset < track.m_buffer_length)
+		{
+			const MotionTrack::BufferedFrame& buffered = track.m_bufferedFrame(offset);
+
+			state.frame_slots[offset]   = buffered.slot;
+			state.frame_indexes[offset] = buffered.frame.index;
+		}
+		else
+		{
+			state.frame_slots[offset]   = Motion::SLOT_END;
+			state.frame_indexes[offset] = 0;
+		}
+	}
+
+	state.previous_slot  = previous_slot;
+	state.previous_index = previous_index;
+	state.header_slot    = track.m_header.slot;
+	state.loop_count     = track.m_header.loop_count;
+	state.loop_flags     = (track.m_header.use_loop << 1) | track.m_header.use_jump;
+	state.prefetch_index = track.m_prefetch_index;
+	state.prefetch_flags = (track.m_prefetch_resolved << 1) | track.m_prefetch_finished;
+	state.reserved       = 0;
+}
+
+
+void PLEN2::MotionBake::m_path(unsigned char slot, char path[])
+{
+	snprintf(path, PATH_LENGTH, "/bake_%02d.bin", static_cast<int>(slot));
+}
+
+
+void PLEN2::MotionBake::m_delete(unsigned char slot)
+{
+	char path[PATH_LENGTH];
+	m_path(slot, path);
+
+	SPIFFS.remove(path);
+
+	m_baked[slot / 8] &= ~(1 << (slot % 8));
+
+	// An open player of the motion must never read the file again.
+	m_generation++;
+}
+
+
+bool PLEN2::MotionBake::m_readDependencies(unsigned char slot, unsigned char dependencies[])
+{
+	char path[PATH_LENGTH];
+	m_path(slot, path);
+
+	File file = SPIFFS.open(path, "r");
+
+	if (!file)
+	{
+		return false;
+	}
+
+	unsigned char data[3];
+
+	// A file of other version has the bitmap elsewhere, so it can't tell its dependencies.
+	const bool result = (file.read(data, sizeof(data)) == sizeof(data))
+		&& (data[0] == MAGIC_0) && (data[1] == MAGIC_1) && (data[2] == FORMAT_VERSION)
+		&& file.seek(DEPENDENCY_OFFSET, SeekSet)
+		&& (file.read(dependencies, DEPENDENCY_SIZE) == DEPENDENCY_SIZE);
+	file.close();
+
+	return result;
+}
+
+
+void PLEN2::MotionBake::m_updateDependencies()
+{
+	unsigned char dependencies[DEPENDENCY_SIZE];
+
+	for (unsigned char index = 0; index < DEPENDENCY_SIZE; index++)
+	{
+		m_dependencies[index] = 0;
+	}
+
+	for (unsigned char slot = 0; slot < Motion::SLOT_END; slot++)
+	{
+		if (!baked(slot))
+		{
+			continue;
+		}
+
+		if (!m_readDependencies(slot, dependencies))
+		{
+			// A file that can't tell its dependencies can't be invalidated, so it is never kept.
+			m_delete(slot);
+
+			continue;
+		}
+
+		for (unsigned char index = 0; index < DEPENDENCY_SIZE; index++)
+		{
+			m_dependencies[index] |= dependencies[index];
+		}
+	}
+}
+
+
+PLEN2::MotionBake::Player::Player()
+{
+	m_opened  = false;
+	m_entered = false;
+	m_generation = 0;
+
+	m_block_sum     = 0;
+	m_block         = 0;
+	m_repeat_block  = NO_REPEAT;
+	m_repeat_offset = 0;
+	m_file_offset   = 0;
+	m_file_size     = 0;
+
+	m_buffer_begin  = 0;
+	m_buffer_length = 0;
+
+	m_record_sum   = 0;
+	m_record       = 0;
+	m_changed_mask = 0;
+	m_stalls       = 0;
+
+	for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		m_indexes[joint_id] = 0;
+	}
+}
+
+
+bool PLEN2::MotionBake::Player::open(unsigned char slot, JointController& joint_ctrl)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionBake::Player::open()"));
+	#endif
+
+	close();
+
+	if (!baked(slot))
+	{
+		return false;
+	}
+
+	char path[PATH_LENGTH];
+	m_path(slot, path);
+
+	m_file = SPIFFS.open(path, "r");
+
+	if (!m_file)
+	{
+		return false;
+	}
+
+	unsigned char data[HEADER_SIZE];
+
+	if (   (m_file.read(data, HEADER_SIZE) != HEADER_SIZE)
+		|| (data[0] != MAGIC_0) || (data[1] != MAGIC_1) || (data[2] != FORMAT_VERSION)
+		|| (data[3] != Motion::Frame::UPDATE_INTERVAL_MS)
+		|| (readShort(data + 4) != joint_ctrl.settingsChecksum())
+	)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> stale bake : slot = "));
+			System::debugSerial().println(static_cast<int>(slot));
+		#endif
+
+		m_file.close();
+		remove(slot);
+
+		return false;
+	}
+
+	m_block_sum     = readShort(data + 6);
+	m_repeat_block  = readShort(data + 8);
+	m_repeat_offset = readShort(data + 10) | (static_cast<unsigned long>(readShort(data + 12)) << 16);
+	m_file_offset   = HEADER_SIZE;
+	m_file_size     = m_file.size();
+
+	for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		m_indexes[joint_id] = readShort(data + INDEXES_OFFSET + 2 * joint_id);
+	}
+
+	m_buffer_begin  = 0;
+	m_buffer_length = 0;
+	m_block         = 0;
+	m_record_sum    = 0;
+	m_record        = 0;
+
+	// The first seek() writes every joint, so the replay never depends on the pose before it.
+	m_changed_mask = JOINT_MASK_ALL;
+	m_generation   = MotionBake::m_generation;
+	m_opened       = true;
+	m_entered      = false;
+
+	return true;
+}
+
+
+void PLEN2::MotionBake::Player::close()
+{
+	if (m_opened)
+	{
+		m_file.close();
+	}
+
+	m_opened  = false;
+	m_entered = false;
+}
+
+
+bool PLEN2::MotionBake::Player::enter(unsigned char current_slot, unsigned short current_index,
+	unsigned char next_slot, unsigned short next_index)
+{
+	TRACE_SCOPE("MotionBake::Player::enter()");
+
+	if (!m_opened || (m_generation != MotionBake::m_generation))
+	{
+		close();
+
+		return false;
+	}
+
+	// The records left in the block must be consumed, because the stream is read in order.
+	if (m_entered)
+	{
+		unsigned long changed_mask;
+
+		if (!seek(m_record_sum, changed_mask))
+		{
+			return false;
+		}
+
+		m_changed_mask = changed_mask;
+	}
+
+	if (m_block == m_block_sum)
+	{
+		if (m_repeat_block == NO_REPEAT)
+		{
+			close();
+
+			return false;
+		}
+
+		m_block = m_repeat_block;
+	}
+
+	unsigned char data[BLOCK_HEADER_SIZE];
+
+	if (   !m_read(data, BLOCK_HEADER_SIZE)
+		|| (data[0] != current_slot) || (readShort(data + 1) != current_index)
+		|| (data[3] != next_slot)    || (readShort(data + 4) != next_index)
+	)
+	{
+		close();
+
+		return false;
+	}
+
+	m_record_sum = readShort(data + 6);
+	m_record     = 0;
+	m_block++;
+	m_entered = true;
+
+	// The block is only consumed, and the track plays it live.
+	if (data[8] & BLOCK_LIVE)
+	{
+		unsigned long changed_mask;
+
+		if (!seek(m_record_sum, changed_mask))
+		{
+			return false;
+		}
+
+		m_changed_mask = JOINT_MASK_ALL;
+		m_entered      = false;
+	}
+
+	return true;
+}
+
+
+bool PLEN2::MotionBake::Player::seek(unsigned int tick, unsigned long& changed_mask)
+{
+	TRACE_SCOPE("MotionBake::Player::seek()");
+
+	if (m_generation != MotionBake::m_generation)
+	{
+		close();
+
+		return false;
+	}
+
+	if (tick > m_record_sum)
+	{
+		tick = m_record_sum;
+	}
+
+	while (m_record < tick)
+	{
+		if (!m_decode())
+		{
+			close();
+
+			return false;
+		}
+
+		m_record++;
+	}
+
+	changed_mask   = m_changed_mask;
+	m_changed_mask = 0;
+
+	return true;
+}
+
+
+bool PLEN2::MotionBake::Player::prefetch()
+{
+	TRACE_SCOPE("MotionBake::Player::prefetch()");
+
+	if (!m_opened || ((RING_LENGTH - m_buffer_length) < CHUNK_LENGTH))
+	{
+		return false;
+	}
+
+	// The stream goes on from the block to repeat, so the ring never sees the end of a looping motion.
+	if (m_file_offset >= m_file_size)
+	{
+		if ((m_repeat_block == NO_REPEAT) || !m_file.seek(m_repeat_offset, SeekSet))
+		{
+			return false;
+		}
+
+		m_file_offset = m_repeat_offset;
+	}
+
+	const unsigned char tail = (m_buffer_begin + m_buffer_length) & (RING_LENGTH - 1);
+	unsigned char length = CHUNK_LENGTH;
+
+	if (length > (RING_LENGTH - tail))
+	{
+		length = RING_LENGTH - tail;
+	}
+
+	if (length > (m_file_size - m_file_offset))
+	{
+		length = m_file_size - m_file_offset;
+	}
+
+	if (m_file.read(m_buffer + tail, length) != length)
+	{
+		return false;
+	}
+
+	m_file_offset   += length;
+	m_buffer_length += length;
+
+	return true;
+}
+
+
+bool PLEN2::MotionBake::Player::m_read(unsigned char data[], unsigned char length)
+{
+	if (!m_fill(length))
+	{
+		return false;
+	}
+
+	for (unsigned char index = 0; index < length; index++)
+	{
+		data[index] = m_buffer[m_buffer_begin];
+		m_buffer_begin = (m_buffer_begin + 1) & (RING_LENGTH - 1);
+	}
+
+	m_buffer_length -= length;
+
+	return true;
+}
+
+
+bool PLEN2::MotionBake::Player::m_fill(unsigned char length)
+{
+	if (m_buffer_length >= length)
+	{
+		return true;
+	}
+
+	m_stalls++;
+
+	while (m_buffer_length < length)
+	{
+		if (!prefetch())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool PLEN2::MotionBake::Player::m_decode()
+{
+	unsigned char data[MASK_SIZE];
+
+	if (!m_read(data, MASK_SIZE))
+	{
+		return false;
+	}
+
+	const unsigned long record_mask =
+		  (static_cast<unsigned long>(data[0])      )
+		| (static_cast<unsigned long>(data[1]) <<  8)
+		| (static_cast<unsigned long>(data[2]) << 16);
+
+	for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		if (!(record_mask & (1UL << joint_id)))
+		{
+			continue;
+		}
+
+		if (!m_read(data, 1))
+		{
+			return false;
+		}
+
+		if (data[0] == ESCAPE)
+		{
+			if (!m_read(data, 2))
+			{
+				return false;
+			}
+
+			m_indexes[joint_id] += static_cast<short>(readShort(data));
+		}
+		else
+		{
+			m_indexes[joint_id] += static_cast<signed char>(data[0]);
+		}
+	}
+
+	m_changed_mask |= record_mask;
+
+	return true;
+}
@@ -0,0 +1,277 @@
+/*!
+	@file      MotionBake.h
+	@brief     Motions baked into streams of joint outputs per tick.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef PLEN2_MOTION_BAKE_H
+#define PLEN2_MOTION_BAKE_H
+
+#include "FS.h"
+
+#include "JointController.h"
+#include "Motion.h"
+#include "MotionTrack.h"
+
+
+namespace PLEN2
+{
+	class MotionBake;
+}
+
+/*!
+	@brief Motions baked into streams of joint outputs per tick
+
+	A motion is walked offline from its first frame through "loop" and "jump",
+	and every tick of every transition is stored as indexes of the PWM tables,
+	interpolated and trimmed by the calibration already.
+	Replaying a baked motion costs a few bytes decoded per tick instead of interpolating and trimming every joint.
+
+	Indexes are stored instead of PWM values, so the slew limits and the output profiles are still applied
+	by the output vector as they are to live motions.
+
+	A file "/bake_NN.bin" is stored for the slot NN (in decimal) next to "motions.bin".
+	@code
+	offset  size  content
+	     0     2  Magic. ("PB")
+	     2     1  Version.
+	     3     1  Motion::Frame::UPDATE_INTERVAL_MS that the motion was baked at.
+	     4     2  JointController::settingsChecksum() that the motion was baked under.
+	     6     2  Count of the blocks.
+	     8     2  Block that the stream repeats from after the last one, or 0xFFFF.
+	    10     4  Offset of the block to repeat from.
+	    14    32  Bitmap of the slots read to bake the motion.
+	    46    48  Indexes of the joints at the first frame, int16 each.
+	    94        Blocks.
+	@endcode
+
+	A block is a transition of the walk.
+	@code
+	offset  size  content
+	     0     3  Slot and index (uint16) of current-frame.
+	     3     3  Slot and index (uint16) of next-frame.
+	     6     2  Count of the records. (Ticks of the transition)
+	     8     1  Flags. (BLOCK_LIVE)
+	     9        Records.
+	@endcode
+
+	A record is indexes at a tick of the transition, as differences from the tick before it.
+	It begins with a 24 bit mask of the joints changed, followed by an int8 difference for each of them.
+	A difference out of int8 is escaped by -128, and followed by an int16.
+	The last record of a block is the pose of next-frame exactly.
+
+	A motion looping forever is baked until the walk returns to a state it has passed,
+	and the stream repeats from there. A walk that neither ends nor repeats in BLOCK_MAX transitions
+	is baked partly, and the motion is played live after the stream ends.
+
+	Writing a motion that a baked motion has read, deletes the file.
+	A file baked under other calibration is deleted when it is opened.
+
+	@attention
+	The class is not guarded against interruptions, so please use it from the main loop only.
+*/
+class PLEN2::MotionBake
+{
+public:
+	enum {
+		FORMAT_VERSION = 2,  //!< Version of the file format.
+		BLOCK_MAX      = 32  //!< Max transitions baked.
+	};
+
+	/*!
+		@brief Find the motions baked
+
+		@attention
+		Please call the method after ExternalFs::init().
+	*/
+	static void init();
+
+	/*!
+		@brief Bake a motion
+
+		The method reads the whole motion and writes a file, so please never call it while a motion is playing.
+
+		@param [in] slot       Number of a motion.
+		@param [in] joint_ctrl An instance of joint controller.
+
+		@return Result
+		@retval false The motion has no transition after the first frame, or the file could not be written.
+	*/
+	static bool bake(unsigned char slot, JointController& joint_ctrl);
+
+	/*!
+		@brief Delete a baked motion
+
+		@param [in] slot Number of a motion.
+	*/
+	static void remove(unsigned char slot);
+
+	/*!
+		@brief Delete the baked motions that have read a motion
+
+		Motion::Header::set() and Motion::Frame::set() call the method by themselves.
+
+		@param [in] slot Number of a motion written.
+	*/
+	static void invalidate(unsigned char slot);
+
+	//! @brief Decide a motion is baked
+	static bool baked(unsigned char slot);
+
+	/*!
+		@brief Flags of a block
+	*/
+	enum {
+		BLOCK_LIVE = 0x01 //!< The transition depends on the pose before the motion, so it is played live.
+	};
+
+	/*!
+		@brief Replay of a baked motion
+
+		The player follows a live track: it is entered at every boundary of the track,
+		and checks the transition baked is the one the track goes,
+		so the track can take over at any tick when the player is closed.
+
+		The file is read ahead into a ring by prefetch() between ticks.
+	*/
+	class Player
+	{
+	public:
+		/*!
+			@brief Constructor
+		*/
+		Player();
+
+		/*!
+			@brief Open a baked motion
+
+			@param [in] slot       Number of a motion.
+			@param [in] joint_ctrl An instance of joint controller.
+
+			@return false if the motion is not baked, or baked under other calibration
+		*/
+		bool open(unsigned char slot, JointController& joint_ctrl);
+
+		//! @brief Close the motion
+		void close();
+
+		//! @brief Decide a motion is opened
+		bool opened() const { return m_opened; }
+
+		/*!
+			@brief Go to the next block
+
+			The player is closed if the block is not the transition given.
+
+			@param [in] current_slot  Slot of the frame that the transition starts from.
+			@param [in] current_index Index of the frame that the transition starts from.
+			@param [in] next_slot     Slot of the frame that the transition arrives at.
+			@param [in] next_index    Index of the frame that the transition arrives at.
+
+			@return Result
+		*/
+		bool enter(unsigned char current_slot, unsigned short current_index,
+			unsigned char next_slot, unsigned short next_index);
+
+		//! @brief Decide a block is entered, so seek() is available
+		bool engaged() const { return m_opened && m_entered; }
+
+		/*!
+			@brief Decode the records until a tick of the block
+
+			@param [in]  tick          Tick from the beginning of the transition.
+			@param [out] changed_mask  Bit N is set if index of joint N changed after the last seek().
+
+			@return false if the file is broken (The player is closed.)
+		*/
+		bool seek(unsigned int tick, unsigned long& changed_mask);
+
+		//! @brief Get indexes of the joints at the tick sought last
+		const short* indexes() const { return m_indexes; }
+
+		/*!
+			@brief Read ahead a chunk of the file
+
+			@return true if a chunk was read
+		*/
+		bool prefetch();
+
+		//! @brief Get count of ticks that waited for the file
+		unsigned long stalls() const { return m_stalls; }
+
+	private:
+		enum {
+			RING_LENGTH  = 128, //!< Depth of the byte ring. (Must be power of 2.)
+			CHUNK_LENGTH  = 32   //!< Bytes read ahead at a time.
+		};
+
+		bool m_read(unsigned char data[], unsigned char length);
+		bool m_fill(unsigned char length);
+		bool m_decode();
+
+		File           m_file;
+		bool           m_opened;
+		bool           m_entered;
+		unsigned char  m_generation;  //!< MotionBake::m_generation at open().
+
+		unsigned short m_block_sum;
+		unsigned short m_block;       //!< Blocks entered.
+		unsigned short m_repeat_block;
+		unsigned long  m_repeat_offset;
+		unsigned long  m_file_offset; //!< Offset that the ring is read ahead to.
+		unsigned long  m_file_size;
+
+		unsigned char  m_buffer[RING_LENGTH];
+		unsigned char  m_buffer_begin;
+		unsigned char  m_buffer_length;
+
+		unsigned int   m_record_sum;  //!< Records of the block entered.
+		unsigned int   m_record;      //!< Records decoded in the block.
+		short          m_indexes[JointController::SUM];
+		unsigned long  m_changed_mask;
+		unsigned long  m_stalls;
+	};
+
+private:
+	enum {
+		DEPENDENCY_OFFSET = 14,
+		DEPENDENCY_SIZE   = (Motion::SLOT_END + 7) / 8,
+		INDEXES_OFFSET    = DEPENDENCY_OFFSET + DEPENDENCY_SIZE,
+		HEADER_SIZE       = INDEXES_OFFSET + 2 * JointController::SUM
+	};
+
+	/*!
+		@brief State of a walk at a boundary, that decides the rest of the walk
+
+		It has no padding, so states are compared by memcmp().
+	*/
+	class WalkState
+	{
+	public:
+		unsigned short frame_indexes[MotionTrack::FRAMEBUFFER_LENGTH]; //!< Indexes of the frames in the ring of the track.
+		unsigned short previous_index; //!< Index of the frame before current-frame.
+		unsigned short prefetch_index;
+		unsigned char  frame_slots[MotionTrack::FRAMEBUFFER_LENGTH];   //!< Slots of the frames in the ring of the track.
+		unsigned char  previous_slot;  //!< Slot of the frame before current-frame.
+		unsigned char  header_slot;    //!< Slot that the prefetcher walks.
+		unsigned char  loop_count;
+		unsigned char  loop_flags;     //!< use_loop and use_jump.
+		unsigned char  prefetch_flags; //!< The prefetcher has resolved, or finished.
+		unsigned char  reserved;       //!< Always 0. (It fills the padding.)
+	};
+
+	static void m_capture(MotionTrack& track, unsigned char previous_slot, unsigned short previous_index, WalkState& state);
+	static void m_path(unsigned char slot, char path[]);
+	static void m_delete(unsigned char slot);
+	static bool m_readDependencies(unsigned char slot, unsigned char dependencies[]);
+	static void m_updateDependencies();
+
+	static unsigned char m_baked[DEPENDENCY_SIZE];
+	static unsigned char m_dependencies[DEPENDENCY_SIZE]; //!< Union of the slots that the baked motions have read.
+	static unsigned char m_generation;                    //!< Count of deletions, to close players.
+};
+
+#endif // PLEN2_MOTION_BAKE_H
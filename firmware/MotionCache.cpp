@@ -0,0 +1,278 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+#include "Arduino.h"
+
+#include "MotionCache.h"
+#include "System.h"
+#include "Trace.h"
+
+
+PLEN2::MotionCache::HeaderEntry PLEN2::MotionCache::m_headers[PLEN2::MotionCache::HEADER_SUM];
+PLEN2::MotionCache::FrameEntry  PLEN2::MotionCache::m_frames[PLEN2::MotionCache::FRAME_SUM];
+unsigned char PLEN2::MotionCache::m_pinned[(PLEN2::Motion::SLOT_END + 7) / 8];
+unsigned long PLEN2::MotionCache::m_clock     = 0;
+unsigned long PLEN2::MotionCache::m_hits      = 0;
+unsigned long PLEN2::MotionCache::m_misses    = 0;
+unsigned long PLEN2::MotionCache::m_evictions = 0;
+
+
+template<typename Entry>
+Entry* PLEN2::MotionCache::m_victim(Entry entries[], int entry_sum)
+{
+	Entry* victim_ptr = NULL;
+
+	for (int index = 0; index < entry_sum; index++)
+	{
+		Entry& entry = entries[index];
+
+		if (entry.key == 0)
+		{
+			return &entry;
+		}
+
+		if (pinned(entry.key - 1))
+		{
+			continue;
+		}
+
+		// Compare ages instead of clocks, so a wrapped clock keeps the order.
+		if (   (victim_ptr == NULL)
+			|| ((m_clock - entry.used) > (m_clock - victim_ptr->used))
+		)
+		{
+			victim_ptr = &entry;
+		}
+	}
+
+	if (victim_ptr != NULL)
+	{
+		m_evictions++;
+	}
+
+	return victim_ptr;
+}
+
+
+bool PLEN2::MotionCache::loadHeader(Motion::Header& header)
+{
+	TRACE_SCOPE("MotionCache::loadHeader()");
+
+	for (int index = 0; index < HEADER_SUM; index++)
+	{
+		HeaderEntry& entry = m_headers[index];
+
+		if (entry.key == (header.slot + 1))
+		{
+			header     = entry.header;
+			entry.used = ++m_clock;
+			m_hits++;
+
+			return true;
+		}
+	}
+
+	m_misses++;
+
+	return false;
+}
+
+
+void PLEN2::MotionCache::storeHeader(const Motion::Header& header)
+{
+	TRACE_SCOPE("MotionCache::storeHeader()");
+
+	if (header.slot >= Motion::SLOT_END)
+	{
+		return;
+	}
+
+	HeaderEntry* entry_ptr = m_victim(m_headers, HEADER_SUM);
+
+	if (entry_ptr == NULL)
+	{
+		return;
+	}
+
+	entry_ptr->header = header;
+	entry_ptr->key    = header.slot + 1;
+	entry_ptr->used   = ++m_clock;
+}
+
+
+bool PLEN2::MotionCache::loadFrame(unsigned char slot, Motion::Frame& frame)
+{
+	TRACE_SCOPE("MotionCache::loadFrame()");
+
+	for (int index = 0; index < FRAME_SUM; index++)
+	{
+		FrameEntry& entry = m_frames[index];
+
+		if ((entry.key == (slot + 1)) && (entry.frame.index == frame.index))
+		{
+			frame      = entry.frame;
+			entry.used = ++m_clock;
+			m_hits++;
+
+			return true;
+		}
+	}
+
+	m_misses++;
+
+	return false;
+}
+
+
+void PLEN2::MotionCache::storeFrame(unsigned char slot, const Motion::Frame& frame)
+{
+	TRACE_SCOPE("MotionCache::storeFrame()");
+
+	if (slot >= Motion::SLOT_END)
+	{
+		return;
+	}
+
+	FrameEntry* entry_ptr = m_victim(m_frames, FRAME_SUM);
+
+	if (entry_ptr == NULL)
+	{
+		return;
+	}
+
+	entry_ptr->frame = frame;
+	entry_ptr->key   = slot + 1;
+	entry_ptr->used  = ++m_clock;
+}
+
+
+void PLEN2::MotionCache::invalidate(unsigned char slot)
+{
+	for (int index = 0; index < HEADER_SUM; index++)
+	{
+		if (m_headers[index].key == (slot + 1))
+		{
+			m_headers[index].key = 0;
+		}
+	}
+
+	for (int index = 0; index < FRAME_SUM; index++)
+	{
+		if (m_frames[index].key == (slot + 1))
+		{
+			m_frames[index].key = 0;
+		}
+	}
+}
+
+
+void PLEN2::MotionCache::invalidateFrame(unsigned char slot, unsigned short index)
+{
+	for (int entry_index = 0; entry_index < FRAME_SUM; entry_index++)
+	{
+		FrameEntry& entry = m_frames[entry_index];
+
+		if ((entry.key == (slot + 1)) && (entry.frame.index == index))
+		{
+			entry.key = 0;
+		}
+	}
+}
+
+
+void PLEN2::MotionCache::clear()
+{
+	for (int index = 0; index < HEADER_SUM; index++)
+	{
+		m_headers[index].key = 0;
+	}
+
+	for (int index = 0; index < FRAME_SUM; index++)
+	{
+		m_frames[index].key = 0;
+	}
+}
+
+
+bool PLEN2::MotionCache::pin(unsigned char slot, bool pinned)
+{
+	if (slot >= Motion::SLOT_END)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment : slot = "));
+			System::debugSerial().println(static_cast<int>(slot));
+		#endif
+
+		return false;
+	}
+
+	if (pinned)
+	{
+		m_pinned[slot / 8] |= (1 << (slot % 8));
+	}
+	else
+	{
+		m_pinned[slot / 8] &= ~(1 << (slot % 8));
+	}
+
+	return true;
+}
+
+
+bool PLEN2::MotionCache::pinned(unsigned char slot)
+{
+	if (slot >= Motion::SLOT_END)
+	{
+		return false;
+	}
+
+	return (m_pinned[slot / 8] & (1 << (slot % 8))) != 0;
+}
+
+
+unsigned long PLEN2::MotionCache::hits()
+{
+	return m_hits;
+}
+
+
+unsigned long PLEN2::MotionCache::misses()
+{
+	return m_misses;
+}
+
+
+unsigned long PLEN2::MotionCache::evictions()
+{
+	return m_evictions;
+}
+
+
+unsigned char PLEN2::MotionCache::frameCount()
+{
+	unsigned char count = 0;
+
+	for (int index = 0; index < FRAME_SUM; index++)
+	{
+		if (m_frames[index].key != 0)
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
+
+void PLEN2::MotionCache::resetCounters()
+{
+	m_hits      = 0;
+	m_misses    = 0;
+	m_evictions = 0;
+}
@@ -0,0 +1,154 @@
+/*!
+	@file      MotionCache.h
+	@brief     RAM cache of decoded motions.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef PLEN2_MOTION_CACHE_H
+#define PLEN2_MOTION_CACHE_H
+
+#include "Motion.h"
+
+
+namespace PLEN2
+{
+	class MotionCache;
+}
+
+/*!
+	@brief RAM cache of decoded motions
+
+	Headers and frames are cached one by one in fixed pools,
+	so a long motion and many short motions share the same budget.
+	The least recently used entry is evicted first, except entries of pinned slots.
+
+	Motion::Header::get() and Motion::Frame::get() consult the cache by themselves,
+	and Motion::Header::set() and Motion::Frame::set() invalidate it.
+
+	@attention
+	The class is not guarded against interruptions, so please use it from the main loop only.
+*/
+class PLEN2::MotionCache
+{
+public:
+	enum {
+		HEADER_SUM = 8,  //!< Capacity of headers.
+		FRAME_SUM  = 40  //!< Capacity of frames. (About 4.5 KB of RAM.)
+	};
+
+	/*!
+		@brief Read a header from the cache
+
+		@param [in, out] header Please set slot of the header.
+
+		@return true if the header was cached
+	*/
+	static bool loadHeader(Motion::Header& header);
+
+	/*!
+		@brief Store a header read from external EEPROM
+
+		@param [in] header Header to store.
+	*/
+	static void storeHeader(const Motion::Header& header);
+
+	/*!
+		@brief Read a frame from the cache
+
+		@param [in]      slot  Slot number of a motion.
+		@param [in, out] frame Please set index of the frame.
+
+		@return true if the frame was cached
+	*/
+	static bool loadFrame(unsigned char slot, Motion::Frame& frame);
+
+	/*!
+		@brief Store a frame read from external EEPROM
+
+		@param [in] slot  Slot number of a motion.
+		@param [in] frame Frame to store.
+	*/
+	static void storeFrame(unsigned char slot, const Motion::Frame& frame);
+
+	/*!
+		@brief Discard a header and all frames of a motion
+
+		@param [in] slot Slot number of a motion.
+	*/
+	static void invalidate(unsigned char slot);
+
+	/*!
+		@brief Discard a frame
+
+		@param [in] slot  Slot number of a motion.
+		@param [in] index Index of the frame.
+	*/
+	static void invalidateFrame(unsigned char slot, unsigned short index);
+
+	//! @brief Discard all entries
+	static void clear();
+
+	/*!
+		@brief Pin or unpin a motion
+
+		Entries of a pinned motion are never evicted, so the motion plays without reading external EEPROM
+		after it was read once.
+
+		@param [in] slot   Slot number of a motion.
+		@param [in] pinned Please set true to pin.
+
+		@return Result
+	*/
+	static bool pin(unsigned char slot, bool pinned);
+
+	//! @brief Decide a motion is pinned
+	static bool pinned(unsigned char slot);
+
+	//! @brief Get count of reads that the cache answered
+	static unsigned long hits();
+
+	//! @brief Get count of reads that went to external EEPROM
+	static unsigned long misses();
+
+	//! @brief Get count of entries evicted to store others
+	static unsigned long evictions();
+
+	//! @brief Get count of frames in the cache
+	static unsigned char frameCount();
+
+	//! @brief Reset hits(), misses() and evictions()
+	static void resetCounters();
+
+private:
+	class HeaderEntry
+	{
+	public:
+		Motion::Header header;
+		unsigned char  key;  //!< Slot number + 1, or 0 if the entry is empty.
+		unsigned long  used; //!< Clock of the last access.
+	};
+
+	class FrameEntry
+	{
+	public:
+		Motion::Frame frame;
+		unsigned char key;   //!< Slot number + 1, or 0 if the entry is empty.
+		unsigned long used;  //!< Clock of the last access.
+	};
+
+	template<typename Entry>
+	static Entry* m_victim(Entry entries[], int entry_sum);
+
+	static HeaderEntry   m_headers[HEADER_SUM];
+	static FrameEntry    m_frames[FRAME_SUM];
+	static unsigned char m_pinned[(Motion::SLOT_END + 7) / 8];
+	static unsigned long m_clock;
+	static unsigned long m_hits;
+	static unsigned long m_misses;
+	static unsigned long m_evictions;
+};
+
+#endif // PLEN2_MOTION_CACHE_H
@@ -1,360 +1,871 @@
-/*
-        Copyright (c) 2015,
-        - Kazuyuki TAKASE - https://github.com/junbowu
-        - PLEN Project Company Inc. - https://plen.jp
-
-        This software is released under the MIT License.
-        (See also : http://opensource.org/licenses/mit-license.php)
-*/
-#include <Arduino.h>
-
-#include "ExternalFs.h"
-#include "JointController.h"
-#include "Motion.h"
-#include "MotionController.h"
-#include "Profiler.h"
-#include "System.h"
-
-
-namespace {
-enum { PRECISION = 16 };
-
-inline const long fixed_cast(const int value) {
-  return (static_cast<long>(value) << PRECISION);
-}
-
-inline const int unfixed_cast(const long value) {
-  return static_cast<int>(value >> PRECISION);
-}
-} // namespace
-
-PLEN2::MotionController::MotionController(JointController &joint_ctrl) {
-  m_joint_ctrl_ptr = &joint_ctrl;
-
-  m_playing = false;
-  m_frame_current_ptr = m_buffer;
-  m_frame_next_ptr = m_buffer + 1;
-  m_speed_percent = 100;
-
-  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
-    m_frame_current_ptr->joint_angle[joint_id] = 0;
-  }
-}
-
-bool PLEN2::MotionController::playing() {
-#if DEBUG_HARD
-  volatile Utility::Profiler p(F("MotionController::playing()"));
-#endif
-
-  return m_playing;
-}
-
-bool PLEN2::MotionController::frameUpdatable() {
-#if DEBUG_HARD
-  volatile Utility::Profiler p(F("MotionController::frameUpdatable()"));
-#endif
-
-  return m_joint_ctrl_ptr->m_1cycle_finished;
-}
-
-bool PLEN2::MotionController::updatingFinished() {
-#if DEBUG_HARD
-  volatile Utility::Profiler p(F("MotionController::updatingFinished()"));
-#endif
-
-  return (m_transition_count == 0);
-}
-
-bool PLEN2::MotionController::nextFrameLoadable() {
-#if DEBUG_HARD
-  volatile Utility::Profiler p(F("MotionController::nextFrameLoadable()"));
-#endif
-
-  if ((m_header.use_loop) || (m_header.use_jump)) {
-    return true;
-  }
-
-  return ((m_frame_next_ptr->index + 1) < m_header.frame_length);
-}
-
-void PLEN2::MotionController::play(unsigned char slot) {
-#if DEBUG
-  volatile Utility::Profiler p(F("MotionController::play()"));
-#endif
-
-  if (playing()) {
-#if DEBUG
-    System::debugSerial().println(F(">>> error : A motion has been playing."));
-#endif
-
-    return;
-  }
-
-  if (slot >= Motion::SLOT_END) {
-#if DEBUG
-    System::debugSerial().print(F(">>> bad argment : slot = "));
-    System::debugSerial().println(static_cast<int>(slot));
-#endif
-
-    return;
-  }
-
-  m_header.slot = slot;
-  m_header.get();
-
-  m_setupFrame(0);
-
-  m_playing = true;
-}
-
-void PLEN2::MotionController::willStop() {
-#if DEBUG
-  volatile Utility::Profiler p(F("MotionController::willStop()"));
-#endif
-
-  m_header.use_loop = 0;
-  m_header.use_jump = 0;
-}
-
-void PLEN2::MotionController::stop() {
-#if DEBUG
-  volatile Utility::Profiler p(F("MotionController::stop()"));
-#endif
-
-  m_playing = false;
-  m_bufferingFrame(); // @attension It is necessary for a valid sequence!
-}
-
-void PLEN2::MotionController::updateFrame() {
-#if DEBUG
-  volatile Utility::Profiler p(F("MotionController::updateFrame()"));
-#endif
-
-  m_transition_count--;
-
-  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
-    m_current_fixed_points[joint_id] += m_diff_fixed_points[joint_id];
-    m_joint_ctrl_ptr->setAngleDiff(
-        joint_id, unfixed_cast(m_current_fixed_points[joint_id]));
-  }
-
-  m_joint_ctrl_ptr->m_1cycle_finished = false;
-}
-
-void PLEN2::MotionController::m_setupFrame(unsigned char index) {
-#if DEBUG_LESS
-  volatile Utility::Profiler p(F("MotionController::m_setupFrame()"));
-#endif
-
-  m_frame_next_ptr->index = index;
-#if DEBUG_LESS
-  System::debugSerial().print(F("m_frame_next_ptr->get(m_header.slot)"));
-#endif
-  m_frame_next_ptr->get(m_header.slot);
-
-  long actual_transition_time =
-      static_cast<long>(m_frame_next_ptr->transition_time_ms) * 100 /
-      m_speed_percent;
-  m_transition_count =
-      actual_transition_time / Motion::Frame::UPDATE_INTERVAL_MS;
-  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
-    m_current_fixed_points[joint_id] =
-        fixed_cast(m_frame_current_ptr->joint_angle[joint_id]);
-
-    m_diff_fixed_points[joint_id] =
-        fixed_cast(m_frame_next_ptr->joint_angle[joint_id]) -
-        m_current_fixed_points[joint_id];
-    m_diff_fixed_points[joint_id] /= m_transition_count;
-  }
-}
-
-void PLEN2::MotionController::m_bufferingFrame() {
-#if DEBUG
-  volatile Utility::Profiler p(F("MotionController::m_bufferingFrame()"));
-#endif
-
-  Motion::Frame *frame_ptr_temp = m_frame_current_ptr;
-  m_frame_current_ptr = m_frame_next_ptr;
-  m_frame_next_ptr = frame_ptr_temp;
-}
-
-void PLEN2::MotionController::loadNextFrame() {
-#if DEBUG
-  volatile Utility::Profiler p(F("MotionController::loadNextFrame()"));
-#endif
-
-  m_bufferingFrame();
-  const unsigned char index_now = m_frame_current_ptr->index;
-
-#if DEBUG
-  System::debugSerial().print(F(">>> index_now : "));
-  System::debugSerial().println(static_cast<int>(index_now));
-
-  System::debugSerial().print(F(">>> m_header.frame_length : "));
-  System::debugSerial().println(static_cast<int>(m_header.frame_length));
-#endif
-
-  /*!
-          @note
-          The order of priority of doing built-in functions, is "loop" > "jump".
-  */
-  if (m_header.use_loop) {
-    if (index_now >= m_header.loop_end) {
-      m_setupFrame(m_header.loop_begin);
-
-      if (m_header.loop_count != 255) {
-        m_header.loop_count--;
-      }
-
-      if (m_header.loop_count == 0) {
-        m_header.use_loop = 0;
-      }
-
-      return;
-    }
-  }
-
-  if ((!m_header.use_loop) && (m_header.use_jump) &&
-      (index_now >= (m_header.frame_length - 1))) {
-    m_header.slot = m_header.jump_slot;
-    m_header.get();
-    m_setupFrame(0);
-
-    return;
-  }
-
-  m_setupFrame(index_now + 1);
-}
-
-void PLEN2::MotionController::dump(unsigned char slot) {
-#if DEBUG
-  volatile Utility::Profiler p(F("MotionController::dump()"));
-#endif
-
-  if (slot >= Motion::SLOT_END) {
-#if DEBUG
-    System::debugSerial().print(F(">>> bad argment : slot = "));
-    System::debugSerial().println(static_cast<int>(slot));
-#endif
-
-    return;
-  }
-
-  Motion::Header header;
-  header.slot = slot;
-  header.get();
-
-  System::outputSerial().println(F("{"));
-
-  System::outputSerial().print(F("\t\"slot\": "));
-  System::outputSerial().print(static_cast<int>(header.slot));
-  System::outputSerial().println(F(","));
-
-  header.name[Motion::Header::NAME_LENGTH - 1] = '\0'; // sanity check.
-  System::outputSerial().print(F("\t\"name\": \""));
-  System::outputSerial().print(header.name);
-  System::outputSerial().println(F("\","));
-
-  System::outputSerial().print(F("\t\"frame_length\": \""));
-  System::outputSerial().print(header.frame_length);
-  System::outputSerial().println(F("\","));
-
-  System::outputSerial().println(F("\t\"codes\": ["));
-
-  if (header.use_loop) {
-    System::outputSerial().println(F("\t\t{"));
-
-    System::outputSerial().println(F("\t\t\t\"func\": \"loop\","));
-
-    System::outputSerial().print(F("\t\t\t\"args\": ["));
-
-    System::outputSerial().print(static_cast<int>(header.loop_begin));
-    System::outputSerial().print(F(", "));
-
-    System::outputSerial().print(static_cast<int>(header.loop_end));
-    System::outputSerial().print(F(", "));
-
-    System::outputSerial().print(static_cast<int>(header.loop_count));
-
-    System::outputSerial().println(F("]"));
-
-    System::outputSerial().print(F("\t\t}"));
-
-    if (header.use_jump) {
-      System::outputSerial().print(F(","));
-    }
-
-    System::outputSerial().println();
-  }
-
-  if (header.use_jump == 1) {
-    System::outputSerial().println(F("\t\t{"));
-
-    System::outputSerial().println(F("\t\t\t\"func\": \"jump\","));
-
-    System::outputSerial().print(F("\t\t\t\"args\": ["));
-
-    System::outputSerial().print(static_cast<int>(header.jump_slot));
-
-    System::outputSerial().println(F("]"));
-
-    System::outputSerial().println(F("\t\t}"));
-  }
-
-  System::outputSerial().println(F("\t],"));
-
-  System::outputSerial().println(F("\t\"frames\": ["));
-
-  Motion::Frame frame;
-
-  for (char frame_index = 0; frame_index < header.frame_length; frame_index++) {
-    frame.index = frame_index;
-    frame.get(header.slot);
-
-    System::outputSerial().println(F("\t\t{"));
-
-    System::outputSerial().print(F("\t\t\t\"transition_time_ms\": "));
-    System::outputSerial().print(frame.transition_time_ms);
-    System::outputSerial().println(F(","));
-
-    System::outputSerial().println(F("\t\t\t\"outputs\": ["));
-
-    for (int device_index = 0; device_index < JointController::SUM;
-         device_index++) {
-      System::outputSerial().println(F("\t\t\t\t{"));
-
-      System::outputSerial().print(F("\t\t\t\t\t\"device\": "));
-      System::outputSerial().print(device_index);
-      System::outputSerial().println(F(","));
-
-      System::outputSerial().print(F("\t\t\t\t\t\"value\": "));
-      System::outputSerial().println(frame.joint_angle[device_index]);
-
-      if ((device_index + 1) == JointController::SUM) {
-        System::outputSerial().println(F("\t\t\t\t}"));
-      } else {
-        System::outputSerial().println(F("\t\t\t\t},"));
-      }
-    }
-
-    System::outputSerial().println(F("\t\t\t]"));
-
-    System::outputSerial().print(F("\t\t}"));
-
-    if ((frame_index + 1) == header.frame_length) {
-      System::outputSerial().println();
-    } else {
-      System::outputSerial().println(F(","));
-    }
-  }
-
-  System::outputSerial().println(F("\t]"));
-
-  System::outputSerial().println(F("}"));
-}
-
-void PLEN2::MotionController::setSpeed(int percent) {
-  if (percent <= 0)
-    return;
-  m_speed_percent = percent;
-}
+/*
+        Copyright (c) 2015,
+        - Kazuyuki TAKASE - https://github.com/junbowu
+        - PLEN Project Company Inc. - https://plen.jp
+
+        This software is released under the MIT License.
+        (See also : http://opensource.org/licenses/mit-license.php)
+*/
+#include <Arduino.h>
+
+#include "ExternalFs.h"
+#include "JointController.h"
+#include "Motion.h"
+#include "MotionCache.h"
+#include "MotionController.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "System.h"
+
+
+namespace {
+enum { PRECISION = PLEN2::MotionTrack::RATIO_PRECISION };
+
+//! @brief Weight of a finished crossfade
+const long WEIGHT_ONE = (1L << PRECISION);
+
+//! @brief Mask of all joints
+const unsigned long JOINT_MASK_ALL = (1UL << PLEN2::JointController::SUM) - 1;
+} // namespace
+
+PLEN2::MotionController::MotionController(JointController &joint_ctrl) {
+  m_joint_ctrl_ptr = &joint_ctrl;
+
+  m_primary = 0;
+
+  m_rate_from = MotionTrack::RATE_ONE();
+  m_rate_to = MotionTrack::RATE_ONE();
+  m_ramp_begin_us = 0;
+  m_ramp_us = 0;
+  m_ramp_ms = 250;
+
+  m_fading = false;
+  m_fade_begin_us = 0;
+  m_fade_us = 0;
+  m_blend_ms = 0;
+
+  for (char layer = 0; layer < LAYER_SUM; layer++) {
+    m_layer_masks[layer] = 0;
+    m_layer_modes[layer] = LAYER_OVERRIDE;
+  }
+
+  m_arrived = false;
+  m_stop_requested = false;
+  m_stop_here = false;
+  m_stop_slot = 0;
+  m_stop_loops = 0;
+
+  m_holding = false;
+  m_released = false;
+  m_hold_events = 0;
+  m_hold_begin_us = 0;
+  m_hold_us = 0;
+  m_sensor_id = 0;
+  m_sensor_condition = Motion::Frame::SENSOR_GREATER;
+  m_sensor_threshold = 0;
+  m_sensor_reader = NULL;
+
+  m_events_begin = 0;
+  m_events_length = 0;
+  m_dropped_events = 0;
+
+  m_prefetch_enabled = true;
+  m_boundary_stalls = 0;
+}
+
+bool PLEN2::MotionController::playing() {
+  TRACE_SCOPE("MotionController::playing()");
+
+  return m_primaryTrack().playing();
+}
+
+bool PLEN2::MotionController::frameUpdatable() {
+  TRACE_SCOPE("MotionController::frameUpdatable()");
+
+  return m_joint_ctrl_ptr->m_1cycle_finished;
+}
+
+bool PLEN2::MotionController::updatingFinished() {
+  TRACE_SCOPE("MotionController::updatingFinished()");
+
+  if (!m_primaryTrack().updatingFinished()) {
+    return false;
+  }
+
+  const unsigned long now_us = micros();
+
+  if (!m_arrived) {
+    m_arrived = true;
+    m_arrive(now_us);
+  }
+
+  return (!m_holding || m_releaseHold(now_us));
+}
+
+bool PLEN2::MotionController::nextFrameLoadable() {
+  TRACE_SCOPE("MotionController::nextFrameLoadable()");
+
+  if (m_stop_here) {
+    return false;
+  }
+
+  return m_primaryTrack().nextFrameLoadable();
+}
+
+void PLEN2::MotionController::play(unsigned char slot) {
+#if DEBUG
+  volatile Utility::Profiler p(F("MotionController::play()"));
+#endif
+
+  if (slot >= Motion::SLOT_END) {
+#if DEBUG
+    System::debugSerial().print(F(">>> bad argment : slot = "));
+    System::debugSerial().println(static_cast<int>(slot));
+#endif
+
+    return;
+  }
+
+  if (playing()) {
+    if (!blendable()) {
+#if DEBUG
+      System::debugSerial().println(F(">>> error : A motion has been playing."));
+#endif
+
+      return;
+    }
+
+    /*!
+            @note
+            The playing motion fades out on the other track until its last
+            transition ends, and the next motion starts from the pose of this
+            moment, so the mix begins exactly where the joints are.
+    */
+    MotionTrack &fading_track = m_primaryTrack();
+    const unsigned long now_us = micros();
+    const long rate = m_rate(now_us);
+    int angles[JointController::SUM];
+
+    fading_track.sample(now_us, rate);
+
+    const long remaining_us = m_wallUs(fading_track.remainingUs(), rate);
+
+    for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+      angles[joint_id] = fading_track.angle(joint_id);
+    }
+
+    m_primary = (m_primary + 1) % TRACK_SUM;
+    m_fading = true;
+    m_fade_begin_us = now_us;
+    m_fade_us = (remaining_us > 0) ? remaining_us : 0;
+
+    m_bake_player.close();
+    m_resetEvents();
+    m_primaryTrack().play(slot, angles, now_us);
+
+    return;
+  }
+
+  MotionTrack &track = m_primaryTrack();
+  m_resetEvents();
+  track.play(slot, track.currentFrame().joint_angle, micros());
+
+  // The player is entered at the first boundary, after the track reached the
+  // first frame live.
+  m_bake_player.open(slot, *m_joint_ctrl_ptr);
+}
+
+void PLEN2::MotionController::willStop() {
+#if DEBUG
+  volatile Utility::Profiler p(F("MotionController::willStop()"));
+#endif
+
+  MotionTrack &track = m_primaryTrack();
+
+  m_stop_requested = true;
+  m_stop_loops = 0;
+
+  if (m_holding) {
+    // Next-frame is a pose that the motion rests at.
+    m_holding = false;
+    m_stop_here = true;
+
+    return;
+  }
+
+  m_stop_slot = track.nextSlot();
+
+  /*!
+          @note
+          The walk goes on to the stop point as it was baked,
+          so the baked stream is kept playing.
+  */
+  if (track.playing() && m_hasStopFrame(m_stop_slot)) {
+    return;
+  }
+
+  // The frames baked after a "loop" or a "jump" are no longer played.
+  m_bake_player.close();
+  track.willStop();
+}
+
+void PLEN2::MotionController::release() { m_released = true; }
+
+bool PLEN2::MotionController::popEvent(Event &event) {
+  if (m_events_length == 0) {
+    return false;
+  }
+
+  event = m_events[m_events_begin];
+  m_events_begin = (m_events_begin + 1) % EVENT_QUEUE_LENGTH;
+  m_events_length--;
+
+  return true;
+}
+
+void PLEN2::MotionController::m_resetEvents() {
+  m_arrived = false;
+  m_stop_requested = false;
+  m_stop_here = false;
+  m_holding = false;
+}
+
+void PLEN2::MotionController::m_arrive(unsigned long now_us) {
+  MotionTrack &track = m_primaryTrack();
+  const Motion::Frame &frame = track.nextFrame();
+  const unsigned char slot = track.nextSlot();
+
+  /*!
+          @note
+          A stop point must be ahead of the walk: after a "jump" to a motion
+          without one, or after a whole loop passed none, the stop falls back
+          to the end of the motion.
+  */
+  if (m_stop_requested && !m_stop_here) {
+    if (slot != m_stop_slot) {
+      m_stop_slot = slot;
+      m_stop_loops = 0;
+
+      if (!m_hasStopFrame(slot)) {
+        m_bake_player.close();
+        track.willStop();
+      }
+    } else if ((frame.index <= track.currentFrame().index) &&
+               (++m_stop_loops >= 2)) {
+      m_bake_player.close();
+      track.willStop();
+    }
+  }
+
+  const unsigned char events = frame.events;
+
+  if (events == 0) {
+    return;
+  }
+
+  if (events & Motion::Frame::EVENT_EMIT) {
+    if (m_events_length < EVENT_QUEUE_LENGTH) {
+      Event &event =
+          m_events[(m_events_begin + m_events_length) % EVENT_QUEUE_LENGTH];
+
+      event.slot = slot;
+      event.index = frame.index;
+      event.code = frame.event_code;
+      event.time_ms = millis();
+
+      m_events_length++;
+    } else {
+      m_dropped_events++;
+    }
+  }
+
+  if ((events & Motion::Frame::EVENT_STOP) && m_stop_requested) {
+    m_stop_here = true;
+
+    return;
+  }
+
+  if (events & (Motion::Frame::EVENT_SYNC | Motion::Frame::EVENT_WAIT_SENSOR)) {
+    m_holding = true;
+    m_released = false;
+    m_hold_events = events;
+    m_hold_begin_us = now_us;
+    m_hold_us = static_cast<unsigned long>(frame.hold_timeout_ms) * 1000;
+    m_sensor_id = frame.sensor_id;
+    m_sensor_condition = frame.sensor_condition;
+    m_sensor_threshold = frame.sensor_threshold;
+  }
+}
+
+bool PLEN2::MotionController::m_releaseHold(unsigned long now_us) {
+  const bool timeout =
+      (m_hold_us != 0) && ((now_us - m_hold_begin_us) >= m_hold_us);
+
+  if (!timeout) {
+    if ((m_hold_events & Motion::Frame::EVENT_SYNC) && !m_released) {
+      return false;
+    }
+
+    if ((m_hold_events & Motion::Frame::EVENT_WAIT_SENSOR) &&
+        (m_sensor_reader != NULL)) {
+      const int value = m_sensor_reader(m_sensor_id);
+      bool met;
+
+      switch (m_sensor_condition) {
+      case Motion::Frame::SENSOR_GREATER:
+        met = (value > m_sensor_threshold);
+        break;
+
+      case Motion::Frame::SENSOR_LESS:
+        met = (value < m_sensor_threshold);
+        break;
+
+      case Motion::Frame::SENSOR_ABS_LESS:
+        met = (abs(value) < m_sensor_threshold);
+        break;
+
+      default:
+        met = true;
+        break;
+      }
+
+      if (!met) {
+        return false;
+      }
+    }
+  }
+
+  m_holding = false;
+  m_primaryTrack().resume(now_us);
+
+  return true;
+}
+
+bool PLEN2::MotionController::m_hasStopFrame(unsigned char slot) {
+  Motion::Header header;
+  header.slot = slot;
+  header.get();
+
+  return (header.eventsValid() &&
+          (header.frame_events & Motion::Frame::EVENT_STOP));
+}
+
+void PLEN2::MotionController::stop() {
+#if DEBUG
+  volatile Utility::Profiler p(F("MotionController::stop()"));
+#endif
+
+  if (m_fading) {
+    m_tracks[(m_primary + 1) % TRACK_SUM].stop();
+    m_fading = false;
+  }
+
+  m_bake_player.close();
+  m_resetEvents();
+  m_primaryTrack().stop();
+}
+
+void PLEN2::MotionController::updateFrame() {
+  TRACE_SCOPE("MotionController::updateFrame()");
+
+  const unsigned long now_us = micros();
+  const long rate = m_rate(now_us);
+  MotionTrack &track = m_primaryTrack();
+  MotionTrack &fading_track = m_tracks[(m_primary + 1) % TRACK_SUM];
+  int angles[JointController::SUM];
+  unsigned long joint_mask = 0;
+  long weight = WEIGHT_ONE;
+
+  if (m_bake_player.engaged() && m_replayBaked(now_us, rate)) {
+    return;
+  }
+
+  if (!track.playing()) {
+    // Only layers are playing, over the pose the body motion stopped at.
+    for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+      angles[joint_id] = track.currentFrame().joint_angle[joint_id];
+    }
+  } else {
+    joint_mask = JOINT_MASK_ALL;
+    track.sample(now_us, rate);
+
+    if (m_fading) {
+      const unsigned long elapsed_us = now_us - m_fade_begin_us;
+
+      if (elapsed_us < m_fade_us) {
+        weight = MotionTrack::ease(
+            (static_cast<unsigned long long>(elapsed_us) << PRECISION) /
+                m_fade_us,
+            Motion::Header::INTERPOLATION_SMOOTHSTEP);
+
+        fading_track.sample(now_us, rate);
+      } else {
+        fading_track.stop();
+        m_fading = false;
+      }
+    }
+
+    if (weight >= WEIGHT_ONE) {
+      for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+        angles[joint_id] = track.angle(joint_id);
+      }
+    } else {
+      for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+        const int angle_out = fading_track.angle(joint_id);
+        const int angle_in = track.angle(joint_id);
+
+        angles[joint_id] =
+            angle_out +
+            static_cast<int>(
+                (static_cast<long>(angle_in - angle_out) * weight) >>
+                PRECISION);
+      }
+    }
+  }
+
+  m_mixLayers(now_us, rate, angles, joint_mask);
+  m_writeAngles(angles, joint_mask);
+}
+
+void PLEN2::MotionController::updatePose(const int pose[]) {
+  TRACE_SCOPE("MotionController::updatePose()");
+
+  const unsigned long now_us = micros();
+  int angles[JointController::SUM];
+  unsigned long joint_mask = JOINT_MASK_ALL;
+
+  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+    angles[joint_id] = pose[joint_id];
+  }
+
+  m_mixLayers(now_us, m_rate(now_us), angles, joint_mask);
+  m_writeAngles(angles, joint_mask);
+}
+
+bool PLEN2::MotionController::m_replayBaked(unsigned long now_us, long rate) {
+  TRACE_SCOPE("MotionController::m_replayBaked()");
+
+  /*!
+          @note
+          The stream was baked alone at normal speed, so anything else hands
+          the motion back to the track. The track has followed every tick, so
+          it goes on from where the stream was.
+  */
+  if (m_fading || (rate != MotionTrack::RATE_ONE()) || layerPlaying()) {
+    m_bake_player.close();
+
+    return false;
+  }
+
+  MotionTrack &track = m_primaryTrack();
+  const long interval_us =
+      static_cast<long>(Motion::Frame::UPDATE_INTERVAL_MS) * 1000;
+
+  track.sample(now_us, rate);
+
+  // The last tick of a transition is next-frame exactly, as the track
+  // samples it.
+  const long position_us = track.transitionUs() - track.remainingUs();
+  const unsigned int tick = (track.updatingFinished())
+                                ? 0xFFFF
+                                : (position_us + interval_us / 2) / interval_us;
+  unsigned long changed_mask;
+
+  if (!m_bake_player.seek(tick, changed_mask)) {
+    return false;
+  }
+
+  const short *indexes = m_bake_player.indexes();
+
+  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+    if (changed_mask & (1UL << joint_id)) {
+      m_joint_ctrl_ptr->setIndex(joint_id, indexes[joint_id]);
+    }
+  }
+
+  m_joint_ctrl_ptr->publish();
+  m_joint_ctrl_ptr->m_1cycle_finished = false;
+
+  return true;
+}
+
+void PLEN2::MotionController::m_writeAngles(const int angles[],
+                                            unsigned long joint_mask) {
+  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+    if (joint_mask & (1UL << joint_id)) {
+      m_joint_ctrl_ptr->setAngleDiff(joint_id, angles[joint_id]);
+    }
+  }
+
+  m_joint_ctrl_ptr->publish();
+  m_joint_ctrl_ptr->m_1cycle_finished = false;
+}
+
+void PLEN2::MotionController::m_mixLayers(unsigned long now_us, long rate,
+                                           int angles[],
+                                           unsigned long &joint_mask) {
+  TRACE_SCOPE("MotionController::m_mixLayers()");
+
+  for (char layer = 0; layer < LAYER_SUM; layer++) {
+    MotionTrack &track = m_layers[layer];
+
+    if (!track.playing()) {
+      continue;
+    }
+
+    const unsigned long layer_mask = m_layer_masks[layer];
+
+    track.sample(now_us, rate);
+
+    for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+      if (!(layer_mask & (1UL << joint_id))) {
+        continue;
+      }
+
+      if (m_layer_modes[layer] == LAYER_ADDITIVE) {
+        angles[joint_id] += track.angle(joint_id);
+      } else {
+        angles[joint_id] = track.angle(joint_id);
+      }
+    }
+
+    joint_mask |= layer_mask;
+
+    if (track.updatingFinished()) {
+      if (track.nextFrameLoadable()) {
+        track.loadNextFrame();
+      } else {
+        track.stop();
+      }
+    }
+  }
+}
+
+void PLEN2::MotionController::loadNextFrame() {
+  TRACE_SCOPE("MotionController::loadNextFrame()");
+
+  const unsigned long begin_us = micros();
+  MotionTrack &track = m_primaryTrack();
+
+  if (!track.loadNextFrame()) {
+    return;
+  }
+
+  m_arrived = false;
+
+  if (m_bake_player.opened()) {
+    m_bake_player.enter(track.currentSlot(), track.currentFrame().index,
+                        track.nextSlot(), track.nextFrame().index);
+  }
+
+  if (track.stalled()) {
+    m_boundary_stalls++;
+  }
+
+  m_boundary_durations.sample(micros() - begin_us);
+}
+
+bool PLEN2::MotionController::prefetch() {
+  TRACE_SCOPE("MotionController::prefetch()");
+
+  if (!m_prefetch_enabled) {
+    return false;
+  }
+
+  // A baked stream is consumed at every tick, so it is read ahead first.
+  if (m_bake_player.prefetch()) {
+    return true;
+  }
+
+  if (m_primaryTrack().prefetch()) {
+    return true;
+  }
+
+  for (char layer = 0; layer < LAYER_SUM; layer++) {
+    if (m_layers[layer].playing() && m_layers[layer].prefetch()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void PLEN2::MotionController::setPrefetch(bool enabled) {
+  m_prefetch_enabled = enabled;
+  m_boundary_durations.reset();
+  m_boundary_stalls = 0;
+}
+
+bool PLEN2::MotionController::blendable() {
+  TRACE_SCOPE("MotionController::blendable()");
+
+  if ((m_blend_ms == 0) || m_fading || !playing()) {
+    return false;
+  }
+
+  MotionTrack &track = m_primaryTrack();
+
+  if (m_holding || track.rewound() || nextFrameLoadable()) {
+    return false;
+  }
+
+  const long remaining_us = m_wallUs(track.remainingUs(), m_rate(micros()));
+
+  return ((remaining_us >= 0) &&
+          (remaining_us <= static_cast<long>(m_blend_ms) * 1000));
+}
+
+void PLEN2::MotionController::setBlendTime(unsigned int blend_ms) {
+  m_blend_ms = blend_ms;
+}
+
+bool PLEN2::MotionController::playLayer(unsigned char layer, unsigned char slot,
+                                        unsigned long joint_mask,
+                                        unsigned char mode) {
+#if DEBUG
+  volatile Utility::Profiler p(F("MotionController::playLayer()"));
+#endif
+
+  if ((layer >= LAYER_SUM) || (slot >= Motion::SLOT_END) ||
+      (mode >= LAYER_MODE_SUM)) {
+#if DEBUG
+    System::debugSerial().print(F(">>> bad argment : layer = "));
+    System::debugSerial().print(static_cast<int>(layer));
+    System::debugSerial().print(F(", slot = "));
+    System::debugSerial().println(static_cast<int>(slot));
+#endif
+
+    return false;
+  }
+
+  /*!
+          @note
+          An overriding layer starts from the pose of the motions under it,
+          and an additive layer starts from no offset,
+          so the joints never jump when the layer begins.
+  */
+  const unsigned long now_us = micros();
+  int angles[JointController::SUM];
+  MotionTrack &track = m_primaryTrack();
+
+  if (track.playing()) {
+    track.sample(now_us, m_rate(now_us));
+  }
+
+  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+    if (mode == LAYER_ADDITIVE) {
+      angles[joint_id] = 0;
+    } else if (track.playing()) {
+      angles[joint_id] = track.angle(joint_id);
+    } else {
+      angles[joint_id] = track.currentFrame().joint_angle[joint_id];
+    }
+  }
+
+  m_layer_masks[layer] = joint_mask & JOINT_MASK_ALL;
+  m_layer_modes[layer] = mode;
+  m_layers[layer].play(slot, angles, now_us);
+
+  return true;
+}
+
+void PLEN2::MotionController::stopLayer(unsigned char layer) {
+  if (layer >= LAYER_SUM) {
+    return;
+  }
+
+  m_layers[layer].stop();
+}
+
+bool PLEN2::MotionController::layerPlaying() {
+  for (char layer = 0; layer < LAYER_SUM; layer++) {
+    if (m_layers[layer].playing()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void PLEN2::MotionController::dump(unsigned char slot) {
+#if DEBUG
+  volatile Utility::Profiler p(F("MotionController::dump()"));
+#endif
+
+  if (slot >= Motion::SLOT_END) {
+#if DEBUG
+    System::debugSerial().print(F(">>> bad argment : slot = "));
+    System::debugSerial().println(static_cast<int>(slot));
+#endif
+
+    return;
+  }
+
+  Motion::Header header;
+  header.slot = slot;
+  header.get();
+
+  System::outputSerial().println(F("{"));
+
+  System::outputSerial().print(F("\t\"slot\": "));
+  System::outputSerial().print(static_cast<int>(header.slot));
+  System::outputSerial().println(F(","));
+
+  header.name[Motion::Header::NAME_LENGTH - 1] = '\0'; // sanity check.
+  System::outputSerial().print(F("\t\"name\": \""));
+  System::outputSerial().print(header.name);
+  System::outputSerial().println(F("\","));
+
+  System::outputSerial().print(F("\t\"frame_length\": \""));
+  System::outputSerial().print(header.frame_length);
+  System::outputSerial().println(F("\","));
+
+  System::outputSerial().print(F("\t\"interpolation\": "));
+  System::outputSerial().print(static_cast<int>(header.interpolation));
+  System::outputSerial().println(F(","));
+
+  System::outputSerial().println(F("\t\"codes\": ["));
+
+  if (header.use_loop) {
+    System::outputSerial().println(F("\t\t{"));
+
+    System::outputSerial().println(F("\t\t\t\"func\": \"loop\","));
+
+    System::outputSerial().print(F("\t\t\t\"args\": ["));
+
+    System::outputSerial().print(static_cast<int>(header.loop_begin));
+    System::outputSerial().print(F(", "));
+
+    System::outputSerial().print(static_cast<int>(header.loop_end));
+    System::outputSerial().print(F(", "));
+
+    System::outputSerial().print(static_cast<int>(header.loop_count));
+
+    System::outputSerial().println(F("]"));
+
+    System::outputSerial().print(F("\t\t}"));
+
+    if (header.use_jump) {
+      System::outputSerial().print(F(","));
+    }
+
+    System::outputSerial().println();
+  }
+
+  if (header.use_jump == 1) {
+    System::outputSerial().println(F("\t\t{"));
+
+    System::outputSerial().println(F("\t\t\t\"func\": \"jump\","));
+
+    System::outputSerial().print(F("\t\t\t\"args\": ["));
+
+    System::outputSerial().print(static_cast<int>(header.jump_slot));
+
+    System::outputSerial().println(F("]"));
+
+    System::outputSerial().println(F("\t\t}"));
+  }
+
+  System::outputSerial().println(F("\t],"));
+
+  System::outputSerial().println(F("\t\"frames\": ["));
+
+  Motion::Frame frame;
+
+  for (unsigned short frame_index = 0; frame_index < header.frame_length;
+       frame_index++) {
+    frame.index = frame_index;
+    frame.get(header.slot);
+
+    System::outputSerial().println(F("\t\t{"));
+
+    System::outputSerial().print(F("\t\t\t\"transition_time_ms\": "));
+    System::outputSerial().print(frame.transition_time_ms);
+    System::outputSerial().println(F(","));
+
+    System::outputSerial().println(F("\t\t\t\"outputs\": ["));
+
+    for (int device_index = 0; device_index < JointController::SUM;
+         device_index++) {
+      System::outputSerial().println(F("\t\t\t\t{"));
+
+      System::outputSerial().print(F("\t\t\t\t\t\"device\": "));
+      System::outputSerial().print(device_index);
+      System::outputSerial().println(F(","));
+
+      System::outputSerial().print(F("\t\t\t\t\t\"value\": "));
+      System::outputSerial().println(frame.joint_angle[device_index]);
+
+      if ((device_index + 1) == JointController::SUM) {
+        System::outputSerial().println(F("\t\t\t\t}"));
+      } else {
+        System::outputSerial().println(F("\t\t\t\t},"));
+      }
+    }
+
+    System::outputSerial().println(F("\t\t\t]"));
+
+    System::outputSerial().print(F("\t\t}"));
+
+    if ((frame_index + 1) == header.frame_length) {
+      System::outputSerial().println();
+    } else {
+      System::outputSerial().println(F(","));
+    }
+  }
+
+  System::outputSerial().println(F("\t]"));
+
+  System::outputSerial().println(F("}"));
+}
+
+void PLEN2::MotionController::setSpeed(int percent) {
+  setSpeedRate((static_cast<long>(percent) << MotionTrack::RATE_PRECISION) /
+               100);
+}
+
+void PLEN2::MotionController::setSpeedRate(long rate) {
+  const unsigned long now_us = micros();
+
+  m_rate_from = m_rate(now_us);
+  m_rate_to = constrain(rate, -RATE_MAX(), RATE_MAX());
+  m_ramp_begin_us = now_us;
+  m_ramp_us = static_cast<unsigned long>(m_ramp_ms) * 1000;
+}
+
+void PLEN2::MotionController::setSpeedRamp(unsigned int ramp_ms) {
+  m_ramp_ms = ramp_ms;
+}
+
+long PLEN2::MotionController::m_rate(unsigned long now_us) {
+  const unsigned long elapsed_us = now_us - m_ramp_begin_us;
+
+  if (elapsed_us >= m_ramp_us) {
+    // Forget the ramp, so micros() wrapping around never replays it.
+    m_ramp_us = 0;
+
+    return m_rate_to;
+  }
+
+  // The rate eases in and out, so the motion never jerks at a change.
+  const long weight = MotionTrack::ease(
+      (static_cast<unsigned long long>(elapsed_us) << PRECISION) / m_ramp_us,
+      Motion::Header::INTERPOLATION_SMOOTHSTEP);
+
+  return m_rate_from +
+         static_cast<long>(
+             (static_cast<long long>(m_rate_to - m_rate_from) * weight) >>
+             PRECISION);
+}
+
+long PLEN2::MotionController::m_wallUs(long motion_us, long rate) {
+  if (rate <= 0) {
+    return -1;
+  }
+
+  const long long wall_us =
+      (static_cast<long long>(motion_us) << MotionTrack::RATE_PRECISION) /
+      rate;
+
+  return (wall_us < 0x7FFFFFFFLL) ? static_cast<long>(wall_us) : 0x7FFFFFFFL;
+}
@@ -1,149 +1,487 @@
-/*!
-        @file      MotionController.h
-        @brief     Management class of a motion.
-        @author    Kazuyuki TAKASE
-        @copyright The MIT License -
-   http://opensource.org/licenses/mit-license.php
-*/
-
-#pragma once
-
-#ifndef PLEN2_MOTION_CONTROLLER_H
-#define PLEN2_MOTION_CONTROLLER_H
-
-#include "JointController.h"
-#include "Motion.h"
-
-namespace PLEN2 {
-namespace Motion {
-class Header;
-class Frame;
-} // namespace Motion
-
-#ifdef PLEN2_INTERPRETER_H
-class Interpreter;
-#endif
-
-class MotionController;
-} // namespace PLEN2
-
-/*!
-        @brief Management class of a motion
-*/
-class PLEN2::MotionController {
-#ifdef PLEN2_INTERPRETER_H
-  friend class Interpreter;
-#endif
-
-public:
-  /*!
-          @brief Constructor
-
-          @param [in] joint_ctrl An instance of joint controller.
-  */
-  MotionController(JointController &joint_ctrl);
-
-  /*!
-          @brief Decide a motion is playing
-
-          @return Result
-  */
-  bool playing();
-
-  /*!
-          @brief Decide a motion frame is updatable
-
-          @return Result
-  */
-  bool frameUpdatable();
-
-  /*!
-          @brief Decide that updating a frame has finished
-
-          @return Result
-  */
-  bool updatingFinished();
-
-  /*!
-          @brief Decide there is a loadable frame at the next time
-          決定加載下一次框架的時間
-          @return Result
-  */
-  bool nextFrameLoadable();
-
-  /*!
-          @brief Play a motion
-
-          @param [in] slot  Number of a motion.
-  */
-  void play(unsigned char slot);
-
-  /*!
-          @brief Will stop playing a motion
-
-          The method doesn't stop playing a motion just after running itself,
-          but will stop it when a frame that has the stop flag discovered.
-  */
-  void willStop();
-
-  /*!
-          @brief Stop playing a motion
-  */
-  void stop();
-
-  /*
-          @brief Add differences between current-frame and next-frame to
-     current-frame
-  */
-  void updateFrame();
-
-  /*!
-          @brief Load next frame
-  */
-  void loadNextFrame();
-
-  /*!
-          @brief Dump a motion with JSON format
-
-          Output JSON string like a "motion.json",
-          however, property "device"'s type is not string but integer defined as
-     device id in "device_map.json".
-
-          @sa
-          - https://github.com/plenproject/PLEN2/tree/master/motion
-          -
-     https://github.com/plenproject/plen__control_server/blob/master/control_server/device_map.json
-
-          @param [in] slot Slot of a motion.
-  */
-  void dump(unsigned char slot);
-
-  /*!
-          @brief Set motion playback speed percentage
-
-          @param [in] percent Speed percentage (e.g. 50, 100, 200)
-  */
-  void setSpeed(int percent);
-
-private:
-  enum { FRAMEBUFFER_LENGTH = 2 };
-
-  void m_setupFrame(unsigned char index);
-  void m_bufferingFrame();
-
-  JointController *m_joint_ctrl_ptr;
-
-  unsigned char m_transition_count;
-  bool m_playing;
-  int m_speed_percent;
-
-  Motion::Header m_header;
-  Motion::Frame m_buffer[FRAMEBUFFER_LENGTH];
-  Motion::Frame *m_frame_current_ptr;
-  Motion::Frame *m_frame_next_ptr;
-
-  long m_current_fixed_points[JointController::SUM];
-  long m_diff_fixed_points[JointController::SUM];
-};
-
-#endif // PLEN2_MOTION_CONTROLLER_H
+/*!
+        @file      MotionController.h
+        @brief     Management class of a motion.
+        @author    Kazuyuki TAKASE
+        @copyright The MIT License -
+   http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef PLEN2_MOTION_CONTROLLER_H
+#define PLEN2_MOTION_CONTROLLER_H
+
+#include "JointController.h"
+#include "Motion.h"
+#include "MotionBake.h"
+#include "MotionTrack.h"
+#include "TimingStatistics.h"
+
+namespace PLEN2 {
+namespace Motion {
+class Header;
+class Frame;
+} // namespace Motion
+
+#ifdef PLEN2_INTERPRETER_H
+class Interpreter;
+#endif
+
+class MotionController;
+} // namespace PLEN2
+
+/*!
+        @brief Management class of a motion
+*/
+class PLEN2::MotionController {
+#ifdef PLEN2_INTERPRETER_H
+  friend class Interpreter;
+#endif
+
+public:
+  enum {
+    LAYER_SUM = 2 //!< Summation of the layers over the body motion.
+  };
+
+  /*!
+          @brief How a layer is resolved with the motions under it
+  */
+  enum {
+    LAYER_OVERRIDE, //!< The layer replaces angles of its joints.
+    LAYER_ADDITIVE, //!< The layer adds its angles to the angles under it.
+    LAYER_MODE_SUM  //!< Summation of the modes.
+  };
+
+  enum {
+    EVENT_QUEUE_LENGTH = 8 //!< Events kept until the host reads them.
+  };
+
+  /*!
+          @brief Event that a frame sent to the host (Motion::Frame::EVENT_EMIT)
+  */
+  class Event {
+  public:
+    unsigned char slot;    //!< Slot of the frame.
+    unsigned short index;  //!< Index of the frame.
+    unsigned char code;    //!< Motion::Frame::event_code.
+    unsigned long time_ms; //!< Value of millis() that the motion arrived at the frame.
+  };
+
+  /*!
+          @brief Reader of a sensor that Motion::Frame::EVENT_WAIT_SENSOR waits for
+
+          @param [in] sensor_id Motion::Frame::sensor_id.
+
+          @return Value of the sensor
+  */
+  typedef int (*SensorReader)(unsigned char sensor_id);
+
+  /*!
+          @brief Constructor
+
+          @param [in] joint_ctrl An instance of joint controller.
+  */
+  MotionController(JointController &joint_ctrl);
+
+  /*!
+          @brief Decide a motion is playing
+
+          @return Result
+  */
+  bool playing();
+
+  /*!
+          @brief Decide a motion frame is updatable
+
+          @return Result
+  */
+  bool frameUpdatable();
+
+  /*!
+          @brief Decide that updating a frame has finished
+
+          When the transition arrives at next-frame, the events of the frame
+          happen at once: it is a flag test for a frame without events.
+          While the frame is held by EVENT_SYNC or EVENT_WAIT_SENSOR,
+          the method keeps returning false.
+
+          @return Result
+  */
+  bool updatingFinished();
+
+  /*!
+          @brief Decide there is a loadable frame at the next time
+          決定加載下一次框架的時間
+          @return Result
+  */
+  bool nextFrameLoadable();
+
+  /*!
+          @brief Play a motion
+
+          If a motion is playing and blendable() is true, the motion starts
+          at once and crossfades with the playing one until it ends.
+
+          @param [in] slot  Number of a motion.
+  */
+  void play(unsigned char slot);
+
+  /*!
+          @brief Will stop playing a motion
+
+          The method doesn't stop playing a motion just after running itself,
+          but will stop it at the next frame that has EVENT_STOP,
+          so a gait stops at a safe pose in the middle of its loop.
+          A motion without EVENT_STOP (Motion::Header::frame_events tells it)
+          disables "loop" and "jump", and stops at its last frame.
+          A frame held stops at once.
+  */
+  void willStop();
+
+  //! @brief Decide a stop has been requested by willStop()
+  bool stopRequested() const { return m_stop_requested; }
+
+  /*!
+          @brief Release a frame held by EVENT_SYNC
+
+          (e.g. The host releases robots waiting at a sync point together.)
+  */
+  void release();
+
+  //! @brief Decide next-frame is held by EVENT_SYNC or EVENT_WAIT_SENSOR
+  bool holding() const { return m_holding; }
+
+  /*!
+          @brief Set the reader of sensors for EVENT_WAIT_SENSOR
+
+          @param [in] reader Please set NULL to pass the conditions of sensors.
+  */
+  void setSensorReader(SensorReader reader) { m_sensor_reader = reader; }
+
+  /*!
+          @brief Take the oldest event sent by frames
+
+          @param [out] event The event.
+
+          @return false if there is no event
+  */
+  bool popEvent(Event &event);
+
+  //! @brief Get count of events dropped, because the queue was full
+  unsigned long droppedEvents() const { return m_dropped_events; }
+
+  /*!
+          @brief Stop playing a motion
+  */
+  void stop();
+
+  /*
+          @brief Interpolate between current-frame and next-frame by the time
+     elapsed
+
+          Each joint is placed where it should be at micros() now,
+          so late or missed ticks are caught up by the next update,
+          and a transition finishes on schedule regardless of loop latency.
+
+          The ratio of elapsed time is shaped by the header's interpolation
+          profile once per tick, so every joint costs a multiply and a shift.
+          Only Catmull-Rom evaluates a cubic per joint, from the coefficients
+          prepared when the frame was set up.
+
+          While two motions crossfade, both are evaluated and mixed by a
+          smoothstep weight, so joint velocity stays continuous at both ends
+          of the overlap.
+
+          Playing layers are resolved over the result at last, and stepped
+          to their next frames here, so they need no calls from the main loop.
+
+          A baked motion is replayed instead while it plays alone at normal
+          speed: the track only advances its clock, and the joints changed at
+          the nearest tick baked are written as indexes of the PWM tables.
+  */
+  void updateFrame();
+
+  /*!
+          @brief Update joints by a pose given from outside of the motions
+
+          Playing layers are resolved over the pose, as updateFrame() does.
+          (e.g. Setpoints streamed by a host.)
+
+          @param [in] pose[] Angle differences from home. [degree * 10]
+  */
+  void updatePose(const int pose[]);
+
+  /*!
+          @brief Load next frame
+
+          The frame has usually been read ahead by prefetch(),
+          so the method only reads external EEPROM when prefetching fell behind.
+  */
+  void loadNextFrame();
+
+  /*!
+          @brief Read ahead a frame (or a chunk of the baked motion) to play
+
+          The method reads a frame from the store at most, and resolves
+          "loop" and "jump" while it walks the motion,
+          so please call it from the main loop between updates of frames.
+
+          @return true if a frame or a chunk was read
+  */
+  bool prefetch();
+
+  /*!
+          @brief Enable or disable prefetching
+
+          @param [in] enabled Please set false to read every frame at its
+     boundary. (e.g. To compare latencies.)
+  */
+  void setPrefetch(bool enabled);
+
+  //! @brief Decide prefetching is enabled
+  bool prefetchEnabled() const { return m_prefetch_enabled; }
+
+  //! @brief Get time spent inside loadNextFrame() [usec]
+  const Utility::TimingStatistics &boundaryDurations() const {
+    return m_boundary_durations;
+  }
+
+  //! @brief Get count of frame boundaries that waited for external EEPROM
+  unsigned long boundaryStalls() const { return m_boundary_stalls; }
+
+  //! @brief Decide the playing motion is replayed from its baked stream
+  bool bakedPlaying() const { return m_bake_player.engaged(); }
+
+  //! @brief Get count of ticks baked that waited for the file
+  unsigned long bakeStalls() const { return m_bake_player.stalls(); }
+
+  /*!
+          @brief Decide the next motion can start to crossfade
+
+          It is true while the playing motion is in its last transition,
+          and the transition ends within the blend time.
+
+          @return Result
+  */
+  bool blendable();
+
+  /*!
+          @brief Set overlap of motions played in a row
+
+          @param [in] blend_ms Please set 0 to disable crossfading.
+  */
+  void setBlendTime(unsigned int blend_ms);
+
+  //! @brief Get overlap of motions played in a row [msec]
+  unsigned int blendTime() const { return m_blend_ms; }
+
+  /*!
+          @brief Dump a motion with JSON format
+
+          Output JSON string like a "motion.json",
+          however, property "device"'s type is not string but integer defined as
+     device id in "device_map.json".
+
+          @sa
+          - https://github.com/plenproject/PLEN2/tree/master/motion
+          -
+     https://github.com/plenproject/plen__control_server/blob/master/control_server/device_map.json
+
+          @param [in] slot Slot of a motion.
+  */
+  void dump(unsigned char slot);
+
+  /*!
+          @brief Play a motion on a layer over the body motion
+
+          A layer plays by itself, and only the joints in its mask are
+          resolved from it. Layers are resolved in order of their numbers,
+          so a layer of a larger number has priority over the others.
+
+          With LAYER_ADDITIVE, the motion should be made as offsets from home.
+          When no body motion is playing, layers are resolved over the last
+          pose of the body motion, and the other joints are left as they are.
+          When the motion ends, its joints return to the motions under it.
+
+          @param [in] layer      Please set layer number in [0, LAYER_SUM).
+          @param [in] slot       Number of a motion.
+          @param [in] joint_mask Bit N is set to drive joint N.
+          @param [in] mode       Please set LAYER_OVERRIDE or LAYER_ADDITIVE.
+
+          @return Result
+  */
+  bool playLayer(unsigned char layer, unsigned char slot,
+                 unsigned long joint_mask, unsigned char mode);
+
+  /*!
+          @brief Stop a layer
+
+          The joints of the layer return to the motions under it at the next
+          update.
+
+          @param [in] layer Please set layer number in [0, LAYER_SUM).
+  */
+  void stopLayer(unsigned char layer);
+
+  //! @brief Decide any layer is playing
+  bool layerPlaying();
+
+  /*!
+          @brief Set motion playback speed percentage
+
+          @param [in] percent Speed percentage (e.g. 50, 100, 200)
+  */
+  void setSpeed(int percent);
+
+  /*!
+          @brief Set rate of playback
+
+          The rate ramps from the rate now to the new one in the ramp time,
+          and is effective in the middle of a transition, so the motion never
+          waits for the next frame to change its speed.
+          A negative rate plays the motion backward, and 0 pauses it.
+
+          @param [in] rate Please set rate in [-RATE_MAX(), RATE_MAX()].
+                           (MotionTrack::RATE_ONE() is 100%.)
+  */
+  void setSpeedRate(long rate);
+
+  //! @brief Get rate of playback that the ramp goes to
+  long speedRate() const { return m_rate_to; }
+
+  /*!
+          @brief Set time to ramp the rate of playback
+
+          @param [in] ramp_ms Please set 0 to change the rate at once.
+  */
+  void setSpeedRamp(unsigned int ramp_ms);
+
+  //! @brief Get time to ramp the rate of playback [msec]
+  unsigned int speedRamp() const { return m_ramp_ms; }
+
+  //! @brief Max rate of playback (1000%)
+  inline static const long RATE_MAX() { return 10 * MotionTrack::RATE_ONE(); }
+
+private:
+  enum {
+    TRACK_SUM = 2 //!< A playing motion, and a motion fading out.
+  };
+
+  //! @brief Get the track that the public methods drive
+  MotionTrack &m_primaryTrack() { return m_tracks[m_primary]; }
+
+  /*!
+          @brief Resolve playing layers into angles, and step them
+
+          @param [in]      now_us      Value of micros().
+          @param [in]      rate        Rate of playback.
+          @param [in, out] angles[]    Angles under the layers.
+          @param [in, out] joint_mask  Joints to write.
+  */
+  void m_mixLayers(unsigned long now_us, long rate, int angles[],
+                   unsigned long &joint_mask);
+
+  /*!
+          @brief Write angles of joints, and publish them
+
+          @param [in] angles[]   Angle differences from home.
+          @param [in] joint_mask Joints to write.
+  */
+  void m_writeAngles(const int angles[], unsigned long joint_mask);
+
+  /*!
+          @brief Get rate of playback on the ramp
+
+          @param [in] now_us Value of micros().
+  */
+  long m_rate(unsigned long now_us);
+
+  /*!
+          @brief Convert time of a motion to time on the wall at the rate now
+
+          @return Wall time [usec], or -1 if the motion doesn't go forward
+  */
+  long m_wallUs(long motion_us, long rate);
+
+  //! @brief Forget the stop requested and the frame held
+  void m_resetEvents();
+
+  /*!
+          @brief Let the events of next-frame happen
+
+          @param [in] now_us Value of micros().
+  */
+  void m_arrive(unsigned long now_us);
+
+  /*!
+          @brief Decide the frame held can be released, and release it
+
+          @param [in] now_us Value of micros().
+
+          @return Result
+  */
+  bool m_releaseHold(unsigned long now_us);
+
+  /*!
+          @brief Decide a motion has a frame that has EVENT_STOP
+
+          @param [in] slot Number of a motion.
+  */
+  static bool m_hasStopFrame(unsigned char slot);
+
+  /*!
+          @brief Write the tick baked for the time now
+
+          @return false if the player can't replay the tick (It is closed.)
+  */
+  bool m_replayBaked(unsigned long now_us, long rate);
+
+  JointController *m_joint_ctrl_ptr;
+
+  MotionTrack m_tracks[TRACK_SUM];
+  unsigned char m_primary; //!< Index of the track playing.
+
+  MotionBake::Player m_bake_player; //!< Follows the primary track.
+
+  long m_rate_from;               //!< Rate of playback the ramp begins at.
+  long m_rate_to;                 //!< Rate of playback the ramp ends at.
+  unsigned long m_ramp_begin_us;
+  unsigned long m_ramp_us;        //!< Length of the ramp, or 0 after it ended.
+  unsigned int m_ramp_ms;
+
+  bool m_fading;                //!< The other track is fading out.
+  unsigned long m_fade_begin_us;
+  unsigned long m_fade_us;
+  unsigned int m_blend_ms;
+
+  MotionTrack m_layers[LAYER_SUM];
+  unsigned long m_layer_masks[LAYER_SUM];
+  unsigned char m_layer_modes[LAYER_SUM];
+
+  bool m_arrived;          //!< Events of next-frame have happened.
+  bool m_stop_requested;
+  bool m_stop_here;        //!< The motion stops at next-frame.
+  unsigned char m_stop_slot; //!< Slot checked for EVENT_STOP last.
+  unsigned char m_stop_loops; //!< Loops gone back through after the request.
+
+  bool m_holding;
+  bool m_released;
+  unsigned char m_hold_events;
+  unsigned long m_hold_begin_us;
+  unsigned long m_hold_us; //!< Timeout of the hold, or 0.
+  unsigned char m_sensor_id;
+  unsigned char m_sensor_condition;
+  int m_sensor_threshold;
+  SensorReader m_sensor_reader;
+
+  Event m_events[EVENT_QUEUE_LENGTH];
+  unsigned char m_events_begin;
+  unsigned char m_events_length;
+  unsigned long m_dropped_events;
+
+  bool m_prefetch_enabled;
+  Utility::TimingStatistics m_boundary_durations;
+  unsigned long m_boundary_stalls;
+};
+
+#endif // PLEN2_MOTION_CONTROLLER_H
@@ -0,0 +1,2327 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+#include "Arduino.h"
+#include "FS.h"
+
+#include "ExternalFs.h"
+#include "MotionStore.h"
+#include "FlashPartition.h"
+#include "Profiler.h"
+#include "System.h"
+#include "Trace.h"
+
+
+namespace
+{
+	using namespace PLEN2;
+	using namespace PLEN2::Motion;
+
+
+	enum {
+		MAGIC_0 = 'P',
+		MAGIC_1 = 'M',
+
+		END_OFFSET = 4,
+		MASK_SIZE  = 3,
+		EXTRA_SIZE = 7, //!< Fields of events.
+
+		VERSION_RAW     = 1,  //!< Version that stored frames as they are.
+		VERSION_ENCODED = 2,  //!< Version that encoded frames, in records of 8 bit counts.
+
+		LEGACY_SLOT_END    = 90, //!< Slots of the files before version 3.
+		LEGACY_HEADER_SIZE = 30,
+		LEGACY_KEYFRAMES_OFFSET = LEGACY_HEADER_SIZE + 6
+	};
+
+	//! @brief File that a motion library is converted into
+	const char* const TEMPORARY_FILE = "/motions.tmp";
+
+	inline void writeShort(unsigned char data[], unsigned short value)
+	{
+		data[0] = lowByte(value);
+		data[1] = highByte(value);
+	}
+
+	inline unsigned short readShort(const unsigned char data[])
+	{
+		return data[0] | (data[1] << 8);
+	}
+
+	inline void writeLong(unsigned char data[], unsigned long value)
+	{
+		data[0] = value;
+		data[1] = value >> 8;
+		data[2] = value >> 16;
+		data[3] = value >> 24;
+	}
+
+	inline unsigned long readLong(const unsigned char data[])
+	{
+		return (static_cast<unsigned long>(data[0])      )
+			| (static_cast<unsigned long>(data[1]) <<  8)
+			| (static_cast<unsigned long>(data[2]) << 16)
+			| (static_cast<unsigned long>(data[3]) << 24);
+	}
+
+	inline unsigned char* putVarint(unsigned char* data_ptr, unsigned long value)
+	{
+		while (value >= 0x80)
+		{
+			*data_ptr++ = value | 0x80;
+			value >>= 7;
+		}
+
+		*data_ptr++ = value;
+
+		return data_ptr;
+	}
+
+	//! @return Pointer after the varint, or NULL if it runs over end_ptr
+	inline const unsigned char* getVarint(const unsigned char* data_ptr, const unsigned char* end_ptr, unsigned long& value)
+	{
+		value = 0;
+
+		for (unsigned char shift = 0; (data_ptr < end_ptr) && (shift < 35); shift += 7)
+		{
+			const unsigned char byte = *data_ptr++;
+
+			value |= static_cast<unsigned long>(byte & 0x7F) << shift;
+
+			if (!(byte & 0x80))
+			{
+				return data_ptr;
+			}
+		}
+
+		return NULL;
+	}
+
+	//! @brief Map a signed value to unsigned one, so small magnitudes take a byte of varint
+	inline unsigned long zigzag(long value)
+	{
+		return (static_cast<unsigned long>(value) << 1) ^ static_cast<unsigned long>(value >> 31);
+	}
+
+	inline long unzigzag(unsigned long value)
+	{
+		return static_cast<long>(value >> 1) ^ -static_cast<long>(value & 1);
+	}
+
+
+	/*!
+		@brief Header of the files before version 3, that had 8 bit frame indexes
+	*/
+	class LegacyHeader
+	{
+	public:
+		unsigned char slot;
+		char          name[Header::NAME_LENGTH];
+		unsigned char frame_length;
+
+		unsigned char NON_RESERVED  : 3;
+		unsigned char interpolation : 2;
+		unsigned char use_extra     : 1;
+		unsigned char use_jump      : 1;
+		unsigned char use_loop      : 1;
+
+		unsigned char loop_begin;
+		unsigned char loop_end;
+		unsigned char loop_count;
+		unsigned char jump_slot;
+		unsigned char frame_events;
+		unsigned char frame_events_check;
+	};
+
+	void convertHeader(const LegacyHeader& legacy, Header& header)
+	{
+		header.init();
+
+		header.slot = legacy.slot;
+		memcpy(header.name, legacy.name, Header::NAME_LENGTH);
+		header.name[Header::NAME_LENGTH - 1] = '\0';
+
+		header.frame_length       = legacy.frame_length;
+		header.interpolation      = legacy.interpolation;
+		header.use_extra          = legacy.use_extra;
+		header.use_jump           = legacy.use_jump;
+		header.use_loop           = legacy.use_loop;
+		header.loop_begin         = legacy.loop_begin;
+		header.loop_end           = legacy.loop_end;
+		header.loop_count         = legacy.loop_count;
+		header.jump_slot          = legacy.jump_slot;
+		header.frame_events       = legacy.frame_events;
+		header.frame_events_check = legacy.frame_events_check;
+	}
+
+
+	/*
+		Layout of the old "/motion.bin": every slot had a header and 20 frames,
+		split into pieces of ExternalFs::SLOT_SIZE() bytes at ExternalFs::CHUNK_SIZE() strides.
+	*/
+	template<const int N>
+	struct IF
+	{
+		enum { VALUE = 1 };
+	};
+
+	template<>
+	struct IF<0>
+	{
+		enum { VALUE = 0 };
+	};
+
+	template<typename T>
+	struct SIZE_SUP
+	{
+		enum { VALUE = sizeof(T) % 30 /* ExternalFs::SLOT_SIZE */ };
+	};
+
+	template<typename T>
+	struct SLOT_COUNT
+	{
+		enum {
+			VALUE = sizeof(T) / 30 /* ExternalFs::SLOT_SIZE */
+			      + IF<SIZE_SUP<T>::VALUE>::VALUE
+		};
+	};
+
+	enum {
+		LEGACY_FRAMELENGTH_MAX   = 20,
+		LEGACY_SLOT_COUNT_HEADER = SLOT_COUNT<LegacyHeader>::VALUE,
+		LEGACY_SLOT_COUNT_FRAME  = SLOT_COUNT<Frame       >::VALUE,
+		LEGACY_SLOT_COUNT_MOTION = LEGACY_SLOT_COUNT_HEADER + LEGACY_SLOT_COUNT_FRAME * LEGACY_FRAMELENGTH_MAX
+	};
+
+	template<typename T>
+	bool readLegacy(unsigned int first_slot, T& value, File& fp)
+	{
+		unsigned char* filler = reinterpret_cast<unsigned char*>(&value);
+
+		for (int count = 0; count < SLOT_COUNT<T>::VALUE; count++)
+		{
+			const unsigned char size = (
+				(count == (SLOT_COUNT<T>::VALUE - 1)) && (SIZE_SUP<T>::VALUE != 0)
+			)? SIZE_SUP<T>::VALUE : ExternalFs::SLOT_SIZE();
+
+			if (ExternalFs::readSlot(first_slot + count, filler + count * ExternalFs::SLOT_SIZE(), size, fp) != size)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//! @brief Update CRC-16/CCITT-FALSE, as JointController checks its configuration
+	unsigned short updateCrc(unsigned short crc, const unsigned char data[], unsigned long size)
+	{
+		for (unsigned long index = 0; index < size; index++)
+		{
+			crc ^= static_cast<unsigned short>(data[index]) << 8;
+
+			for (int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc & 0x8000)? ((crc << 1) ^ 0x1021) : (crc << 1);
+			}
+		}
+
+		return crc;
+	}
+
+	//! @brief Clear a frame to home
+	void clearFrame(Frame& frame)
+	{
+		const unsigned short index = frame.index;
+
+		memset(&frame, 0, sizeof(Frame));
+		frame.index = index;
+	}
+
+	//! @brief Clear fields of events, that are meaningless without events
+	void clearEventFields(Frame& frame)
+	{
+		if (frame.events == 0)
+		{
+			frame.event_code       = 0;
+			frame.sensor_id        = 0;
+			frame.sensor_condition = 0;
+			frame.sensor_threshold = 0;
+			frame.hold_timeout_ms  = 0;
+		}
+	}
+}
+
+
+File                       PLEN2::MotionStore::m_file;
+bool                       PLEN2::MotionStore::m_mapped      = false;
+PLEN2::MotionStore::Entry  PLEN2::MotionStore::m_entries[PLEN2::Motion::SLOT_END];
+unsigned long              PLEN2::MotionStore::m_end         = 0;
+unsigned long              PLEN2::MotionStore::m_limit       = 0;
+unsigned long              PLEN2::MotionStore::m_compactions = 0;
+unsigned char              PLEN2::MotionStore::m_pending     = PLEN2::Motion::SLOT_END;
+bool                       PLEN2::MotionStore::m_open        = false;
+unsigned char              PLEN2::MotionStore::m_index_copy  = 0;
+unsigned long              PLEN2::MotionStore::m_sequence    = 0;
+PLEN2::MotionStore::Stage  PLEN2::MotionStore::m_stage;
+unsigned char              PLEN2::MotionStore::m_buffer[PLEN2::MotionStore::BUFFER_SIZE];
+PLEN2::MotionStore::Cursor PLEN2::MotionStore::m_cursors[PLEN2::MotionStore::CURSOR_SUM];
+unsigned long              PLEN2::MotionStore::m_clock       = 0;
+
+
+void PLEN2::MotionStore::init()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::init()"));
+	#endif
+
+	m_compactions = 0;
+	m_mapped      = false;
+	m_pending     = Motion::SLOT_END;
+	m_open        = false;
+	m_stage.slot  = Motion::SLOT_END;
+	m_forget();
+
+	bool loaded = false;
+
+	/*!
+		@note
+		The old file is removed only after all motions were converted,
+		so a conversion broken by power loss begins again at the next boot.
+		The files are converted in SPIFFS, and imported into the partition after it.
+	*/
+	if (SPIFFS.exists(MOTION_FILE))
+	{
+		if (m_create(MOTION_STORE_FILE))
+		{
+			m_migrate();
+			loaded = true;
+		}
+	}
+	else
+	{
+		// A conversion was broken between removing the old file and renaming the new one.
+		if (!SPIFFS.exists(MOTION_STORE_FILE) && SPIFFS.exists(TEMPORARY_FILE))
+		{
+			SPIFFS.rename(TEMPORARY_FILE, MOTION_STORE_FILE);
+		}
+
+		if (SPIFFS.exists(MOTION_STORE_FILE))
+		{
+			m_file = SPIFFS.open(MOTION_STORE_FILE, "r+");
+			loaded = (m_load() || m_upgrade());
+
+			if (!loaded)
+			{
+				m_file.close();
+
+				#if DEBUG
+					System::debugSerial().println(F(">>> error : The motions are broken, so they are made again."));
+				#endif
+			}
+		}
+	}
+
+	if (FlashPartition::init())
+	{
+		if (loaded)
+		{
+			m_import();
+		}
+		else
+		{
+			SPIFFS.remove(MOTION_STORE_FILE);
+
+			m_mapped = true;
+
+			if (!m_load())
+			{
+				m_create(NULL);
+			}
+		}
+	}
+	else if (!loaded)
+	{
+		m_create(MOTION_STORE_FILE);
+	}
+
+	m_updateLimit();
+}
+
+
+bool PLEN2::MotionStore::readHeader(Motion::Header& header)
+{
+	TRACE_SCOPE("MotionStore::readHeader()");
+
+	const unsigned char slot = header.slot;
+	const Entry& entry = m_entries[slot];
+
+	if (entry.offset == 0)
+	{
+		header.init();
+		header.slot = slot;
+
+		return false;
+	}
+
+	return m_read(entry.offset, reinterpret_cast<unsigned char*>(&header), HEADER_SIZE);
+}
+
+
+bool PLEN2::MotionStore::writeHeader(const Motion::Header& header)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::writeHeader()"));
+	#endif
+
+	const unsigned char slot = header.slot;
+	const Entry& entry = m_entries[slot];
+
+	discard();
+
+	/*!
+		@note
+		The partition never erases a record in place, so a header changed moves the record.
+		(A header written again as it is, e.g. by Header::gatherEvents(), is skipped.)
+	*/
+	if (m_mapped)
+	{
+		Motion::Header stored;
+		stored.slot = slot;
+
+		if (   (entry.capacity >= header.frame_length)
+			&& readHeader(stored)
+			&& (memcmp(&stored, &header, HEADER_SIZE) == 0)
+		)
+		{
+			return true;
+		}
+
+		return m_rewrite(slot, (entry.capacity < header.frame_length)? header.frame_length : entry.capacity, &header, NULL);
+	}
+
+	// The header is at the beginning of the record, so it is written in place if the record has room.
+	if (   ((entry.offset == 0) || (entry.capacity < header.frame_length))
+		&& !m_rewrite(slot, header.frame_length, &header, NULL)
+	)
+	{
+		return false;
+	}
+
+	const bool result = m_write(m_entries[slot].offset, reinterpret_cast<const unsigned char*>(&header), HEADER_SIZE);
+	m_flush();
+
+	return result;
+}
+
+
+bool PLEN2::MotionStore::readFrame(unsigned char slot, Motion::Frame& frame)
+{
+	TRACE_SCOPE("MotionStore::readFrame()");
+
+	const unsigned short index = frame.index;
+
+	// The slot might be the jump of a broken header, so it is checked as the index is.
+	if ((slot >= Motion::SLOT_END) || (index >= m_entries[slot].count))
+	{
+		clearFrame(frame);
+
+		return false;
+	}
+
+	const Entry& entry = m_entries[slot];
+
+	const unsigned short keyframe = index - (index % KEYFRAME_INTERVAL);
+	Cursor* cursor_ptr = NULL;
+	Cursor* victim_ptr = &m_cursors[0];
+
+	// The nearest cursor before the frame is taken, unless the keyframe before the frame is nearer.
+	for (unsigned char cursor_index = 0; cursor_index < CURSOR_SUM; cursor_index++)
+	{
+		Cursor& cursor = m_cursors[cursor_index];
+
+		if (   (cursor.slot == slot)
+			&& (cursor.frame.index <= index)
+			&& ((cursor.frame.index + 1) >= keyframe)
+			&& ((cursor_ptr == NULL) || (cursor.frame.index > cursor_ptr->frame.index))
+		)
+		{
+			cursor_ptr = &cursor;
+		}
+
+		if (cursor.used < victim_ptr->used)
+		{
+			victim_ptr = &cursor;
+		}
+	}
+
+	if (cursor_ptr == NULL)
+	{
+		unsigned char data[4];
+
+		if (!m_read(entry.offset + KEYFRAMES_OFFSET + 4UL * (keyframe / KEYFRAME_INTERVAL), data, sizeof(data)))
+		{
+			clearFrame(frame);
+
+			return false;
+		}
+
+		cursor_ptr = victim_ptr;
+		cursor_ptr->slot = slot;
+		cursor_ptr->next = entry.offset + readLong(data);
+
+		clearFrame(cursor_ptr->frame);
+		cursor_ptr->frame.index = keyframe - 1;
+	}
+
+	cursor_ptr->used = ++m_clock;
+
+	while (cursor_ptr->frame.index != index)
+	{
+		if (!m_decodeNext(*cursor_ptr))
+		{
+			clearFrame(frame);
+
+			return false;
+		}
+	}
+
+	frame = cursor_ptr->frame;
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::writeFrame(unsigned char slot, const Motion::Frame& frame)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::writeFrame()"));
+	#endif
+
+	Entry& entry = m_entries[slot];
+	const unsigned short index = frame.index;
+
+	discard();
+
+	if (   (entry.offset == 0)
+		|| (index != entry.count)
+		|| (index >= entry.capacity)
+		|| ((entry.offset + entry.size) != m_end)
+	)
+	{
+		return m_rewrite(slot, (index < entry.capacity)? entry.capacity : (index + 1), NULL, &frame);
+	}
+
+	/*!
+		@note
+		The frame is appended to the record at the end of the file,
+		so installing a motion in order never rewrites it.
+	*/
+	Motion::Frame previous;
+	unsigned char data[ENCODED_SIZE_MAX];
+
+	if ((index % KEYFRAME_INTERVAL) == 0)
+	{
+		clearFrame(previous);
+	}
+	else
+	{
+		previous.index = index - 1;
+
+		if (!readFrame(slot, previous))
+		{
+			return false;
+		}
+	}
+
+	// Compaction moves the record, but it is still at the end of the file.
+	if (!m_reserve(ENCODED_SIZE_MAX))
+	{
+		return false;
+	}
+
+	/*!
+		@note
+		m_recover() reads the bytes after the end as frames while the index is open,
+		so it is opened only if they are erased. Otherwise, the record moves to the erased bytes.
+	*/
+	if (m_mapped && !m_open)
+	{
+		if (m_begin() != m_end)
+		{
+			return m_rewrite(slot, entry.capacity, NULL, &frame);
+		}
+
+		m_open = true;
+
+		if (!m_flip())
+		{
+			return false;
+		}
+	}
+
+	const unsigned char size = encode(frame, previous, data);
+	const unsigned long offset = entry.offset + entry.size;
+	bool written = true;
+
+	// The keyframe is written before the frame, so a frame found by m_recover() always has it.
+	if ((index % KEYFRAME_INTERVAL) == 0)
+	{
+		unsigned char keyframe[4];
+		writeLong(keyframe, entry.size);
+
+		written = m_write(entry.offset + KEYFRAMES_OFFSET + 4UL * (index / KEYFRAME_INTERVAL), keyframe, sizeof(keyframe));
+	}
+
+	if (!written || !m_write(offset, data, size))
+	{
+		// The partition refuses bytes that are not erased, and the record moves instead.
+		return (m_mapped && m_rewrite(slot, entry.capacity, NULL, &frame));
+	}
+
+	entry.count++;
+	entry.size += size;
+	m_end = entry.offset + entry.size;
+
+	m_keep(slot, frame, m_end);
+
+	/*!
+		@note
+		The partition after the end is erased, so the frames appended are found by m_recover().
+		The count and the end are written to the index when the record stops being the last one,
+		instead of switching the index for every frame.
+	*/
+	if (m_mapped)
+	{
+		m_pending = slot;
+
+		return true;
+	}
+
+	return (m_writeRecordSize(slot) && m_writeEnd());
+}
+
+
+bool PLEN2::MotionStore::stageHeader(const Motion::Header& header)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::stageHeader()"));
+	#endif
+
+	discard();
+
+	if ((header.slot >= Motion::SLOT_END) || (header.frame_length == 0))
+	{
+		return false;
+	}
+
+	const unsigned long frames_begin = m_framesBegin(header.frame_length);
+	const unsigned long margin       = m_mapped? FlashPartition::SECTOR_SIZE : 0;
+
+	/*!
+		@note
+		The bytes staged are not in the index, so compaction would erase them.
+		Room for the frames is made before staging, for their worst size if it can be.
+	*/
+	if (   !m_settle()
+		|| (   !m_reserve(frames_begin + margin + static_cast<unsigned long>(header.frame_length) * ENCODED_SIZE_MAX)
+			&& !m_reserve(frames_begin + margin + static_cast<unsigned long>(header.frame_length) * ENCODED_SIZE_MIN)
+		)
+	)
+	{
+		return false;
+	}
+
+	memcpy(&m_stage.header, &header, HEADER_SIZE);
+	m_stage.offset  = m_begin();
+	m_stage.flushed = 0;
+	m_stage.used    = 0;
+	m_stage.count   = 0;
+	m_stage.check   = 0xFFFF;
+
+	clearFrame(m_stage.previous);
+
+	unsigned char data[ENCODED_SIZE_MAX];
+
+	// The count, the size and the keyframes are patched later, so they are left erased.
+	memset(data, 0xFF, sizeof(data));
+
+	if (!m_stagePut(reinterpret_cast<const unsigned char*>(&header), HEADER_SIZE))
+	{
+		return false;
+	}
+
+	for (unsigned long position = HEADER_SIZE; position < frames_begin; position += sizeof(data))
+	{
+		if (!m_stagePut(data, ((frames_begin - position) < sizeof(data))? (frames_begin - position) : sizeof(data)))
+		{
+			return false;
+		}
+	}
+
+	m_stage.slot = header.slot;
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::stageFrame(const Motion::Frame& frame)
+{
+	TRACE_SCOPE("MotionStore::stageFrame()");
+
+	const unsigned short index = frame.index;
+
+	if (   (m_stage.slot == Motion::SLOT_END)
+		|| (index != m_stage.count)
+		|| (index >= m_stage.header.frame_length)
+	)
+	{
+		return false;
+	}
+
+	const unsigned long size = m_stage.flushed + m_stage.used;
+	unsigned char data[ENCODED_SIZE_MAX];
+
+	if ((index % KEYFRAME_INTERVAL) == 0)
+	{
+		clearFrame(m_stage.previous);
+
+		writeLong(data, size);
+
+		if (!m_stagePatch(KEYFRAMES_OFFSET + 4UL * (index / KEYFRAME_INTERVAL), data, 4))
+		{
+			discard();
+
+			return false;
+		}
+	}
+
+	const unsigned char encoded_size = encode(frame, m_stage.previous, data);
+
+	if (   ((m_stage.offset + size + encoded_size) > m_limit)
+		|| !m_stagePut(data, encoded_size)
+	)
+	{
+		#if DEBUG
+			System::debugSerial().println(F(">>> error : There is no room for the motion."));
+		#endif
+
+		discard();
+
+		return false;
+	}
+
+	m_stage.check    = updateCrc(m_stage.check, data, encoded_size);
+	m_stage.previous = frame;
+	m_stage.count++;
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::commit()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::commit()"));
+	#endif
+
+	const unsigned char slot = m_stage.slot;
+
+	if ((slot == Motion::SLOT_END) || (m_stage.count != m_stage.header.frame_length))
+	{
+		discard();
+
+		return false;
+	}
+
+	const unsigned long size = m_stage.flushed + m_stage.used;
+	unsigned char data[6];
+
+	writeShort(data, m_stage.count);
+	writeLong(data + 2, size);
+
+	// The record is read back after it was written, so the index never points to a broken record.
+	if (   !m_stagePatch(COUNT_OFFSET, data, sizeof(data))
+		|| !m_stageFlush()
+		|| !m_verify()
+	)
+	{
+		#if DEBUG
+			System::debugSerial().println(F(">>> error : The motion was not written correctly."));
+		#endif
+
+		discard();
+
+		return false;
+	}
+
+	Entry& entry = m_entries[slot];
+
+	entry.offset   = m_stage.offset;
+	entry.capacity = m_stage.header.frame_length;
+	entry.count    = m_stage.count;
+	entry.size     = size;
+	m_end          = entry.offset + entry.size;
+	m_stage.slot   = Motion::SLOT_END;
+	m_forget();
+
+	/*!
+		@note
+		In the partition, the slot is switched with the end by a copy of the index at once.
+		In the file, the end is written before the entry, so the entry always points into the file.
+	*/
+	if (m_mapped)
+	{
+		return m_flip();
+	}
+
+	return (m_writeEnd() && m_writeEntry(slot));
+}
+
+
+void PLEN2::MotionStore::discard()
+{
+	// The bytes staged are after the end, so they are just left. (Refer to m_begin().)
+	m_stage.slot  = Motion::SLOT_END;
+	m_stage.count = 0;
+}
+
+
+bool PLEN2::MotionStore::installed(unsigned char slot)
+{
+	if (slot >= Motion::SLOT_END)
+	{
+		return false;
+	}
+
+	return (m_entries[slot].offset != 0);
+}
+
+
+unsigned short PLEN2::MotionStore::frameCount(unsigned char slot)
+{
+	if (slot >= Motion::SLOT_END)
+	{
+		return 0;
+	}
+
+	return m_entries[slot].count;
+}
+
+
+unsigned char PLEN2::MotionStore::encode(const Motion::Frame& frame, const Motion::Frame& previous, unsigned char data[])
+{
+	TRACE_SCOPE("MotionStore::encode()");
+
+	unsigned char* data_ptr = putVarint(data + 1, frame.transition_time_ms);
+	unsigned char* mask     = data_ptr;
+
+	data_ptr += MASK_SIZE;
+	mask[0] = mask[1] = mask[2] = 0;
+
+	for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		const long difference = static_cast<long>(frame.joint_angle[joint_id]) - previous.joint_angle[joint_id];
+
+		if (difference != 0)
+		{
+			mask[joint_id / 8] |= (1 << (joint_id % 8));
+			data_ptr = putVarint(data_ptr, zigzag(difference));
+		}
+	}
+
+	*data_ptr++ = frame.events;
+
+	if (frame.events != 0)
+	{
+		*data_ptr++ = frame.event_code;
+		*data_ptr++ = frame.sensor_id;
+		*data_ptr++ = frame.sensor_condition;
+		writeShort(data_ptr, frame.sensor_threshold);
+		writeShort(data_ptr + 2, frame.hold_timeout_ms);
+		data_ptr += 4;
+	}
+
+	data[0] = data_ptr - data;
+
+	return data[0];
+}
+
+
+bool PLEN2::MotionStore::decode(const unsigned char data[], unsigned char size, Motion::Frame& frame)
+{
+	TRACE_SCOPE("MotionStore::decode()");
+
+	if ((size == 0) || (data[0] > size))
+	{
+		return false;
+	}
+
+	const unsigned char* end_ptr  = data + data[0];
+	const unsigned char* data_ptr = data + 1;
+	unsigned long value;
+
+	if ((data_ptr = getVarint(data_ptr, end_ptr, value)) == NULL)
+	{
+		return false;
+	}
+
+	frame.transition_time_ms = value;
+
+	if ((end_ptr - data_ptr) < (MASK_SIZE + 1))
+	{
+		return false;
+	}
+
+	const unsigned long mask =
+		  (static_cast<unsigned long>(data_ptr[0])      )
+		| (static_cast<unsigned long>(data_ptr[1]) <<  8)
+		| (static_cast<unsigned long>(data_ptr[2]) << 16);
+
+	data_ptr += MASK_SIZE;
+
+	for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		if (!(mask & (1UL << joint_id)))
+		{
+			continue;
+		}
+
+		if ((data_ptr = getVarint(data_ptr, end_ptr, value)) == NULL)
+		{
+			return false;
+		}
+
+		frame.joint_angle[joint_id] += unzigzag(value);
+	}
+
+	if (data_ptr >= end_ptr)
+	{
+		return false;
+	}
+
+	frame.events = *data_ptr++;
+
+	if (frame.events != 0)
+	{
+		if ((end_ptr - data_ptr) < EXTRA_SIZE)
+		{
+			return false;
+		}
+
+		frame.event_code       = data_ptr[0];
+		frame.sensor_id        = data_ptr[1];
+		frame.sensor_condition = data_ptr[2];
+		frame.sensor_threshold = readShort(data_ptr + 3);
+		frame.hold_timeout_ms  = readShort(data_ptr + 5);
+	}
+	else
+	{
+		clearEventFields(frame);
+	}
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::m_read(unsigned long offset, unsigned char data[], unsigned long size)
+{
+	if (m_mapped)
+	{
+		return ((offset >= RECORDS_BEGIN) && FlashPartition::read(m_address(offset), data, size));
+	}
+
+	m_file.seek(offset, SeekSet);
+
+	return (m_file.read(data, size) == size);
+}
+
+
+bool PLEN2::MotionStore::m_write(unsigned long offset, const unsigned char data[], unsigned long size)
+{
+	// The partition programs the records without erasing, so a record is never erased in place.
+	if (m_mapped)
+	{
+		return ((offset >= RECORDS_BEGIN) && FlashPartition::program(m_address(offset), data, size));
+	}
+
+	m_file.seek(offset, SeekSet);
+
+	return (m_file.write(data, size) == size);
+}
+
+
+void PLEN2::MotionStore::m_flush()
+{
+	if (!m_mapped)
+	{
+		m_file.flush();
+	}
+}
+
+
+unsigned long PLEN2::MotionStore::m_size()
+{
+	return m_mapped? (FlashPartition::size() - m_address(RECORDS_BEGIN) + RECORDS_BEGIN) : m_file.size();
+}
+
+
+unsigned long PLEN2::MotionStore::m_address(unsigned long offset)
+{
+	return (offset - RECORDS_BEGIN) + INDEX_COPY_SUM * FlashPartition::SECTOR_SIZE;
+}
+
+
+unsigned long PLEN2::MotionStore::m_begin()
+{
+	if (!m_mapped)
+	{
+		return m_end;
+	}
+
+	const unsigned long sector_end = (m_address(m_end) + FlashPartition::SECTOR_SIZE - 1) & ~static_cast<unsigned long>(FlashPartition::SECTOR_SIZE - 1);
+
+	/*!
+		@note
+		A record staged is written in order, so the bytes left after the end are contiguous.
+		The sectors after the sector of the end are erased until an erased one.
+	*/
+	for (unsigned long sector = sector_end; sector < FlashPartition::size(); sector += FlashPartition::SECTOR_SIZE)
+	{
+		if (FlashPartition::erased(sector, sector + FlashPartition::SECTOR_SIZE))
+		{
+			break;
+		}
+
+		FlashPartition::erase(sector, sector + FlashPartition::SECTOR_SIZE);
+	}
+
+	if (FlashPartition::erased(m_address(m_end), sector_end))
+	{
+		return m_end;
+	}
+
+	return m_end + (sector_end - m_address(m_end));
+}
+
+
+bool PLEN2::MotionStore::m_flip()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::m_flip()"));
+	#endif
+
+	const unsigned char copy = (m_index_copy + 1) % INDEX_COPY_SUM;
+	const unsigned long base = static_cast<unsigned long>(copy) * FlashPartition::SECTOR_SIZE;
+	unsigned short check = 0xFFFF;
+	unsigned long  position = 0;
+	unsigned short used = 0;
+
+	if (!FlashPartition::erase(base, base + FlashPartition::SECTOR_SIZE))
+	{
+		return false;
+	}
+
+	m_buffer[0] = MAGIC_0;
+	m_buffer[1] = MAGIC_1;
+	m_buffer[2] = FORMAT_VERSION;
+	m_buffer[3] = m_open? FLAG_OPEN : 0;
+	writeLong(m_buffer + END_OFFSET, m_end);
+	used = SUPERBLOCK_SIZE;
+
+	// The copy is programmed in pieces of m_buffer, and the checksum is programmed at last.
+	for (unsigned short slot = 0; slot <= Motion::SLOT_END; slot++)
+	{
+		if ((slot == Motion::SLOT_END) || ((used + INDEX_ENTRY_SIZE) > BUFFER_SIZE))
+		{
+			check = updateCrc(check, m_buffer, used);
+
+			if (!FlashPartition::program(base + position, m_buffer, used))
+			{
+				return false;
+			}
+
+			position += used;
+			used      = 0;
+		}
+
+		if (slot == Motion::SLOT_END)
+		{
+			break;
+		}
+
+		const Entry& entry = m_entries[slot];
+
+		writeLong(m_buffer + used, entry.offset);
+		writeLong(m_buffer + used + 4, entry.size);
+		writeShort(m_buffer + used + 8, entry.capacity);
+		writeShort(m_buffer + used + 10, entry.count);
+		used += INDEX_ENTRY_SIZE;
+	}
+
+	writeLong(m_buffer, m_sequence + 1);
+	check = updateCrc(check, m_buffer, 4);
+	writeShort(m_buffer + 4, check);
+
+	if (   !FlashPartition::program(base + SEQUENCE_OFFSET, m_buffer, 4)
+		|| !FlashPartition::program(base + INDEX_CHECK_OFFSET, m_buffer + 4, 2)
+	)
+	{
+		return false;
+	}
+
+	m_index_copy = copy;
+	m_sequence++;
+	m_pending = Motion::SLOT_END;
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::m_checkIndex(unsigned char copy, unsigned long& sequence)
+{
+	const unsigned long base = static_cast<unsigned long>(copy) * FlashPartition::SECTOR_SIZE;
+	unsigned char data[64];
+	unsigned short check = 0xFFFF;
+
+	for (unsigned long position = 0; position < INDEX_CHECK_OFFSET; position += sizeof(data))
+	{
+		const unsigned char length = ((INDEX_CHECK_OFFSET - position) < sizeof(data))? (INDEX_CHECK_OFFSET - position) : sizeof(data);
+
+		if (!FlashPartition::read(base + position, data, length))
+		{
+			return false;
+		}
+
+		check = updateCrc(check, data, length);
+	}
+
+	if (   !FlashPartition::read(base + INDEX_CHECK_OFFSET, data, 2)
+		|| (readShort(data) != check)
+		|| !FlashPartition::read(base + SEQUENCE_OFFSET, data + 2, 4)
+		|| !FlashPartition::read(base, data + 6, SUPERBLOCK_SIZE)
+		|| (data[6] != MAGIC_0) || (data[7] != MAGIC_1)
+		|| (data[8] != FORMAT_VERSION)
+	)
+	{
+		return false;
+	}
+
+	sequence = readLong(data + 2);
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::m_loadPartition()
+{
+	unsigned char copy = INDEX_COPY_SUM;
+	unsigned long sequence = 0;
+
+	// A copy broken by power loss fails its checksum, and the other one is taken.
+	for (unsigned char candidate = 0; candidate < INDEX_COPY_SUM; candidate++)
+	{
+		unsigned long candidate_sequence;
+
+		if (   m_checkIndex(candidate, candidate_sequence)
+			&& ((copy == INDEX_COPY_SUM) || (candidate_sequence > sequence))
+		)
+		{
+			copy     = candidate;
+			sequence = candidate_sequence;
+		}
+	}
+
+	if (copy == INDEX_COPY_SUM)
+	{
+		return false;
+	}
+
+	const unsigned long base = static_cast<unsigned long>(copy) * FlashPartition::SECTOR_SIZE;
+	unsigned char data[INDEX_ENTRY_SIZE];
+
+	if (!FlashPartition::read(base, data, SUPERBLOCK_SIZE))
+	{
+		return false;
+	}
+
+	m_open       = (data[3] & FLAG_OPEN);
+	m_end        = readLong(data + END_OFFSET);
+	m_index_copy = copy;
+	m_sequence   = sequence;
+
+	if ((m_end < RECORDS_BEGIN) || (m_end > m_size()))
+	{
+		return false;
+	}
+
+	for (unsigned char slot = 0; slot < Motion::SLOT_END; slot++)
+	{
+		Entry& entry = m_entries[slot];
+
+		if (!FlashPartition::read(base + SUPERBLOCK_SIZE + static_cast<unsigned long>(slot) * INDEX_ENTRY_SIZE, data, INDEX_ENTRY_SIZE))
+		{
+			return false;
+		}
+
+		entry.offset   = readLong(data);
+		entry.size     = readLong(data + 4);
+		entry.capacity = readShort(data + 8);
+		entry.count    = readShort(data + 10);
+
+		if (   (entry.offset != 0)
+			&& (   (entry.offset < RECORDS_BEGIN)
+				|| (entry.count > entry.capacity)
+				|| (entry.size < m_framesBegin(entry.capacity))
+				|| ((entry.offset + entry.size) > m_end)
+			)
+		)
+		{
+			entry.offset   = 0;
+			entry.capacity = 0;
+			entry.count    = 0;
+			entry.size     = 0;
+		}
+	}
+
+	if (m_open)
+	{
+		m_recover();
+	}
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::m_stagePut(const unsigned char data[], unsigned long size)
+{
+	while (size != 0)
+	{
+		if ((m_stage.used == BUFFER_SIZE) && !m_stageFlush())
+		{
+			return false;
+		}
+
+		const unsigned long room   = BUFFER_SIZE - m_stage.used;
+		const unsigned long length = (room < size)? room : size;
+
+		memcpy(m_buffer + m_stage.used, data, length);
+
+		m_stage.used += length;
+		data += length;
+		size -= length;
+	}
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::m_stagePatch(unsigned long position, const unsigned char data[], unsigned char size)
+{
+	// The bytes written already were left erased, so they are programmed in place.
+	if (position < m_stage.flushed)
+	{
+		const unsigned char length = ((m_stage.flushed - position) < size)? (m_stage.flushed - position) : size;
+
+		if (!m_write(m_stage.offset + position, data, length))
+		{
+			return false;
+		}
+
+		position += length;
+		data     += length;
+		size     -= length;
+	}
+
+	memcpy(m_buffer + (position - m_stage.flushed), data, size);
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::m_stageFlush()
+{
+	if (m_stage.used == 0)
+	{
+		return true;
+	}
+
+	if (!m_write(m_stage.offset + m_stage.flushed, m_buffer, m_stage.used))
+	{
+		return false;
+	}
+
+	m_stage.flushed += m_stage.used;
+	m_stage.used     = 0;
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::m_verify()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::m_verify()"));
+	#endif
+
+	const unsigned long offset = m_stage.offset;
+	const unsigned long size   = m_stage.flushed;
+	unsigned long position = m_framesBegin(m_stage.header.frame_length);
+	unsigned short check = 0xFFFF;
+	Motion::Header header;
+	unsigned char data[ENCODED_SIZE_MAX];
+
+	m_flush();
+
+	if (   !m_read(offset, reinterpret_cast<unsigned char*>(&header), HEADER_SIZE)
+		|| (memcmp(&header, &m_stage.header, HEADER_SIZE) != 0)
+		|| !m_read(offset + COUNT_OFFSET, data, 6)
+		|| (readShort(data) != m_stage.count)
+		|| (readLong(data + 2) != size)
+	)
+	{
+		return false;
+	}
+
+	for (unsigned short index = 0; index < m_stage.count; index++)
+	{
+		if ((index % KEYFRAME_INTERVAL) == 0)
+		{
+			if (   !m_read(offset + KEYFRAMES_OFFSET + 4UL * (index / KEYFRAME_INTERVAL), data, 4)
+				|| (readLong(data) != position)
+			)
+			{
+				return false;
+			}
+		}
+
+		const unsigned char length = ((size - position) < ENCODED_SIZE_MAX)? (size - position) : static_cast<unsigned long>(ENCODED_SIZE_MAX);
+
+		if (   (position >= size)
+			|| !m_read(offset + position, data, length)
+			|| (data[0] == 0) || (data[0] > length)
+		)
+		{
+			return false;
+		}
+
+		check     = updateCrc(check, data, data[0]);
+		position += data[0];
+	}
+
+	return ((position == size) && (check == m_stage.check));
+}
+
+
+bool PLEN2::MotionStore::m_create(const char* path)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::m_create()"));
+	#endif
+
+	/*!
+		@note
+		The partition is erased at all, so the records are programmed without erasing.
+		(A sector erased already is skipped, so a new flash takes a moment.)
+	*/
+	bool created;
+
+	if (path == NULL)
+	{
+		created = FlashPartition::erase(0, FlashPartition::size());
+	}
+	else
+	{
+		m_file  = SPIFFS.open(path, "w+");
+		created = m_file;
+	}
+
+	if (!created)
+	{
+		#if DEBUG
+			System::debugSerial().println(F(">>> error : The motions could not be created."));
+		#endif
+
+		return false;
+	}
+
+	m_mapped = (path == NULL);
+
+	unsigned char data[ENTRY_SIZE] = { 0 };
+
+	for (unsigned char slot = 0; slot < Motion::SLOT_END; slot++)
+	{
+		m_entries[slot].offset   = 0;
+		m_entries[slot].capacity = 0;
+		m_entries[slot].count    = 0;
+		m_entries[slot].size     = 0;
+	}
+
+	m_end     = RECORDS_BEGIN;
+	m_pending = Motion::SLOT_END;
+	m_open    = false;
+	m_forget();
+
+	// The first copy of the index is written by switching from the second one.
+	if (m_mapped)
+	{
+		m_index_copy = INDEX_COPY_SUM - 1;
+		m_sequence   = 0;
+
+		return m_flip();
+	}
+
+	data[0] = MAGIC_0;
+	data[1] = MAGIC_1;
+	data[2] = FORMAT_VERSION;
+	writeLong(data + END_OFFSET, m_end);
+
+	m_write(0, data, SUPERBLOCK_SIZE);
+	memset(data, 0, ENTRY_SIZE);
+
+	for (unsigned char slot = 0; slot < Motion::SLOT_END; slot++)
+	{
+		m_write(SUPERBLOCK_SIZE + static_cast<unsigned long>(slot) * ENTRY_SIZE, data, ENTRY_SIZE);
+	}
+
+	m_flush();
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::m_import()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::m_import()"));
+	#endif
+
+	const unsigned long end = m_end;
+
+	/*!
+		@note
+		The file is removed only after the motions were copied,
+		so an import broken by power loss begins again at the next boot.
+		The records are copied as they are, and the index loaded from the file is written after them.
+	*/
+	if (!FlashPartition::erase(0, FlashPartition::size()))
+	{
+		return false;
+	}
+
+	m_mapped = true;
+
+	for (unsigned long offset = RECORDS_BEGIN; offset < end; offset += sizeof(m_buffer))
+	{
+		const unsigned long length = ((end - offset) < sizeof(m_buffer))? (end - offset) : sizeof(m_buffer);
+
+		m_file.seek(offset, SeekSet);
+
+		if (   (m_file.read(m_buffer, length) != length)
+			|| !m_write(offset, m_buffer, length)
+		)
+		{
+			m_mapped = false;
+
+			return false;
+		}
+	}
+
+	m_open       = false;
+	m_index_copy = INDEX_COPY_SUM - 1;
+	m_sequence   = 0;
+
+	if (!m_flip())
+	{
+		m_mapped = false;
+
+		return false;
+	}
+
+	m_file.close();
+	SPIFFS.remove(MOTION_STORE_FILE);
+	m_forget();
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::m_load()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::m_load()"));
+	#endif
+
+	unsigned char data[ENTRY_SIZE];
+
+	if (m_mapped)
+	{
+		return m_loadPartition();
+	}
+
+	if (   !m_file
+		|| !m_read(0, data, SUPERBLOCK_SIZE)
+		|| (data[0] != MAGIC_0) || (data[1] != MAGIC_1)
+		|| (data[2] != FORMAT_VERSION)
+	)
+	{
+		return false;
+	}
+
+	m_end = readLong(data + END_OFFSET);
+
+	if ((m_end < RECORDS_BEGIN) || (m_end > m_size()))
+	{
+		return false;
+	}
+
+	for (unsigned char slot = 0; slot < Motion::SLOT_END; slot++)
+	{
+		Entry& entry = m_entries[slot];
+
+		if (!m_read(SUPERBLOCK_SIZE + static_cast<unsigned long>(slot) * ENTRY_SIZE, data, ENTRY_SIZE))
+		{
+			return false;
+		}
+
+		entry.offset   = readLong(data);
+		entry.capacity = readShort(data + 4);
+		entry.count    = 0;
+		entry.size     = 0;
+
+		if (entry.offset == 0)
+		{
+			continue;
+		}
+
+		if ((entry.offset >= RECORDS_BEGIN) && (entry.offset < m_end))
+		{
+			if (m_read(entry.offset + COUNT_OFFSET, data, 6))
+			{
+				entry.count = readShort(data);
+				entry.size  = readLong(data + 2);
+			}
+		}
+
+		// A record out of the file is forgotten, instead of being read as garbage.
+		if (   (entry.offset < RECORDS_BEGIN)
+			|| (entry.count > entry.capacity)
+			|| (entry.size < m_framesBegin(entry.capacity))
+			|| ((entry.offset + entry.size) > m_end)
+		)
+		{
+			entry.offset   = 0;
+			entry.capacity = 0;
+			entry.count    = 0;
+			entry.size     = 0;
+		}
+	}
+
+	return true;
+}
+
+
+void PLEN2::MotionStore::m_migrate()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::m_migrate()"));
+	#endif
+
+	File legacy = SPIFFS.open(MOTION_FILE, "r");
+	LegacyHeader   legacy_header;
+	Motion::Header header;
+	Motion::Frame  frame;
+
+	for (unsigned char slot = 0; slot < LEGACY_SLOT_END; slot++)
+	{
+		const unsigned int first_slot = static_cast<unsigned int>(slot) * LEGACY_SLOT_COUNT_MOTION;
+
+		/*!
+			@note
+			The old file was filled with blank bytes, so a slot never installed has no valid header.
+		*/
+		if (   !readLegacy(first_slot, legacy_header, legacy)
+			|| (legacy_header.slot != slot)
+			|| (legacy_header.frame_length < Motion::Header::FRAMELENGTH_MIN)
+			|| (legacy_header.frame_length > LEGACY_FRAMELENGTH_MAX)
+		)
+		{
+			continue;
+		}
+
+		convertHeader(legacy_header, header);
+
+		if (!writeHeader(header))
+		{
+			legacy.close();
+
+			return;
+		}
+
+		for (unsigned short index = 0; index < header.frame_length; index++)
+		{
+			if (!readLegacy(first_slot + LEGACY_SLOT_COUNT_HEADER + index * LEGACY_SLOT_COUNT_FRAME, frame, legacy))
+			{
+				clearFrame(frame);
+			}
+
+			// The bytes after "events" were never stored by old firmware.
+			clearEventFields(frame);
+			frame.index = index;
+
+			if (!writeFrame(slot, frame))
+			{
+				legacy.close();
+
+				return;
+			}
+		}
+	}
+
+	legacy.close();
+	SPIFFS.remove(MOTION_FILE);
+}
+
+
+bool PLEN2::MotionStore::m_upgrade()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::m_upgrade()"));
+	#endif
+
+	File old = m_file;
+	unsigned char data[ENCODED_SIZE_MAX];
+
+	old.seek(0, SeekSet);
+
+	if (   (old.read(data, SUPERBLOCK_SIZE) != SUPERBLOCK_SIZE)
+		|| (data[0] != MAGIC_0) || (data[1] != MAGIC_1)
+		|| ((data[2] != VERSION_RAW) && (data[2] != VERSION_ENCODED))
+	)
+	{
+		return false;
+	}
+
+	const unsigned char   version = data[2];
+	const unsigned long   old_end = readLong(data + END_OFFSET);
+	const unsigned long   old_records_begin = SUPERBLOCK_SIZE + ENTRY_SIZE * LEGACY_SLOT_END;
+
+	if (!m_create(TEMPORARY_FILE))
+	{
+		return false;
+	}
+
+	LegacyHeader   legacy_header;
+	Motion::Header header;
+	Motion::Frame  frame;
+
+	for (unsigned char slot = 0; slot < LEGACY_SLOT_END; slot++)
+	{
+		old.seek(SUPERBLOCK_SIZE + static_cast<unsigned long>(slot) * ENTRY_SIZE, SeekSet);
+
+		if (old.read(data, ENTRY_SIZE) != ENTRY_SIZE)
+		{
+			break;
+		}
+
+		const unsigned long offset   = readLong(data);
+		const unsigned char capacity = data[4];
+		unsigned char count = capacity;
+		unsigned long position = offset + LEGACY_HEADER_SIZE;
+		unsigned long end      = offset + LEGACY_HEADER_SIZE + static_cast<unsigned long>(capacity) * FRAME_SIZE;
+
+		if ((offset < old_records_begin) || (offset >= old_end))
+		{
+			continue;
+		}
+
+		// A record of version 2 has its count and size after the header.
+		if (version == VERSION_ENCODED)
+		{
+			old.seek(offset + LEGACY_HEADER_SIZE, SeekSet);
+
+			if (old.read(data, 6) != 6)
+			{
+				continue;
+			}
+
+			count    = data[0];
+			position = offset + LEGACY_KEYFRAMES_OFFSET + 4UL * ((capacity + KEYFRAME_INTERVAL - 1) / KEYFRAME_INTERVAL);
+			end      = offset + readLong(data + 2);
+		}
+
+		old.seek(offset, SeekSet);
+
+		if (   (end > old_end)
+			|| (old.read(reinterpret_cast<unsigned char*>(&legacy_header), LEGACY_HEADER_SIZE) != LEGACY_HEADER_SIZE)
+		)
+		{
+			continue;
+		}
+
+		convertHeader(legacy_header, header);
+		header.slot = slot;
+
+		if (!writeHeader(header))
+		{
+			continue;
+		}
+
+		clearFrame(frame);
+
+		for (unsigned short index = 0; (index < count) && (index < header.frame_length); index++)
+		{
+			old.seek(position, SeekSet);
+
+			if (version == VERSION_RAW)
+			{
+				if (old.read(reinterpret_cast<unsigned char*>(&frame), FRAME_SIZE) != FRAME_SIZE)
+				{
+					break;
+				}
+
+				position += FRAME_SIZE;
+			}
+			else
+			{
+				const unsigned char size = ((end - position) < ENCODED_SIZE_MAX)? (end - position) : static_cast<unsigned long>(ENCODED_SIZE_MAX);
+
+				if ((index % KEYFRAME_INTERVAL) == 0)
+				{
+					clearFrame(frame);
+				}
+
+				if ((old.read(data, size) != size) || !decode(data, size, frame))
+				{
+					break;
+				}
+
+				position += data[0];
+			}
+
+			frame.index = index;
+
+			if (!writeFrame(slot, frame))
+			{
+				break;
+			}
+		}
+	}
+
+	old.close();
+	m_file.close();
+
+	SPIFFS.remove(MOTION_STORE_FILE);
+	SPIFFS.rename(TEMPORARY_FILE, MOTION_STORE_FILE);
+
+	m_file = SPIFFS.open(MOTION_STORE_FILE, "r+");
+
+	return m_load();
+}
+
+
+void PLEN2::MotionStore::m_updateLimit()
+{
+	FSInfo info;
+
+	// The partition keeps room after the records for a copy of them, that m_compact() needs.
+	if (m_mapped)
+	{
+		m_limit = RECORDS_BEGIN + (m_size() - RECORDS_BEGIN - FlashPartition::SECTOR_SIZE) / 2;
+
+		return;
+	}
+
+	if (!SPIFFS.info(info))
+	{
+		m_limit = m_end;
+
+		return;
+	}
+
+	const unsigned long size = m_size();
+	const unsigned long free = (info.totalBytes > info.usedBytes)? (info.totalBytes - info.usedBytes) : 0;
+
+	m_limit = size + (free / 4) * 3;
+}
+
+
+bool PLEN2::MotionStore::m_rewrite(unsigned char slot, unsigned short capacity, const Motion::Header* header, const Motion::Frame* replacement)
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::m_rewrite()"));
+	#endif
+
+	Entry& entry = m_entries[slot];
+	const unsigned short count = (
+		(replacement != NULL) && (replacement->index >= entry.count)
+	)? (replacement->index + 1) : entry.count;
+	const unsigned long frames_begin = m_framesBegin(capacity);
+
+	// The new record is written after the end, so the bytes there must not be read as frames appended.
+	if (!m_settle())
+	{
+		return false;
+	}
+
+	/*!
+		@note
+		A frame encoded again has the same bytes, except the frame replaced and the frame after it,
+		so the new record is bounded by the old one.
+	*/
+	const unsigned long frames_size = (entry.offset == 0)? 0 : (entry.size - m_framesBegin(entry.capacity));
+
+	if (!m_reserve(
+		  frames_begin + frames_size + (static_cast<unsigned long>(count - entry.count) + 2) * ENCODED_SIZE_MAX
+		+ (m_mapped? FlashPartition::SECTOR_SIZE : 0)
+	))
+	{
+		return false;
+	}
+
+	const unsigned long offset = m_begin();
+	Motion::Header record_header;
+	unsigned char data[ENCODED_SIZE_MAX];
+
+	record_header.slot = slot;
+
+	if (header != NULL)
+	{
+		record_header = *header;
+	}
+	// The record is written in order from its beginning, so the file only grows at its end.
+	else if (!readHeader(record_header))
+	{
+		record_header.frame_length = (count != 0)? count : static_cast<unsigned short>(Motion::Header::FRAMELENGTH_MIN);
+	}
+
+	if (!m_write(offset, reinterpret_cast<const unsigned char*>(&record_header), HEADER_SIZE))
+	{
+		return false;
+	}
+
+	// The keyframes not written yet are left erased, so the flash programs them without erasing.
+	memset(data, 0xFF, sizeof(data));
+
+	for (unsigned long position = HEADER_SIZE; position < frames_begin; position += sizeof(data))
+	{
+		m_write(offset + position, data, ((frames_begin - position) < sizeof(data))? (frames_begin - position) : sizeof(data));
+	}
+
+	/*!
+		@note
+		Frames are decoded from the old record, and encoded again into the new one,
+		because a frame replaced changes the difference of the frame after it.
+	*/
+	Motion::Frame frame;
+	Motion::Frame previous;
+	unsigned long size = frames_begin;
+
+	for (unsigned short index = 0; index < count; index++)
+	{
+		if ((replacement != NULL) && (index == replacement->index))
+		{
+			frame = *replacement;
+		}
+		else
+		{
+			frame.index = index;
+			readFrame(slot, frame);
+		}
+
+		if ((index % KEYFRAME_INTERVAL) == 0)
+		{
+			clearFrame(previous);
+
+			unsigned char keyframe[4];
+			writeLong(keyframe, size);
+
+			m_write(offset + KEYFRAMES_OFFSET + 4UL * (index / KEYFRAME_INTERVAL), keyframe, sizeof(keyframe));
+		}
+
+		const unsigned char encoded_size = encode(frame, previous, data);
+
+		if (!m_write(offset + size, data, encoded_size))
+		{
+			return false;
+		}
+
+		size    += encoded_size;
+		previous = frame;
+	}
+
+	entry.offset   = offset;
+	entry.capacity = capacity;
+	entry.count    = count;
+	entry.size     = size;
+	m_end          = offset + size;
+	m_forget();
+
+	// The index points to the record after the record was written.
+	if (!m_writeRecordSize(slot))
+	{
+		return false;
+	}
+
+	// The bytes after the new record are erased, so frames are appended to it.
+	if (m_mapped)
+	{
+		m_open = true;
+
+		return m_flip();
+	}
+
+	return (m_writeEnd() && m_writeEntry(slot));
+}
+
+
+bool PLEN2::MotionStore::m_decodeNext(Cursor& cursor)
+{
+	TRACE_SCOPE("MotionStore::m_decodeNext()");
+
+	const Entry& entry = m_entries[cursor.slot];
+	const unsigned long end = entry.offset + entry.size;
+	unsigned char data[ENCODED_SIZE_MAX];
+
+	if (cursor.next >= end)
+	{
+		cursor.slot = Motion::SLOT_END;
+
+		return false;
+	}
+
+	const unsigned char available = ((end - cursor.next) < ENCODED_SIZE_MAX)? (end - cursor.next) : static_cast<unsigned long>(ENCODED_SIZE_MAX);
+	unsigned char size = (available < DECODE_READ_SIZE)? available : static_cast<unsigned char>(DECODE_READ_SIZE);
+
+	// A keyframe differs from home, not from the frame before it.
+	if (((cursor.frame.index + 1) % KEYFRAME_INTERVAL) == 0)
+	{
+		clearFrame(cursor.frame);
+	}
+
+	bool result = m_read(cursor.next, data, size);
+
+	if (result && (data[0] > size) && (data[0] <= available))
+	{
+		result = m_read(cursor.next + size, data + size, data[0] - size);
+		size   = data[0];
+	}
+
+	if (!result || !decode(data, size, cursor.frame))
+	{
+		cursor.slot = Motion::SLOT_END;
+
+		return false;
+	}
+
+	cursor.frame.index++;
+	cursor.next += data[0];
+
+	return true;
+}
+
+
+void PLEN2::MotionStore::m_keep(unsigned char slot, const Motion::Frame& frame, unsigned long next)
+{
+	Cursor* cursor_ptr = &m_cursors[0];
+
+	// The cursor that read the frame before it goes on, so a motion being written keeps a cursor.
+	for (unsigned char cursor_index = 0; cursor_index < CURSOR_SUM; cursor_index++)
+	{
+		Cursor& cursor = m_cursors[cursor_index];
+
+		if ((cursor.slot == slot) && ((cursor.frame.index + 1) == frame.index))
+		{
+			cursor_ptr = &cursor;
+
+			break;
+		}
+
+		if (cursor.used < cursor_ptr->used)
+		{
+			cursor_ptr = &cursor;
+		}
+	}
+
+	cursor_ptr->frame = frame;
+	cursor_ptr->slot  = slot;
+	cursor_ptr->next  = next;
+	cursor_ptr->used  = ++m_clock;
+}
+
+
+void PLEN2::MotionStore::m_forget()
+{
+	for (unsigned char cursor_index = 0; cursor_index < CURSOR_SUM; cursor_index++)
+	{
+		m_cursors[cursor_index].slot = Motion::SLOT_END;
+		m_cursors[cursor_index].used = 0;
+	}
+}
+
+
+bool PLEN2::MotionStore::m_compact()
+{
+	#if DEBUG
+		volatile Utility::Profiler p(F("MotionStore::m_compact()"));
+	#endif
+
+	m_forget();
+
+	if (!(m_mapped? m_compactPartition() : m_compactFile()))
+	{
+		#if DEBUG
+			System::debugSerial().println(F(">>> error : The motions could not be compacted."));
+		#endif
+
+		return false;
+	}
+
+	m_compactions++;
+
+	return true;
+}
+
+
+unsigned char PLEN2::MotionStore::m_nextRecord(unsigned long after)
+{
+	unsigned char result = Motion::SLOT_END;
+
+	for (unsigned char slot = 0; slot < Motion::SLOT_END; slot++)
+	{
+		const Entry& entry = m_entries[slot];
+
+		if (   (entry.offset > after) && (entry.offset < m_end)
+			&& ((result == Motion::SLOT_END) || (entry.offset < m_entries[result].offset))
+		)
+		{
+			result = slot;
+		}
+	}
+
+	return result;
+}
+
+
+unsigned long PLEN2::MotionStore::m_copyRecords(unsigned long to)
+{
+	// Offsets in a record are relative to it, so the record is copied as it is.
+	for (unsigned char slot = m_nextRecord(0); slot != Motion::SLOT_END; slot = m_nextRecord(m_entries[slot].offset))
+	{
+		if (!m_copy(m_entries[slot].offset, to, m_entries[slot].size))
+		{
+			return 0;
+		}
+
+		to += m_entries[slot].size;
+	}
+
+	return to;
+}
+
+
+void PLEN2::MotionStore::m_moveRecords(unsigned long to)
+{
+	unsigned char slot = m_nextRecord(0);
+
+	// The records are searched before the end, and the offsets changed are out of it until the end is moved.
+	while (slot != Motion::SLOT_END)
+	{
+		const unsigned char next = m_nextRecord(m_entries[slot].offset);
+
+		m_entries[slot].offset = to;
+		to += m_entries[slot].size;
+		slot = next;
+	}
+
+	m_end = to;
+}
+
+
+bool PLEN2::MotionStore::m_compactPartition()
+{
+	const unsigned long sector = FlashPartition::SECTOR_SIZE;
+	unsigned long live = 0;
+
+	for (unsigned char slot = 0; slot < Motion::SLOT_END; slot++)
+	{
+		live += m_entries[slot].size;
+	}
+
+	// The copy is after the sector of the end, so the sectors of the records are erased only after the index left them.
+	const unsigned long copy_address = (m_address(m_end) + sector - 1) & ~(sector - 1);
+	const unsigned long copy         = m_end + (copy_address - m_address(m_end));
+
+	// The end is before limit(), so the copy fits after it.
+	if (   ((copy + live) > m_size())
+		|| !m_settle()
+		|| !FlashPartition::erase(copy_address, (m_address(copy + live) + sector - 1) & ~(sector - 1))
+		|| (m_copyRecords(copy) != (copy + live))
+	)
+	{
+		return false;
+	}
+
+	m_moveRecords(copy);
+
+	if (!m_flip())
+	{
+		return false;
+	}
+
+	// The records before the copy are not in the index any longer, so they are erased and written again.
+	if (   !FlashPartition::erase(m_address(RECORDS_BEGIN), copy_address)
+		|| (m_copyRecords(RECORDS_BEGIN) != (RECORDS_BEGIN + live))
+	)
+	{
+		return false;
+	}
+
+	m_moveRecords(RECORDS_BEGIN);
+
+	if (!m_flip())
+	{
+		return false;
+	}
+
+	/*!
+		@note
+		The area freed is erased from the sector after the end, with the copy and the bytes staged after it,
+		so the records written to it are programmed without erasing.
+		The sector of the end is not erased, because it has the last record. (m_begin() skips the rest of it.)
+	*/
+	return FlashPartition::erase((m_address(m_end) + sector - 1) & ~(sector - 1), FlashPartition::size());
+}
+
+
+bool PLEN2::MotionStore::m_compactFile()
+{
+	File file = SPIFFS.open(TEMPORARY_FILE, "w+");
+
+	if (!file)
+	{
+		return false;
+	}
+
+	unsigned char data[ENTRY_SIZE];
+	unsigned char record[FRAME_SIZE];
+	unsigned long to = RECORDS_BEGIN;
+	bool result = true;
+
+	// The index is written with the offsets that m_moveRecords() gives, and the records follow it in their order.
+	memset(data, 0, sizeof(data));
+
+	for (unsigned char slot = 0; slot < Motion::SLOT_END; slot++)
+	{
+		result = result && (file.write(data, ENTRY_SIZE) == ENTRY_SIZE);
+	}
+
+	for (unsigned char slot = m_nextRecord(0); result && (slot != Motion::SLOT_END); slot = m_nextRecord(m_entries[slot].offset))
+	{
+		const Entry& entry = m_entries[slot];
+
+		writeLong(data, to);
+		writeShort(data + 4, entry.capacity);
+		writeShort(data + 6, 0);
+
+		file.seek(SUPERBLOCK_SIZE + static_cast<unsigned long>(slot) * ENTRY_SIZE, SeekSet);
+		result = (file.write(data, ENTRY_SIZE) == ENTRY_SIZE);
+
+		file.seek(to, SeekSet);
+
+		for (unsigned long position = 0; result && (position < entry.size); position += FRAME_SIZE)
+		{
+			const unsigned char length = ((entry.size - position) < FRAME_SIZE)? (entry.size - position) : static_cast<unsigned long>(FRAME_SIZE);
+
+			result = m_read(entry.offset + position, record, length) && (file.write(record, length) == length);
+		}
+
+		to += entry.size;
+	}
+
+	data[0] = MAGIC_0;
+	data[1] = MAGIC_1;
+	data[2] = FORMAT_VERSION;
+	data[3] = 0;
+	writeLong(data + END_OFFSET, to);
+
+	file.seek(0, SeekSet);
+	result = result && (file.write(data, SUPERBLOCK_SIZE) == SUPERBLOCK_SIZE);
+	file.close();
+
+	if (!result)
+	{
+		SPIFFS.remove(TEMPORARY_FILE);
+
+		return false;
+	}
+
+	/*!
+		@note
+		The file is replaced by the compacted one at once, so power loss leaves one of them.
+		(A replacement broken between removing and renaming is finished by init().)
+	*/
+	m_file.close();
+	SPIFFS.remove(MOTION_STORE_FILE);
+
+	m_file = SPIFFS.rename(TEMPORARY_FILE, MOTION_STORE_FILE)
+		? SPIFFS.open(MOTION_STORE_FILE, "r+")
+		: SPIFFS.open(TEMPORARY_FILE, "r+");
+
+	m_moveRecords(RECORDS_BEGIN);
+	m_updateLimit();
+
+	return m_file;
+}
+
+
+bool PLEN2::MotionStore::m_reserve(unsigned long size)
+{
+	if ((m_end + size) <= m_limit)
+	{
+		return true;
+	}
+
+	// Other files may have been removed, so the flash free is measured again before compaction.
+	m_updateLimit();
+
+	if (((m_end + size) > m_limit) && (!m_compact() || ((m_end + size) > m_limit)))
+	{
+		#if DEBUG
+			System::debugSerial().println(F(">>> error : There is no room for the motion."));
+		#endif
+
+		return false;
+	}
+
+	return true;
+}
+
+
+bool PLEN2::MotionStore::m_copy(unsigned long from, unsigned long to, unsigned long size)
+{
+	unsigned char data[FRAME_SIZE];
+
+	while (size != 0)
+	{
+		const unsigned char length = (size < FRAME_SIZE)? size : static_cast<unsigned long>(FRAME_SIZE);
+
+		if (!m_read(from, data, length) || !m_write(to, data, length))
+		{
+			return false;
+		}
+
+		from += length;
+		to   += length;
+		size -= length;
+	}
+
+	return true;
+}
+
+
+void PLEN2::MotionStore::m_recover()
+{
+	unsigned char slot = 0;
+
+	while ((slot < Motion::SLOT_END) && ((m_entries[slot].offset == 0) || ((m_entries[slot].offset + m_entries[slot].size) != m_end)))
+	{
+		slot++;
+	}
+
+	if (slot == Motion::SLOT_END)
+	{
+		return;
+	}
+
+	Entry& entry = m_entries[slot];
+	Motion::Frame frame;
+	unsigned char data[ENCODED_SIZE_MAX];
+
+	clearFrame(frame);
+
+	// The frames appended are followed by the erased bytes, that are never a frame. (0xFF is over ENCODED_SIZE_MAX.)
+	while (entry.count < entry.capacity)
+	{
+		const unsigned long room = m_size() - m_end;
+		const unsigned char size = (room < ENCODED_SIZE_MAX)? room : static_cast<unsigned long>(ENCODED_SIZE_MAX);
+
+		if (!m_read(m_end, data, size) || !decode(data, size, frame))
+		{
+			break;
+		}
+
+		entry.count++;
+		entry.size += data[0];
+		m_end      += data[0];
+		m_pending   = slot;
+	}
+}
+
+
+bool PLEN2::MotionStore::m_settle()
+{
+	if (!m_open && (m_pending == Motion::SLOT_END))
+	{
+		return true;
+	}
+
+	m_open = false;
+
+	return m_flip();
+}
+
+
+bool PLEN2::MotionStore::m_writeEntry(unsigned char slot)
+{
+	unsigned char data[ENTRY_SIZE] = { 0 };
+
+	if (m_mapped)
+	{
+		return m_flip();
+	}
+
+	writeLong(data, m_entries[slot].offset);
+	writeShort(data + 4, m_entries[slot].capacity);
+
+	const bool result = m_write(SUPERBLOCK_SIZE + static_cast<unsigned long>(slot) * ENTRY_SIZE, data, ENTRY_SIZE);
+	m_flush();
+
+	return result;
+}
+
+
+bool PLEN2::MotionStore::m_writeRecordSize(unsigned char slot)
+{
+	const Entry& entry = m_entries[slot];
+	unsigned char data[6] = { 0 };
+
+	writeShort(data, entry.count);
+	writeLong(data + 2, entry.size);
+
+	return m_write(entry.offset + COUNT_OFFSET, data, sizeof(data));
+}
+
+
+bool PLEN2::MotionStore::m_writeEnd()
+{
+	unsigned char data[4];
+
+	if (m_mapped)
+	{
+		return m_flip();
+	}
+
+	writeLong(data, m_end);
+
+	const bool result = m_write(END_OFFSET, data, sizeof(data));
+	m_flush();
+
+	return result;
+}
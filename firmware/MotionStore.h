@@ -0,0 +1,490 @@
+/*!
+	@file      MotionStore.h
+	@brief     Indexed storage of motions in a file of variable length records.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef PLEN2_MOTION_STORE_H
+#define PLEN2_MOTION_STORE_H
+
+#include "FS.h"
+
+#include "Motion.h"
+
+
+namespace PLEN2
+{
+	class MotionStore;
+}
+
+/*!
+	@brief Indexed storage of motions in a file of variable length records
+
+	A motion is a record of its header followed by its frames, stored contiguously,
+	and found by the index in RAM. A motion has up to 65535 frames,
+	and the motions are limited by the flash free rather than by the file.
+
+	Frames are encoded as differences from the frames before them:
+	a mask of the joints changed, and a zig-zag varint for each of them.
+	Consecutive frames usually differ in a few joints by small angles, so a frame takes 10 to 30 bytes instead of 112.
+	Every KEYFRAME_INTERVAL-th frame is a keyframe, that differs from home instead,
+	so any frame is decoded from the keyframe before it.
+
+	Motions are streamed by cursors, that keep the frames decoded last,
+	so the frame after one is decoded from a read() at once.
+	A cursor follows a track, so the tracks playing at once never thrash each other.
+
+	The motions are kept in FlashPartition, that is read at computed offsets without seeking a file,
+	if the flash layout has room for it. Otherwise, they are kept in "/motions.bin" of SPIFFS,
+	that grows as motions are installed. Both have the same records, so "/motions.bin" is imported
+	into the partition by init(), when the partition becomes usable.
+	@code
+	offset  size  content
+	     0     2  Magic. ("PM")
+	     2     1  Version.
+	     3     1  Reserved.
+	     4     4  End of the records.
+	     8  2040  Index of the slots, 8 bytes each.
+	  2048        Records.
+	@endcode
+
+	An entry of the index.
+	@code
+	offset  size  content
+	     0     4  Offset of the record, or 0 if the slot is empty.
+	     4     2  Count of frames that the record has room for.
+	     6     2  Reserved.
+	@endcode
+
+	A record.
+	@code
+	offset  size  content
+	     0    34  Motion::Header.
+	    34     2  Count of frames encoded.
+	    36     4  Size of the record.
+	    40   4*K  Offsets of the keyframes in the record, for the frames that the record has room for.
+	              Frames encoded.
+	@endcode
+
+	A frame encoded.
+	@code
+	size  content
+	   1  Size of the frame encoded.
+	 1-5  transition_time_ms, varint.
+	   3  Mask of the joints changed. (Bit N is joint N.)
+	 1-5  Difference of a joint, zig-zag varint, for each joint changed.
+	   1  events.
+	   7  event_code, sensor_id, sensor_condition, sensor_threshold and hold_timeout_ms, only if events is not 0.
+	@endcode
+
+	A frame is appended to the record of its motion, if the record is at the end of the file.
+	(e.g. A motion installed in order.) Otherwise, the motion is written to a new record at the end of the file,
+	and the index is switched to it after it was written.
+	The file is compacted when the end reaches limit(). The records are never moved in place:
+	the file is compacted to a copy that replaces it, and the partition copies them after the end,
+	switches the index to the copy, and copies them back to the beginning, switching the index again.
+	So power loss while compacting leaves every motion in one of the places, and the partition
+	keeps half of it for a copy of all motions. (They are around 20 KB of its 1 MB.)
+
+	A motion is installed at once by stageHeader(), stageFrame() and commit().
+	The record is staged after the end, and the index is switched to it only after all frames arrived
+	and the record read back matched their checksum, so an installation broken halfway
+	(e.g. A connection dropped, or power loss.) leaves the old motion as it was.
+	The record is buffered in RAM, so a short motion is programmed at once.
+
+	The partition never erases a record in place, even while compacting.
+	A record is written once to erased bytes, and a header or a frame changed moves the record.
+	Its first 2 sectors hold 2 copies of the index, and the index is switched
+	by writing the older copy with the next sequence number. The copy is valid after its checksum was written last,
+	so power loss while writing it leaves the other one. A copy of the index in the partition:
+	@code
+	offset   size  content
+	     0      2  Magic. ("PM")
+	     2      1  Version.
+	     3      1  Flags. (Bit 0: Frames may be appended after the end, and m_recover() finds them.)
+	     4      4  End of the records.
+	     8  12*255 Index of the slots: offset (4), size (4), capacity (2) and count (2) of a record.
+	  3068      4  Sequence number.
+	  3072      2  CRC-16 of the bytes before it.
+	@endcode
+	Offsets of the records are the same as the file, and a record is at (offset - 2048 + 8192) in the partition.
+
+	The old "/motion.bin", that reserved 20 frames for every slot in 32 bytes chunks,
+	and the files of version 1 and 2, that had 90 slots of 20 frames, are converted by init().
+
+	@attention
+	The class is not guarded against interruptions, so please use it from the main loop only.
+*/
+class PLEN2::MotionStore
+{
+public:
+	enum {
+		FORMAT_VERSION     = 3,                      //!< Version of the file format.
+		HEADER_SIZE        = sizeof(Motion::Header),
+		FRAME_SIZE         = sizeof(Motion::Frame),  //!< Size of a frame decoded.
+		KEYFRAME_INTERVAL  = 4,                      //!< Frames from a keyframe to the next.
+		ENCODED_SIZE_MAX   = 1 + 5 + 3 + 5 * JointController::SUM + 1 + 7,
+		ENCODED_SIZE_MIN   = 1 + 1 + 3 + 1,
+		CURSOR_SUM         = 4                       //!< Motions streamed at once. (The tracks and the layers.)
+	};
+
+	/*!
+		@brief Open the motions, or convert the old file
+
+		@attention
+		Please call the method after ExternalFs::init().
+	*/
+	static void init();
+
+	/*!
+		@brief Read a header
+
+		@param [in, out] header Please set slot of the header.
+
+		@return false if the slot is empty (The header is initialized.)
+	*/
+	static bool readHeader(Motion::Header& header);
+
+	/*!
+		@brief Write a header
+
+		The record grows if it has no room for frame_length frames.
+
+		@param [in] header Header to write.
+
+		@return Result
+	*/
+	static bool writeHeader(const Motion::Header& header);
+
+	/*!
+		@brief Read a frame
+
+		@param [in]      slot  Slot number of a motion.
+		@param [in, out] frame Please set index of the frame.
+
+		@return false if the slot is invalid or its record has no such frame (The frame is cleared to home.)
+	*/
+	static bool readFrame(unsigned char slot, Motion::Frame& frame);
+
+	/*!
+		@brief Write a frame
+
+		A frame after the frames encoded is appended, and others rewrite the motion.
+
+		@param [in] slot  Slot number of a motion.
+		@param [in] frame Frame to write.
+
+		@return Result
+	*/
+	static bool writeFrame(unsigned char slot, const Motion::Frame& frame);
+
+	/*!
+		@brief Encode a frame
+
+		@param [in]  frame    Frame to encode.
+		@param [in]  previous Frame that the differences are taken from.
+		@param [out] data[]   Please set buffer of ENCODED_SIZE_MAX bytes.
+
+		@return Size of the frame encoded
+	*/
+	static unsigned char encode(const Motion::Frame& frame, const Motion::Frame& previous, unsigned char data[]);
+
+	/*!
+		@brief Decode a frame
+
+		@param [in]      data[] Frame encoded.
+		@param [in]      size   Bytes readable from data[].
+		@param [in, out] frame  Please set the frame that the differences are taken from.
+
+		@return false if the data is broken
+	*/
+	static bool decode(const unsigned char data[], unsigned char size, Motion::Frame& frame);
+
+	/*!
+		@brief Begin to stage a motion, that replaces the motion of the slot at commit()
+
+		The motion staged before is discarded.
+
+		@param [in] header Header of the motion. (Its frame_length frames follow.)
+
+		@return Result
+	*/
+	static bool stageHeader(const Motion::Header& header);
+
+	/*!
+		@brief Stage a frame of the motion
+
+		@param [in] frame Please set the frames in order from 0.
+
+		@return Result (The motion staged is discarded if there is no room for it.)
+	*/
+	static bool stageFrame(const Motion::Frame& frame);
+
+	/*!
+		@brief Switch the slot to the motion staged
+
+		@return false if its frames have not arrived, or it was not written correctly (It is discarded.)
+	*/
+	static bool commit();
+
+	/*!
+		@brief Discard the motion staged
+
+		@attention
+		The other writes discard it too, because it is staged after the end.
+	*/
+	static void discard();
+
+	//! @brief Get slot of the motion staged, or SLOT_END
+	static unsigned char stagedSlot() { return m_stage.slot; }
+
+	//! @brief Get count of the frames staged
+	static unsigned short stagedCount() { return m_stage.count; }
+
+	//! @brief Get frame length of the motion staged
+	static unsigned short stagedLength() { return m_stage.header.frame_length; }
+
+	//! @brief Decide a motion is installed
+	static bool installed(unsigned char slot);
+
+	//! @brief Get count of frames stored for a motion
+	static unsigned short frameCount(unsigned char slot);
+
+	//! @brief Get bytes used by the motions
+	static unsigned long used() { return m_end; }
+
+	//! @brief Decide the motions are in FlashPartition, instead of the file
+	static bool mapped() { return m_mapped; }
+
+	/*!
+		@brief Get size that the motions are compacted at (bytes)
+
+		It is half of the partition, so the records are compacted by copying them to the other half,
+		or 3/4 of the flash free and the file, so the rest is left to baked motions.
+	*/
+	static unsigned long limit() { return m_limit; }
+
+	//! @brief Get count of compactions after init()
+	static unsigned long compactions() { return m_compactions; }
+
+private:
+	enum {
+		SUPERBLOCK_SIZE = 8,
+		ENTRY_SIZE      = 8,
+		RECORDS_BEGIN   = SUPERBLOCK_SIZE + ENTRY_SIZE * Motion::SLOT_END,
+
+		COUNT_OFFSET     = HEADER_SIZE,     //!< Offset of count of frames in a record.
+		SIZE_OFFSET      = HEADER_SIZE + 2, //!< Offset of size in a record.
+		KEYFRAMES_OFFSET = HEADER_SIZE + 6, //!< Offset of the keyframes in a record.
+
+		INDEX_COPY_SUM      = 2,
+		INDEX_ENTRY_SIZE    = 12, //!< Size of an entry in a copy of the index.
+		INDEX_ENTRIES_SIZE  = INDEX_ENTRY_SIZE * Motion::SLOT_END,
+		SEQUENCE_OFFSET     = SUPERBLOCK_SIZE + INDEX_ENTRIES_SIZE, //!< Offset of sequence number in a copy of the index.
+		INDEX_CHECK_OFFSET  = SEQUENCE_OFFSET + 4,                  //!< Offset of CRC-16 in a copy of the index.
+		FLAG_OPEN           = 0x01,
+
+		BUFFER_SIZE = 512, //!< Bytes of a motion staged, that are programmed at once.
+
+		/*!
+			@brief Bytes of a frame read at first, that most frames fit in
+
+			A longer frame is read again from there to its end, so a frame costs a burst of the flash,
+			and not the bursts of ENCODED_SIZE_MAX bytes.
+		*/
+		DECODE_READ_SIZE = 32
+	};
+
+	class Entry
+	{
+	public:
+		unsigned long  offset;   //!< Offset of the record, or 0.
+		unsigned long  size;     //!< Bytes of the record.
+		unsigned short capacity; //!< Frames that the record has room for.
+		unsigned short count;    //!< Frames encoded.
+	};
+
+	/*!
+		@brief Position of a motion streamed
+	*/
+	class Cursor
+	{
+	public:
+		Motion::Frame frame; //!< Frame decoded last.
+		unsigned char slot;  //!< Slot of the frame, or SLOT_END.
+		unsigned long next;  //!< Offset of the frame after it in the file.
+		unsigned long used;  //!< Clock of the last access.
+	};
+
+	/*!
+		@brief Motion staged
+	*/
+	class Stage
+	{
+	public:
+		Motion::Header header;
+		Motion::Frame  previous; //!< Frame staged last, that the differences are taken from.
+		unsigned long  offset;   //!< Offset of the record.
+		unsigned long  flushed;  //!< Bytes of the record written. (The rest is in m_buffer.)
+		unsigned short used;     //!< Bytes of m_buffer.
+		unsigned short count;    //!< Frames staged.
+		unsigned short check;    //!< CRC-16 of the frames encoded.
+		unsigned char  slot;     //!< Slot staged, or SLOT_END.
+	};
+
+	//! @brief Get offset of the first frame in a record that has room for frames
+	static unsigned long m_framesBegin(unsigned short capacity)
+	{
+		return KEYFRAMES_OFFSET + 4UL * ((static_cast<unsigned long>(capacity) + KEYFRAME_INTERVAL - 1) / KEYFRAME_INTERVAL);
+	}
+
+	/*
+		Accesses of the motions, in the partition or the file.
+	*/
+	static bool m_read(unsigned long offset, unsigned char data[], unsigned long size);
+	static bool m_write(unsigned long offset, const unsigned char data[], unsigned long size);
+	static void m_flush();
+	static unsigned long m_size();
+
+	//! @brief Get address in the partition of an offset of the records
+	static unsigned long m_address(unsigned long offset);
+
+	/*!
+		@brief Get offset that a new record begins at
+
+		In the partition, the bytes after the end may be a record staged and discarded, or a frame broken.
+		The record begins at the next sector then, and the sectors after it are erased.
+	*/
+	static unsigned long m_begin();
+
+	/*!
+		@brief Write the older copy of the index, and switch to it
+	*/
+	static bool m_flip();
+
+	//! @brief Read the newer copy of the index that is valid
+	static bool m_loadPartition();
+
+	//! @brief Decide a copy of the index is valid, and get its sequence number
+	static bool m_checkIndex(unsigned char copy, unsigned long& sequence);
+
+	/*
+		Writing of a motion staged.
+		m_stagePatch() writes bytes staged before, at a position in the record.
+	*/
+	static bool m_stagePut(const unsigned char data[], unsigned long size);
+	static bool m_stagePatch(unsigned long position, const unsigned char data[], unsigned char size);
+	static bool m_stageFlush();
+
+	//! @brief Read the record staged back, and compare it with the frames staged
+	static bool m_verify();
+
+	/*!
+		@brief Create empty motions
+
+		@param [in] path File to create, or NULL to create them in the partition.
+	*/
+	static bool m_create(const char* path);
+
+	//! @brief Copy the motions loaded from the file to the partition, and remove the file
+	static bool m_import();
+
+	static bool m_load();
+	static void m_migrate();
+	static bool m_upgrade();
+	static void m_updateLimit();
+
+	/*!
+		@brief Write a motion to a new record at the end of the file
+
+		@param [in] slot        Slot number of a motion.
+		@param [in] capacity    Frames that the new record has room for.
+		@param [in] header      Header written instead of the header of the motion, or NULL.
+		@param [in] replacement Frame written instead of the frame of its index, or NULL.
+	*/
+	static bool m_rewrite(unsigned char slot, unsigned short capacity, const Motion::Header* header, const Motion::Frame* replacement);
+
+	/*!
+		@brief Decode the frame after the frame of a cursor
+
+		@return Result (The cursor is discarded if it fails.)
+	*/
+	static bool m_decodeNext(Cursor& cursor);
+
+	/*!
+		@brief Keep a frame written to decode the frames after it
+
+		@param [in] slot  Slot number of a motion.
+		@param [in] frame Frame written.
+		@param [in] next  Offset of the frame after it in the file.
+	*/
+	static void m_keep(unsigned char slot, const Motion::Frame& frame, unsigned long next);
+
+	//! @brief Discard all cursors (Offsets in the file were changed.)
+	static void m_forget();
+
+	/*!
+		@brief Pack the records to the beginning of the file
+
+		The records are copied and the index is switched to the copy, so they are not lost by power loss.
+		The offsets of them keep their order, so the last record is still at the end.
+	*/
+	static bool m_compact();
+	static bool m_compactPartition();
+	static bool m_compactFile();
+
+	//! @brief Get the slot of the record after an offset, before the end, or SLOT_END
+	static unsigned char m_nextRecord(unsigned long after);
+
+	/*!
+		@brief Copy the records in their order
+
+		@return End of the copy, or 0 if it fails
+	*/
+	static unsigned long m_copyRecords(unsigned long to);
+
+	//! @brief Set the offsets of the records copied by m_copyRecords(), and the end after them
+	static void m_moveRecords(unsigned long to);
+
+	/*!
+		@brief Find the frames appended to the last record after its count was written
+
+		Please call it after m_load() in the partition.
+	*/
+	static void m_recover();
+
+	/*!
+		@brief Write the frames appended to the index of the partition, and stop appending them
+
+		It keeps the bytes after the end from being read as frames by m_recover().
+	*/
+	static bool m_settle();
+
+	static bool m_reserve(unsigned long size);
+	static bool m_copy(unsigned long from, unsigned long to, unsigned long size);
+	static bool m_writeEntry(unsigned char slot);
+	static bool m_writeRecordSize(unsigned char slot);
+	static bool m_writeEnd();
+
+	static File          m_file;
+	static bool          m_mapped;
+	static Entry         m_entries[Motion::SLOT_END];
+	static unsigned long m_end;
+	static unsigned long m_limit;
+	static unsigned long m_compactions;
+	static unsigned char m_pending; //!< Slot of the last record, if its count is not written yet, or SLOT_END.
+	static bool          m_open;    //!< Frames may be appended after the end. (FLAG_OPEN)
+	static unsigned char m_index_copy;
+	static unsigned long m_sequence;
+
+	static Stage         m_stage;
+	static unsigned char m_buffer[BUFFER_SIZE]; //!< Bytes of the motion staged, or of a copy of the index.
+
+	static Cursor        m_cursors[CURSOR_SUM];
+	static unsigned long m_clock;
+};
+
+#endif // PLEN2_MOTION_STORE_H
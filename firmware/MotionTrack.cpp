@@ -0,0 +1,493 @@
+/*
+        Copyright (c) 2015,
+        - Kazuyuki TAKASE - https://github.com/junbowu
+        - PLEN Project Company Inc. - https://plen.jp
+
+        This software is released under the MIT License.
+        (See also : http://opensource.org/licenses/mit-license.php)
+*/
+#include <Arduino.h>
+
+#include "Motion.h"
+#include "MotionCache.h"
+#include "MotionStore.h"
+#include "MotionTrack.h"
+#include "System.h"
+#include "Trace.h"
+
+
+namespace {
+enum {
+  PRECISION = PLEN2::MotionTrack::RATIO_PRECISION,
+  SPLINE_PRECISION = 12 //!< Keeps the cubic of 0.1 degrees in 32 bits.
+};
+
+//! @brief Ratio of a finished transition
+const long RATIO_ONE = (1L << PRECISION);
+} // namespace
+
+long PLEN2::MotionTrack::ease(long ratio, unsigned char interpolation) {
+  const long long r = ratio;
+
+  switch (interpolation) {
+  // Powers are kept in Q24, so truncation does not break monotonicity.
+  case Motion::Header::INTERPOLATION_SMOOTHSTEP: {
+    // r^2 * (3 - 2r)
+    const long long r2 = (r * r) >> (PRECISION - 8);
+
+    return static_cast<long>((r2 * ((3LL << PRECISION) - 2 * r)) >>
+                             (PRECISION + 8));
+  }
+
+  case Motion::Header::INTERPOLATION_MINIMUM_JERK: {
+    // r^3 * (10 + r * (6r - 15))
+    const long long r3 = (((r * r) >> (PRECISION - 8)) * r) >> PRECISION;
+    const long long poly =
+        (10LL << (PRECISION + 8)) + ((r * (6 * r - (15LL << PRECISION))) >> 8);
+
+    return static_cast<long>((r3 * poly) >> (PRECISION + 16));
+  }
+
+  default: {
+    return ratio;
+  }
+  }
+}
+
+PLEN2::MotionTrack::MotionTrack() {
+  m_transition_us = 0;
+  m_position_us = 0;
+  m_sampled_us = 0;
+  m_ratio = RATIO_ONE;
+  m_transition_finished = true;
+  m_playing = false;
+
+  m_buffer_begin = 0;
+  m_buffer_length = 1;
+  m_frame_current_ptr = &m_buffer[0].frame;
+  m_frame_next_ptr = &m_buffer[1].frame;
+  m_interpolation = Motion::Header::INTERPOLATION_LINEAR;
+
+  m_prefetch_index = 0;
+  m_prefetch_resolved = false;
+  m_prefetch_redirected = false;
+  m_prefetch_finished = true;
+  m_prefetch_stalled = false;
+
+  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+    m_buffer[0].frame.joint_angle[joint_id] = 0;
+    m_buffer[1].frame.joint_angle[joint_id] = 0;
+    m_previous_angles[joint_id] = 0;
+  }
+
+  m_rewind_frames[0].slot = Motion::SLOT_END;
+  m_rewind_frames[1].slot = Motion::SLOT_END;
+  m_rewind = 0;
+  m_rewind_limit = 0;
+}
+
+void PLEN2::MotionTrack::play(unsigned char slot, const int angles[],
+                              unsigned long begin_us) {
+  TRACE_SCOPE("MotionTrack::play()");
+
+  m_header.slot = slot;
+  m_header.get();
+
+  m_prefetch_index = 0;
+  m_prefetch_resolved = true;
+  m_prefetch_redirected = false;
+  m_prefetch_finished = false;
+
+  m_buffer_length = 1;
+
+  Motion::Frame &current = m_bufferedFrame(0).frame;
+
+  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+    current.joint_angle[joint_id] = angles[joint_id];
+    m_previous_angles[joint_id] = angles[joint_id];
+  }
+
+  m_fillBuffer(2);
+
+  // The starting pose is not a frame of the motion, so it is never gone back.
+  m_rewind_frames[0].slot = Motion::SLOT_END;
+  m_rewind_frames[1].slot = Motion::SLOT_END;
+  m_rewind = 0;
+  m_rewind_limit = 0;
+
+  m_position_us = 0;
+  m_sampled_us = begin_us;
+  m_setupFrame();
+  m_ratio = 0;
+
+  m_playing = true;
+}
+
+bool PLEN2::MotionTrack::nextFrameLoadable() {
+  TRACE_SCOPE("MotionTrack::nextFrameLoadable()");
+
+  if (m_buffer_length > 2) {
+    return true;
+  }
+
+  // Nothing is buffered after next-frame, so ask where the prefetcher goes.
+  return m_resolvePrefetch();
+}
+
+void PLEN2::MotionTrack::willStop() {
+  m_header.use_loop = 0;
+  m_header.use_jump = 0;
+
+  if (!m_playing) {
+    return;
+  }
+
+  // Discard the frames read ahead through "loop" or "jump".
+  for (unsigned char offset = 2; offset < m_buffer_length; offset++) {
+    if (m_bufferedFrame(offset).redirected) {
+      m_buffer_length = offset;
+
+      break;
+    }
+  }
+
+  // Walk forward again from the last frame kept, without "loop" and "jump".
+  const BufferedFrame &last = m_bufferedFrame(m_buffer_length - 1);
+
+  if (m_header.slot != last.slot) {
+    m_header.slot = last.slot;
+    m_header.get();
+
+    m_header.use_loop = 0;
+    m_header.use_jump = 0;
+  }
+
+  m_prefetch_index = last.frame.index;
+  m_prefetch_resolved = false;
+  m_prefetch_finished = false;
+}
+
+void PLEN2::MotionTrack::stop() {
+  m_playing = false;
+
+  // @attension It is necessary for a valid sequence!
+  if (m_buffer_length > 1) {
+    m_buffer_begin = (m_buffer_begin + 1) & (FRAMEBUFFER_LENGTH - 1);
+  }
+
+  m_buffer_length = 1;
+  m_prefetch_finished = true;
+  m_transition_finished = true;
+  m_rewind = 0;
+  m_frame_current_ptr = &m_bufferedFrame(0).frame;
+}
+
+void PLEN2::MotionTrack::resume(unsigned long now_us) {
+  m_position_us = m_transition_us;
+  m_sampled_us = now_us;
+}
+
+bool PLEN2::MotionTrack::loadNextFrame() {
+  TRACE_SCOPE("MotionTrack::loadNextFrame()");
+
+  m_prefetch_stalled = false;
+
+  if (!m_fillBuffer(3)) {
+    return false;
+  }
+
+  /*!
+          @note
+          The next transition begins when the last one ended on the clock,
+          so the time the last update overran is not added to the motion.
+  */
+  m_position_us -= m_transition_us;
+
+  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+    m_previous_angles[joint_id] = m_frame_current_ptr->joint_angle[joint_id];
+  }
+
+  m_buffer_begin = (m_buffer_begin + 1) & (FRAMEBUFFER_LENGTH - 1);
+  m_buffer_length--;
+
+  if (m_bufferedFrame(1).interpolation ==
+      Motion::Header::INTERPOLATION_CATMULL_ROM) {
+    m_fillBuffer(3);
+  }
+
+#if DEBUG
+  System::debugSerial().print(F(">>> index_now : "));
+  System::debugSerial().println(
+      static_cast<int>(m_bufferedFrame(0).frame.index));
+
+  System::debugSerial().print(F(">>> m_header.frame_length : "));
+  System::debugSerial().println(static_cast<int>(m_header.frame_length));
+#endif
+
+  m_rewind_limit = m_bufferedFrame(0).frame.index;
+  m_setupFrame();
+
+  /*!
+          @note
+          A late update may have passed the new transition too (e.g. It is
+          shorter than a tick.), so it is finished at once, and the main loop
+          goes through it without waiting for the next update.
+  */
+  if (m_position_us >= m_transition_us) {
+    m_ratio = RATIO_ONE;
+    m_transition_finished = true;
+  }
+
+  return true;
+}
+
+bool PLEN2::MotionTrack::prefetch() {
+  TRACE_SCOPE("MotionTrack::prefetch()");
+
+  if (!m_playing) {
+    return false;
+  }
+
+  return m_prefetchFrame();
+}
+
+void PLEN2::MotionTrack::sample(unsigned long now_us, long rate) {
+  TRACE_SCOPE("MotionTrack::sample()");
+
+  m_position_us += static_cast<long>(
+      (static_cast<long long>(now_us - m_sampled_us) * rate) >>
+      RATE_PRECISION);
+  m_sampled_us = now_us;
+
+  while (m_position_us < 0) {
+    if (m_rewind >= m_rewind_limit) {
+      m_position_us = 0;
+
+      break;
+    }
+
+    m_rewind++;
+    m_setupRewind();
+    m_position_us += m_transition_us;
+  }
+
+  while ((m_rewind > 0) && (m_position_us >= m_transition_us)) {
+    m_position_us -= m_transition_us;
+    m_rewind--;
+
+    if (m_rewind == 0) {
+      m_setupFrame();
+    } else {
+      m_setupRewind();
+    }
+  }
+
+  // A zero-length transition snaps to the next frame at the first update.
+  if (m_position_us < m_transition_us) {
+    m_ratio = (static_cast<long long>(m_position_us) << PRECISION) /
+              m_transition_us;
+  } else {
+    m_ratio = RATIO_ONE;
+    m_transition_finished = true;
+  }
+
+  if (m_interpolation != Motion::Header::INTERPOLATION_CATMULL_ROM) {
+    m_ratio = ease(m_ratio, m_interpolation);
+  }
+}
+
+int PLEN2::MotionTrack::angle(unsigned char joint_id) const {
+  const int angle_from = m_frame_current_ptr->joint_angle[joint_id];
+  const int angle_to = m_frame_next_ptr->joint_angle[joint_id];
+
+  if (m_ratio >= RATIO_ONE) {
+    return angle_to;
+  }
+
+  if (m_interpolation == Motion::Header::INTERPOLATION_CATMULL_ROM) {
+    const long t = m_ratio >> (PRECISION - SPLINE_PRECISION);
+    const SplineCoefficient &spline = m_splines[joint_id];
+    long value = spline.c;
+
+    value = ((value * t) >> SPLINE_PRECISION) + spline.b;
+    value = ((value * t) >> SPLINE_PRECISION) + spline.a;
+
+    return angle_from +
+           static_cast<int>((value * t) >> (SPLINE_PRECISION + 1));
+  }
+
+  return angle_from +
+         static_cast<int>(
+             (static_cast<long>(angle_to - angle_from) * m_ratio) >> PRECISION);
+}
+
+PLEN2::MotionTrack::BufferedFrame &
+PLEN2::MotionTrack::m_bufferedFrame(unsigned char offset) {
+  return m_buffer[(m_buffer_begin + offset) & (FRAMEBUFFER_LENGTH - 1)];
+}
+
+void PLEN2::MotionTrack::m_setupFrame() {
+  TRACE_SCOPE("MotionTrack::m_setupFrame()");
+
+  m_frame_current_ptr = &m_bufferedFrame(0).frame;
+  m_frame_next_ptr = &m_bufferedFrame(1).frame;
+  m_interpolation = m_bufferedFrame(1).interpolation;
+  m_transition_us =
+      static_cast<long>(m_frame_next_ptr->transition_time_ms) * 1000;
+  m_transition_finished = false;
+
+  if (m_interpolation == Motion::Header::INTERPOLATION_CATMULL_ROM) {
+    m_setupSpline();
+  }
+}
+
+void PLEN2::MotionTrack::m_setupSpline() {
+  TRACE_SCOPE("MotionTrack::m_setupSpline()");
+
+  // The frame after next-frame is in the ring unless the motion ends.
+  const Motion::Frame *following_ptr =
+      (m_buffer_length > 2) ? &m_bufferedFrame(2).frame : m_frame_next_ptr;
+
+  for (char joint_id = 0; joint_id < JointController::SUM; joint_id++) {
+    const long p0 = m_previous_angles[joint_id];
+    const long p1 = m_frame_current_ptr->joint_angle[joint_id];
+    const long p2 = m_frame_next_ptr->joint_angle[joint_id];
+    const long p3 = following_ptr->joint_angle[joint_id];
+
+    SplineCoefficient &spline = m_splines[joint_id];
+    spline.a = p2 - p0;
+    spline.b = 2 * p0 - 5 * p1 + 4 * p2 - p3;
+    spline.c = -p0 + 3 * p1 - 3 * p2 + p3;
+  }
+}
+
+void PLEN2::MotionTrack::m_setupRewind() {
+  TRACE_SCOPE("MotionTrack::m_setupRewind()");
+
+  m_frame_current_ptr = &m_rewindFrame(m_rewind);
+  m_frame_next_ptr = (m_rewind == 1) ? &m_bufferedFrame(0).frame
+                                     : &m_rewindFrame(m_rewind - 1);
+
+  // Splines are kept for the transition to next-frame, so go back linearly.
+  m_interpolation = m_bufferedFrame(0).interpolation;
+
+  if (m_interpolation == Motion::Header::INTERPOLATION_CATMULL_ROM) {
+    m_interpolation = Motion::Header::INTERPOLATION_LINEAR;
+  }
+
+  m_transition_us =
+      static_cast<long>(m_frame_next_ptr->transition_time_ms) * 1000;
+}
+
+const PLEN2::Motion::Frame &
+PLEN2::MotionTrack::m_rewindFrame(unsigned short depth) {
+  TRACE_SCOPE("MotionTrack::m_rewindFrame()");
+
+  const BufferedFrame &current = m_bufferedFrame(0);
+  BufferedFrame &rewound = m_rewind_frames[depth & 1];
+  const unsigned short index = current.frame.index - depth;
+
+  if ((rewound.slot != current.slot) || (rewound.frame.index != index)) {
+    rewound.slot = current.slot;
+    rewound.frame.index = index;
+    rewound.frame.get(current.slot);
+  }
+
+  return rewound.frame;
+}
+
+bool PLEN2::MotionTrack::m_resolvePrefetch() {
+  TRACE_SCOPE("MotionTrack::m_resolvePrefetch()");
+
+  if (m_prefetch_finished) {
+    return false;
+  }
+
+  if (m_prefetch_resolved) {
+    return true;
+  }
+
+  const unsigned short index_now = m_prefetch_index;
+  m_prefetch_redirected = true;
+
+  /*!
+          @note
+          The order of priority of doing built-in functions, is "loop" > "jump".
+  */
+  if ((m_header.use_loop) && (index_now >= m_header.loop_end)) {
+    m_prefetch_index = m_header.loop_begin;
+
+    if (m_header.loop_count != 255) {
+      m_header.loop_count--;
+    }
+
+    if (m_header.loop_count == 0) {
+      m_header.use_loop = 0;
+    }
+  } else if ((m_header.use_jump) &&
+             (index_now >= (m_header.frame_length - 1))) {
+    m_header.slot = m_header.jump_slot;
+    m_header.get();
+
+    m_prefetch_index = 0;
+  } else if ((index_now + 1) < m_header.frame_length) {
+    m_prefetch_index = index_now + 1;
+    m_prefetch_redirected = false;
+  } else {
+    m_prefetch_finished = true;
+
+    return false;
+  }
+
+  m_prefetch_resolved = true;
+
+  return true;
+}
+
+bool PLEN2::MotionTrack::m_prefetchFrame() {
+  TRACE_SCOPE("MotionTrack::m_prefetchFrame()");
+
+  if ((m_buffer_length >= FRAMEBUFFER_LENGTH) || !m_resolvePrefetch()) {
+    return false;
+  }
+
+  BufferedFrame &buffered = m_bufferedFrame(m_buffer_length);
+
+  buffered.frame.index = m_prefetch_index;
+  buffered.slot = m_header.slot;
+  buffered.interpolation = m_header.interpolation;
+  buffered.redirected = m_prefetch_redirected;
+
+  // A cached frame is buffered at once, without reading the store.
+  if (!MotionCache::loadFrame(m_header.slot, buffered.frame)) {
+#if DEBUG_LESS
+    System::debugSerial().print(F("MotionStore::readFrame(m_header.slot)"));
+#endif
+    MotionStore::readFrame(m_header.slot, buffered.frame);
+
+    /*!
+            @note
+            A motion longer than the cache would only evict the frames of
+            others before it comes back to its own, so it is streamed.
+    */
+    if ((m_header.frame_length <= MotionCache::FRAME_SUM) ||
+        MotionCache::pinned(m_header.slot)) {
+      MotionCache::storeFrame(m_header.slot, buffered.frame);
+    }
+  }
+
+  m_buffer_length++;
+  m_prefetch_resolved = false;
+
+  return true;
+}
+
+bool PLEN2::MotionTrack::m_fillBuffer(unsigned char length) {
+  TRACE_SCOPE("MotionTrack::m_fillBuffer()");
+
+  while ((m_buffer_length < length) && m_prefetchFrame()) {
+    m_prefetch_stalled = true;
+  }
+
+  return (m_buffer_length >= length);
+}
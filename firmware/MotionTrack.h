@@ -0,0 +1,262 @@
+/*!
+        @file      MotionTrack.h
+        @brief     Playback state of a motion.
+        @author    Kazuyuki TAKASE
+        @copyright The MIT License -
+   http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef PLEN2_MOTION_TRACK_H
+#define PLEN2_MOTION_TRACK_H
+
+#include "JointController.h"
+#include "Motion.h"
+
+namespace PLEN2 {
+class MotionBake;
+class MotionTrack;
+} // namespace PLEN2
+
+/*!
+        @brief Playback state of a motion
+
+        A track walks a motion by itself: it prefetches the frames into a ring,
+        resolves "loop" and "jump", and interpolates joint angles by the time
+        elapsed. It never writes joints, so MotionController can mix tracks.
+
+        The time is a clock of the motion, advanced by the wall time elapsed
+        times a rate at every sample(), so a change of the rate takes effect
+        in the middle of a transition. With a negative rate the track retraces
+        the frames of the current slot by index, without "loop" and "jump".
+*/
+class PLEN2::MotionTrack {
+  // The baker walks a track offline, and compares its states to find a cycle.
+  friend class MotionBake;
+
+public:
+  enum {
+    RATIO_PRECISION = 16, //!< Fraction bits of a ratio of a transition.
+    RATE_PRECISION = 16   //!< Fraction bits of a rate of playback.
+  };
+
+  //! @brief Rate of playback at normal speed
+  inline static const long RATE_ONE() { return (1L << RATE_PRECISION); }
+
+  /*!
+          @brief Shape ratio of elapsed time with an easing profile
+
+          @param [in] ratio         Please set ratio in [0, 1 << RATIO_PRECISION].
+          @param [in] interpolation Please set Motion::Header::INTERPOLATION_*.
+
+          @return Ratio of the way between the frames
+  */
+  static long ease(long ratio, unsigned char interpolation);
+
+  /*!
+          @brief Constructor
+  */
+  MotionTrack();
+
+  /*!
+          @brief Start playing a motion
+
+          Only the first frame is read here, because Interpreter edits "loop"
+          of header() after play(), and the prefetcher must see it.
+
+          @param [in] slot     Number of a motion.
+          @param [in] angles[] Pose that the motion starts from.
+          @param [in] begin_us Value of micros() that the motion starts at.
+  */
+  void play(unsigned char slot, const int angles[], unsigned long begin_us);
+
+  //! @brief Decide the track is playing
+  bool playing() const { return m_playing; }
+
+  //! @brief Decide the transition to next-frame has finished
+  bool updatingFinished() const { return m_transition_finished; }
+
+  //! @brief Decide there is a frame after next-frame
+  bool nextFrameLoadable();
+
+  /*!
+          @brief Disable "loop" and "jump", and discard frames read ahead
+     through them
+  */
+  void willStop();
+
+  /*!
+          @brief Stop playing, keeping next-frame as the pose
+  */
+  void stop();
+
+  /*!
+          @brief Go to the next transition
+
+          The time that the last transition overran is carried over,
+          so late updates are not added to the motion.
+          A transition that the time carried has passed is finished at once.
+
+          @return false if there was no frame to go
+  */
+  bool loadNextFrame();
+
+  /*!
+          @brief Go on after next-frame was held
+
+          The time sampled while the frame was held is dropped,
+          so the next transition starts from the beginning.
+
+          @param [in] now_us Value of micros().
+  */
+  void resume(unsigned long now_us);
+
+  /*!
+          @brief Read ahead a frame to play
+
+          @return true if a frame was read
+  */
+  bool prefetch();
+
+  /*!
+          @brief Sample the transition at a time
+
+          The method advances the clock of the motion, computes the ratio of
+          the transition once, and angle() evaluates joints from it.
+
+          Going back past the beginning of a transition reads the frame
+          before it, which is not prefetched. The motion holds its first
+          transition at the beginning.
+
+          @param [in] now_us Value of micros().
+          @param [in] rate   Rate of playback. (RATE_ONE() is normal speed.)
+  */
+  void sample(unsigned long now_us, long rate);
+
+  /*!
+          @brief Get angle of a joint at the time sampled last
+
+          @param [in] joint_id Please set joint id in [0, JointController::SUM).
+
+          @return Angle difference from home. [degree * 10]
+  */
+  int angle(unsigned char joint_id) const;
+
+  //! @brief Get the frame that the transition starts from
+  const Motion::Frame &currentFrame() const { return *m_frame_current_ptr; }
+
+  //! @brief Get the frame that the transition arrives at
+  const Motion::Frame &nextFrame() const { return *m_frame_next_ptr; }
+
+  //! @brief Get slot that the frame the transition starts from was read from
+  unsigned char currentSlot() { return m_bufferedFrame(0).slot; }
+
+  //! @brief Get slot that the frame the transition arrives at was read from
+  unsigned char nextSlot() { return m_bufferedFrame(1).slot; }
+
+  //! @brief Get length of the transition sampled last at normal speed [usec]
+  long transitionUs() const { return m_transition_us; }
+
+  /*!
+          @brief Get time of the motion left in the transition sampled last
+
+          @return Remaining time at normal speed [usec]
+  */
+  long remainingUs() const { return m_transition_us - m_position_us; }
+
+  //! @brief Decide the track went back before the transition to next-frame
+  bool rewound() const { return (m_rewind != 0); }
+
+  /*!
+          @brief Get header that the prefetcher walks
+
+          Editing "loop" and "jump" of it is effective right after play().
+  */
+  Motion::Header &header() { return m_header; }
+
+  /*!
+          @brief Decide the last loadNextFrame() waited for external EEPROM
+  */
+  bool stalled() const { return m_prefetch_stalled; }
+
+private:
+  enum {
+    FRAMEBUFFER_LENGTH = 4 //!< Depth of the frame ring. (Must be power of 2.)
+  };
+
+  /*!
+          @brief Frame in the ring buffer, with the information to play it
+  */
+  class BufferedFrame {
+  public:
+    Motion::Frame frame;
+    unsigned char slot;          //!< Slot number that the frame was read from.
+    unsigned char interpolation; //!< Interpolation profile of the slot.
+    bool redirected;             //!< The frame was reached by "loop" or "jump".
+  };
+
+  /*!
+          @brief Coefficients of a Catmull-Rom segment, doubled
+
+          The segment is p1 + (t * (a + t * (b + t * c))) / 2.
+  */
+  class SplineCoefficient {
+  public:
+    long a;
+    long b;
+    long c;
+  };
+
+  BufferedFrame &m_bufferedFrame(unsigned char offset);
+  void m_setupFrame();
+  void m_setupSpline();
+  void m_setupRewind();
+  const Motion::Frame &m_rewindFrame(unsigned short depth);
+  bool m_resolvePrefetch();
+  bool m_prefetchFrame();
+  bool m_fillBuffer(unsigned char length);
+
+  long m_transition_us;        //!< Length of the transition at normal speed.
+  long m_position_us;          //!< Clock of the motion in the transition.
+  unsigned long m_sampled_us;  //!< Value of micros() sampled last.
+  long m_ratio;                //!< Ratio sampled last. (Q16)
+  bool m_transition_finished;
+  bool m_playing;
+
+  /*!
+          @brief Header of the motion that the prefetcher walks
+
+          "loop" and "jump" are resolved through it, so the frames in the ring
+          can belong to the motion before a jump.
+  */
+  Motion::Header m_header;
+
+  BufferedFrame m_buffer[FRAMEBUFFER_LENGTH];
+  unsigned char m_buffer_begin;  //!< Index of current-frame.
+  unsigned char m_buffer_length; //!< Count of the frames from current-frame.
+  const Motion::Frame *m_frame_current_ptr;
+  const Motion::Frame *m_frame_next_ptr;
+  unsigned char m_interpolation; //!< Interpolation profile of next-frame.
+
+  unsigned short m_prefetch_index; //!< Frame being read, or read last.
+  bool m_prefetch_resolved;        //!< m_prefetch_index is the frame to read.
+  bool m_prefetch_redirected;      //!< The frame was reached by "loop" or "jump".
+  bool m_prefetch_finished;        //!< No frame is left to read.
+  bool m_prefetch_stalled;         //!< A frame was read while waited for.
+
+  int m_previous_angles[JointController::SUM]; //!< Frame before current-frame.
+  SplineCoefficient m_splines[JointController::SUM];
+
+  /*!
+          @brief Frames read to go back before current-frame
+
+          The frame that is N transitions back from current-frame is kept at
+          [N & 1], so a transition going back has both of its frames here.
+  */
+  BufferedFrame m_rewind_frames[2];
+  unsigned short m_rewind;       //!< Transitions gone back from current-frame.
+  unsigned short m_rewind_limit; //!< Transitions that can be gone back.
+};
+
+#endif // PLEN2_MOTION_TRACK_H
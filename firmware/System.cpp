@@ -1,448 +1,1068 @@
-/*
-        Copyright (c) 2015,
-        - Kazuyuki TAKASE - https://github.com/Guvalif
-        - PLEN Project Company Inc. - https://plen.jp
-
-        This software is released under the MIT License.
-        (See also : http://opensource.org/licenses/mit-license.php)
-*/
-#include "System.h"
-#include "Arduino.h"
-#include "ExternalFs.h"
-#include "JointController.h"
-#include "MotionController.h"
-#include "Pin.h"
-#include "Profiler.h"
-#include <ESP8266HTTPUpdateServer.h>
-#include <ESP8266WebServer.h>
-#include <ESP8266WiFi.h>
-#include <ESP8266mDNS.h>
-#include <Ticker.h>
-#include <WiFiClient.h>
-#include <WiFiUDP.h>
-
-
-extern PLEN2::JointController joint_ctrl;
-extern PLEN2::MotionController motion_ctrl;
-
-#define PLEN2_SYSTEM_SERIAL Serial
-
-#define CONNECT_TIMEOUT_CNT 100
-
-IPAddress broadcastIp(255, 255, 255, 255);
-#define BROADCAST_PORT 6000
-WiFiUDP udp;
-
-ESP8266WebServer httpServer(80);
-ESP8266HTTPUpdateServer httpUpdater;
-static bool servers_started = false;
-
-WiFiServer tcp_server(23);
-WiFiClient serverClient;
-Ticker smartconfig_tricker;
-
-String robot_name = "ViVi-" + String(ESP.getChipId(), HEX);
-const char *wifi_psd = "12345678xyz";
-
-volatile bool update_cfg;
-
-extern File fp_motion;
-extern File fp_config;
-extern File fp_syscfg;
-File fsUploadFile;
-// 启动ao模式
-void PLEN2::System::StartAp() {
-#if CLOCK_WISE
-  String ap_name = "ViVi-M-" + String(ESP.getChipId(), HEX);
-#else
-  String ap_name = "ViVi-N-" + String(ESP.getChipId(), HEX);
-#endif
-  WiFi.mode(WIFI_AP);
-  WiFi.softAP(ap_name.c_str(), wifi_psd);
-
-  IPAddress my_ip = WiFi.softAPIP();
-  outputSerial().print("start AP! SSID:");
-  outputSerial().print(ap_name);
-  outputSerial().print("PSWD:");
-  outputSerial().println(wifi_psd);
-}
-// 启用sta模式
-PLEN2::System::System() {
-  PLEN2_SYSTEM_SERIAL.begin(SERIAL_BAUDRATE());
-  //	WiFi.mode(WIFI_STA);
-}
-
-// 配置wiif信息和存储
-void PLEN2::System::setup_smartconfig() {
-  WiFi.mode(WIFI_STA);
-  WiFi.begin("your_ssid", "your_password");
-
-  unsigned char cnt = 0;
-  while (WiFi.status() != WL_CONNECTED && cnt < 20) {
-    delay(500);
-    outputSerial().print(".");
-    cnt++;
-  }
-
-  smartconfig_tricker.attach_ms(1024, PLEN2::System::smart_config);
-}
-
-// format bytes换算
-String formatBytes(size_t bytes) {
-  if (bytes < 1024) {
-    return String(bytes) + "B";
-  } else if (bytes < (1024 * 1024)) {
-    return String(bytes / 1024.0) + "KB";
-  } else if (bytes < (1024 * 1024 * 1024)) {
-    return String(bytes / 1024.0 / 1024.0) + "MB";
-  } else {
-    return String(bytes / 1024.0 / 1024.0 / 1024.0) + "GB";
-  }
-}
-
-String getContentType(String filename) {
-  if (httpServer.hasArg("download"))
-    return "application/octet-stream";
-  else if (filename.endsWith(".htm"))
-    return "text/html";
-  else if (filename.endsWith(".html"))
-    return "text/html";
-  else if (filename.endsWith(".css"))
-    return "text/css";
-  else if (filename.endsWith(".js"))
-    return "application/javascript";
-  else if (filename.endsWith(".png"))
-    return "image/png";
-  else if (filename.endsWith(".gif"))
-    return "image/gif";
-  else if (filename.endsWith(".jpg"))
-    return "image/jpeg";
-  else if (filename.endsWith(".ico"))
-    return "image/x-icon";
-  else if (filename.endsWith(".xml"))
-    return "text/xml";
-  else if (filename.endsWith(".pdf"))
-    return "application/x-pdf";
-  else if (filename.endsWith(".zip"))
-    return "application/x-zip";
-  else if (filename.endsWith(".gz"))
-    return "application/x-gzip";
-  return "text/plain";
-}
-
-bool handleFileRead(String path) {
-  PLEN2_SYSTEM_SERIAL.println("handleFileRead: " + path);
-  if (path.endsWith("/"))
-    path += "index.htm";
-  String contentType = getContentType(path);
-  String pathWithGz = path + ".gz";
-  if (SPIFFS.exists(pathWithGz) || SPIFFS.exists(path)) {
-    if (SPIFFS.exists(pathWithGz))
-      path += ".gz";
-    File file = SPIFFS.open(path, "r");
-    size_t sent = httpServer.streamFile(file, contentType);
-    file.close();
-    return true;
-  }
-  return false;
-}
-
-void handleFileUpload() {
-  if (httpServer.uri() != "/edit")
-    return;
-  HTTPUpload &upload = httpServer.upload();
-  if (upload.status == UPLOAD_FILE_START) {
-    String filename = upload.filename;
-    if (!filename.startsWith("/"))
-      filename = "/" + filename;
-    PLEN2_SYSTEM_SERIAL.print("handleFileUpload Name: ");
-    PLEN2_SYSTEM_SERIAL.println(filename);
-    fsUploadFile = SPIFFS.open(filename, "w");
-    filename = String();
-  } else if (upload.status == UPLOAD_FILE_WRITE) {
-    // PLEN2_SYSTEM_SERIAL.print("handleFileUpload Data: ");
-    // PLEN2_SYSTEM_SERIAL.println(upload.currentSize);
-    if (fsUploadFile)
-      fsUploadFile.write(upload.buf, upload.currentSize);
-  } else if (upload.status == UPLOAD_FILE_END) {
-    if (fsUploadFile)
-      fsUploadFile.close();
-    PLEN2_SYSTEM_SERIAL.print("handleFileUpload Size: ");
-    PLEN2_SYSTEM_SERIAL.println(upload.totalSize);
-  }
-}
-
-void handleFileDelete() {
-  if (httpServer.args() == 0)
-    return httpServer.send(500, "text/plain", "BAD ARGS");
-  String path = httpServer.arg(0);
-  PLEN2_SYSTEM_SERIAL.println("handleFileDelete: " + path);
-  if (path == "/")
-    return httpServer.send(500, "text/plain", "BAD PATH");
-  if (!SPIFFS.exists(path))
-    return httpServer.send(404, "text/plain", "FileNotFound");
-  SPIFFS.remove(path);
-  httpServer.send(200, "text/plain", "");
-  path = String();
-}
-
-void handleFileCreate() {
-  if (httpServer.args() == 0)
-    return httpServer.send(500, "text/plain", "BAD ARGS");
-  String path = httpServer.arg(0);
-  PLEN2_SYSTEM_SERIAL.println("handleFileCreate: " + path);
-  if (path == "/")
-    return httpServer.send(500, "text/plain", "BAD PATH");
-  if (SPIFFS.exists(path))
-    return httpServer.send(500, "text/plain", "FILE EXISTS");
-  File file = SPIFFS.open(path, "w");
-  if (file)
-    file.close();
-  else
-    return httpServer.send(500, "text/plain", "CREATE FAILED");
-  httpServer.send(200, "text/plain", "");
-  path = String();
-}
-
-void handleFileList() {
-  if (!httpServer.hasArg("dir")) {
-    httpServer.send(500, "text/plain", "BAD ARGS");
-    return;
-  }
-
-  String path = httpServer.arg("dir");
-  PLEN2_SYSTEM_SERIAL.println("handleFileList: " + path);
-  Dir dir = SPIFFS.openDir(path);
-  path = String();
-
-  String output = "[";
-  while (dir.next()) {
-    File entry = dir.openFile("r");
-    if (output != "[")
-      output += ',';
-    bool isDir = false;
-    output += "{\"type\":\"";
-    output += (isDir) ? "dir" : "file";
-    output += "\",\"name\":\"";
-    output += String(entry.name()).substring(1);
-    output += "\"}";
-    entry.close();
-  }
-
-  output += "]";
-  httpServer.send(200, "text/json", output);
-}
-
-void PLEN2::System::smart_config() {
-  static int cnt = 0;
-  static int timeout = 30;
-
-  if (!update_cfg &&
-      ((WiFi.status() == WL_CONNECTED) || WiFi.softAPgetStationNum())) {
-    if (!servers_started) {
-      // list directory
-      httpServer.on("/list", HTTP_GET, handleFileList);
-      // load editor
-      httpServer.on("/edit", HTTP_GET, []() {
-        if (!handleFileRead("/edit.htm"))
-          httpServer.send(404, "text/plain", "FileNotFound");
-      });
-      // create file
-      httpServer.on("/edit", HTTP_PUT, handleFileCreate);
-      // delete file
-      httpServer.on("/edit", HTTP_DELETE, handleFileDelete);
-      // first callback is called after the request has ended with all parsed
-      // arguments second callback handles file uploads at that location
-      httpServer.on(
-          "/edit", HTTP_POST, []() { httpServer.send(200, "text/plain", ""); },
-          handleFileUpload);
-
-      // called when the url is not defined here
-      // use it to load content from SPIFFS
-      httpServer.onNotFound([]() {
-        if (!handleFileRead(httpServer.uri()))
-          httpServer.send(404, "text/plain", "FileNotFound");
-      });
-
-      // get heap status, analog input value and all GPIO statuses in one json
-      // call
-      httpServer.on("/all", HTTP_GET, []() {
-        String json = "{";
-        json += "\"heap\":" + String(ESP.getFreeHeap());
-        json += ", \"analog\":" + String(analogRead(A0));
-        json += ", \"gpio\":" + String((uint32_t)(((GPI | GPO) & 0xFFFF) |
-                                                  ((GP16I & 0x01) << 16)));
-        json += "}";
-        httpServer.send(200, "text/json", json);
-        json = String();
-        json += "}";
-        httpServer.send(200, "text/json", json);
-        json = String();
-      });
-
-      // API: List Joints
-      httpServer.on("/api/joints", HTTP_GET, []() {
-        String json = "[";
-        for (int i = 0; i < PLEN2::JointController::SUM; i++) {
-          if (i > 0)
-            json += ",";
-          json += "{\"id\":" + String(i);
-          json += ",\"min\":" + String(joint_ctrl.getMinAngle(i));
-          json += ",\"max\":" + String(joint_ctrl.getMaxAngle(i));
-          json += ",\"home\":" + String(joint_ctrl.getHomeAngle(i));
-          json += "}";
-        }
-        json += "]";
-        httpServer.send(200, "text/json", json);
-      });
-
-      // API: Set Joint Home (Calibration)
-      httpServer.on("/api/set_home", HTTP_POST, []() {
-        if (!httpServer.hasArg("id") || !httpServer.hasArg("value")) {
-          httpServer.send(400, "text/plain", "Missing id or value");
-          return;
-        }
-        int id = httpServer.arg("id").toInt();
-        int val = httpServer.arg("value").toInt();
-        if (joint_ctrl.setHomeAngle(id, val)) {
-          httpServer.send(200, "text/plain", "OK");
-        } else {
-          httpServer.send(500, "text/plain", "Failed");
-        }
-      });
-
-      // API: Move Joint (Check position)
-      httpServer.on("/api/move_joint", HTTP_POST, []() {
-        if (!httpServer.hasArg("id") || !httpServer.hasArg("value")) {
-          httpServer.send(400, "text/plain", "Missing id or value");
-          return;
-        }
-        int id = httpServer.arg("id").toInt();
-        int val = httpServer.arg("value").toInt();
-        // To move reliably, we might need to use setAngleDiff or just setAngle.
-        // setAngle takes raw angle. For calibration context, user might want to
-        // set 'Home' then see result. Or set angle to see result, then set
-        // Home. Here we simply expose setAngle.
-        if (joint_ctrl.setAngle(id, val)) {
-          joint_ctrl.updateAngle(); // Force update if needed, though loop
-                                    // handles PWM.
-          httpServer.send(200, "text/plain", "OK");
-        } else {
-          httpServer.send(500, "text/plain", "Failed");
-        }
-      });
-
-      // API: Play Motion
-      httpServer.on("/api/play_motion", HTTP_POST, []() {
-        if (!httpServer.hasArg("slot")) {
-          httpServer.send(400, "text/plain", "Missing slot");
-          return;
-        }
-        int slot = httpServer.arg("slot").toInt();
-        motion_ctrl.play(slot);
-        httpServer.send(200, "text/plain", "OK");
-      });
-
-      // API: Set Motion Speed
-      httpServer.on("/api/set_speed", HTTP_POST, []() {
-        if (!httpServer.hasArg("value")) {
-          httpServer.send(400, "text/plain", "Missing value");
-          return;
-        }
-        int val = httpServer.arg("value").toInt(); // 50, 100, 200
-        motion_ctrl.setSpeed(val);
-        httpServer.send(200, "text/plain", "OK");
-      });
-
-      httpUpdater.setup(&httpServer);
-      httpServer.begin();
-      servers_started = true;
-      outputSerial().println("HTTPUpdateServer ready! Open "
-                             "http://192.168.4.1/update in your browser\n");
-      tcp_server.begin();
-      tcp_server.setNoDelay(true);
-    }
-    udp.beginPacketMulticast(broadcastIp, BROADCAST_PORT, WiFi.localIP());
-    udp.write(robot_name.c_str(), robot_name.length());
-    udp.endPacket();
-  }
-
-  if (update_cfg && WiFi.smartConfigDone()) {
-    outputSerial().println("smartConfigDone!\n");
-    outputSerial().printf("SSID:%s\r\n", WiFi.SSID().c_str());
-    outputSerial().printf("PSW:%s\r\n", WiFi.psk().c_str());
-
-    if (fp_syscfg) {
-      fp_syscfg.close();
-      fp_syscfg = SPIFFS.open(SYSCFG_FILE, "w");
-      fp_syscfg.println(WiFi.SSID().c_str());
-      fp_syscfg.println(WiFi.psk().c_str());
-      fp_syscfg.close();
-      fp_syscfg = SPIFFS.open(SYSCFG_FILE, "r");
-    }
-    update_cfg = false;
-  }
-  if (update_cfg) {
-    WiFi.stopSmartConfig();
-    StartAp();
-    update_cfg = false;
-  }
-}
-
-void PLEN2::System::handleClient() {
-  if (servers_started) {
-    httpServer.handleClient();
-  }
-}
-
-bool PLEN2::System::tcp_available() {
-  if (tcp_server.hasClient()) {
-    serverClient = tcp_server.available();
-    if (!serverClient || !serverClient.connected()) {
-      if (serverClient) {
-        serverClient.stop();
-      }
-      serverClient = tcp_server.available();
-    }
-  }
-  if (serverClient && serverClient.connected()) {
-    return serverClient.available();
-  }
-  return false;
-}
-
-bool PLEN2::System::tcp_connected() {
-  return serverClient && serverClient.connected();
-}
-
-char PLEN2::System::tcp_read() { return serverClient.read(); }
-
-Stream &PLEN2::System::SystemSerial() { return PLEN2_SYSTEM_SERIAL; }
-
-Stream &PLEN2::System::inputSerial() { return PLEN2_SYSTEM_SERIAL; }
-
-Stream &PLEN2::System::outputSerial() { return PLEN2_SYSTEM_SERIAL; }
-
-Stream &PLEN2::System::debugSerial() { return PLEN2_SYSTEM_SERIAL; }
-
-void PLEN2::System::dump() {
-#if DEBUG
-  volatile Utility::Profiler p(F("System::dump()"));
-#endif
-
-  outputSerial().println(F("{"));
-
-  outputSerial().print(F("\t\"device\": \""));
-  outputSerial().print(DEVICE_NAME);
-  outputSerial().println(F("\","));
-
-  outputSerial().print(F("\t\"codename\": \""));
-  outputSerial().print(CODE_NAME);
-  outputSerial().println(F("\","));
-
-  outputSerial().print(F("\t\"version\": \""));
-  outputSerial().print(VERSION);
-  outputSerial().println(F("\""));
-
-  outputSerial().println(F("}"));
-}
+/*
+        Copyright (c) 2015,
+        - Kazuyuki TAKASE - https://github.com/Guvalif
+        - PLEN Project Company Inc. - https://plen.jp
+
+        This software is released under the MIT License.
+        (See also : http://opensource.org/licenses/mit-license.php)
+*/
+#include "System.h"
+#include "Arduino.h"
+#include "ExternalFs.h"
+#include "FlashPartition.h"
+#include "JointController.h"
+#include "MotionBake.h"
+#include "MotionCache.h"
+#include "MotionController.h"
+#include "MotionStore.h"
+#include "Parser.h"
+#include "Pin.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "TrajectoryStream.h"
+#include <ESP8266HTTPUpdateServer.h>
+#include <ESP8266WebServer.h>
+#include <ESP8266WiFi.h>
+#include <ESP8266mDNS.h>
+#include <Ticker.h>
+#include <WiFiClient.h>
+#include <WiFiUDP.h>
+
+
+extern PLEN2::JointController joint_ctrl;
+extern PLEN2::MotionController motion_ctrl;
+extern PLEN2::TrajectoryStream trajectory_stream;
+
+#define PLEN2_SYSTEM_SERIAL Serial
+
+#define CONNECT_TIMEOUT_CNT 100
+
+IPAddress broadcastIp(255, 255, 255, 255);
+#define BROADCAST_PORT 6000
+WiFiUDP udp;
+
+ESP8266WebServer httpServer(80);
+ESP8266HTTPUpdateServer httpUpdater;
+static bool servers_started = false;
+
+WiFiServer tcp_server(23);
+WiFiClient serverClient;
+Ticker smartconfig_tricker;
+
+String robot_name = "ViVi-" + String(ESP.getChipId(), HEX);
+const char *wifi_psd = "12345678xyz";
+
+volatile bool update_cfg;
+
+extern File fp_config;
+extern File fp_syscfg;
+File fsUploadFile;
+// 启动ao模式
+void PLEN2::System::StartAp() {
+#if CLOCK_WISE
+  String ap_name = "ViVi-M-" + String(ESP.getChipId(), HEX);
+#else
+  String ap_name = "ViVi-N-" + String(ESP.getChipId(), HEX);
+#endif
+  WiFi.mode(WIFI_AP);
+  WiFi.softAP(ap_name.c_str(), wifi_psd);
+
+  IPAddress my_ip = WiFi.softAPIP();
+  outputSerial().print("start AP! SSID:");
+  outputSerial().print(ap_name);
+  outputSerial().print("PSWD:");
+  outputSerial().println(wifi_psd);
+}
+// 启用sta模式
+PLEN2::System::System() {
+  PLEN2_SYSTEM_SERIAL.begin(SERIAL_BAUDRATE());
+  //	WiFi.mode(WIFI_STA);
+}
+
+// 配置wiif信息和存储
+void PLEN2::System::setup_smartconfig() {
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("your_ssid", "your_password");
+
+  unsigned char cnt = 0;
+  while (WiFi.status() != WL_CONNECTED && cnt < 20) {
+    delay(500);
+    outputSerial().print(".");
+    cnt++;
+  }
+
+  smartconfig_tricker.attach_ms(1024, PLEN2::System::smart_config);
+}
+
+// format bytes换算
+String formatBytes(size_t bytes) {
+  if (bytes < 1024) {
+    return String(bytes) + "B";
+  } else if (bytes < (1024 * 1024)) {
+    return String(bytes / 1024.0) + "KB";
+  } else if (bytes < (1024 * 1024 * 1024)) {
+    return String(bytes / 1024.0 / 1024.0) + "MB";
+  } else {
+    return String(bytes / 1024.0 / 1024.0 / 1024.0) + "GB";
+  }
+}
+
+String getContentType(String filename) {
+  if (httpServer.hasArg("download"))
+    return "application/octet-stream";
+  else if (filename.endsWith(".htm"))
+    return "text/html";
+  else if (filename.endsWith(".html"))
+    return "text/html";
+  else if (filename.endsWith(".css"))
+    return "text/css";
+  else if (filename.endsWith(".js"))
+    return "application/javascript";
+  else if (filename.endsWith(".png"))
+    return "image/png";
+  else if (filename.endsWith(".gif"))
+    return "image/gif";
+  else if (filename.endsWith(".jpg"))
+    return "image/jpeg";
+  else if (filename.endsWith(".ico"))
+    return "image/x-icon";
+  else if (filename.endsWith(".xml"))
+    return "text/xml";
+  else if (filename.endsWith(".pdf"))
+    return "application/x-pdf";
+  else if (filename.endsWith(".zip"))
+    return "application/x-zip";
+  else if (filename.endsWith(".gz"))
+    return "application/x-gzip";
+  return "text/plain";
+}
+
+bool handleFileRead(String path) {
+  PLEN2_SYSTEM_SERIAL.println("handleFileRead: " + path);
+  if (path.endsWith("/"))
+    path += "index.htm";
+  String contentType = getContentType(path);
+  String pathWithGz = path + ".gz";
+  if (SPIFFS.exists(pathWithGz) || SPIFFS.exists(path)) {
+    if (SPIFFS.exists(pathWithGz))
+      path += ".gz";
+    File file = SPIFFS.open(path, "r");
+    size_t sent = httpServer.streamFile(file, contentType);
+    file.close();
+    return true;
+  }
+  return false;
+}
+
+void handleFileUpload() {
+  if (httpServer.uri() != "/edit")
+    return;
+  HTTPUpload &upload = httpServer.upload();
+  if (upload.status == UPLOAD_FILE_START) {
+    String filename = upload.filename;
+    if (!filename.startsWith("/"))
+      filename = "/" + filename;
+    PLEN2_SYSTEM_SERIAL.print("handleFileUpload Name: ");
+    PLEN2_SYSTEM_SERIAL.println(filename);
+    fsUploadFile = SPIFFS.open(filename, "w");
+    filename = String();
+  } else if (upload.status == UPLOAD_FILE_WRITE) {
+    // PLEN2_SYSTEM_SERIAL.print("handleFileUpload Data: ");
+    // PLEN2_SYSTEM_SERIAL.println(upload.currentSize);
+    if (fsUploadFile)
+      fsUploadFile.write(upload.buf, upload.currentSize);
+  } else if (upload.status == UPLOAD_FILE_END) {
+    if (fsUploadFile)
+      fsUploadFile.close();
+    PLEN2_SYSTEM_SERIAL.print("handleFileUpload Size: ");
+    PLEN2_SYSTEM_SERIAL.println(upload.totalSize);
+  }
+}
+
+void handleFileDelete() {
+  if (httpServer.args() == 0)
+    return httpServer.send(500, "text/plain", "BAD ARGS");
+  String path = httpServer.arg(0);
+  PLEN2_SYSTEM_SERIAL.println("handleFileDelete: " + path);
+  if (path == "/")
+    return httpServer.send(500, "text/plain", "BAD PATH");
+  if (!SPIFFS.exists(path))
+    return httpServer.send(404, "text/plain", "FileNotFound");
+  SPIFFS.remove(path);
+  httpServer.send(200, "text/plain", "");
+  path = String();
+}
+
+void handleFileCreate() {
+  if (httpServer.args() == 0)
+    return httpServer.send(500, "text/plain", "BAD ARGS");
+  String path = httpServer.arg(0);
+  PLEN2_SYSTEM_SERIAL.println("handleFileCreate: " + path);
+  if (path == "/")
+    return httpServer.send(500, "text/plain", "BAD PATH");
+  if (SPIFFS.exists(path))
+    return httpServer.send(500, "text/plain", "FILE EXISTS");
+  File file = SPIFFS.open(path, "w");
+  if (file)
+    file.close();
+  else
+    return httpServer.send(500, "text/plain", "CREATE FAILED");
+  httpServer.send(200, "text/plain", "");
+  path = String();
+}
+
+void handleFileList() {
+  if (!httpServer.hasArg("dir")) {
+    httpServer.send(500, "text/plain", "BAD ARGS");
+    return;
+  }
+
+  String path = httpServer.arg("dir");
+  PLEN2_SYSTEM_SERIAL.println("handleFileList: " + path);
+  Dir dir = SPIFFS.openDir(path);
+  path = String();
+
+  String output = "[";
+  while (dir.next()) {
+    File entry = dir.openFile("r");
+    if (output != "[")
+      output += ',';
+    bool isDir = false;
+    output += "{\"type\":\"";
+    output += (isDir) ? "dir" : "file";
+    output += "\",\"name\":\"";
+    output += String(entry.name()).substring(1);
+    output += "\"}";
+    entry.close();
+  }
+
+  output += "]";
+  httpServer.send(200, "text/json", output);
+}
+
+String timingStatisticsJson(const Utility::TimingStatistics &stats) {
+  String json = "{";
+  json += "\"count\":" + String(stats.count());
+  json += ",\"min\":" + String(stats.count() ? stats.min() : 0);
+  json += ",\"mean\":" + String(stats.mean());
+  json += ",\"p99\":" + String(stats.percentile(99));
+  json += ",\"max\":" + String(stats.max());
+  json += "}";
+  return json;
+}
+
+#if DEBUG_TRACE
+// Sends printed text to the HTTP client by chunks.
+class HttpChunkPrint : public Print {
+public:
+  size_t write(uint8_t c) override {
+    m_chunk += static_cast<char>(c);
+    if (m_chunk.length() >= 1024) {
+      sendChunk();
+    }
+    return 1;
+  }
+
+  void sendChunk() {
+    if (m_chunk.length() > 0) {
+      httpServer.sendContent(m_chunk);
+      m_chunk = String();
+    }
+  }
+
+private:
+  String m_chunk;
+};
+
+// Drains the trace events as Chrome's trace event format.
+void handleTrace() {
+  HttpChunkPrint output;
+
+  // Sending yields to the ticker, so recording is stopped while draining.
+  Utility::Trace::enable(false);
+  httpServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  httpServer.send(200, "text/json", "");
+  Utility::Trace::dump(output);
+  output.sendChunk();
+  httpServer.sendContent("");
+  Utility::Trace::clear();
+  Utility::Trace::enable(true);
+}
+#endif
+
+void PLEN2::System::smart_config() {
+  static int cnt = 0;
+  static int timeout = 30;
+
+  if (!update_cfg &&
+      ((WiFi.status() == WL_CONNECTED) || WiFi.softAPgetStationNum())) {
+    if (!servers_started) {
+      // list directory
+      httpServer.on("/list", HTTP_GET, handleFileList);
+      // load editor
+      httpServer.on("/edit", HTTP_GET, []() {
+        if (!handleFileRead("/edit.htm"))
+          httpServer.send(404, "text/plain", "FileNotFound");
+      });
+      // create file
+      httpServer.on("/edit", HTTP_PUT, handleFileCreate);
+      // delete file
+      httpServer.on("/edit", HTTP_DELETE, handleFileDelete);
+      // first callback is called after the request has ended with all parsed
+      // arguments second callback handles file uploads at that location
+      httpServer.on(
+          "/edit", HTTP_POST, []() { httpServer.send(200, "text/plain", ""); },
+          handleFileUpload);
+
+      // called when the url is not defined here
+      // use it to load content from SPIFFS
+      httpServer.onNotFound([]() {
+        if (!handleFileRead(httpServer.uri()))
+          httpServer.send(404, "text/plain", "FileNotFound");
+      });
+
+      // get heap status, analog input value and all GPIO statuses in one json
+      // call
+      httpServer.on("/all", HTTP_GET, []() {
+        String json = "{";
+        json += "\"heap\":" + String(ESP.getFreeHeap());
+        json += ", \"analog\":" + String(analogRead(A0));
+        json += ", \"gpio\":" + String((uint32_t)(((GPI | GPO) & 0xFFFF) |
+                                                  ((GP16I & 0x01) << 16)));
+        json += ", \"servo_writes_issued\":" +
+                String(PLEN2::JointController::writesIssued());
+        json += ", \"servo_writes_skipped\":" +
+                String(PLEN2::JointController::writesSkipped());
+        json += ", \"active_joints\":" +
+                String(PLEN2::JointController::activeJointSum());
+        json += ", \"config_writes\":" + String(joint_ctrl.configWrites());
+        json += "}";
+        httpServer.send(200, "text/json", json);
+        json = String();
+        json += "}";
+        httpServer.send(200, "text/json", json);
+        json = String();
+      });
+
+      // API: List Joints
+      httpServer.on("/api/joints", HTTP_GET, []() {
+        String json = "[";
+        for (int i = 0; i < PLEN2::JointController::SUM; i++) {
+          if (i > 0)
+            json += ",";
+          json += "{\"id\":" + String(i);
+          json += ",\"min\":" + String(joint_ctrl.getMinAngle(i));
+          json += ",\"max\":" + String(joint_ctrl.getMaxAngle(i));
+          json += ",\"home\":" + String(joint_ctrl.getHomeAngle(i));
+          json += ",\"speed\":" + String(joint_ctrl.getSpeedLimit(i));
+          json += ",\"accel\":" + String(joint_ctrl.getAccelLimit(i));
+          const PLEN2::JointController::ChannelSetting &channel =
+              joint_ctrl.getChannel(i);
+          json += ",\"kind\":" + String(channel.KIND);
+          json += ",\"channel\":" + String(channel.CHANNEL);
+          json += ",\"direction\":" + String(channel.DIRECTION);
+          json += ",\"pwm_min\":" + String(channel.PWM_MIN);
+          json += ",\"pwm_max\":" + String(channel.PWM_MAX);
+          json += "}";
+        }
+        json += "]";
+        httpServer.send(200, "text/json", json);
+      });
+
+      // API: Set Joint Home (Calibration)
+      httpServer.on("/api/set_home", HTTP_POST, []() {
+        if (!httpServer.hasArg("id") || !httpServer.hasArg("value")) {
+          httpServer.send(400, "text/plain", "Missing id or value");
+          return;
+        }
+        int id = httpServer.arg("id").toInt();
+        int val = httpServer.arg("value").toInt();
+        if (joint_ctrl.setHomeAngle(id, val)) {
+          httpServer.send(200, "text/plain", "OK");
+        } else {
+          httpServer.send(500, "text/plain", "Failed");
+        }
+      });
+
+      // API: Set Joint Slew Limits (0 = unlimited)
+      httpServer.on("/api/set_slew", HTTP_POST, []() {
+        if (!httpServer.hasArg("id") ||
+            (!httpServer.hasArg("speed") && !httpServer.hasArg("accel"))) {
+          httpServer.send(400, "text/plain", "Missing id, speed or accel");
+          return;
+        }
+        int id = httpServer.arg("id").toInt();
+        bool result = true;
+        if (httpServer.hasArg("speed"))
+          result &= joint_ctrl.setSpeedLimit(id, httpServer.arg("speed").toInt());
+        if (httpServer.hasArg("accel"))
+          result &= joint_ctrl.setAccelLimit(id, httpServer.arg("accel").toInt());
+        if (result) {
+          httpServer.send(200, "text/plain", "OK");
+        } else {
+          httpServer.send(500, "text/plain", "Failed");
+        }
+      });
+
+      // API: Commit Joint Settings (They are committed 2 sec after the last
+      // change without it.)
+      httpServer.on("/api/commit_settings", HTTP_POST, []() {
+        joint_ctrl.commitSettings();
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Move Joint (Check position)
+      httpServer.on("/api/move_joint", HTTP_POST, []() {
+        if (!httpServer.hasArg("id") || !httpServer.hasArg("value")) {
+          httpServer.send(400, "text/plain", "Missing id or value");
+          return;
+        }
+        int id = httpServer.arg("id").toInt();
+        int val = httpServer.arg("value").toInt();
+        // To move reliably, we might need to use setAngleDiff or just setAngle.
+        // setAngle takes raw angle. For calibration context, user might want to
+        // set 'Home' then see result. Or set angle to see result, then set
+        // Home. Here we simply expose setAngle.
+        if (joint_ctrl.setAngle(id, val)) {
+          joint_ctrl.publish(); // The output ticker sends it at next tick.
+          httpServer.send(200, "text/plain", "OK");
+        } else {
+          httpServer.send(500, "text/plain", "Failed");
+        }
+      });
+
+      // API: Set Joint Output (kind: 0 = none, 1 = PCA9685, 2 = GPIO servo)
+      httpServer.on("/api/set_channel", HTTP_POST, []() {
+        if (!httpServer.hasArg("id") || !httpServer.hasArg("kind")) {
+          httpServer.send(400, "text/plain", "Missing id or kind");
+          return;
+        }
+        int id = httpServer.arg("id").toInt();
+        // Omitted arguments keep the current setting.
+        PLEN2::JointController::ChannelSetting channel =
+            joint_ctrl.getChannel(id);
+        channel.KIND = httpServer.arg("kind").toInt();
+        if (httpServer.hasArg("channel"))
+          channel.CHANNEL = httpServer.arg("channel").toInt();
+        if (httpServer.hasArg("direction"))
+          channel.DIRECTION = (httpServer.arg("direction").toInt() < 0) ? -1 : 1;
+        if (httpServer.hasArg("pwm_min"))
+          channel.PWM_MIN = httpServer.arg("pwm_min").toInt();
+        if (httpServer.hasArg("pwm_max"))
+          channel.PWM_MAX = httpServer.arg("pwm_max").toInt();
+        if (joint_ctrl.setChannel(id, channel)) {
+          httpServer.send(200, "text/plain", "OK");
+        } else {
+          httpServer.send(500, "text/plain", "Failed");
+        }
+      });
+
+      // API: Reset Joint Outputs
+      httpServer.on("/api/reset_channels", HTTP_POST, []() {
+        joint_ctrl.resetChannels();
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Move All Joints to Home
+      httpServer.on("/api/home", HTTP_POST, []() {
+        joint_ctrl.applyHomePose();
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Relax All Servos (until the next pose)
+      httpServer.on("/api/relax", HTTP_POST, []() {
+        PLEN2::JointController::relaxAll();
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Play Motion
+      httpServer.on("/api/play_motion", HTTP_POST, []() {
+        if (!httpServer.hasArg("slot")) {
+          httpServer.send(400, "text/plain", "Missing slot");
+          return;
+        }
+        int slot = httpServer.arg("slot").toInt();
+        motion_ctrl.play(slot);
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Set Motion Speed
+      httpServer.on("/api/set_speed", HTTP_POST, []() {
+        if (!httpServer.hasArg("value")) {
+          httpServer.send(400, "text/plain", "Missing value");
+          return;
+        }
+        // Percentage like 50, 100 or 12.5. Negative plays backward.
+        float val = httpServer.arg("value").toFloat();
+        if ((val < -1000.0f) || (val > 1000.0f)) {
+          httpServer.send(400, "text/plain", "Invalid value");
+          return;
+        }
+        if (httpServer.hasArg("ramp")) {
+          int ramp = httpServer.arg("ramp").toInt(); // msec, 0 is at once
+          if (ramp < 0) {
+            httpServer.send(400, "text/plain", "Invalid ramp");
+            return;
+          }
+          motion_ctrl.setSpeedRamp(ramp);
+        }
+        motion_ctrl.setSpeedRate(
+            static_cast<long>(val * PLEN2::MotionTrack::RATE_ONE() / 100.0f));
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Servo Output Timing (usec)
+      httpServer.on("/api/servo_timing", HTTP_GET, []() {
+        Utility::TimingStatistics intervals;
+        Utility::TimingStatistics durations;
+
+        // Copy them at once, because the output ticker updates them.
+        noInterrupts();
+        intervals = PLEN2::JointController::outputIntervals();
+        durations = PLEN2::JointController::outputDurations();
+        interrupts();
+
+        String json = "{";
+        json += "\"rate_hz\":" + String(PLEN2::JointController::outputRate());
+        json += ",\"interval_us\":" + timingStatisticsJson(intervals);
+        json += ",\"update_us\":" + timingStatisticsJson(durations);
+        json += "}";
+        httpServer.send(200, "text/json", json);
+      });
+
+      // API: Set Servo Output Rate
+      httpServer.on("/api/set_output_rate", HTTP_POST, []() {
+        if (!httpServer.hasArg("value")) {
+          httpServer.send(400, "text/plain", "Missing value");
+          return;
+        }
+        int val = httpServer.arg("value").toInt(); // 50, 100, 200
+        if (PLEN2::JointController::setOutputRate(val)) {
+          httpServer.send(200, "text/plain", "OK");
+        } else {
+          httpServer.send(500, "text/plain", "Failed");
+        }
+      });
+
+      // API: Motion Frame Boundary Timing
+      httpServer.on("/api/motion_timing", HTTP_GET, []() {
+        String json = "{";
+        json += "\"prefetch\":";
+        json += (motion_ctrl.prefetchEnabled()) ? "true" : "false";
+        json += ",\"boundary_us\":" +
+                timingStatisticsJson(motion_ctrl.boundaryDurations());
+        json += ",\"boundary_stalls\":" + String(motion_ctrl.boundaryStalls());
+        json += "}";
+        httpServer.send(200, "text/json", json);
+      });
+
+      // API: Motion Cache Statistics
+      httpServer.on("/api/motion_cache", HTTP_GET, []() {
+        String json = "{";
+        json += "\"hits\":" + String(PLEN2::MotionCache::hits());
+        json += ",\"misses\":" + String(PLEN2::MotionCache::misses());
+        json += ",\"evictions\":" + String(PLEN2::MotionCache::evictions());
+        json += ",\"frames\":" + String(PLEN2::MotionCache::frameCount());
+        json += ",\"frame_capacity\":" +
+                String(PLEN2::MotionCache::FRAME_SUM);
+        json += ",\"pinned\":[";
+        bool first = true;
+        for (int slot = 0; slot < PLEN2::Motion::SLOT_END; slot++) {
+          if (!PLEN2::MotionCache::pinned(slot))
+            continue;
+          if (!first)
+            json += ",";
+          json += String(slot);
+          first = false;
+        }
+        json += "]}";
+        httpServer.send(200, "text/json", json);
+      });
+
+      // API: Pin/Unpin a Motion in the Cache
+      httpServer.on("/api/pin_motion", HTTP_POST, []() {
+        if (!httpServer.hasArg("slot") || !httpServer.hasArg("value")) {
+          httpServer.send(400, "text/plain", "Missing slot or value");
+          return;
+        }
+        int slot = httpServer.arg("slot").toInt();
+        bool pinned = (httpServer.arg("value").toInt() != 0);
+        if ((slot >= 0) && PLEN2::MotionCache::pin(slot, pinned)) {
+          httpServer.send(200, "text/plain", "OK");
+        } else {
+          httpServer.send(400, "text/plain", "Invalid slot");
+        }
+      });
+
+      // API: Reset Motion Cache Counters
+      httpServer.on("/api/reset_motion_cache", HTTP_POST, []() {
+        PLEN2::MotionCache::resetCounters();
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Set Crossfade Time between Queued Motions
+      httpServer.on("/api/set_blend", HTTP_POST, []() {
+        if (!httpServer.hasArg("value")) {
+          httpServer.send(400, "text/plain", "Missing value");
+          return;
+        }
+        int val = httpServer.arg("value").toInt(); // msec, 0 disables it
+        if (val < 0) {
+          httpServer.send(400, "text/plain", "Invalid value");
+          return;
+        }
+        motion_ctrl.setBlendTime(val);
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Play a Motion on a Layer over the Body Motion
+      httpServer.on("/api/play_layer", HTTP_POST, []() {
+        if (!httpServer.hasArg("layer") || !httpServer.hasArg("slot") ||
+            !httpServer.hasArg("mask")) {
+          httpServer.send(400, "text/plain", "Missing layer, slot or mask");
+          return;
+        }
+        int layer = httpServer.arg("layer").toInt();
+        int slot = httpServer.arg("slot").toInt();
+        // Bit N drives joint N. (e.g. "0xF0F0" or "61680")
+        unsigned long mask = strtoul(httpServer.arg("mask").c_str(), NULL, 0);
+        int mode = httpServer.hasArg("mode")
+                       ? static_cast<int>(httpServer.arg("mode").toInt())
+                       : static_cast<int>(
+                             PLEN2::MotionController::LAYER_OVERRIDE);
+        if ((layer >= 0) && (slot >= 0) && (mode >= 0) &&
+            motion_ctrl.playLayer(layer, slot, mask, mode)) {
+          httpServer.send(200, "text/plain", "OK");
+        } else {
+          httpServer.send(400, "text/plain", "Invalid layer, slot or mode");
+        }
+      });
+
+      // API: Stop a Layer
+      httpServer.on("/api/stop_layer", HTTP_POST, []() {
+        if (!httpServer.hasArg("layer")) {
+          httpServer.send(400, "text/plain", "Missing layer");
+          return;
+        }
+        int layer = httpServer.arg("layer").toInt();
+        if ((layer < 0) || (layer >= PLEN2::MotionController::LAYER_SUM)) {
+          httpServer.send(400, "text/plain", "Invalid layer");
+          return;
+        }
+        motion_ctrl.stopLayer(layer);
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Motions Installed, and Storage Used
+      httpServer.on("/api/motion_store", HTTP_GET, []() {
+        String json = "{";
+        json += "\"used\":" + String(PLEN2::MotionStore::used());
+        json += ",\"size_max\":" + String(PLEN2::MotionStore::limit());
+        json += ",\"compactions\":" + String(PLEN2::MotionStore::compactions());
+        json += ",\"partition\":" +
+                String(PLEN2::MotionStore::mapped() ? "true" : "false");
+        json += ",\"erasures\":" + String(PLEN2::FlashPartition::erasures());
+        json += ",\"programs\":" + String(PLEN2::FlashPartition::programs());
+        json += ",\"slots\":[";
+        bool first = true;
+        for (int slot = 0; slot < PLEN2::Motion::SLOT_END; slot++) {
+          if (!PLEN2::MotionStore::installed(slot))
+            continue;
+          if (!first)
+            json += ",";
+          json += "{\"slot\":" + String(slot) + ",\"frames\":" +
+                  String(PLEN2::MotionStore::frameCount(slot)) + "}";
+          first = false;
+        }
+        json += "]}";
+        httpServer.send(200, "text/json", json);
+      });
+
+      // API: Begin to Install a Motion (Motions longer than 255 frames.)
+      // The motion replaces the slot after /api/motion_frames sent its last
+      // frame.
+      httpServer.on("/api/motion_header", HTTP_POST, []() {
+        if (!httpServer.hasArg("slot") || !httpServer.hasArg("frame_length")) {
+          httpServer.send(400, "text/plain", "Missing slot or frame_length");
+          return;
+        }
+        long slot = httpServer.arg("slot").toInt();
+        long frame_length = httpServer.arg("frame_length").toInt();
+        long interpolation = httpServer.arg("interpolation").toInt();
+        if ((slot < 0) || (slot >= PLEN2::Motion::SLOT_END) ||
+            (frame_length < PLEN2::Motion::Header::FRAMELENGTH_MIN) ||
+            (frame_length > PLEN2::Motion::Header::FRAMELENGTH_MAX) ||
+            (interpolation < 0) ||
+            (interpolation >= PLEN2::Motion::Header::INTERPOLATION_SUM)) {
+          httpServer.send(400, "text/plain", "Invalid argument");
+          return;
+        }
+        if (motion_ctrl.playing()) {
+          httpServer.send(409, "text/plain", "Motion playing");
+          return;
+        }
+        PLEN2::Motion::Header header;
+        header.init();
+        header.slot = slot;
+        header.frame_length = frame_length;
+        header.interpolation = interpolation;
+        strncpy(header.name, httpServer.arg("name").c_str(),
+                PLEN2::Motion::Header::NAME_LENGTH - 1);
+        if (httpServer.hasArg("loop_end")) {
+          header.use_loop = 1;
+          header.loop_begin = httpServer.arg("loop_begin").toInt();
+          header.loop_end = httpServer.arg("loop_end").toInt();
+          header.loop_count = httpServer.hasArg("loop_count")
+                                  ? httpServer.arg("loop_count").toInt()
+                                  : 255;
+        } else if (httpServer.hasArg("jump")) {
+          header.use_jump = 1;
+          header.jump_slot = httpServer.arg("jump").toInt();
+        }
+        if (PLEN2::Motion::Installation::begin(header)) {
+          httpServer.send(200, "text/plain", "OK");
+        } else {
+          httpServer.send(500, "text/plain", "Failed");
+        }
+      });
+
+      // API: Write Frames of a Motion from an Index
+      httpServer.on("/api/motion_frames", HTTP_POST, []() {
+        if (!httpServer.hasArg("slot") || !httpServer.hasArg("index") ||
+            !httpServer.hasArg("frames")) {
+          httpServer.send(400, "text/plain", "Missing slot, index or frames");
+          return;
+        }
+        long slot = httpServer.arg("slot").toInt();
+        long index = httpServer.arg("index").toInt();
+        // Frames as ">mf" sends them: transition time and the angles, in hex.
+        const String &frames = httpServer.arg("frames");
+        const unsigned int frame_size = 4 + 4 * PLEN2::JointController::SUM;
+        // Frames of the installation are appended in order, and others edit
+        // the motion installed.
+        const bool installing =
+            (slot == PLEN2::Motion::Installation::slot());
+        PLEN2::Motion::Header header;
+        header.slot = slot;
+        if ((slot < 0) || (slot >= PLEN2::Motion::SLOT_END) || (index < 0) ||
+            ((frames.length() % frame_size) != 0) ||
+            (installing && (index != PLEN2::Motion::Installation::count())) ||
+            (!installing && !header.get()) ||
+            ((index + frames.length() / frame_size) >
+             (installing ? PLEN2::Motion::Installation::length()
+                         : header.frame_length))) {
+          httpServer.send(400, "text/plain", "Invalid argument");
+          return;
+        }
+        if (motion_ctrl.playing()) {
+          httpServer.send(409, "text/plain", "Motion playing");
+          return;
+        }
+        PLEN2::Motion::Frame frame;
+        const char *data = frames.c_str();
+        for (unsigned int offset = 0; offset < frames.length();
+             offset += frame_size) {
+          frame.index = index++;
+          frame.transition_time_ms = Utility::hexbytes2uint(data + offset, 4);
+          for (char joint_id = 0; joint_id < PLEN2::JointController::SUM;
+               joint_id++) {
+            frame.joint_angle[joint_id] = Utility::hexbytes2int(
+                data + offset + 4 + 4 * joint_id, 4);
+          }
+          frame.events = 0;
+          frame.event_code = 0;
+          frame.sensor_id = 0;
+          frame.sensor_condition = 0;
+          frame.sensor_threshold = 0;
+          frame.hold_timeout_ms = 0;
+          if (installing ? !PLEN2::Motion::Installation::append(frame)
+                         : !frame.set(slot)) {
+            httpServer.send(500, "text/plain", "Failed");
+            return;
+          }
+        }
+        if (installing && (PLEN2::Motion::Installation::count() ==
+                           PLEN2::Motion::Installation::length()) &&
+            !PLEN2::Motion::Installation::commit()) {
+          httpServer.send(500, "text/plain", "Failed");
+          return;
+        }
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Baked Motions
+      httpServer.on("/api/baked_motions", HTTP_GET, []() {
+        String json = "{";
+        json += "\"playing\":";
+        json += (motion_ctrl.bakedPlaying()) ? "true" : "false";
+        json += ",\"stalls\":" + String(motion_ctrl.bakeStalls());
+        json += ",\"slots\":[";
+        bool first = true;
+        for (int slot = 0; slot < PLEN2::Motion::SLOT_END; slot++) {
+          if (!PLEN2::MotionBake::baked(slot))
+            continue;
+          if (!first)
+            json += ",";
+          json += String(slot);
+          first = false;
+        }
+        json += "]}";
+        httpServer.send(200, "text/json", json);
+      });
+
+      // API: Bake/Unbake a Motion into Ticks of Joint Outputs
+      httpServer.on("/api/bake_motion", HTTP_POST, []() {
+        if (!httpServer.hasArg("slot") || !httpServer.hasArg("value")) {
+          httpServer.send(400, "text/plain", "Missing slot or value");
+          return;
+        }
+        int slot = httpServer.arg("slot").toInt();
+        bool baked = (httpServer.arg("value").toInt() != 0);
+        if ((slot < 0) || (slot >= PLEN2::Motion::SLOT_END)) {
+          httpServer.send(400, "text/plain", "Invalid slot");
+          return;
+        }
+        if (!baked) {
+          PLEN2::MotionBake::remove(slot);
+          httpServer.send(200, "text/plain", "OK");
+          return;
+        }
+        // Baking reads the whole motion, so it never runs under a motion.
+        if (motion_ctrl.playing()) {
+          httpServer.send(409, "text/plain", "Motion playing");
+          return;
+        }
+        if (PLEN2::MotionBake::bake(slot, joint_ctrl)) {
+          httpServer.send(200, "text/plain", "OK");
+        } else {
+          httpServer.send(500, "text/plain", "Failed");
+        }
+      });
+
+      // API: Events of Frames, and the Frame Held
+      httpServer.on("/api/motion_events", HTTP_GET, []() {
+        String json = "{";
+        json += "\"holding\":";
+        json += (motion_ctrl.holding()) ? "true" : "false";
+        json += ",\"stop_requested\":";
+        json += (motion_ctrl.stopRequested()) ? "true" : "false";
+        json += ",\"dropped\":" + String(motion_ctrl.droppedEvents());
+        json += "}";
+        httpServer.send(200, "text/json", json);
+      });
+
+      // API: Release a Frame Held at a Sync Point
+      httpServer.on("/api/release_motion", HTTP_POST, []() {
+        motion_ctrl.release();
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Set Events of a Frame
+      httpServer.on("/api/frame_events", HTTP_POST, []() {
+        if (!httpServer.hasArg("slot") || !httpServer.hasArg("frame") ||
+            !httpServer.hasArg("events")) {
+          httpServer.send(400, "text/plain", "Missing slot, frame or events");
+          return;
+        }
+        int slot = httpServer.arg("slot").toInt();
+        int index = httpServer.arg("frame").toInt();
+        int events = httpServer.arg("events").toInt();
+        int condition = httpServer.arg("condition").toInt();
+        if ((slot < 0) || (slot >= PLEN2::Motion::SLOT_END) || (index < 0) ||
+            (index >= PLEN2::Motion::Frame::FRAME_END) || (events < 0) ||
+            (events & ~PLEN2::Motion::Frame::EVENT_ALL) || (condition < 0) ||
+            (condition >= PLEN2::Motion::Frame::SENSOR_CONDITION_SUM)) {
+          httpServer.send(400, "text/plain", "Invalid argument");
+          return;
+        }
+        // Writing the motion under it would change the frames to come.
+        if (motion_ctrl.playing()) {
+          httpServer.send(409, "text/plain", "Motion playing");
+          return;
+        }
+        PLEN2::Motion::Header header;
+        PLEN2::Motion::Frame frame;
+        header.slot = slot;
+        frame.index = index;
+        if (!header.get() || (index >= header.frame_length) ||
+            !frame.get(slot)) {
+          httpServer.send(400, "text/plain", "Invalid frame");
+          return;
+        }
+        frame.events = events;
+        frame.event_code = httpServer.arg("code").toInt();
+        frame.sensor_id = httpServer.arg("sensor").toInt();
+        frame.sensor_condition = condition;
+        frame.sensor_threshold = httpServer.arg("threshold").toInt();
+        frame.hold_timeout_ms = httpServer.arg("timeout_ms").toInt();
+        // The header keeps the union of the events, so it is written after.
+        if (frame.set(slot) && header.gatherEvents() && header.set()) {
+          httpServer.send(200, "text/plain", "OK");
+        } else {
+          httpServer.send(500, "text/plain", "Failed");
+        }
+      });
+
+      // API: Setpoint Streaming Statistics
+      httpServer.on("/api/stream", HTTP_GET, []() {
+        String json = "{";
+        json += "\"active\":";
+        json += (trajectory_stream.active()) ? "true" : "false";
+        json += ",\"delay_ms\":" + String(trajectory_stream.delayTime());
+        json += ",\"underrun_policy\":" +
+                String(trajectory_stream.underrunPolicy());
+        json += ",\"depth\":" + String(trajectory_stream.depth());
+        json += ",\"received\":" + String(trajectory_stream.received());
+        json += ",\"late\":" + String(trajectory_stream.late());
+        json += ",\"dropped\":" + String(trajectory_stream.dropped());
+        json += ",\"corrupted\":" + String(trajectory_stream.corrupted());
+        json += ",\"underruns\":" + String(trajectory_stream.underruns());
+        json += ",\"arrival_us\":" +
+                timingStatisticsJson(trajectory_stream.arrivalIntervals());
+        json += "}";
+        httpServer.send(200, "text/json", json);
+      });
+
+      // API: Set Delay and Underrun Policy of Setpoint Streaming
+      httpServer.on("/api/set_stream", HTTP_POST, []() {
+        if (!httpServer.hasArg("delay") && !httpServer.hasArg("policy")) {
+          httpServer.send(400, "text/plain", "Missing delay or policy");
+          return;
+        }
+        if (httpServer.hasArg("delay")) {
+          int delay_ms = httpServer.arg("delay").toInt();
+          if (delay_ms < 0) {
+            httpServer.send(400, "text/plain", "Invalid delay");
+            return;
+          }
+          trajectory_stream.setDelayTime(delay_ms);
+        }
+        if (httpServer.hasArg("policy")) {
+          int policy = httpServer.arg("policy").toInt(); // 0: hold, 1: extrapolate
+          if ((policy < 0) || !trajectory_stream.setUnderrunPolicy(policy)) {
+            httpServer.send(400, "text/plain", "Invalid policy");
+            return;
+          }
+        }
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Reset Setpoint Streaming Statistics
+      httpServer.on("/api/reset_stream", HTTP_POST, []() {
+        trajectory_stream.resetStatistics();
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+      // API: Enable/Disable Motion Frame Prefetching
+      httpServer.on("/api/set_prefetch", HTTP_POST, []() {
+        if (!httpServer.hasArg("value")) {
+          httpServer.send(400, "text/plain", "Missing value");
+          return;
+        }
+        motion_ctrl.setPrefetch(httpServer.arg("value").toInt() != 0);
+        httpServer.send(200, "text/plain", "OK");
+      });
+
+#if DEBUG_TRACE
+      // API: Trace Events (Open the response by chrome://tracing.)
+      httpServer.on("/api/trace", HTTP_GET, handleTrace);
+#endif
+
+      httpUpdater.setup(&httpServer);
+      httpServer.begin();
+      servers_started = true;
+      outputSerial().println("HTTPUpdateServer ready! Open "
+                             "http://192.168.4.1/update in your browser\n");
+      tcp_server.begin();
+      tcp_server.setNoDelay(true);
+    }
+    udp.beginPacketMulticast(broadcastIp, BROADCAST_PORT, WiFi.localIP());
+    udp.write(robot_name.c_str(), robot_name.length());
+    udp.endPacket();
+  }
+
+  if (update_cfg && WiFi.smartConfigDone()) {
+    outputSerial().println("smartConfigDone!\n");
+    outputSerial().printf("SSID:%s\r\n", WiFi.SSID().c_str());
+    outputSerial().printf("PSW:%s\r\n", WiFi.psk().c_str());
+
+    if (fp_syscfg) {
+      fp_syscfg.close();
+      fp_syscfg = SPIFFS.open(SYSCFG_FILE, "w");
+      fp_syscfg.println(WiFi.SSID().c_str());
+      fp_syscfg.println(WiFi.psk().c_str());
+      fp_syscfg.close();
+      fp_syscfg = SPIFFS.open(SYSCFG_FILE, "r");
+    }
+    update_cfg = false;
+  }
+  if (update_cfg) {
+    WiFi.stopSmartConfig();
+    StartAp();
+    update_cfg = false;
+  }
+}
+
+void PLEN2::System::handleClient() {
+  if (servers_started) {
+    httpServer.handleClient();
+  }
+}
+
+bool PLEN2::System::tcp_available() {
+  if (tcp_server.hasClient()) {
+    serverClient = tcp_server.available();
+    if (!serverClient || !serverClient.connected()) {
+      if (serverClient) {
+        serverClient.stop();
+      }
+      serverClient = tcp_server.available();
+    }
+  }
+  if (serverClient && serverClient.connected()) {
+    return serverClient.available();
+  }
+  return false;
+}
+
+bool PLEN2::System::tcp_connected() {
+  return serverClient && serverClient.connected();
+}
+
+char PLEN2::System::tcp_read() { return serverClient.read(); }
+
+void PLEN2::System::tcp_println(const String &line) {
+  if (tcp_connected()) {
+    serverClient.println(line);
+  }
+}
+
+Stream &PLEN2::System::SystemSerial() { return PLEN2_SYSTEM_SERIAL; }
+
+Stream &PLEN2::System::inputSerial() { return PLEN2_SYSTEM_SERIAL; }
+
+Stream &PLEN2::System::outputSerial() { return PLEN2_SYSTEM_SERIAL; }
+
+Stream &PLEN2::System::debugSerial() { return PLEN2_SYSTEM_SERIAL; }
+
+void PLEN2::System::dump() {
+#if DEBUG
+  volatile Utility::Profiler p(F("System::dump()"));
+#endif
+
+  outputSerial().println(F("{"));
+
+  outputSerial().print(F("\t\"device\": \""));
+  outputSerial().print(DEVICE_NAME);
+  outputSerial().println(F("\","));
+
+  outputSerial().print(F("\t\"codename\": \""));
+  outputSerial().print(CODE_NAME);
+  outputSerial().println(F("\","));
+
+  outputSerial().print(F("\t\"version\": \""));
+  outputSerial().print(VERSION);
+  outputSerial().println(F("\""));
+
+  outputSerial().println(F("}"));
+}
@@ -0,0 +1,113 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+#include "Arduino.h"
+#include "TimingStatistics.h"
+
+
+Utility::TimingStatistics::TimingStatistics()
+{
+	reset();
+}
+
+
+void Utility::TimingStatistics::reset()
+{
+	for (int bucket = 0; bucket < BUCKET_SUM; bucket++)
+	{
+		m_buckets[bucket] = 0;
+	}
+
+	m_count = 0;
+	m_sum   = 0;
+	m_min   = 0xFFFFFFFFUL;
+	m_max   = 0;
+}
+
+
+unsigned char Utility::TimingStatistics::m_bucketOf(unsigned long value)
+{
+	if (value < (1UL << SUB_BUCKET_BITS))
+	{
+		return value;
+	}
+
+	unsigned char msb = 31 - __builtin_clz(static_cast<unsigned int>(value));
+
+	return ((msb - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS)
+		| ((value >> (msb - SUB_BUCKET_BITS)) & ((1UL << SUB_BUCKET_BITS) - 1));
+}
+
+
+unsigned long Utility::TimingStatistics::m_upperBoundOf(unsigned char bucket)
+{
+	if (bucket < (1 << SUB_BUCKET_BITS))
+	{
+		return bucket;
+	}
+
+	unsigned char msb = (bucket >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+	unsigned long sub = bucket & ((1 << SUB_BUCKET_BITS) - 1);
+
+	return (((1UL << SUB_BUCKET_BITS) | sub) << (msb - SUB_BUCKET_BITS))
+		+ (1UL << (msb - SUB_BUCKET_BITS)) - 1;
+}
+
+
+void Utility::TimingStatistics::sample(unsigned long value)
+{
+	if (m_count >= WINDOW)
+	{
+		m_count = 0;
+
+		for (int bucket = 0; bucket < BUCKET_SUM; bucket++)
+		{
+			m_buckets[bucket] >>= 1;
+			m_count += m_buckets[bucket];
+		}
+
+		m_sum = (m_sum >> 1);
+		m_min = 0xFFFFFFFFUL;
+		m_max = 0;
+	}
+
+	m_buckets[m_bucketOf(value)]++;
+	m_count++;
+	m_sum += value;
+
+	if (value < m_min) m_min = value;
+	if (value > m_max) m_max = value;
+}
+
+
+unsigned long Utility::TimingStatistics::mean() const
+{
+	return (m_count == 0)? 0 : static_cast<unsigned long>(m_sum / m_count);
+}
+
+
+unsigned long Utility::TimingStatistics::percentile(unsigned char percent) const
+{
+	unsigned long threshold = (static_cast<unsigned long>(m_count) * percent + 99) / 100;
+	unsigned long accumulated = 0;
+
+	for (int bucket = 0; bucket < BUCKET_SUM; bucket++)
+	{
+		accumulated += m_buckets[bucket];
+
+		if ((accumulated >= threshold) && (accumulated != 0))
+		{
+			unsigned long bound = m_upperBoundOf(bucket);
+
+			return (bound < m_max)? bound : m_max;
+		}
+	}
+
+	return m_max;
+}
@@ -0,0 +1,94 @@
+/*!
+	@file      TimingStatistics.h
+	@brief     Rolling histogram of time intervals.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef UTILITY_TIMING_STATISTICS_H
+#define UTILITY_TIMING_STATISTICS_H
+
+
+namespace Utility
+{
+	class TimingStatistics;
+}
+
+/*!
+	@brief Rolling histogram of time intervals
+
+	The class is cheap enough to sample from a timer callback.
+	Refer to the usage below.
+	@code
+	Utility::TimingStatistics stats;
+
+	stats.sample(micros() - begin);
+
+	stats.min(); stats.mean(); stats.percentile(99); stats.max();
+	@endcode
+
+	@note
+	Buckets are logarithmic with 4 sub-buckets per power of 2, so a percentile has about 25% of resolution.
+	When the samples reach WINDOW, all counts are halved, so old samples fade out.
+*/
+class Utility::TimingStatistics
+{
+public:
+	enum {
+		SUB_BUCKET_BITS = 2,    //!< Bits of sub-buckets per power of 2.
+		BUCKET_SUM      = 124,  //!< Summation of buckets. (:= (32 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS)
+		WINDOW          = 1024  //!< Sample count that halves the histogram.
+	};
+
+	/*!
+		@brief Constructor
+	*/
+	TimingStatistics();
+
+	/*!
+		@brief Clear all samples
+	*/
+	void reset();
+
+	/*!
+		@brief Add a sample
+
+		@param [in] value Please set a sample. (e.g. micro seconds)
+	*/
+	void sample(unsigned long value);
+
+	//! @brief Get count of samples in the window
+	unsigned int count() const { return m_count; }
+
+	//! @brief Get min value after the histogram was halved last
+	unsigned long min() const { return m_min; }
+
+	//! @brief Get max value after the histogram was halved last
+	unsigned long max() const { return m_max; }
+
+	//! @brief Get mean value of the window
+	unsigned long mean() const;
+
+	/*!
+		@brief Get percentile of the window
+
+		@param [in] percent Please set percentage. (e.g. 99)
+
+		@return Upper bound of the bucket that includes the percentile
+	*/
+	unsigned long percentile(unsigned char percent) const;
+
+private:
+	static unsigned char m_bucketOf(unsigned long value);
+	static unsigned long m_upperBoundOf(unsigned char bucket);
+
+	unsigned short m_buckets[BUCKET_SUM];
+	unsigned int   m_count;
+	unsigned long long m_sum;
+	unsigned long  m_min;
+	unsigned long  m_max;
+};
+
+#endif // UTILITY_TIMING_STATISTICS_H
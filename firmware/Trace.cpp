@@ -0,0 +1,124 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+#include "Arduino.h"
+#include "Trace.h"
+
+
+Utility::Trace::Event Utility::Trace::m_events[Utility::Trace::EVENT_SUM];
+unsigned int  Utility::Trace::m_head    = 0;
+unsigned int  Utility::Trace::m_size    = 0;
+unsigned long Utility::Trace::m_dropped = 0;
+unsigned char Utility::Trace::m_depth   = 0;
+bool          Utility::Trace::m_enabled = true;
+
+
+void Utility::Trace::record(const __FlashStringHelper* name, unsigned char phase)
+{
+	if (!m_enabled)
+	{
+		return;
+	}
+
+	if (phase == PHASE_END)
+	{
+		m_depth--;
+	}
+
+	Event& event = m_events[m_head];
+
+	event.timestamp_us = micros();
+	event.name         = name;
+	event.phase        = phase;
+	event.depth        = m_depth;
+
+	if (phase == PHASE_BEGIN)
+	{
+		m_depth++;
+	}
+
+	m_head = (m_head + 1) & (EVENT_SUM - 1);
+
+	if (m_size < EVENT_SUM)
+	{
+		m_size++;
+	}
+	else
+	{
+		m_dropped++;
+	}
+}
+
+
+unsigned int Utility::Trace::size()
+{
+	return m_size;
+}
+
+
+unsigned long Utility::Trace::dropped()
+{
+	return m_dropped;
+}
+
+
+const Utility::Trace::Event& Utility::Trace::at(unsigned int index)
+{
+	return m_events[(m_head - m_size + index) & (EVENT_SUM - 1)];
+}
+
+
+void Utility::Trace::enable(bool enabled)
+{
+	m_enabled = enabled;
+}
+
+
+void Utility::Trace::clear()
+{
+	m_head    = 0;
+	m_size    = 0;
+	m_dropped = 0;
+}
+
+
+void Utility::Trace::dump(Print& output)
+{
+	output.print(F("{\"traceEvents\":["));
+
+	for (unsigned int index = 0; index < m_size; index++)
+	{
+		if (index != 0)
+		{
+			output.print(',');
+		}
+
+		dumpEvent(output, index);
+	}
+
+	output.print(F("],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":"));
+	output.print(m_dropped);
+	output.println(F("}}"));
+}
+
+
+void Utility::Trace::dumpEvent(Print& output, unsigned int index)
+{
+	const Event& event = at(index);
+
+	output.print(F("{\"name\":\""));
+	output.print(event.name);
+	output.print(F("\",\"ph\":\""));
+	output.print(static_cast<char>(event.phase));
+	output.print(F("\",\"ts\":"));
+	output.print(event.timestamp_us);
+	output.print(F(",\"pid\":0,\"tid\":0,\"args\":{\"depth\":"));
+	output.print(event.depth);
+	output.print(F("}}"));
+}
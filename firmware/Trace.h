@@ -0,0 +1,175 @@
+/*!
+	@file      Trace.h
+	@brief     Ring buffer of timestamped trace events.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef UTILITY_TRACE_H
+#define UTILITY_TRACE_H
+
+#include "System.h"
+
+
+class __FlashStringHelper;
+class Print;
+
+
+namespace Utility
+{
+	class Trace;
+	class TraceScope;
+}
+
+/*!
+	@brief Record the scope as a trace event
+
+	The macro expands to nothing unless DEBUG_TRACE is true, so hot paths can keep it.
+	Refer to the usage below.
+	@code
+	void anyFunction()
+	{
+		TRACE_SCOPE("anyFunction()");
+
+		Any code here...
+	}
+	@endcode
+*/
+#if DEBUG_TRACE
+	#define TRACE_SCOPE(NAME) volatile Utility::TraceScope trace_scope(F(NAME))
+#else
+	#define TRACE_SCOPE(NAME)
+#endif
+
+/*!
+	@brief Ring buffer of timestamped trace events
+
+	Recording an event only stores (name, micros(), nesting depth) to RAM, and never outputs to serial.
+	The events are drained later as JSON of Chrome's trace event format, that chrome://tracing can open.
+
+	@attention
+	Recording is not guarded against interruptions, so please record from the main loop
+	and from callbacks of Ticker, that never preempt each other.
+*/
+class Utility::Trace
+{
+public:
+	enum {
+		EVENT_SUM = 256 //!< Capacity of the ring buffer. (Must be power of 2.)
+	};
+
+	enum {
+		PHASE_BEGIN = 'B', //!< Beginning of a scope.
+		PHASE_END   = 'E'  //!< End of a scope.
+	};
+
+	/*!
+		@brief Trace event
+	*/
+	class Event
+	{
+	public:
+		unsigned long timestamp_us;      //!< Value of micros().
+		const __FlashStringHelper* name; //!< Name that is also the id of the event.
+		unsigned char phase;             //!< PHASE_BEGIN or PHASE_END.
+		unsigned char depth;             //!< Nesting depth of the scope.
+	};
+
+	/*!
+		@brief Record an event
+
+		The oldest event is overwritten when the buffer is full.
+
+		@param [in] name  Please set name in flash memory.
+		@param [in] phase Please set PHASE_BEGIN or PHASE_END.
+	*/
+	static void record(const __FlashStringHelper* name, unsigned char phase);
+
+	//! @brief Get count of the events recorded
+	static unsigned int size();
+
+	//! @brief Get count of the events overwritten before drained
+	static unsigned long dropped();
+
+	/*!
+		@brief Get an event
+
+		@param [in] index Please set index from the oldest event.
+
+		@return Reference of the event
+	*/
+	static const Event& at(unsigned int index);
+
+	/*!
+		@brief Stop or restart recording
+
+		@param [in] enabled Please set false while the events are drained.
+	*/
+	static void enable(bool enabled);
+
+	//! @brief Discard all events
+	static void clear();
+
+	/*!
+		@brief Output all events as JSON of Chrome's trace event format
+
+		@param [out] output Please set output stream. (e.g. Serial, WiFiClient)
+	*/
+	static void dump(Print& output);
+
+	/*!
+		@brief Output an event as JSON object
+
+		@param [out] output Please set output stream.
+		@param [in]  index  Please set index from the oldest event.
+	*/
+	static void dumpEvent(Print& output, unsigned int index);
+
+private:
+	static Event m_events[EVENT_SUM];
+	static unsigned int  m_head;    //!< Index that the next event is written.
+	static unsigned int  m_size;    //!< Count of the events in the buffer.
+	static unsigned long m_dropped; //!< Count of the overwritten events.
+	static unsigned char m_depth;   //!< Nesting depth of the current scope.
+	static bool          m_enabled; //!< Recording is enabled.
+};
+
+/*!
+	@brief Scope that records its beginning and end to Trace
+
+	@attention
+	Please use TRACE_SCOPE() instead of instantiating the class directly.
+*/
+class Utility::TraceScope
+{
+private:
+	const __FlashStringHelper* m_name;
+
+	// Disable copy constructor and operator =.
+	TraceScope(const TraceScope&);
+	TraceScope& operator=(const TraceScope&);
+
+public:
+	/*!
+		@brief Constructor
+
+		@param [in] name Please set name in flash memory.
+	*/
+	TraceScope(const __FlashStringHelper* name)
+		: m_name(name)
+	{
+		Trace::record(m_name, Trace::PHASE_BEGIN);
+	}
+
+	/*!
+		@brief Destructor
+	*/
+	~TraceScope()
+	{
+		Trace::record(m_name, Trace::PHASE_END);
+	}
+};
+
+#endif // UTILITY_TRACE_H
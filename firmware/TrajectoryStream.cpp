@@ -0,0 +1,320 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+#include "Arduino.h"
+
+#include "System.h"
+#include "Trace.h"
+#include "TrajectoryStream.h"
+
+
+namespace
+{
+	enum {
+		SYNC_0 = 0xA5,
+		SYNC_1 = 0x5A,
+
+		TIMESTAMP_OFFSET = 2,
+		ANGLES_OFFSET    = 6,
+
+		PRECISION = 16 //!< Fraction bits of a ratio between setpoints.
+	};
+}
+
+
+PLEN2::TrajectoryStream::TrajectoryStream()
+{
+	m_packet_position = 0;
+
+	m_buffer_begin   = 0;
+	m_length         = 0;
+	m_previous_valid = false;
+	m_underrunning   = false;
+
+	m_synchronized    = false;
+	m_offset_us       = 0;
+	m_arrival_us      = 0;
+	m_delay_us        = DELAY_US_DEFAULT();
+	m_underrun_policy = UNDERRUN_HOLD;
+
+	resetStatistics();
+}
+
+
+bool PLEN2::TrajectoryStream::readByte(unsigned char byte)
+{
+	if (m_packet_position == 0)
+	{
+		if (byte != SYNC_0)
+		{
+			return false;
+		}
+	}
+	else if (m_packet_position == 1)
+	{
+		if (byte != SYNC_1)
+		{
+			m_packet_position = 0;
+
+			return false;
+		}
+	}
+
+	m_packet[m_packet_position++] = byte;
+
+	if (m_packet_position == PACKET_LENGTH)
+	{
+		m_packet_position = 0;
+
+		m_accept();
+	}
+
+	return true;
+}
+
+
+bool PLEN2::TrajectoryStream::active()
+{
+	if (!m_synchronized)
+	{
+		return false;
+	}
+
+	if ((micros() - m_arrival_us) >= TIMEOUT_US())
+	{
+		m_synchronized   = false;
+		m_length         = 0;
+		m_previous_valid = false;
+		m_underrunning   = false;
+
+		return false;
+	}
+
+	return true;
+}
+
+
+bool PLEN2::TrajectoryStream::sample(unsigned long now_us, int angles[])
+{
+	TRACE_SCOPE("TrajectoryStream::sample()");
+
+	if (m_length == 0)
+	{
+		return false;
+	}
+
+	// Drop the setpoints passed, keeping the last one to extrapolate from it.
+	while ((m_length >= 2) && (m_untilPlay(m_setpoint(1), now_us) <= 0))
+	{
+		m_previous       = m_setpoint(0);
+		m_previous_valid = true;
+
+		m_buffer_begin = (m_buffer_begin + 1) & (RING_LENGTH - 1);
+		m_length--;
+	}
+
+	const Setpoint& from  = m_setpoint(0);
+	const long elapsed_us = -m_untilPlay(from, now_us);
+
+	if (elapsed_us < 0)
+	{
+		return false;
+	}
+
+	if (m_length >= 2)
+	{
+		const Setpoint& to = m_setpoint(1);
+		const long ratio   = (static_cast<long long>(elapsed_us) << PRECISION) / static_cast<long>(to.time_us - from.time_us);
+
+		for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+		{
+			angles[joint_id] = from.angles[joint_id] + static_cast<int>(
+				(static_cast<long>(to.angles[joint_id] - from.angles[joint_id]) * ratio) >> PRECISION
+			);
+		}
+
+		m_underrunning = false;
+
+		return true;
+	}
+
+	if (!m_underrunning)
+	{
+		m_underrunning = true;
+		m_underruns++;
+	}
+
+	if ((m_underrun_policy == UNDERRUN_EXTRAPOLATE) && m_previous_valid)
+	{
+		const long span_us = static_cast<long>(from.time_us - m_previous.time_us);
+		const long ahead_us = (elapsed_us < static_cast<long>(EXTRAPOLATION_US_MAX())) ?
+			elapsed_us : static_cast<long>(EXTRAPOLATION_US_MAX());
+
+		for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+		{
+			angles[joint_id] = from.angles[joint_id] + static_cast<int>(
+				(static_cast<long long>(from.angles[joint_id] - m_previous.angles[joint_id]) * ahead_us) / span_us
+			);
+		}
+
+		return true;
+	}
+
+	for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		angles[joint_id] = from.angles[joint_id];
+	}
+
+	return true;
+}
+
+
+void PLEN2::TrajectoryStream::setDelayTime(unsigned int delay_ms)
+{
+	m_delay_us = static_cast<unsigned long>(delay_ms) * 1000;
+}
+
+
+bool PLEN2::TrajectoryStream::setUnderrunPolicy(unsigned char policy)
+{
+	if (policy >= UNDERRUN_POLICY_SUM)
+	{
+		#if DEBUG
+			System::debugSerial().print(F(">>> bad argment : policy = "));
+			System::debugSerial().println(static_cast<int>(policy));
+		#endif
+
+		return false;
+	}
+
+	m_underrun_policy = policy;
+
+	return true;
+}
+
+
+void PLEN2::TrajectoryStream::resetStatistics()
+{
+	m_received  = 0;
+	m_late      = 0;
+	m_dropped   = 0;
+	m_corrupted = 0;
+	m_underruns = 0;
+
+	m_arrival_intervals.reset();
+}
+
+
+PLEN2::TrajectoryStream::Setpoint& PLEN2::TrajectoryStream::m_setpoint(unsigned char offset)
+{
+	return m_buffer[(m_buffer_begin + offset) & (RING_LENGTH - 1)];
+}
+
+
+void PLEN2::TrajectoryStream::m_accept()
+{
+	TRACE_SCOPE("TrajectoryStream::m_accept()");
+
+	unsigned char sum = 0;
+
+	for (unsigned char index = TIMESTAMP_OFFSET; index < PACKET_LENGTH; index++)
+	{
+		sum += m_packet[index];
+	}
+
+	if (sum != 0)
+	{
+		m_corrupted++;
+
+		return;
+	}
+
+	const unsigned long now_us  = micros();
+	const unsigned long time_us =
+		  (static_cast<unsigned long>(m_packet[TIMESTAMP_OFFSET    ])      )
+		| (static_cast<unsigned long>(m_packet[TIMESTAMP_OFFSET + 1]) <<  8)
+		| (static_cast<unsigned long>(m_packet[TIMESTAMP_OFFSET + 2]) << 16)
+		| (static_cast<unsigned long>(m_packet[TIMESTAMP_OFFSET + 3]) << 24);
+
+	// Setpoints must go forward, so a packet out of order is useless.
+	if (m_synchronized)
+	{
+		const Setpoint* newest_ptr = (m_length != 0) ? &m_setpoint(m_length - 1) : (m_previous_valid ? &m_previous : NULL);
+
+		if ((newest_ptr != NULL) && (static_cast<long>(time_us - newest_ptr->time_us) <= 0))
+		{
+			m_dropped++;
+
+			return;
+		}
+	}
+
+	/*!
+		@note
+		The shortest transit is the best guess of the relation of the clocks,
+		because a packet is never faster than the network.
+	*/
+	const unsigned long transit_us = now_us - time_us;
+
+	if (!m_synchronized)
+	{
+		m_synchronized = true;
+		m_offset_us    = transit_us;
+	}
+	else
+	{
+		m_arrival_intervals.sample(now_us - m_arrival_us);
+
+		if (static_cast<long>(transit_us - m_offset_us) < 0)
+		{
+			m_offset_us = transit_us;
+		}
+		else
+		{
+			m_offset_us += CLOCK_LEAK_US();
+		}
+	}
+
+	m_arrival_us = now_us;
+	m_received++;
+
+	if (m_length == RING_LENGTH)
+	{
+		m_previous       = m_setpoint(0);
+		m_previous_valid = true;
+
+		m_buffer_begin = (m_buffer_begin + 1) & (RING_LENGTH - 1);
+		m_length--;
+		m_dropped++;
+	}
+
+	Setpoint& setpoint = m_setpoint(m_length);
+
+	setpoint.time_us = time_us;
+
+	for (char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		const unsigned char* data = m_packet + ANGLES_OFFSET + 2 * joint_id;
+
+		setpoint.angles[joint_id] = static_cast<short>(data[0] | (data[1] << 8));
+	}
+
+	m_length++;
+
+	if (m_untilPlay(setpoint, now_us) < 0)
+	{
+		m_late++;
+	}
+}
+
+
+long PLEN2::TrajectoryStream::m_untilPlay(const Setpoint& setpoint, unsigned long now_us)
+{
+	return static_cast<long>(setpoint.time_us + m_offset_us + m_delay_us - now_us);
+}
@@ -0,0 +1,191 @@
+/*!
+	@file      TrajectoryStream.h
+	@brief     Jitter buffer of joint setpoints streamed by a host.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef PLEN2_TRAJECTORY_STREAM_H
+#define PLEN2_TRAJECTORY_STREAM_H
+
+#include "JointController.h"
+#include "TimingStatistics.h"
+
+
+namespace PLEN2
+{
+	class TrajectoryStream;
+}
+
+/*!
+	@brief Jitter buffer of joint setpoints streamed by a host
+
+	A host pushes full-body setpoints with its own timestamps in a binary packet.
+	The packets share the TCP port with the text protocol, because the sync byte never appears in it.
+	@code
+	offset  size  content
+	     0     2  Sync bytes. (0xA5, 0x5A)
+	     2     4  Timestamp of the setpoint on the host clock. [usec] (Little endian)
+	     6    48  Angles of the joints, int16 each. [degree * 10 from home] (Little endian)
+	    54     1  Checksum. (The 8 bit sum of bytes from offset 2 to 54 is 0.)
+	@endcode
+
+	The setpoints are played on the host clock delayed by delay time,
+	so packets arriving with jitter within it are interpolated without a gap.
+	The host clock is related to micros() by the shortest transit observed,
+	and the relation leaks a little at every packet, so drift of the clocks is followed.
+
+	When the buffer runs dry, the last setpoint is held, or extrapolated from the last two
+	for EXTRAPOLATION_US_MAX() at most.
+*/
+class PLEN2::TrajectoryStream
+{
+public:
+	enum {
+		PACKET_LENGTH = 55, //!< Length of a packet.
+		RING_LENGTH   = 8   //!< Depth of the setpoint ring. (Must be power of 2.)
+	};
+
+	/*!
+		@brief Policies of an underrun
+	*/
+	enum {
+		UNDERRUN_HOLD,        //!< Hold the last setpoint.
+		UNDERRUN_EXTRAPOLATE, //!< Extrapolate the last two setpoints.
+		UNDERRUN_POLICY_SUM   //!< Summation of the policies.
+	};
+
+	//! @brief Default delay of playing setpoints (usec), that covers 2 packets late at 50 Hz
+	inline static const unsigned long DELAY_US_DEFAULT() { return 60000UL; }
+
+	//! @brief Max time to extrapolate setpoints (usec)
+	inline static const unsigned long EXTRAPOLATION_US_MAX() { return 100000UL; }
+
+	//! @brief Time without packets that ends streaming (usec)
+	inline static const unsigned long TIMEOUT_US() { return 500000UL; }
+
+	//! @brief Leak of the clock relation per packet (usec), that follows drift of 100 ppm at 50 Hz
+	inline static const unsigned long CLOCK_LEAK_US() { return 2UL; }
+
+	/*!
+		@brief Constructor
+	*/
+	TrajectoryStream();
+
+	/*!
+		@brief Read a byte from the host
+
+		@param [in] byte A byte.
+
+		@return false if the byte is not a part of a packet (It belongs to the text protocol.)
+	*/
+	bool readByte(unsigned char byte);
+
+	/*!
+		@brief Decide setpoints are streamed
+
+		Streaming ends when no packet arrives in TIMEOUT_US(),
+		and the buffer and the clock relation are discarded then.
+
+		@return Result
+	*/
+	bool active();
+
+	/*!
+		@brief Sample the setpoints at a time
+
+		@param [in]  now_us   Value of micros().
+		@param [out] angles[] Angles of the joints. [degree * 10 from home]
+
+		@return false if no setpoint is to play yet
+	*/
+	bool sample(unsigned long now_us, int angles[]);
+
+	/*!
+		@brief Set delay of playing setpoints
+
+		@param [in] delay_ms Please set longer than jitter of the packets.
+	*/
+	void setDelayTime(unsigned int delay_ms);
+
+	//! @brief Get delay of playing setpoints [msec]
+	unsigned int delayTime() const { return m_delay_us / 1000; }
+
+	/*!
+		@brief Set policy of an underrun
+
+		@param [in] policy Please set UNDERRUN_HOLD or UNDERRUN_EXTRAPOLATE.
+
+		@return Result
+	*/
+	bool setUnderrunPolicy(unsigned char policy);
+
+	//! @brief Get policy of an underrun
+	unsigned char underrunPolicy() const { return m_underrun_policy; }
+
+	//! @brief Get count of setpoints buffered
+	unsigned char depth() const { return m_length; }
+
+	//! @brief Get count of packets accepted
+	unsigned long received() const { return m_received; }
+
+	//! @brief Get count of packets that arrived after their time to play
+	unsigned long late() const { return m_late; }
+
+	//! @brief Get count of packets discarded (Out of order, or the buffer was full.)
+	unsigned long dropped() const { return m_dropped; }
+
+	//! @brief Get count of packets broken
+	unsigned long corrupted() const { return m_corrupted; }
+
+	//! @brief Get count of times the buffer ran dry
+	unsigned long underruns() const { return m_underruns; }
+
+	//! @brief Get intervals of packets arriving [usec]
+	const Utility::TimingStatistics& arrivalIntervals() const { return m_arrival_intervals; }
+
+	//! @brief Reset the statistics
+	void resetStatistics();
+
+private:
+	/*!
+		@brief Setpoint in the ring buffer
+	*/
+	class Setpoint
+	{
+	public:
+		unsigned long time_us;                 //!< Timestamp on the host clock.
+		short angles[JointController::SUM];
+	};
+
+	Setpoint& m_setpoint(unsigned char offset);
+	void m_accept();
+	long m_untilPlay(const Setpoint& setpoint, unsigned long now_us);
+
+	unsigned char m_packet[PACKET_LENGTH];
+	unsigned char m_packet_position;
+
+	Setpoint      m_buffer[RING_LENGTH];
+	unsigned char m_buffer_begin;
+	unsigned char m_length;
+	Setpoint      m_previous;          //!< Setpoint before the first one, to extrapolate.
+	bool          m_previous_valid;
+	bool          m_underrunning;
+
+	bool          m_synchronized;      //!< m_offset_us relates the clocks.
+	unsigned long m_offset_us;         //!< micros() - host clock, of the shortest transit.
+	unsigned long m_arrival_us;        //!< Value of micros() the last packet arrived at.
+	unsigned long m_delay_us;
+	unsigned char m_underrun_policy;
+
+	unsigned long m_received;
+	unsigned long m_late;
+	unsigned long m_dropped;
+	unsigned long m_corrupted;
+	unsigned long m_underruns;
+	Utility::TimingStatistics m_arrival_intervals;
+};
+
+#endif // PLEN2_TRAJECTORY_STREAM_H
@@ -1,48 +1,48 @@
-/*!
-	@file      firmware.h
-	@brief     Mainpage's markdown file
-	@author    Kazuyuki TAKASE
-	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
-*/
-
-/*!
-	@mainpage
-
-	PLEN2 - Firmware for Arduino (Atmega32u4)
-	===============================================================================
-
-	Code name "Cytisus" (version 1.3.1) is now available!
-
-
-	## Attention!
-	"Arduino" means compatible board created by us.
-	Please get it [here](http://shop.plen.jp/) or create yourself.
-
-
-	## Copyright (c) 2015,
-	- [Kazuyuki TAKASE](https://github.com/junbowu), Project manager of the repository.
-	- [PLEN Project Company Inc.](https://plen.jp)
-
-
-	## API Guide
-	Please check [here](https://plenproject.github.io/plen__firmware_for_Arduino).
-
-
-	## Build Enviroment
-	- Windows 8.1 Professional edition
-	- Windows 7 Home Premium
-	- Arduino IDE ver.1.6.5-r5
-	- Sublime Text 3 Build 3083
-	- [Arduino Unit](https://github.com/mmurdoch/arduinounit)
-
-
-	## License
-	This software is released under the MIT License.
-*/
-\
-/*!
-	@note
-	If you want to apply natural moving on PLEN, set the macro to "true".
-	(The process is using a lot of calculation space, so the firmware becomes hard to input user action.)
-*/
-#define ENSOUL_PLEN2 false
+/*!
+	@file      firmware.h
+	@brief     Mainpage's markdown file
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+/*!
+	@mainpage
+
+	PLEN2 - Firmware for Arduino (Atmega32u4)
+	===============================================================================
+
+	Code name "Cytisus" (version 1.3.1) is now available!
+
+
+	## Attention!
+	"Arduino" means compatible board created by us.
+	Please get it [here](http://shop.plen.jp/) or create yourself.
+
+
+	## Copyright (c) 2015,
+	- [Kazuyuki TAKASE](https://github.com/junbowu), Project manager of the repository.
+	- [PLEN Project Company Inc.](https://plen.jp)
+
+
+	## API Guide
+	Please check [here](https://plenproject.github.io/plen__firmware_for_Arduino).
+
+
+	## Build Enviroment
+	- Windows 8.1 Professional edition
+	- Windows 7 Home Premium
+	- Arduino IDE ver.1.6.5-r5
+	- Sublime Text 3 Build 3083
+	- [Arduino Unit](https://github.com/mmurdoch/arduinounit)
+
+
+	## License
+	This software is released under the MIT License.
+*/
+\
+/*!
+	@note
+	If you want to apply natural moving on PLEN, set the macro to "true".
+	(The process is using a lot of calculation space, so the firmware becomes hard to input user action.)
+*/
+#define ENSOUL_PLEN2 false
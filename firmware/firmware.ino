@@ -1,517 +1,651 @@
-/*
-       Copyright (c) 2015,
-       - Kazuyuki TAKASE - https://github.com/junbowu
-       - PLEN Project Company Inc. - https://plen.jp
-
-       This software is released under the MIT License.
-       (See also : http://opensource.org/licenses/mit-license.php)
-*/
-
-#include <string.h>
-
-#include <Servo.h>
-#include <Wire.h>
-
-
-#include "ExternalFs.h"
-#include "Interpreter.h" 3
-#include "JointController.h"
-#include "Motion.h"
-#include "MotionController.h"
-#include "Parser.h"
-#include "Pin.h"
-#include "Profiler.h"
-#include "Protocol.h"
-#include "System.h"
-
-
-#if ENSOUL_PLEN2
-#include "AccelerationGyroSensor.h"
-#include "Soul.h"
-#endif
-
-using namespace PLEN2;
-
-/*!
-        Core instances
-*/
-JointController joint_ctrl;
-MotionController motion_ctrl(joint_ctrl);
-Interpreter interpreter(motion_ctrl);
-
-#if ENSOUL_PLEN2
-AccelerationGyroSensor sensor;
-Soul soul(sensor, motion_ctrl);
-#endif
-
-namespace {
-
-/*!
-        The application instance
-*/
-class Application : public Protocol {
-private:
-  static void (Application::*CONTROLLER_EVENT_HANDLER[])();
-  static void (Application::*INTERPRETER_EVENT_HANDLER[])();
-  static void (Application::*SETTER_EVENT_HANDLER[])();
-  static void (Application::*GETTER_EVENT_HANDLER[])();
-
-  static void (Application::**EVENT_HANDLER[])();
-
-  Motion::Header m_header_tmp;
-  Motion::Frame m_frame_tmp;
-  Interpreter::Code m_code_tmp;
-
-  void applyDiff() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::applyDiff()"));
-
-    System::debugSerial().print(F(">>> joint_id : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
-
-    System::debugSerial().print(F(">>> angle_diff : "));
-    System::debugSerial().println(Utility::hexbytes2int(m_buffer.data + 2, 3));
-#endif
-
-    joint_ctrl.setAngleDiff(Utility::hexbytes2uint(m_buffer.data, 2),
-                            Utility::hexbytes2int(m_buffer.data + 2, 3));
-  }
-
-  void apply() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::apply()"));
-
-    System::debugSerial().print(F(">>> joint_id : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
-
-    System::debugSerial().print(F(">>> angle : "));
-    System::debugSerial().println(Utility::hexbytes2int(m_buffer.data + 2, 3));
-#endif
-
-    joint_ctrl.setAngle(Utility::hexbytes2uint(m_buffer.data, 2),
-                        Utility::hexbytes2int(m_buffer.data + 2, 3));
-  }
-
-  void homePosition() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::homePosition()"));
-#endif
-
-    joint_ctrl.loadSettings();
-  }
-
-  void playMotion() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::playMotion()"));
-
-    System::debugSerial().print(F(">>> slot : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
-#endif
-
-    motion_ctrl.play(Utility::hexbytes2uint(m_buffer.data, 2));
-  }
-
-  void stopMotion() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::stopMotion()"));
-#endif
-
-    motion_ctrl.willStop();
-  }
-
-  void popCode() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::popCode()"));
-#endif
-
-    interpreter.popCode();
-  }
-
-  void pushCode() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::pushCode()"));
-
-    System::debugSerial().print(F(">>> slot : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
-
-    System::debugSerial().print(F(">>> loop_count : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data + 2, 2));
-#endif
-
-    m_code_tmp.slot = Utility::hexbytes2uint(m_buffer.data, 2);
-    m_code_tmp.loop_count = Utility::hexbytes2uint(m_buffer.data + 2, 2) - 1;
-
-    interpreter.pushCode(m_code_tmp);
-  }
-
-  void resetInterpreter() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::resetInterpreter()"));
-#endif
-
-    interpreter.reset();
-  }
-
-  void setHome() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::setHome()"));
-
-    System::debugSerial().print(F(">>> joint_id : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
-
-    System::debugSerial().print(F(">>> angle : "));
-    System::debugSerial().println(Utility::hexbytes2int(m_buffer.data + 2, 3));
-#endif
-
-    joint_ctrl.setHomeAngle(Utility::hexbytes2uint(m_buffer.data, 2),
-                            Utility::hexbytes2int(m_buffer.data + 2, 3));
-  }
-
-  void setJointSettings() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::setJointSettings()"));
-#endif
-
-    joint_ctrl.resetSettings();
-  }
-
-  void setMax() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::setMax()"));
-
-    System::debugSerial().print(F(">>> joint_id : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
-
-    System::debugSerial().print(F(">>> angle : "));
-    System::debugSerial().println(Utility::hexbytes2int(m_buffer.data + 2, 3));
-#endif
-
-    joint_ctrl.setMaxAngle(Utility::hexbytes2uint(m_buffer.data, 2),
-                           Utility::hexbytes2int(m_buffer.data + 2, 3));
-  }
-
-  void setMotionFrame() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::setMotionFrame()"));
-
-    System::debugSerial().print(F(">>> slot : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
-
-    System::debugSerial().print(F(">>> frame_id : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data + 2, 2));
-
-    System::debugSerial().print(F(">>> transition_time_ms : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data + 4, 4));
-
-    for (int device_id = 0; device_id < JointController::SUM; device_id++) {
-      System::debugSerial().print(F(">>> output["));
-      System::debugSerial().print(device_id);
-      System::debugSerial().print(F("] : "));
-      System::debugSerial().println(
-          Utility::hexbytes2int(m_buffer.data + 8 + device_id * 4, 4));
-    }
-#endif
-
-    m_frame_tmp.transition_time_ms =
-        Utility::hexbytes2uint(m_buffer.data + 4, 4);
-
-    for (char device_id = 0; device_id < JointController::SUM; device_id++) {
-      m_frame_tmp.joint_angle[device_id] =
-          Utility::hexbytes2int(m_buffer.data + 8 + device_id * 4, 4);
-    }
-
-    if (m_installing) {
-      if (m_frame_tmp.index < m_header_tmp.frame_length) {
-        m_frame_tmp.set(m_header_tmp.slot);
-        m_frame_tmp.index++;
-      }
-
-      if (m_frame_tmp.index == m_header_tmp.frame_length) {
-        m_installing = false;
-      } else {
-        readByte('>');
-        accept();
-        transitState();
-
-        readByte('m');
-        readByte('f');
-        accept();
-        transitState();
-
-        readByte('0'); // dummy
-        readByte('0'); // dummy
-        readByte('0'); // dummy
-        readByte('0'); // dummy
-      }
-    } else {
-      m_frame_tmp.index = Utility::hexbytes2uint(m_buffer.data + 2, 2);
-      m_frame_tmp.set(Utility::hexbytes2uint(m_buffer.data, 2));
-    }
-  }
-
-  void setMotionHeader() {
-    strncpy(m_header_tmp.name, m_buffer.data + 2, 20);
-    m_header_tmp.name[20] = '\0';
-    m_buffer.data[2] = '\0';
-
-    if (!(m_parser[ARGUMENTS_INCOMING]->parse(m_buffer.data)) ||
-        !(m_parser[ARGUMENTS_INCOMING]->parse(m_buffer.data + 22))) {
-      return;
-    }
-
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::setMotionHeader()"));
-
-    System::debugSerial().print(F(">>> slot : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
-
-    System::debugSerial().print(F(">>> name : "));
-    System::debugSerial().println(m_header_tmp.name);
-
-    System::debugSerial().print(F(">>> func : "));
-    System::debugSerial().println(
-        Utility::hexbytes2uint(m_buffer.data + 22, 2));
-
-    System::debugSerial().print(F(">>> arg0 : "));
-    System::debugSerial().println(
-        Utility::hexbytes2uint(m_buffer.data + 24, 2));
-
-    System::debugSerial().print(F(">>> arg1 : "));
-    System::debugSerial().println(
-        Utility::hexbytes2uint(m_buffer.data + 26, 2));
-
-    System::debugSerial().print(F(">>> frame_length : "));
-    System::debugSerial().println(
-        Utility::hexbytes2uint(m_buffer.data + 28, 2));
-#endif
-
-    m_header_tmp.slot = Utility::hexbytes2uint(m_buffer.data, 2);
-    m_header_tmp.frame_length = Utility::hexbytes2uint(m_buffer.data + 28, 2);
-
-    switch (Utility::hexbytes2uint(m_buffer.data + 22, 2)) {
-    case 0: {
-      m_header_tmp.use_loop = 0;
-      m_header_tmp.use_jump = 0;
-
-      break;
-    }
-
-    case 1: {
-      m_header_tmp.use_loop = 1;
-      m_header_tmp.use_jump = 0;
-      m_header_tmp.loop_begin = Utility::hexbytes2uint(m_buffer.data + 24, 2);
-      m_header_tmp.loop_end = Utility::hexbytes2uint(m_buffer.data + 26, 2);
-
-      break;
-    }
-
-    case 2: {
-      m_header_tmp.use_loop = 0;
-      m_header_tmp.use_jump = 1;
-      m_header_tmp.jump_slot = Utility::hexbytes2uint(m_buffer.data + 24, 2);
-
-      break;
-    }
-    }
-
-    m_header_tmp.set();
-
-    if (m_installing == true) {
-      readByte('>');
-      accept();
-      transitState();
-
-      readByte('m');
-      readByte('f');
-      accept();
-      transitState();
-
-      readByte('0'); // dummy
-      readByte('0'); // dummy
-      readByte('0'); // dummy
-      readByte('0'); // dummy
-
-      m_frame_tmp.index = 0;
-    }
-  }
-
-  void setMin() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::setMin()"));
-
-    System::debugSerial().print(F(">>> joint_id : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
-
-    System::debugSerial().print(F(">>> angle : "));
-    System::debugSerial().println(Utility::hexbytes2int(m_buffer.data + 2, 3));
-#endif
-
-    joint_ctrl.setMinAngle(Utility::hexbytes2uint(m_buffer.data, 2),
-                           Utility::hexbytes2int(m_buffer.data + 2, 3));
-  }
-
-  void getJointSettings() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::getJointSettings()"));
-#endif
-
-    joint_ctrl.dump();
-  }
-
-  void getMotion() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::getMotion()"));
-
-    System::debugSerial().print(F(">>> slot : "));
-    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
-#endif
-
-    motion_ctrl.dump(Utility::hexbytes2uint(m_buffer.data, 2));
-  }
-
-  void getVersionInformation() {
-#if DEBUG_LESS
-    volatile Utility::Profiler p(F("Application::getVersionInformation()"));
-#endif
-
-    System::dump();
-  }
-
-public:
-  virtual void afterHook() {
-#if DEBUG
-    volatile Utility::Profiler p(F("Application::afterFook()"));
-#endif
-
-    if (m_state == HEADER_INCOMING) {
-      unsigned char header_id = m_parser[HEADER_INCOMING]->index();
-      unsigned char cmd_id = m_parser[COMMAND_INCOMING]->index();
-
-      (this->*EVENT_HANDLER[header_id][cmd_id])();
-
-#if ENSOUL_PLEN2
-      soul.userActionInputed();
-#endif
-    }
-  }
-};
-
-void (Application::*Application::CONTROLLER_EVENT_HANDLER[])() = {
-    &Application::applyDiff,    &Application::apply,
-    &Application::homePosition, &Application::playMotion,
-    &Application::stopMotion,   &Application::playMotion,
-    &Application::stopMotion};
-
-void (Application::*Application::INTERPRETER_EVENT_HANDLER[])() = {
-    &Application::popCode, &Application::pushCode,
-    &Application::resetInterpreter};
-
-void (Application::*Application::SETTER_EVENT_HANDLER[])() = {
-    &Application::setHome,
-    &Application::setMotionHeader, // sanity check.
-    &Application::setJointSettings,
-    &Application::setMax,
-    &Application::setMotionFrame,
-    &Application::setMotionHeader,
-    &Application::setMin};
-
-void (Application::*Application::GETTER_EVENT_HANDLER[])() = {
-    &Application::getJointSettings, &Application::getMotion,
-    &Application::getVersionInformation};
-
-void (Application::**Application::EVENT_HANDLER[])() = {
-    Application::CONTROLLER_EVENT_HANDLER,
-    Application::INTERPRETER_EVENT_HANDLER, Application::SETTER_EVENT_HANDLER,
-    Application::GETTER_EVENT_HANDLER};
-
-Application app;
-} // namespace
-
-/*!
-        @brief Setup
-
-        Put your setup code here, to run once:
-
-        @attention
-        Digital pin's output is an indefinite if you don't give an initialize
-   value. Please ensure that setup the pins which are configurable.
-*/
-void setup() {
-  volatile PLEN2::System system;
-  ExternalFs::init();
-
-  joint_ctrl.Init();
-  joint_ctrl.loadSettings();
-  System::setup_smartconfig();
-
-#if ENSOUL_PLEN2
-  /*!
-          @attention
-          The order of power supplied or firmware startup timing is base-board,
-     head-board. If the sampling method calls from early timing, program freezes
-     because synchronism of communication is missed. (Generally, it is going to
-     success setup() inserts 3000[msec] delays.)
-  */
-  //		delay(3000);
-#endif
-
-#if DEBUG
-  while (!Serial)
-    ;
-
-  PLEN2::System::outputSerial().println(
-      F("Hello, I am ViVi! My system is up and running ver.1.0.1, Let me walk "
-        ":)"));
-#endif
-}
-
-/*!
-        @brief Main polling loop
-
-        Put your main code here, to run repeatedly:
-*/
-void loop() {
-  if (motion_ctrl.playing()) {
-    if (motion_ctrl.frameUpdatable()) {
-      motion_ctrl.updateFrame();
-    }
-
-    if (motion_ctrl.updatingFinished()) {
-      if (motion_ctrl.nextFrameLoadable()) {
-        motion_ctrl.loadNextFrame();
-      } else {
-        motion_ctrl.stop();
-
-        if (interpreter.ready()) {
-          interpreter.popCode();
-        }
-      }
-    }
-  }
-
-  if (PLEN2::System::SystemSerial().available()) {
-    app.readByte(PLEN2::System::SystemSerial().read());
-
-    if (app.accept()) {
-      app.transitState();
-    }
-  }
-  if (PLEN2::System::tcp_available()) {
-#if DEBUG_LESS
-    uint8_t c = PLEN2::System::tcp_read();
-    PLEN2::System::outputSerial().write(c);
-    app.readByte(c);
-#else
-    app.readByte(PLEN2::System::tcp_read());
-#endif
-    if (app.accept()) {
-      app.transitState();
-    }
-  }
-
-  PLEN2::System::handleClient();
-#if ENSOUL_PLEN2
-  soul.log();
-  soul.action();
-#endif
-}
+/*
+       Copyright (c) 2015,
+       - Kazuyuki TAKASE - https://github.com/junbowu
+       - PLEN Project Company Inc. - https://plen.jp
+
+       This software is released under the MIT License.
+       (See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+#include <string.h>
+
+#include <Servo.h>
+#include <Wire.h>
+
+
+#include "ExternalFs.h"
+#include "Interpreter.h" 3
+#include "JointController.h"
+#include "Motion.h"
+#include "MotionBake.h"
+#include "MotionCache.h"
+#include "MotionController.h"
+#include "MotionStore.h"
+#include "Parser.h"
+#include "Pin.h"
+#include "Profiler.h"
+#include "Protocol.h"
+#include "System.h"
+#include "Trace.h"
+#include "TrajectoryStream.h"
+
+
+#if ENSOUL_PLEN2
+#include "AccelerationGyroSensor.h"
+#include "Soul.h"
+#endif
+
+using namespace PLEN2;
+
+/*!
+        Core instances
+*/
+JointController joint_ctrl;
+MotionController motion_ctrl(joint_ctrl);
+Interpreter interpreter(motion_ctrl);
+TrajectoryStream trajectory_stream;
+
+#if ENSOUL_PLEN2
+AccelerationGyroSensor sensor;
+Soul soul(sensor, motion_ctrl);
+#endif
+
+namespace {
+
+/*!
+        The application instance
+*/
+class Application : public Protocol {
+private:
+  static void (Application::*CONTROLLER_EVENT_HANDLER[])();
+  static void (Application::*INTERPRETER_EVENT_HANDLER[])();
+  static void (Application::*SETTER_EVENT_HANDLER[])();
+  static void (Application::*GETTER_EVENT_HANDLER[])();
+
+  static void (Application::**EVENT_HANDLER[])();
+
+  Motion::Header m_header_tmp;
+  Motion::Frame m_frame_tmp;
+  Interpreter::Code m_code_tmp;
+
+  void applyDiff() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::applyDiff()"));
+
+    System::debugSerial().print(F(">>> joint_id : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
+
+    System::debugSerial().print(F(">>> angle_diff : "));
+    System::debugSerial().println(Utility::hexbytes2int(m_buffer.data + 2, 3));
+#endif
+
+    joint_ctrl.setAngleDiff(Utility::hexbytes2uint(m_buffer.data, 2),
+                            Utility::hexbytes2int(m_buffer.data + 2, 3));
+    joint_ctrl.publish();
+  }
+
+  void apply() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::apply()"));
+
+    System::debugSerial().print(F(">>> joint_id : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
+
+    System::debugSerial().print(F(">>> angle : "));
+    System::debugSerial().println(Utility::hexbytes2int(m_buffer.data + 2, 3));
+#endif
+
+    joint_ctrl.setAngle(Utility::hexbytes2uint(m_buffer.data, 2),
+                        Utility::hexbytes2int(m_buffer.data + 2, 3));
+    joint_ctrl.publish();
+  }
+
+  void homePosition() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::homePosition()"));
+#endif
+
+    joint_ctrl.applyHomePose();
+  }
+
+  void playMotion() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::playMotion()"));
+
+    System::debugSerial().print(F(">>> slot : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
+#endif
+
+    motion_ctrl.play(Utility::hexbytes2uint(m_buffer.data, 2));
+  }
+
+  void stopMotion() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::stopMotion()"));
+#endif
+
+    motion_ctrl.willStop();
+  }
+
+  void popCode() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::popCode()"));
+#endif
+
+    interpreter.popCode();
+  }
+
+  void pushCode() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::pushCode()"));
+
+    System::debugSerial().print(F(">>> slot : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
+
+    System::debugSerial().print(F(">>> loop_count : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data + 2, 2));
+#endif
+
+    m_code_tmp.slot = Utility::hexbytes2uint(m_buffer.data, 2);
+    m_code_tmp.loop_count = Utility::hexbytes2uint(m_buffer.data + 2, 2) - 1;
+
+    interpreter.pushCode(m_code_tmp);
+  }
+
+  void resetInterpreter() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::resetInterpreter()"));
+#endif
+
+    interpreter.reset();
+  }
+
+  void setHome() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::setHome()"));
+
+    System::debugSerial().print(F(">>> joint_id : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
+
+    System::debugSerial().print(F(">>> angle : "));
+    System::debugSerial().println(Utility::hexbytes2int(m_buffer.data + 2, 3));
+#endif
+
+    joint_ctrl.setHomeAngle(Utility::hexbytes2uint(m_buffer.data, 2),
+                            Utility::hexbytes2int(m_buffer.data + 2, 3));
+  }
+
+  void setJointSettings() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::setJointSettings()"));
+#endif
+
+    joint_ctrl.resetSettings();
+  }
+
+  void setMax() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::setMax()"));
+
+    System::debugSerial().print(F(">>> joint_id : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
+
+    System::debugSerial().print(F(">>> angle : "));
+    System::debugSerial().println(Utility::hexbytes2int(m_buffer.data + 2, 3));
+#endif
+
+    joint_ctrl.setMaxAngle(Utility::hexbytes2uint(m_buffer.data, 2),
+                           Utility::hexbytes2int(m_buffer.data + 2, 3));
+  }
+
+  void setMotionFrame() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::setMotionFrame()"));
+
+    System::debugSerial().print(F(">>> slot : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
+
+    System::debugSerial().print(F(">>> frame_id : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data + 2, 2));
+
+    System::debugSerial().print(F(">>> transition_time_ms : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data + 4, 4));
+
+    for (int device_id = 0; device_id < JointController::SUM; device_id++) {
+      System::debugSerial().print(F(">>> output["));
+      System::debugSerial().print(device_id);
+      System::debugSerial().print(F("] : "));
+      System::debugSerial().println(
+          Utility::hexbytes2int(m_buffer.data + 8 + device_id * 4, 4));
+    }
+#endif
+
+    m_frame_tmp.transition_time_ms =
+        Utility::hexbytes2uint(m_buffer.data + 4, 4);
+
+    for (char device_id = 0; device_id < JointController::SUM; device_id++) {
+      m_frame_tmp.joint_angle[device_id] =
+          Utility::hexbytes2int(m_buffer.data + 8 + device_id * 4, 4);
+    }
+
+    if (m_installing) {
+      if (m_frame_tmp.index < m_header_tmp.frame_length) {
+        Motion::Installation::append(m_frame_tmp);
+        m_frame_tmp.index++;
+      }
+
+      if (m_frame_tmp.index == m_header_tmp.frame_length) {
+        Motion::Installation::commit();
+        m_installing = false;
+      } else {
+        readByte('>');
+        accept();
+        transitState();
+
+        readByte('m');
+        readByte('f');
+        accept();
+        transitState();
+
+        readByte('0'); // dummy
+        readByte('0'); // dummy
+        readByte('0'); // dummy
+        readByte('0'); // dummy
+      }
+    } else {
+      m_frame_tmp.index = Utility::hexbytes2uint(m_buffer.data + 2, 2);
+      m_frame_tmp.set(Utility::hexbytes2uint(m_buffer.data, 2));
+    }
+  }
+
+  void setMotionHeader() {
+    strncpy(m_header_tmp.name, m_buffer.data + 2, 20);
+    m_header_tmp.name[20] = '\0';
+    m_buffer.data[2] = '\0';
+
+    if (!(m_parser[ARGUMENTS_INCOMING]->parse(m_buffer.data)) ||
+        !(m_parser[ARGUMENTS_INCOMING]->parse(m_buffer.data + 22))) {
+      return;
+    }
+
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::setMotionHeader()"));
+
+    System::debugSerial().print(F(">>> slot : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
+
+    System::debugSerial().print(F(">>> name : "));
+    System::debugSerial().println(m_header_tmp.name);
+
+    System::debugSerial().print(F(">>> func : "));
+    System::debugSerial().println(
+        Utility::hexbytes2uint(m_buffer.data + 22, 2));
+
+    System::debugSerial().print(F(">>> arg0 : "));
+    System::debugSerial().println(
+        Utility::hexbytes2uint(m_buffer.data + 24, 2));
+
+    System::debugSerial().print(F(">>> arg1 : "));
+    System::debugSerial().println(
+        Utility::hexbytes2uint(m_buffer.data + 26, 2));
+
+    System::debugSerial().print(F(">>> frame_length : "));
+    System::debugSerial().println(
+        Utility::hexbytes2uint(m_buffer.data + 28, 2));
+#endif
+
+    m_header_tmp.slot = Utility::hexbytes2uint(m_buffer.data, 2);
+    m_header_tmp.frame_length = Utility::hexbytes2uint(m_buffer.data + 28, 2);
+
+    /*!
+            @note
+            The upper nibble of "func" selects the interpolation profile,
+            so old clients that send 0 to 2 keep linear interpolation.
+    */
+    const unsigned char func = Utility::hexbytes2uint(m_buffer.data + 22, 2);
+    const unsigned char interpolation = (func >> 4);
+
+    m_header_tmp.interpolation =
+        (interpolation < Motion::Header::INTERPOLATION_SUM)
+            ? interpolation
+            : static_cast<unsigned char>(
+                  Motion::Header::INTERPOLATION_LINEAR);
+
+    switch (func & 0x0F) {
+    case 0: {
+      m_header_tmp.use_loop = 0;
+      m_header_tmp.use_jump = 0;
+
+      break;
+    }
+
+    case 1: {
+      m_header_tmp.use_loop = 1;
+      m_header_tmp.use_jump = 0;
+      m_header_tmp.loop_begin = Utility::hexbytes2uint(m_buffer.data + 24, 2);
+      m_header_tmp.loop_end = Utility::hexbytes2uint(m_buffer.data + 26, 2);
+
+      break;
+    }
+
+    case 2: {
+      m_header_tmp.use_loop = 0;
+      m_header_tmp.use_jump = 1;
+      m_header_tmp.jump_slot = Utility::hexbytes2uint(m_buffer.data + 24, 2);
+
+      break;
+    }
+    }
+
+    /*!
+            @note
+            An installed motion replaces the old one after its last frame
+            arrived, so an installation broken halfway leaves the old one.
+    */
+    if (m_installing == true) {
+      Motion::Installation::begin(m_header_tmp);
+
+      readByte('>');
+      accept();
+      transitState();
+
+      readByte('m');
+      readByte('f');
+      accept();
+      transitState();
+
+      readByte('0'); // dummy
+      readByte('0'); // dummy
+      readByte('0'); // dummy
+      readByte('0'); // dummy
+
+      m_frame_tmp.index = 0;
+    } else {
+      m_header_tmp.set();
+    }
+  }
+
+  void setMin() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::setMin()"));
+
+    System::debugSerial().print(F(">>> joint_id : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
+
+    System::debugSerial().print(F(">>> angle : "));
+    System::debugSerial().println(Utility::hexbytes2int(m_buffer.data + 2, 3));
+#endif
+
+    joint_ctrl.setMinAngle(Utility::hexbytes2uint(m_buffer.data, 2),
+                           Utility::hexbytes2int(m_buffer.data + 2, 3));
+  }
+
+  void getJointSettings() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::getJointSettings()"));
+#endif
+
+    joint_ctrl.dump();
+  }
+
+  void getMotion() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::getMotion()"));
+
+    System::debugSerial().print(F(">>> slot : "));
+    System::debugSerial().println(Utility::hexbytes2uint(m_buffer.data, 2));
+#endif
+
+    motion_ctrl.dump(Utility::hexbytes2uint(m_buffer.data, 2));
+  }
+
+  void getVersionInformation() {
+#if DEBUG_LESS
+    volatile Utility::Profiler p(F("Application::getVersionInformation()"));
+#endif
+
+    System::dump();
+  }
+
+public:
+  virtual void afterHook() {
+    TRACE_SCOPE("Application::afterFook()");
+
+    if (m_state == HEADER_INCOMING) {
+      unsigned char header_id = m_parser[HEADER_INCOMING]->index();
+      unsigned char cmd_id = m_parser[COMMAND_INCOMING]->index();
+
+      (this->*EVENT_HANDLER[header_id][cmd_id])();
+
+#if ENSOUL_PLEN2
+      soul.userActionInputed();
+#endif
+    }
+  }
+};
+
+void (Application::*Application::CONTROLLER_EVENT_HANDLER[])() = {
+    &Application::applyDiff,    &Application::apply,
+    &Application::homePosition, &Application::playMotion,
+    &Application::stopMotion,   &Application::playMotion,
+    &Application::stopMotion};
+
+void (Application::*Application::INTERPRETER_EVENT_HANDLER[])() = {
+    &Application::popCode, &Application::pushCode,
+    &Application::resetInterpreter};
+
+void (Application::*Application::SETTER_EVENT_HANDLER[])() = {
+    &Application::setHome,
+    &Application::setMotionHeader, // sanity check.
+    &Application::setJointSettings,
+    &Application::setMax,
+    &Application::setMotionFrame,
+    &Application::setMotionHeader,
+    &Application::setMin};
+
+void (Application::*Application::GETTER_EVENT_HANDLER[])() = {
+    &Application::getJointSettings, &Application::getMotion,
+    &Application::getVersionInformation};
+
+void (Application::**Application::EVENT_HANDLER[])() = {
+    Application::CONTROLLER_EVENT_HANDLER,
+    Application::INTERPRETER_EVENT_HANDLER, Application::SETTER_EVENT_HANDLER,
+    Application::GETTER_EVENT_HANDLER};
+
+Application app;
+
+#if ENSOUL_PLEN2
+/*!
+        @brief Read a sensor that a frame waits for
+
+        @param [in] sensor_id Acc X, Y, Z, gyro roll, pitch and yaw in order.
+*/
+int readSensor(unsigned char sensor_id) {
+  sensor.sampling();
+
+  switch (sensor_id) {
+  case 0:
+    return sensor.getAccX();
+  case 1:
+    return sensor.getAccY();
+  case 2:
+    return sensor.getAccZ();
+  case 3:
+    return sensor.getGyroRoll();
+  case 4:
+    return sensor.getGyroPitch();
+  case 5:
+    return sensor.getGyroYaw();
+  default:
+    return 0;
+  }
+}
+#endif
+
+/*!
+        @brief Send the events of frames to the host
+
+        Each event is a line of JSON, written to the serial and the TCP client.
+*/
+void sendMotionEvents() {
+  MotionController::Event event;
+
+  while (motion_ctrl.popEvent(event)) {
+    String line = "{\"event\":" + String(event.code);
+    line += ",\"slot\":" + String(event.slot);
+    line += ",\"frame\":" + String(event.index);
+    line += ",\"ms\":" + String(event.time_ms) + "}";
+
+    PLEN2::System::outputSerial().println(line);
+    PLEN2::System::tcp_println(line);
+  }
+}
+} // namespace
+
+/*!
+        @brief Setup
+
+        Put your setup code here, to run once:
+
+        @attention
+        Digital pin's output is an indefinite if you don't give an initialize
+   value. Please ensure that setup the pins which are configurable.
+*/
+void setup() {
+  volatile PLEN2::System system;
+  ExternalFs::init();
+  MotionStore::init();
+
+  joint_ctrl.Init();
+  joint_ctrl.loadSettings();
+  MotionBake::init();
+
+#if ENSOUL_PLEN2
+  motion_ctrl.setSensorReader(readSensor);
+#endif
+  System::setup_smartconfig();
+
+  // Walking motions (slot 0 to 2) are queued over and over, so keep them in RAM.
+  for (unsigned char slot = 0; slot < 3; slot++) {
+    MotionCache::pin(slot, true);
+  }
+
+#if ENSOUL_PLEN2
+  /*!
+          @attention
+          The order of power supplied or firmware startup timing is base-board,
+     head-board. If the sampling method calls from early timing, program freezes
+     because synchronism of communication is missed. (Generally, it is going to
+     success setup() inserts 3000[msec] delays.)
+  */
+  //		delay(3000);
+#endif
+
+#if DEBUG
+  while (!Serial)
+    ;
+
+  PLEN2::System::outputSerial().println(
+      F("Hello, I am ViVi! My system is up and running ver.1.0.1, Let me walk "
+        ":)"));
+#endif
+}
+
+/*!
+        @brief Main polling loop
+
+        Put your main code here, to run repeatedly:
+*/
+void loop() {
+  if (trajectory_stream.active()) {
+    // Setpoints streamed by the host take the body over from motions.
+    if (motion_ctrl.playing()) {
+      motion_ctrl.stop();
+    }
+
+    if (motion_ctrl.frameUpdatable()) {
+      int angles[JointController::SUM];
+
+      if (trajectory_stream.sample(micros(), angles)) {
+        motion_ctrl.updatePose(angles);
+      }
+    }
+  } else if (motion_ctrl.playing()) {
+    if (motion_ctrl.frameUpdatable()) {
+      motion_ctrl.updateFrame();
+    }
+
+    // Start the next queued motion early, so the two crossfade.
+    if (interpreter.ready() && motion_ctrl.blendable()) {
+      interpreter.popCode();
+    }
+
+    if (motion_ctrl.updatingFinished()) {
+      if (motion_ctrl.nextFrameLoadable()) {
+        motion_ctrl.loadNextFrame();
+      } else {
+        motion_ctrl.stop();
+
+        if (interpreter.ready()) {
+          interpreter.popCode();
+        }
+      }
+    }
+
+    // Read the frames to come between updates, so a boundary never waits.
+    if (!motion_ctrl.frameUpdatable()) {
+      motion_ctrl.prefetch();
+    }
+
+    sendMotionEvents();
+  } else if (motion_ctrl.layerPlaying()) {
+    // Layers step by themselves in updateFrame(), without a body motion.
+    if (motion_ctrl.frameUpdatable()) {
+      motion_ctrl.updateFrame();
+    } else {
+      motion_ctrl.prefetch();
+    }
+  }
+
+  if (PLEN2::System::SystemSerial().available()) {
+    app.readByte(PLEN2::System::SystemSerial().read());
+
+    if (app.accept()) {
+      app.transitState();
+    }
+  }
+  /*!
+          @note
+          Binary packets of the stream are read at once, so 50 Hz of setpoints
+          never wait for the loop. A byte of the text protocol ends the burst.
+  */
+  for (int count = 0; count < TrajectoryStream::PACKET_LENGTH; count++) {
+    if (!PLEN2::System::tcp_available()) {
+      break;
+    }
+
+    uint8_t c = PLEN2::System::tcp_read();
+
+    if (trajectory_stream.readByte(c)) {
+      continue;
+    }
+
+#if DEBUG_LESS
+    PLEN2::System::outputSerial().write(c);
+#endif
+    app.readByte(c);
+
+    if (app.accept()) {
+      app.transitState();
+    }
+
+    break;
+  }
+
+  PLEN2::System::handleClient();
+  joint_ctrl.updateSettings();
+#if ENSOUL_PLEN2
+  soul.log();
+  soul.action();
+#endif
+}
@@ -0,0 +1,83 @@
+/*!
+	@file      HostTest.h
+	@brief     Checks and timers of the host tests.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <chrono>
+#include <stdio.h>
+
+
+namespace HostTest
+{
+	extern unsigned long checks;
+	extern unsigned long failures;
+
+	/*!
+		@brief Count a check, and report it if failed
+
+		@return Result of the check
+	*/
+	inline bool check(bool result, const char* expression, const char* file, int line)
+	{
+		checks++;
+
+		if (!result)
+		{
+			failures++;
+			printf("%s:%d: check failed: %s\n", file, line, expression);
+		}
+
+		return result;
+	}
+
+	/*!
+		@brief Report the checks
+
+		@return Exit status of the test
+	*/
+	inline int finish()
+	{
+		printf("%lu checks, %lu failures\n", checks, failures);
+
+		return (failures == 0)? 0 : 1;
+	}
+
+	/*!
+		@brief Stopwatch of the benchmarks
+	*/
+	class Stopwatch
+	{
+	public:
+		Stopwatch() : m_begin(std::chrono::steady_clock::now()) {}
+
+		//! @brief Get time elapsed [nsec]
+		double elapsedNs() const
+		{
+			return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - m_begin).count();
+		}
+
+	private:
+		std::chrono::steady_clock::time_point m_begin;
+	};
+}
+
+/*!
+	@brief Check an expression, and go on if it failed
+*/
+#define CHECK(EXPRESSION) HostTest::check((EXPRESSION), #EXPRESSION, __FILE__, __LINE__)
+
+/*!
+	@brief Define the counters of the checks (Please put it once in a test.)
+*/
+#define HOST_TEST_MAIN() \
+	unsigned long HostTest::checks   = 0; \
+	unsigned long HostTest::failures = 0
+
+#endif // HOST_TEST_H
@@ -0,0 +1,446 @@
+/*!
+	@file      MotionJson.h
+	@brief     Reader of the motion files in data/, for the host tests.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef HOST_MOTION_JSON_H
+#define HOST_MOTION_JSON_H
+
+#include <algorithm>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Motion.h"
+
+
+namespace MotionJson
+{
+	/*!
+		@brief Value of JSON
+
+		It has only what the motion files use: objects, arrays, strings, integers and literals.
+	*/
+	class Value
+	{
+	public:
+		enum {
+			TYPE_NULL,
+			TYPE_NUMBER,
+			TYPE_STRING,
+			TYPE_ARRAY,
+			TYPE_OBJECT
+		};
+
+		int type;
+		long number;
+		std::string string;
+		std::vector<Value> items;
+		std::vector<std::pair<std::string, Value> > members;
+
+		Value() : type(TYPE_NULL), number(0) {}
+
+		//! @brief Get a member, or the null value if the object doesn't have it
+		const Value& operator[](const char* key) const
+		{
+			static const Value null_value;
+
+			for (size_t index = 0; index < members.size(); index++)
+			{
+				if (members[index].first == key)
+				{
+					return members[index].second;
+				}
+			}
+
+			return null_value;
+		}
+	};
+
+	/*!
+		@brief Parser of JSON text
+	*/
+	class Parser
+	{
+	public:
+		explicit Parser(const std::string& text) : m_text(text), m_position(0) {}
+
+		//! @brief Parse the whole text
+		bool parse(Value& value)
+		{
+			return m_value(value) && (m_skip(), m_position == m_text.size());
+		}
+
+	private:
+		const std::string& m_text;
+		size_t m_position;
+
+		void m_skip()
+		{
+			while ((m_position < m_text.size()) && strchr(" \t\r\n", m_text[m_position]))
+			{
+				m_position++;
+			}
+		}
+
+		bool m_accept(char c)
+		{
+			m_skip();
+
+			if ((m_position < m_text.size()) && (m_text[m_position] == c))
+			{
+				m_position++;
+
+				return true;
+			}
+
+			return false;
+		}
+
+		bool m_string(std::string& result)
+		{
+			if (!m_accept('"'))
+			{
+				return false;
+			}
+
+			result.clear();
+
+			while (m_position < m_text.size())
+			{
+				const char c = m_text[m_position++];
+
+				if (c == '"')
+				{
+					return true;
+				}
+
+				if (c == '\\')
+				{
+					if (m_position >= m_text.size())
+					{
+						return false;
+					}
+
+					const char escaped = m_text[m_position++];
+					result += (escaped == 'n')? '\n' : ((escaped == 't')? '\t' : escaped);
+				}
+				else
+				{
+					result += c;
+				}
+			}
+
+			return false;
+		}
+
+		bool m_value(Value& value)
+		{
+			m_skip();
+
+			if (m_position >= m_text.size())
+			{
+				return false;
+			}
+
+			const char c = m_text[m_position];
+
+			if (c == '{')
+			{
+				m_position++;
+				value.type = Value::TYPE_OBJECT;
+
+				if (m_accept('}'))
+				{
+					return true;
+				}
+
+				do
+				{
+					std::pair<std::string, Value> member;
+
+					if (!m_string(member.first) || !m_accept(':') || !m_value(member.second))
+					{
+						return false;
+					}
+
+					value.members.push_back(member);
+				} while (m_accept(','));
+
+				return m_accept('}');
+			}
+
+			if (c == '[')
+			{
+				m_position++;
+				value.type = Value::TYPE_ARRAY;
+
+				if (m_accept(']'))
+				{
+					return true;
+				}
+
+				do
+				{
+					value.items.push_back(Value());
+
+					if (!m_value(value.items.back()))
+					{
+						return false;
+					}
+				} while (m_accept(','));
+
+				return m_accept(']');
+			}
+
+			if (c == '"')
+			{
+				value.type = Value::TYPE_STRING;
+
+				return m_string(value.string);
+			}
+
+			if ((c == '-') || ((c >= '0') && (c <= '9')))
+			{
+				char* end;
+				value.type   = Value::TYPE_NUMBER;
+				value.number = strtol(m_text.c_str() + m_position, &end, 10);
+				m_position   = end - m_text.c_str();
+
+				return true;
+			}
+
+			static const char* const LITERALS[] = { "null", "true", "false" };
+
+			for (int index = 0; index < 3; index++)
+			{
+				if (m_text.compare(m_position, strlen(LITERALS[index]), LITERALS[index]) == 0)
+				{
+					m_position  += strlen(LITERALS[index]);
+					value.type   = (index == 0)? Value::TYPE_NULL : Value::TYPE_NUMBER;
+					value.number = (index == 1)? 1 : 0;
+
+					return true;
+				}
+			}
+
+			return false;
+		}
+	};
+
+	/*!
+		@brief Joint of a device, or -1
+
+		Refer to "device_map.json" of the control server.
+	*/
+	inline int jointId(const std::string& device)
+	{
+		static const char* const DEVICES[] = {
+			"shoulder_pitch", "thigh_yaw", "shoulder_roll", "elbow_roll", "thigh_roll",
+			"thigh_pitch", "knee_pitch", "foot_pitch", "foot_roll"
+		};
+
+		int side;
+
+		if (device.compare(0, 5, "left_") == 0)
+		{
+			side = 0;
+		}
+		else if (device.compare(0, 6, "right_") == 0)
+		{
+			side = 12;
+		}
+		else
+		{
+			return -1;
+		}
+
+		const std::string part = device.substr(device.find('_') + 1);
+
+		for (int index = 0; index < 9; index++)
+		{
+			if (part == DEVICES[index])
+			{
+				return side + index;
+			}
+		}
+
+		return -1;
+	}
+
+	/*!
+		@brief Motion read from a file
+	*/
+	class MotionFile
+	{
+	public:
+		std::string path;
+		size_t      text_size; //!< Size of the file.
+		PLEN2::Motion::Header header;
+		std::vector<PLEN2::Motion::Frame> frames;
+	};
+
+	/*!
+		@brief Read a motion file
+
+		The frames are cleared to home before their outputs are read.
+
+		@return Result
+	*/
+	inline bool load(const std::string& path, MotionFile& motion)
+	{
+		FILE* fp = fopen(path.c_str(), "rb");
+
+		if (fp == NULL)
+		{
+			return false;
+		}
+
+		std::string text;
+		char buffer[4096];
+
+		for (size_t size; (size = fread(buffer, 1, sizeof(buffer), fp)) != 0; )
+		{
+			text.append(buffer, size);
+		}
+
+		fclose(fp);
+
+		Value root;
+
+		if (!Parser(text).parse(root) || (root.type != Value::TYPE_OBJECT))
+		{
+			return false;
+		}
+
+		motion.path      = path;
+		motion.text_size = text.size();
+		motion.frames.clear();
+
+		PLEN2::Motion::Header& header = motion.header;
+		memset(&header, 0, sizeof(header));
+		header.init();
+		header.slot         = static_cast<unsigned char>(root["slot"].number);
+		header.frame_length = static_cast<unsigned short>(root["frames"].items.size());
+		strncpy(header.name, root["name"].string.c_str(), PLEN2::Motion::Header::NAME_LENGTH - 1);
+
+		const std::vector<Value>& codes = root["codes"].items;
+
+		for (size_t index = 0; index < codes.size(); index++)
+		{
+			const std::vector<Value>& arguments = codes[index]["arguments"].items;
+
+			if ((codes[index]["method"].string == "loop") && (arguments.size() == 3))
+			{
+				header.use_loop   = 1;
+				header.loop_begin = static_cast<unsigned short>(arguments[0].number);
+				header.loop_end   = static_cast<unsigned short>(arguments[1].number);
+				header.loop_count = static_cast<unsigned char>(arguments[2].number);
+			}
+			else if ((codes[index]["method"].string == "jump") && (arguments.size() == 1))
+			{
+				header.use_jump  = 1;
+				header.jump_slot = static_cast<unsigned char>(arguments[0].number);
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		const std::vector<Value>& frames = root["frames"].items;
+
+		for (size_t index = 0; index < frames.size(); index++)
+		{
+			PLEN2::Motion::Frame frame;
+			memset(&frame, 0, sizeof(frame));
+			frame.index              = static_cast<unsigned short>(index);
+			frame.transition_time_ms = static_cast<unsigned int>(frames[index]["transition_time_ms"].number);
+
+			const std::vector<Value>& outputs = frames[index]["outputs"].items;
+
+			for (size_t output = 0; output < outputs.size(); output++)
+			{
+				const int joint_id = jointId(outputs[output]["device"].string);
+
+				if (joint_id < 0)
+				{
+					return false;
+				}
+
+				frame.joint_angle[joint_id] = static_cast<int>(outputs[output]["value"].number);
+			}
+
+			motion.frames.push_back(frame);
+		}
+
+		return true;
+	}
+
+	//! @brief Get paths of the motion files in the directory, in order of their names
+	inline std::vector<std::string> paths(const char* directory = "data")
+	{
+		std::vector<std::string> result;
+		DIR* dir = opendir(directory);
+
+		if (dir == NULL)
+		{
+			return result;
+		}
+
+		for (dirent* entry; (entry = readdir(dir)) != NULL; )
+		{
+			const std::string name = entry->d_name;
+
+			if ((name.size() > 5) && (name.compare(name.size() - 5, 5, ".json") == 0))
+			{
+				result.push_back(std::string(directory) + "/" + name);
+			}
+		}
+
+		closedir(dir);
+		std::sort(result.begin(), result.end());
+
+		return result;
+	}
+
+	//! @brief Decide the frames are the same, except the padding
+	inline bool sameFrame(const PLEN2::Motion::Frame& lhs, const PLEN2::Motion::Frame& rhs)
+	{
+		return (lhs.index == rhs.index)
+			&& (lhs.transition_time_ms == rhs.transition_time_ms)
+			&& (memcmp(lhs.joint_angle, rhs.joint_angle, sizeof(lhs.joint_angle)) == 0)
+			&& (lhs.events == rhs.events)
+			&& (lhs.event_code == rhs.event_code)
+			&& (lhs.sensor_id == rhs.sensor_id)
+			&& (lhs.sensor_condition == rhs.sensor_condition)
+			&& (lhs.sensor_threshold == rhs.sensor_threshold)
+			&& (lhs.hold_timeout_ms == rhs.hold_timeout_ms);
+	}
+
+	//! @brief Decide the headers are the same, except the padding and the events gathered
+	inline bool sameHeader(const PLEN2::Motion::Header& lhs, const PLEN2::Motion::Header& rhs)
+	{
+		return (lhs.slot == rhs.slot)
+			&& (strncmp(lhs.name, rhs.name, PLEN2::Motion::Header::NAME_LENGTH) == 0)
+			&& (lhs.frame_length == rhs.frame_length)
+			&& (lhs.interpolation == rhs.interpolation)
+			&& (lhs.use_extra == rhs.use_extra)
+			&& (lhs.use_jump == rhs.use_jump)
+			&& (lhs.use_loop == rhs.use_loop)
+			&& (lhs.loop_begin == rhs.loop_begin)
+			&& (lhs.loop_end == rhs.loop_end)
+			&& (lhs.loop_count == rhs.loop_count)
+			&& (lhs.jump_slot == rhs.jump_slot);
+	}
+}
+
+#endif // HOST_MOTION_JSON_H
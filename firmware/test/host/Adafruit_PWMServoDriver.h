@@ -0,0 +1,46 @@
+/*!
+	@file      Adafruit_PWMServoDriver.h
+	@brief     PCA9685 driver of the host build, that writes through the fake Wire.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef HOST_ADAFRUIT_PWM_SERVO_DRIVER_H
+#define HOST_ADAFRUIT_PWM_SERVO_DRIVER_H
+
+#include "Arduino.h"
+#include "Wire.h"
+
+
+/*!
+	@brief PCA9685 driver
+
+	setPWM() sends a transaction for a channel as the library does,
+	so the cost of the former per-joint output is measured on the same bus.
+*/
+class Adafruit_PWMServoDriver
+{
+public:
+	Adafruit_PWMServoDriver(uint8_t address = 0x40) : m_address(address) {}
+
+	void begin() {}
+	void setPWMFreq(float) {}
+
+	void setPWM(uint8_t channel, uint16_t on, uint16_t off)
+	{
+		Wire.beginTransmission(m_address);
+		Wire.write(0x06 + 4 * channel);
+		Wire.write(lowByte(on));
+		Wire.write(highByte(on));
+		Wire.write(lowByte(off));
+		Wire.write(highByte(off));
+		Wire.endTransmission();
+	}
+
+private:
+	uint8_t m_address;
+};
+
+#endif // HOST_ADAFRUIT_PWM_SERVO_DRIVER_H
@@ -0,0 +1,376 @@
+/*!
+	@file      Arduino.h
+	@brief     Arduino core of the host build, that runs the firmware modules on a PC.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define PROGMEM
+#define PSTR(STR) (STR)
+
+class __FlashStringHelper;
+
+#define F(STR)     (reinterpret_cast<const __FlashStringHelper*>(STR))
+#define FPSTR(STR) (reinterpret_cast<const __FlashStringHelper*>(STR))
+
+#define pgm_read_byte(ADDRESS)  (*reinterpret_cast<const uint8_t*>(ADDRESS))
+#define pgm_read_word(ADDRESS)  (*reinterpret_cast<const uint16_t*>(ADDRESS))
+#define pgm_read_dword(ADDRESS) (*reinterpret_cast<const uint32_t*>(ADDRESS))
+
+#define memcpy_P  memcpy
+#define strcpy_P  strcpy
+#define strlen_P  strlen
+#define strcmp_P  strcmp
+#define strncmp_P strncmp
+
+#define lowByte(W)  (static_cast<uint8_t>((W) & 0xFF))
+#define highByte(W) (static_cast<uint8_t>((W) >> 8))
+
+#define constrain(AMT, LOW_, HIGH_) ((AMT) < (LOW_)? (LOW_) : ((AMT) > (HIGH_)? (HIGH_) : (AMT)))
+
+#define HIGH 1
+#define LOW  0
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+
+#define A0 17
+
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+/*
+	Time of the host build is a clock of the test, that starts at 0 and advances only by Host::advance().
+	(delay() advances it too.) So the modules see the same time in every run.
+*/
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+/*
+	Interruptions of the host build are a lock shared by the threads,
+	so the section between them excludes the other thread as it excludes the Ticker on the board.
+*/
+void noInterrupts();
+void interrupts();
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+long random(long max_value);
+long random(long min_value, long max_value);
+void randomSeed(unsigned long seed);
+
+inline bool isDigit(int c)             { return isdigit(c) != 0; }
+inline bool isHexadecimalDigit(int c)  { return isxdigit(c) != 0; }
+inline bool isAlpha(int c)             { return isalpha(c) != 0; }
+inline bool isSpace(int c)             { return isspace(c) != 0; }
+
+
+class String
+{
+public:
+	String() {}
+	String(const char* value) : m_string(value? value : "") {}
+	String(const std::string& value) : m_string(value) {}
+	String(const __FlashStringHelper* value) : m_string(value? reinterpret_cast<const char*>(value) : "") {}
+	explicit String(char value) : m_string(1, value) {}
+	explicit String(unsigned char value, unsigned char base = 10) { m_number(value, base); }
+	explicit String(int value, unsigned char base = 10) { m_signed(value, base); }
+	explicit String(unsigned int value, unsigned char base = 10) { m_number(value, base); }
+	explicit String(long value, unsigned char base = 10) { m_signed(value, base); }
+	explicit String(unsigned long value, unsigned char base = 10) { m_number(value, base); }
+	explicit String(double value, unsigned char digits = 2)
+	{
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+		m_string = buffer;
+	}
+
+	const char* c_str() const { return m_string.c_str(); }
+	unsigned int length() const { return m_string.size(); }
+	char operator[](unsigned int index) const { return m_string[index]; }
+	char charAt(unsigned int index) const { return m_string[index]; }
+
+	String& operator+=(const String& value) { m_string += value.m_string; return *this; }
+	String& operator+=(const char* value) { m_string += value; return *this; }
+	String& operator+=(char value) { m_string += value; return *this; }
+	String& operator+=(int value) { return *this += String(value); }
+	String& operator+=(unsigned int value) { return *this += String(value); }
+	String& operator+=(long value) { return *this += String(value); }
+	String& operator+=(unsigned long value) { return *this += String(value); }
+
+	bool concat(const String& value) { m_string += value.m_string; return true; }
+	bool concat(const char* value) { m_string += value; return true; }
+	bool concat(char value) { m_string += value; return true; }
+
+	bool operator==(const String& value) const { return m_string == value.m_string; }
+	bool operator==(const char* value) const { return m_string == value; }
+	bool operator!=(const String& value) const { return m_string != value.m_string; }
+	bool operator!=(const char* value) const { return m_string != value; }
+
+	long toInt() const { return atol(m_string.c_str()); }
+	float toFloat() const { return static_cast<float>(atof(m_string.c_str())); }
+
+	int indexOf(char value, unsigned int from = 0) const { return m_index(m_string.find(value, from)); }
+	int indexOf(const String& value, unsigned int from = 0) const { return m_index(m_string.find(value.m_string, from)); }
+	int lastIndexOf(char value) const { return m_index(m_string.rfind(value)); }
+
+	String substring(unsigned int begin) const { return (begin < m_string.size())? String(m_string.substr(begin)) : String(); }
+	String substring(unsigned int begin, unsigned int end) const { return (begin < end)? String(m_string.substr(begin, end - begin)) : String(); }
+
+	bool startsWith(const String& prefix) const { return m_string.compare(0, prefix.m_string.size(), prefix.m_string) == 0; }
+	bool endsWith(const String& suffix) const
+	{
+		return (m_string.size() >= suffix.m_string.size())
+			&& (m_string.compare(m_string.size() - suffix.m_string.size(), suffix.m_string.size(), suffix.m_string) == 0);
+	}
+
+	void trim()
+	{
+		const size_t begin = m_string.find_first_not_of(" \t\r\n");
+		const size_t end   = m_string.find_last_not_of(" \t\r\n");
+		m_string = (begin == std::string::npos)? std::string() : m_string.substr(begin, end - begin + 1);
+	}
+
+	void toLowerCase() { for (size_t index = 0; index < m_string.size(); index++) m_string[index] = tolower(m_string[index]); }
+	void toUpperCase() { for (size_t index = 0; index < m_string.size(); index++) m_string[index] = toupper(m_string[index]); }
+	bool reserve(unsigned int size) { m_string.reserve(size); return true; }
+	void remove(unsigned int index) { if (index < m_string.size()) m_string.erase(index); }
+	void remove(unsigned int index, unsigned int count) { if (index < m_string.size()) m_string.erase(index, count); }
+	void replace(const String& from, const String& to)
+	{
+		if (from.m_string.empty())
+		{
+			return;
+		}
+
+		for (size_t index = m_string.find(from.m_string); index != std::string::npos; index = m_string.find(from.m_string, index + to.m_string.size()))
+		{
+			m_string.replace(index, from.m_string.size(), to.m_string);
+		}
+	}
+
+private:
+	static int m_index(size_t position) { return (position == std::string::npos)? -1 : static_cast<int>(position); }
+
+	void m_number(unsigned long value, unsigned char base)
+	{
+		char buffer[72];
+		char* cursor = buffer + sizeof(buffer) - 1;
+		*cursor = '\0';
+
+		if (base < 2)
+		{
+			base = 10;
+		}
+
+		do
+		{
+			const unsigned int digit = value % base;
+			*--cursor = (digit < 10)? ('0' + digit) : ('A' + digit - 10);
+			value /= base;
+		} while (value != 0);
+
+		m_string = cursor;
+	}
+
+	void m_signed(long value, unsigned char base)
+	{
+		if ((base == 10) && (value < 0))
+		{
+			m_number(-static_cast<unsigned long>(value), base);
+			m_string.insert(0, 1, '-');
+		}
+		else
+		{
+			m_number(static_cast<unsigned long>(value), base);
+		}
+	}
+
+	std::string m_string;
+};
+
+inline String operator+(const String& lhs, const String& rhs) { String result(lhs); result += rhs; return result; }
+inline String operator+(const String& lhs, const char* rhs) { String result(lhs); result += rhs; return result; }
+inline String operator+(const char* lhs, const String& rhs) { String result(lhs); result += rhs; return result; }
+inline String operator+(const String& lhs, char rhs) { String result(lhs); result += rhs; return result; }
+inline String operator+(const String& lhs, int rhs) { return lhs + String(rhs); }
+inline String operator+(const String& lhs, unsigned int rhs) { return lhs + String(rhs); }
+inline String operator+(const String& lhs, long rhs) { return lhs + String(rhs); }
+inline String operator+(const String& lhs, unsigned long rhs) { return lhs + String(rhs); }
+inline String operator+(const String& lhs, const __FlashStringHelper* rhs) { return lhs + String(rhs); }
+
+
+/*!
+	@brief Output stream of the host build, that formats as Print of Arduino does
+*/
+class Print
+{
+public:
+	virtual ~Print() {}
+
+	virtual size_t write(uint8_t value) = 0;
+
+	virtual size_t write(const uint8_t* buffer, size_t size)
+	{
+		size_t written = 0;
+
+		while (size-- != 0)
+		{
+			written += write(*buffer++);
+		}
+
+		return written;
+	}
+
+	size_t write(const char* value) { return (value == NULL)? 0 : write(reinterpret_cast<const uint8_t*>(value), strlen(value)); }
+	size_t write(const char* buffer, size_t size) { return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+
+	size_t print(const __FlashStringHelper* value) { return write(reinterpret_cast<const char*>(value)); }
+	size_t print(const String& value) { return write(value.c_str(), value.length()); }
+	size_t print(const char* value) { return write(value); }
+	size_t print(char value) { return write(static_cast<uint8_t>(value)); }
+	size_t print(unsigned char value, int base = DEC) { return print(static_cast<unsigned long>(value), base); }
+	size_t print(int value, int base = DEC) { return print(static_cast<long>(value), base); }
+	size_t print(unsigned int value, int base = DEC) { return print(static_cast<unsigned long>(value), base); }
+	size_t print(long value, int base = DEC) { return print(String(value, base)); }
+	size_t print(unsigned long value, int base = DEC) { return print(String(value, base)); }
+	size_t print(double value, int digits = 2) { return print(String(value, digits)); }
+
+	size_t println() { return write("\r\n"); }
+	template<typename T> size_t println(const T& value) { size_t written = print(value); return written + println(); }
+	template<typename T> size_t println(const T& value, int format) { size_t written = print(value, format); return written + println(); }
+
+	size_t printf(const char* format, ...)
+	{
+		char buffer[256];
+		va_list arguments;
+		va_start(arguments, format);
+		const int length = vsnprintf(buffer, sizeof(buffer), format, arguments);
+		va_end(arguments);
+
+		return (length < 0)? 0 : write(buffer, std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+	}
+
+	virtual void flush() {}
+};
+
+
+/*!
+	@brief Input stream of the host build, that has nothing to read unless a test derives it
+*/
+class Stream : public Print
+{
+public:
+	virtual size_t write(uint8_t) { return 1; }
+	using Print::write;
+
+	virtual int available() { return 0; }
+	virtual int read() { return -1; }
+	virtual int peek() { return -1; }
+
+	size_t readBytes(uint8_t* buffer, size_t size)
+	{
+		size_t count = 0;
+
+		while ((count < size) && (available() > 0))
+		{
+			buffer[count++] = static_cast<uint8_t>(read());
+		}
+
+		return count;
+	}
+
+	size_t readBytes(char* buffer, size_t size) { return readBytes(reinterpret_cast<uint8_t*>(buffer), size); }
+
+	String readStringUntil(char terminator)
+	{
+		String result;
+
+		for (int value = read(); (value >= 0) && (value != terminator); value = read())
+		{
+			result += static_cast<char>(value);
+		}
+
+		return result;
+	}
+
+	void setTimeout(unsigned long) {}
+};
+
+
+class HardwareSerial : public Stream
+{
+public:
+	void begin(unsigned long) {}
+	void end() {}
+	operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+
+class EspClass
+{
+public:
+	uint32_t getChipId() { return 0x00C0FFEE; }
+	uint32_t getFreeHeap() { return 40000; }
+	uint32_t getSketchSize() { return 0x60000; }
+	uint32_t getFlashChipRealSize() { return 0x400000; }
+	uint32_t getCycleCount() { return static_cast<uint32_t>(micros() * 80); }
+	void restart() {}
+	bool flashEraseSector(uint32_t) { return false; }
+	bool flashWrite(uint32_t, uint32_t*, size_t) { return false; }
+	bool flashRead(uint32_t, uint32_t*, size_t) { return false; }
+};
+
+extern EspClass ESP;
+
+
+/*!
+	@brief Controls of the host build, that the tests use
+*/
+namespace Host
+{
+	//! @brief Set time of micros()
+	void setMicros(unsigned long us);
+
+	//! @brief Advance time of micros()
+	void advance(unsigned long us);
+}
+
+#endif // HOST_ARDUINO_H
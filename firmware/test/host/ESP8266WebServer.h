@@ -0,0 +1,10 @@
+/*!
+	@file      ESP8266WebServer.h
+	@brief     Refer to HostNetwork.h.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#include "HostNetwork.h"
@@ -0,0 +1,317 @@
+/*!
+	@file      FS.h
+	@brief     SPIFFS of the host build, that keeps the files in RAM.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+
+enum SeekMode {
+	SeekSet,
+	SeekCur,
+	SeekEnd
+};
+
+
+/*!
+	@brief File in RAM
+
+	Copies of an instance share the same file and the same position, as File of the ESP8266 core does.
+*/
+class File : public Stream
+{
+public:
+	typedef std::vector<uint8_t> Data;
+
+	File() {}
+	File(const std::string& name, const std::shared_ptr<Data>& data, bool append)
+		: m_handle(new Handle())
+	{
+		m_handle->name     = name;
+		m_handle->data     = data;
+		m_handle->position = append? data->size() : 0;
+	}
+
+	operator bool() const { return m_handle && m_handle->data; }
+
+	bool seek(uint32_t position, SeekMode mode = SeekSet)
+	{
+		if (!*this)
+		{
+			return false;
+		}
+
+		const long base = (mode == SeekSet)? 0 : ((mode == SeekCur)? m_handle->position : m_handle->data->size());
+		const long next = base + static_cast<int32_t>(position);
+
+		if ((next < 0) || (static_cast<size_t>(next) > m_handle->data->size()))
+		{
+			return false;
+		}
+
+		m_handle->position = next;
+		m_handle->seeks++;
+
+		return true;
+	}
+
+	size_t position() const { return *this? m_handle->position : 0; }
+	size_t size() const { return *this? m_handle->data->size() : 0; }
+	const char* name() const { return *this? m_handle->name.c_str() : ""; }
+
+	size_t read(uint8_t* buffer, size_t size)
+	{
+		if (!*this)
+		{
+			return 0;
+		}
+
+		const Data& data = *m_handle->data;
+		const size_t count = (m_handle->position < data.size())? std::min(size, data.size() - m_handle->position) : 0;
+
+		memcpy(buffer, data.data() + m_handle->position, count);
+		m_handle->position += count;
+
+		return count;
+	}
+
+	virtual int read()
+	{
+		uint8_t value;
+
+		return (read(&value, 1) == 1)? value : -1;
+	}
+
+	virtual int peek()
+	{
+		return (*this && (m_handle->position < m_handle->data->size()))? (*m_handle->data)[m_handle->position] : -1;
+	}
+
+	virtual int available() { return *this? static_cast<int>(m_handle->data->size() - m_handle->position) : 0; }
+
+	virtual size_t write(uint8_t value) { return write(&value, 1); }
+
+	virtual size_t write(const uint8_t* buffer, size_t size)
+	{
+		if (!*this)
+		{
+			return 0;
+		}
+
+		Data& data = *m_handle->data;
+
+		if (data.size() < m_handle->position + size)
+		{
+			data.resize(m_handle->position + size);
+		}
+
+		memcpy(data.data() + m_handle->position, buffer, size);
+		m_handle->position += size;
+
+		return size;
+	}
+
+	using Stream::write;
+
+	bool truncate(uint32_t size)
+	{
+		if (!*this)
+		{
+			return false;
+		}
+
+		m_handle->data->resize(size);
+
+		return true;
+	}
+
+	void close() { m_handle.reset(); }
+
+	//! @brief Get count of seek() of the file (Copies of the instance share the count.)
+	unsigned long seeks() const { return *this? m_handle->seeks : 0; }
+
+private:
+	class Handle
+	{
+	public:
+		Handle() : position(0), seeks(0) {}
+
+		std::string           name;
+		std::shared_ptr<Data> data;
+		size_t                position;
+		unsigned long         seeks;
+	};
+
+	std::shared_ptr<Handle> m_handle;
+};
+
+
+struct FSInfo
+{
+	size_t totalBytes;
+	size_t usedBytes;
+	size_t blockSize;
+	size_t pageSize;
+	size_t maxOpenFiles;
+	size_t maxPathLength;
+};
+
+
+class FS;
+
+class Dir
+{
+public:
+	Dir() : m_fs(NULL), m_started(false) {}
+	Dir(FS* fs, const std::string& path) : m_fs(fs), m_path(path), m_started(false) {}
+
+	bool next();
+	String fileName() const { return String(m_current); }
+	size_t fileSize() const;
+	File openFile(const char* mode);
+
+private:
+	FS*         m_fs;
+	std::string m_path;
+	std::string m_current;
+	bool        m_started;
+};
+
+
+/*!
+	@brief File system in RAM
+
+	The files are kept over begin(), as SPIFFS keeps them over reboots, and format() discards them.
+*/
+class FS
+{
+public:
+	typedef std::map<std::string, std::shared_ptr<File::Data> > Files;
+
+	bool begin() { return true; }
+	void end() {}
+	bool format() { m_files.clear(); return true; }
+
+	File open(const char* path, const char* mode)
+	{
+		Files::iterator file = m_files.find(path);
+
+		if (mode[0] == 'r')
+		{
+			if (file == m_files.end())
+			{
+				return File();
+			}
+		}
+		else if ((file == m_files.end()) || (mode[0] == 'w'))
+		{
+			m_files[path] = std::make_shared<File::Data>();
+		}
+
+		return File(path, m_files[path], mode[0] == 'a');
+	}
+
+	File open(const String& path, const char* mode) { return open(path.c_str(), mode); }
+
+	bool exists(const char* path) const { return m_files.count(path) != 0; }
+	bool exists(const String& path) const { return exists(path.c_str()); }
+
+	bool remove(const char* path) { return m_files.erase(path) != 0; }
+	bool remove(const String& path) { return remove(path.c_str()); }
+
+	bool rename(const char* from, const char* to)
+	{
+		Files::iterator file = m_files.find(from);
+
+		if ((file == m_files.end()) || exists(to))
+		{
+			return false;
+		}
+
+		m_files[to] = file->second;
+		m_files.erase(from);
+
+		return true;
+	}
+
+	bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+
+	Dir openDir(const char* path) { return Dir(this, path); }
+	Dir openDir(const String& path) { return openDir(path.c_str()); }
+
+	bool info(FSInfo& info) const
+	{
+		info.totalBytes    = 3 * 1024 * 1024;
+		info.usedBytes     = 0;
+		info.blockSize     = 8192;
+		info.pageSize      = 256;
+		info.maxOpenFiles  = 5;
+		info.maxPathLength = 32;
+
+		for (Files::const_iterator file = m_files.begin(); file != m_files.end(); ++file)
+		{
+			info.usedBytes += file->second->size();
+		}
+
+		return true;
+	}
+
+	//! @brief Get all files
+	const Files& files() const { return m_files; }
+
+private:
+	Files m_files;
+};
+
+extern FS SPIFFS;
+
+
+inline bool Dir::next()
+{
+	if (m_fs == NULL)
+	{
+		return false;
+	}
+
+	const FS::Files& files = m_fs->files();
+	FS::Files::const_iterator file = m_started? files.upper_bound(m_current) : files.lower_bound(m_path);
+
+	m_started = true;
+
+	if ((file == files.end()) || (file->first.compare(0, m_path.size(), m_path) != 0))
+	{
+		m_current.clear();
+
+		return false;
+	}
+
+	m_current = file->first;
+
+	return true;
+}
+
+inline size_t Dir::fileSize() const
+{
+	FS::Files::const_iterator file = m_fs->files().find(m_current);
+
+	return (file == m_fs->files().end())? 0 : file->second->size();
+}
+
+inline File Dir::openFile(const char* mode)
+{
+	return m_fs->open(m_current.c_str(), mode);
+}
+
+#endif // HOST_FS_H
@@ -0,0 +1,136 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+#include <atomic>
+#include <mutex>
+
+#include "Arduino.h"
+#include "FS.h"
+#include "HostNetwork.h"
+#include "Wire.h"
+
+
+HardwareSerial   Serial;
+HardwareSerial   Serial1;
+EspClass         ESP;
+TwoWire          Wire;
+FS               SPIFFS;
+ESP8266WiFiClass WiFi;
+MDNSResponder    MDNS;
+
+
+namespace
+{
+	std::atomic<unsigned long> now_us(0);
+
+	std::mutex interruptions;
+	thread_local bool interruptions_disabled = false;
+}
+
+
+void Host::setMicros(unsigned long us)
+{
+	now_us = us;
+}
+
+void Host::advance(unsigned long us)
+{
+	now_us += us;
+}
+
+
+unsigned long micros()
+{
+	return now_us;
+}
+
+unsigned long millis()
+{
+	return now_us / 1000;
+}
+
+void delay(unsigned long ms)
+{
+	now_us += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	now_us += us;
+}
+
+void yield()
+{
+}
+
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t, uint8_t)
+{
+}
+
+int digitalRead(uint8_t)
+{
+	return LOW;
+}
+
+int analogRead(uint8_t)
+{
+	return 0;
+}
+
+void analogWrite(uint8_t, int)
+{
+}
+
+
+/*
+	As the ESP8266, disabling twice and enabling once enables the interruptions.
+*/
+void noInterrupts()
+{
+	if (!interruptions_disabled)
+	{
+		interruptions.lock();
+		interruptions_disabled = true;
+	}
+}
+
+void interrupts()
+{
+	if (interruptions_disabled)
+	{
+		interruptions_disabled = false;
+		interruptions.unlock();
+	}
+}
+
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+	return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+long random(long max_value)
+{
+	return (max_value <= 0)? 0 : (rand() % max_value);
+}
+
+long random(long min_value, long max_value)
+{
+	return (min_value >= max_value)? min_value : (min_value + random(max_value - min_value));
+}
+
+void randomSeed(unsigned long seed)
+{
+	srand(seed);
+}
@@ -0,0 +1,197 @@
+/*!
+	@file      HostNetwork.h
+	@brief     Network classes of the host build, that connect to nothing.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef HOST_NETWORK_H
+#define HOST_NETWORK_H
+
+#include "Arduino.h"
+#include "FS.h"
+
+
+class IPAddress
+{
+public:
+	IPAddress() {}
+	IPAddress(int, int, int, int) {}
+
+	String toString() const { return String("0.0.0.0"); }
+};
+
+
+class WiFiClient : public Stream
+{
+public:
+	operator bool() const { return false; }
+	bool connected() const { return false; }
+	void stop() {}
+	void setNoDelay(bool) {}
+
+	virtual size_t write(uint8_t) { return 1; }
+	virtual size_t write(const uint8_t*, size_t size) { return size; }
+	using Stream::write;
+};
+
+
+class WiFiServer : public Print
+{
+public:
+	WiFiServer(int) {}
+
+	void begin() {}
+	WiFiClient available() { return WiFiClient(); }
+	bool hasClient() const { return false; }
+	void setNoDelay(bool) {}
+
+	virtual size_t write(uint8_t) { return 1; }
+	virtual size_t write(const uint8_t*, size_t size) { return size; }
+	using Print::write;
+};
+
+
+class WiFiUDP : public Print
+{
+public:
+	int begin(int) { return 1; }
+	int beginPacket(IPAddress, int) { return 1; }
+	int beginPacketMulticast(IPAddress, int, IPAddress) { return 1; }
+	int endPacket() { return 1; }
+
+	virtual size_t write(uint8_t) { return 1; }
+	virtual size_t write(const uint8_t*, size_t size) { return size; }
+	using Print::write;
+};
+
+
+enum HTTPMethod {
+	HTTP_ANY,
+	HTTP_GET,
+	HTTP_POST,
+	HTTP_PUT,
+	HTTP_PATCH,
+	HTTP_DELETE,
+	HTTP_OPTIONS
+};
+
+enum HTTPUploadStatus {
+	UPLOAD_FILE_START,
+	UPLOAD_FILE_WRITE,
+	UPLOAD_FILE_END,
+	UPLOAD_FILE_ABORTED
+};
+
+#define CONTENT_LENGTH_UNKNOWN (static_cast<size_t>(-1))
+
+struct HTTPUpload
+{
+	HTTPUploadStatus status;
+	String           filename;
+	size_t           totalSize;
+	size_t           currentSize;
+	uint8_t          buf[2048];
+};
+
+
+class ESP8266WebServer
+{
+public:
+	typedef void (*THandlerFunction)();
+
+	ESP8266WebServer(int) {}
+
+	void on(const char*, THandlerFunction) {}
+	void on(const char*, HTTPMethod, THandlerFunction) {}
+	void on(const char*, HTTPMethod, THandlerFunction, THandlerFunction) {}
+	void onNotFound(THandlerFunction) {}
+	void begin() {}
+	void handleClient() {}
+
+	String arg(const char*) { return String(); }
+	String arg(const String&) { return String(); }
+	String arg(int) { return String(); }
+	String argName(int) { return String(); }
+	int args() { return 0; }
+	bool hasArg(const char*) { return false; }
+	bool hasArg(const String&) { return false; }
+	String uri() { return String(); }
+	HTTPMethod method() { return HTTP_GET; }
+	HTTPUpload& upload() { return m_upload; }
+	WiFiClient client() { return WiFiClient(); }
+
+	void send(int) {}
+	void send(int, const char*, const String&) {}
+	void send(int, const char*, const char*) {}
+	void send(int, const String&, const String&) {}
+	void sendHeader(const String&, const String&, bool = false) {}
+	void sendContent(const String&) {}
+	void setContentLength(size_t) {}
+
+	template<typename T> size_t streamFile(T&, const String&) { return 0; }
+
+private:
+	HTTPUpload m_upload;
+};
+
+
+class ESP8266HTTPUpdateServer
+{
+public:
+	void setup(ESP8266WebServer*) {}
+	void setup(ESP8266WebServer*, const char*) {}
+};
+
+
+class MDNSResponder
+{
+public:
+	bool begin(const char*) { return true; }
+	void addService(const char*, const char*, int) {}
+	void update() {}
+};
+
+extern MDNSResponder MDNS;
+
+
+enum WiFiMode {
+	WIFI_OFF,
+	WIFI_STA,
+	WIFI_AP,
+	WIFI_AP_STA
+};
+
+enum wl_status_t {
+	WL_IDLE_STATUS  = 0,
+	WL_DISCONNECTED = 6,
+	WL_CONNECTED    = 3
+};
+
+class ESP8266WiFiClass
+{
+public:
+	void mode(WiFiMode) {}
+	wl_status_t status() { return WL_DISCONNECTED; }
+	void begin(const char*, const char* = NULL) {}
+	void disconnect() {}
+	IPAddress localIP() { return IPAddress(); }
+	IPAddress softAPIP() { return IPAddress(); }
+	bool softAP(const char*, const char* = NULL) { return true; }
+	bool softAPConfig(IPAddress, IPAddress, IPAddress) { return true; }
+	int softAPgetStationNum() { return 0; }
+	bool beginSmartConfig() { return true; }
+	bool stopSmartConfig() { return true; }
+	bool smartConfigDone() { return false; }
+	String SSID() { return String(); }
+	String psk() { return String(); }
+	String macAddress() { return String("00:00:00:00:00:00"); }
+	void setAutoConnect(bool) {}
+	void persistent(bool) {}
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif // HOST_NETWORK_H
@@ -0,0 +1,83 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+#include "Arduino.h"
+#include "HostNetwork.h"
+#include "System.h"
+
+
+/*
+	System.cpp holds the servers and the handlers of the web API,
+	so the host build has only the streams of it, that the modules print to.
+*/
+WiFiServer tcp_server(23);
+
+
+PLEN2::System::System()
+{
+}
+
+Stream& PLEN2::System::SystemSerial()
+{
+	return Serial;
+}
+
+Stream& PLEN2::System::inputSerial()
+{
+	return Serial;
+}
+
+Stream& PLEN2::System::outputSerial()
+{
+	return Serial;
+}
+
+Stream& PLEN2::System::debugSerial()
+{
+	return Serial;
+}
+
+bool PLEN2::System::tcp_available()
+{
+	return false;
+}
+
+char PLEN2::System::tcp_read()
+{
+	return -1;
+}
+
+bool PLEN2::System::tcp_connected()
+{
+	return false;
+}
+
+void PLEN2::System::tcp_println(const String&)
+{
+}
+
+void PLEN2::System::setup_smartconfig()
+{
+}
+
+void PLEN2::System::smart_config()
+{
+}
+
+void PLEN2::System::StartAp()
+{
+}
+
+void PLEN2::System::dump()
+{
+}
+
+void PLEN2::System::handleClient()
+{
+}
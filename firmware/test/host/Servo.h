@@ -0,0 +1,38 @@
+/*!
+	@file      Servo.h
+	@brief     Fake servo of the host build, that keeps the degree written.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef HOST_SERVO_H
+#define HOST_SERVO_H
+
+#include <stdint.h>
+
+
+class Servo
+{
+public:
+	Servo() : m_pin(-1), m_value(0), m_writes(0) {}
+
+	uint8_t attach(int pin) { m_pin = pin; return 0; }
+	uint8_t attach(int pin, int, int) { return attach(pin); }
+	void detach() { m_pin = -1; }
+	bool attached() const { return m_pin >= 0; }
+
+	void write(int value) { m_value = value; m_writes++; }
+	int read() const { return m_value; }
+
+	//! @brief Get count of write()
+	unsigned long writes() const { return m_writes; }
+
+private:
+	int           m_pin;
+	int           m_value;
+	unsigned long m_writes;
+};
+
+#endif // HOST_SERVO_H
@@ -0,0 +1,51 @@
+/*!
+	@file      Ticker.h
+	@brief     Ticker of the host build, that never fires by itself.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef HOST_TICKER_H
+#define HOST_TICKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/*!
+	@brief Ticker
+
+	A test calls the callbacks by itself, at the timing it simulates.
+*/
+class Ticker
+{
+public:
+	typedef void (*callback_t)();
+
+	Ticker() : m_callback(NULL), m_interval_ms(0) {}
+
+	void attach_ms(uint32_t interval_ms, callback_t callback) { m_interval_ms = interval_ms; m_callback = callback; }
+	void attach(float interval_s, callback_t callback) { attach_ms(static_cast<uint32_t>(interval_s * 1000), callback); }
+	void detach() { m_callback = NULL; }
+	bool active() const { return m_callback != NULL; }
+
+	//! @brief Get interval given by attach_ms() [msec]
+	uint32_t interval() const { return m_interval_ms; }
+
+	//! @brief Call the callback as the interval elapsed
+	void fire() const
+	{
+		if (m_callback != NULL)
+		{
+			m_callback();
+		}
+	}
+
+private:
+	callback_t m_callback;
+	uint32_t   m_interval_ms;
+};
+
+#endif // HOST_TICKER_H
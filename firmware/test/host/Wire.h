@@ -0,0 +1,126 @@
+/*!
+	@file      Wire.h
+	@brief     Fake I2C bus of the host build, that counts the transactions.
+	@author    Kazuyuki TAKASE
+	@copyright The MIT License - http://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+
+#define BUFFER_LENGTH 128 //!< Same as the ESP8266 core.
+
+
+/*!
+	@brief Fake I2C bus
+
+	A transaction is written to the registers of its device with auto-increment, as PCA9685 does,
+	so a test reads the outputs back from registers().
+	The counters tell the cost of the bus. (bytes() includes the address byte of each transaction.)
+*/
+class TwoWire
+{
+public:
+	TwoWire()
+		: m_clock(100000), m_transactions(0), m_bytes(0), m_device(0), m_length(0), m_transmitting(false)
+	{
+		memset(m_registers, 0, sizeof(m_registers));
+	}
+
+	void begin(int, int) {}
+	void begin() {}
+	void setClock(uint32_t clock) { m_clock = clock; }
+
+	void beginTransmission(uint8_t device)
+	{
+		m_device       = device & 0x7F;
+		m_length       = 0;
+		m_transmitting = true;
+	}
+
+	uint8_t endTransmission(uint8_t = true)
+	{
+		if (!m_transmitting)
+		{
+			return 4;
+		}
+
+		m_transmitting = false;
+		m_transactions++;
+		m_bytes += 1 + m_length;
+
+		if (m_length != 0)
+		{
+			uint8_t address = m_buffer[0];
+
+			for (size_t index = 1; index < m_length; index++)
+			{
+				m_registers[m_device][address++] = m_buffer[index];
+			}
+		}
+
+		return 0;
+	}
+
+	size_t write(uint8_t value)
+	{
+		if (!m_transmitting || (m_length >= BUFFER_LENGTH))
+		{
+			return 0;
+		}
+
+		m_buffer[m_length++] = value;
+
+		return 1;
+	}
+
+	size_t write(const uint8_t* data, size_t size)
+	{
+		size_t written = 0;
+
+		while ((written < size) && (write(data[written]) != 0))
+		{
+			written++;
+		}
+
+		return written;
+	}
+
+	uint8_t requestFrom(int, int) { return 0; }
+	int read() { return -1; }
+	int available() { return 0; }
+
+	//! @brief Get clock set by setClock() [Hz]
+	uint32_t clock() const { return m_clock; }
+
+	//! @brief Get count of transactions ended
+	unsigned long transactions() const { return m_transactions; }
+
+	//! @brief Get count of bytes sent, including the address byte of each transaction
+	unsigned long bytes() const { return m_bytes; }
+
+	//! @brief Clear the counters
+	void resetCounters() { m_transactions = 0; m_bytes = 0; }
+
+	//! @brief Get the registers of a device
+	const uint8_t* registers(uint8_t device) const { return m_registers[device & 0x7F]; }
+
+private:
+	uint32_t      m_clock;
+	unsigned long m_transactions;
+	unsigned long m_bytes;
+	uint8_t       m_device;
+	uint8_t       m_buffer[BUFFER_LENGTH];
+	size_t        m_length;
+	bool          m_transmitting;
+	uint8_t       m_registers[128][256];
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,306 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Angle to PWM mapping of the output profiles against the former per-call mapping.
+	Every angle of every joint must be output bit-identically, through setAngle() and setAngleDiff(),
+	and so must every angle of output ranges over the whole scale of both kinds.
+	The benchmark compares the cost of both paths.
+*/
+
+#include "Arduino.h"
+#include <Servo.h>
+#include <Wire.h>
+
+#include "HostTest.h"
+#include "JointController.h"
+
+using namespace PLEN2;
+
+HOST_TEST_MAIN();
+
+extern Servo GPIO12SERVO;
+extern Servo GPIO14SERVO;
+
+
+namespace
+{
+	const uint8_t PCA9685_ADDRESS = 0x40;
+	const uint8_t LED0_ON_L       = 0x06;
+
+	/*!
+		@brief Output of the joints in the former firmware
+
+		0-15 are channels of PCA9685, 16 is GPIO12, 17 is GPIO14, and the others have no output.
+	*/
+	const unsigned char SERVO_MAP[JointController::SUM] = {
+		16, 7, 6, 5, 4, 3, 2, 1, 0, 18, 19, 20, 17, 8, 9, 10, 11, 12, 13, 14, 15, 21, 22, 23
+	};
+
+	//! @brief Former JointController::setAngle(), that mapped the angle at every call
+	int formerPwm(unsigned char joint_id, int angle, int angle_min, int angle_max)
+	{
+		angle = constrain(angle, angle_min, angle_max);
+
+		if ((joint_id == 0) || (joint_id == 12))
+		{
+			#if CLOCK_WISE
+				return 90 + angle / 10;
+			#else
+				return 90 - angle / 10;
+			#endif
+		}
+
+		return map(
+			angle,
+			JointController::ANGLE_MIN, JointController::ANGLE_MAX,
+
+			#if CLOCK_WISE
+				JointController::PWM_MIN(), JointController::PWM_MAX()
+			#else
+				JointController::PWM_MAX(), JointController::PWM_MIN()
+			#endif
+		);
+	}
+
+	//! @brief Value output to the joint, or -1 if the joint has no output
+	int outputPwm(unsigned char joint_id)
+	{
+		const unsigned char output = SERVO_MAP[joint_id];
+
+		if (output < 16)
+		{
+			const uint8_t* registers = Wire.registers(PCA9685_ADDRESS) + LED0_ON_L + 4 * output;
+
+			return registers[2] | (registers[3] << 8);
+		}
+
+		if (output == 16)
+		{
+			return GPIO12SERVO.read();
+		}
+
+		if (output == 17)
+		{
+			return GPIO14SERVO.read();
+		}
+
+		return -1;
+	}
+
+	void tick()
+	{
+		JointController::publish();
+		JointController::updateAngle();
+	}
+
+	/*!
+		@brief Output all angles to all joints, and compare them with the former mapping
+
+		@return Count of the outputs that differ
+	*/
+	unsigned long sweep(JointController& joint_ctrl, bool diff)
+	{
+		unsigned long mismatches = 0;
+
+		for (int angle = JointController::ANGLE_MIN; angle <= JointController::ANGLE_MAX; angle++)
+		{
+			for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+			{
+				if (diff)
+				{
+					joint_ctrl.setAngleDiff(joint_id, angle);
+				}
+				else
+				{
+					joint_ctrl.setAngle(joint_id, angle);
+				}
+			}
+
+			tick();
+
+			for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+			{
+				if (SERVO_MAP[joint_id] >= 18)
+				{
+					continue;
+				}
+
+				const int target = diff? (angle + joint_ctrl.getHomeAngle(joint_id)) : angle;
+				const int expected = formerPwm(joint_id, target, joint_ctrl.getMinAngle(joint_id), joint_ctrl.getMaxAngle(joint_id));
+
+				if (outputPwm(joint_id) != expected)
+				{
+					if (mismatches++ < 8)
+					{
+						printf("joint %d, angle %d: %d, expected %d\n", joint_id, target, outputPwm(joint_id), expected);
+					}
+				}
+			}
+		}
+
+		return mismatches;
+	}
+
+	/*!
+		@brief Output all angles to a joint on the range given, and compare them with map() or the center formula
+
+		The joint is set back to its channel after it, so the range never takes the last profile.
+
+		@return Count of the outputs that differ, or 1 if the range is refused
+	*/
+	unsigned long sweepRange(JointController& joint_ctrl, unsigned char joint_id, short pwm_begin, short pwm_end)
+	{
+		const JointController::ChannelSetting previous = joint_ctrl.getChannel(joint_id);
+		JointController::ChannelSetting channel = previous;
+		channel.DIRECTION = (pwm_begin < pwm_end)? 1 : -1;
+		channel.PWM_MIN   = min(pwm_begin, pwm_end);
+		channel.PWM_MAX   = max(pwm_begin, pwm_end);
+
+		if (!joint_ctrl.setChannel(joint_id, channel))
+		{
+			return 1;
+		}
+
+		unsigned long mismatches = 0;
+
+		for (int angle = JointController::ANGLE_MIN; angle <= JointController::ANGLE_MAX; angle++)
+		{
+			joint_ctrl.setAngle(joint_id, angle);
+			tick();
+
+			const long expected = (channel.KIND == JointController::OUTPUT_GPIO_SERVO)
+				? (pwm_begin + pwm_end) / 2 + static_cast<long>(angle) * (pwm_end - pwm_begin) / (JointController::ANGLE_MAX - JointController::ANGLE_MIN)
+				: map(angle, JointController::ANGLE_MIN, JointController::ANGLE_MAX, pwm_begin, pwm_end);
+
+			if (outputPwm(joint_id) != expected)
+			{
+				if (mismatches++ < 8)
+				{
+					printf("joint %d, range %d to %d, angle %d: %d, expected %ld\n", joint_id, pwm_begin, pwm_end, angle, outputPwm(joint_id), expected);
+				}
+			}
+		}
+
+		return joint_ctrl.setChannel(joint_id, previous)? mismatches : mismatches + 1;
+	}
+}
+
+
+int main()
+{
+	JointController joint_ctrl;
+	joint_ctrl.Init();
+	tick();
+
+	// Default settings, that clamp nothing.
+	CHECK(sweep(joint_ctrl, false) == 0);
+	CHECK(sweep(joint_ctrl, true) == 0);
+
+	// Ranges of both directions, from the full scale of the kinds to a single step, on a PCA9685's channel and a GPIO servo.
+	const unsigned char PCA9685_JOINT = 1, GPIO_SERVO_JOINT = 0;
+
+	unsigned long range_mismatches = 0;
+	unsigned long seed = 1;
+
+	for (int range = 0; range < 64; range++)
+	{
+		seed = seed * 1103515245UL + 12345UL;
+		const short pca9685_low  = (range == 0)? 0 : static_cast<short>((seed >> 8) % 4095);
+		const short pca9685_high = (range == 0)? 4095 : static_cast<short>(pca9685_low + 1 + (seed >> 20) % (4095 - pca9685_low));
+
+		seed = seed * 1103515245UL + 12345UL;
+		const short gpio_servo_low  = (range == 0)? 0 : static_cast<short>((seed >> 8) % 180);
+		const short gpio_servo_high = (range == 0)? 180 : static_cast<short>(gpio_servo_low + 1 + (seed >> 20) % (180 - gpio_servo_low));
+
+		range_mismatches += sweepRange(joint_ctrl, PCA9685_JOINT, pca9685_low, pca9685_high);
+		range_mismatches += sweepRange(joint_ctrl, PCA9685_JOINT, pca9685_high, pca9685_low);
+		range_mismatches += sweepRange(joint_ctrl, GPIO_SERVO_JOINT, gpio_servo_low, gpio_servo_high);
+		range_mismatches += sweepRange(joint_ctrl, GPIO_SERVO_JOINT, gpio_servo_high, gpio_servo_low);
+	}
+
+	CHECK(range_mismatches == 0);
+
+	// Narrow settings, that clamp the angles and the offsets from home.
+	for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		CHECK(joint_ctrl.setMinAngle(joint_id, -700 + joint_id * 13));
+		CHECK(joint_ctrl.setMaxAngle(joint_id, 650 - joint_id * 17));
+	}
+
+	CHECK(sweep(joint_ctrl, false) == 0);
+	CHECK(sweep(joint_ctrl, true) == 0);
+
+	// Cost of an angle, that is mapped at every call by the former firmware, and by the profiles now.
+	enum { ROUNDS = 50 };
+
+	volatile int sink = 0;
+	int angle_mins[JointController::SUM];
+	int angle_maxs[JointController::SUM];
+
+	for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		angle_mins[joint_id] = joint_ctrl.getMinAngle(joint_id);
+		angle_maxs[joint_id] = joint_ctrl.getMaxAngle(joint_id);
+	}
+
+	HostTest::Stopwatch former_watch;
+
+	for (int round = 0; round < ROUNDS; round++)
+	{
+		for (int angle = JointController::ANGLE_MIN; angle <= JointController::ANGLE_MAX; angle++)
+		{
+			for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+			{
+				sink = formerPwm(joint_id, angle, angle_mins[joint_id], angle_maxs[joint_id]);
+			}
+		}
+	}
+
+	const double former_ns = former_watch.elapsedNs();
+
+	HostTest::Stopwatch setter_watch;
+
+	for (int round = 0; round < ROUNDS; round++)
+	{
+		for (int angle = JointController::ANGLE_MIN; angle <= JointController::ANGLE_MAX; angle++)
+		{
+			for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+			{
+				joint_ctrl.setAngle(joint_id, angle);
+			}
+		}
+	}
+
+	const double setter_ns = setter_watch.elapsedNs();
+
+	HostTest::Stopwatch output_watch;
+
+	for (int round = 0; round < ROUNDS; round++)
+	{
+		for (int angle = JointController::ANGLE_MIN; angle <= JointController::ANGLE_MAX; angle++)
+		{
+			for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+			{
+				joint_ctrl.setAngle(joint_id, angle);
+			}
+
+			tick();
+		}
+	}
+
+	const double output_ns = output_watch.elapsedNs();
+	const double angles = static_cast<double>(ROUNDS) * JointController::ANGLE_RANGE * JointController::SUM;
+
+	(void)sink;
+	printf("per joint and angle: former map() %.2f ns, setAngle() %.2f ns, setAngle() and output tick %.2f ns\n",
+		former_ns / angles, setter_ns / angles, output_ns / angles);
+
+	return HostTest::finish();
+}
@@ -0,0 +1,127 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Transactions of PCA9685 per output tick.
+	A full frame of 24 joints must cost less than 3 transactions, and an idle frame none.
+*/
+
+#include "Arduino.h"
+#include <Adafruit_PWMServoDriver.h>
+#include <Wire.h>
+
+#include "HostTest.h"
+#include "JointController.h"
+
+using namespace PLEN2;
+
+HOST_TEST_MAIN();
+
+
+namespace
+{
+	const uint8_t PCA9685_ADDRESS = 0x40;
+	const uint8_t LED0_ON_L       = 0x06;
+
+	//! @brief Channel of PCA9685 that the joint is wired to by default, or -1
+	const int CHANNELS[JointController::SUM] = {
+		-1, 7, 6, 5, 4, 3, 2, 1, 0, -1, -1, -1,
+		-1, 8, 9, 10, 11, 12, 13, 14, 15, -1, -1, -1
+	};
+
+	//! @brief PWM value output by the former per-call mapping
+	int expectedPwm(int angle)
+	{
+		#if CLOCK_WISE
+			return map(angle, JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::PWM_MIN(), JointController::PWM_MAX());
+		#else
+			return map(angle, JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::PWM_MAX(), JointController::PWM_MIN());
+		#endif
+	}
+
+	//! @brief PWM value in OFF registers of the channel
+	int registerPwm(int channel)
+	{
+		const uint8_t* registers = Wire.registers(PCA9685_ADDRESS) + LED0_ON_L + 4 * channel;
+
+		return registers[2] | (registers[3] << 8);
+	}
+
+	//! @brief Publish the angles and output them by a tick
+	void tick()
+	{
+		Wire.resetCounters();
+		JointController::publish();
+		JointController::updateAngle();
+	}
+}
+
+
+int main()
+{
+	JointController joint_ctrl;
+	joint_ctrl.Init();
+	JointController::updateAngle();
+
+	CHECK(Wire.clock() == 400000);
+
+	// A full frame. (All joints are changed.)
+	for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		joint_ctrl.setAngle(joint_id, 300 - joint_id * 25);
+	}
+
+	tick();
+
+	const unsigned long full_transactions = Wire.transactions();
+	const unsigned long full_bytes        = Wire.bytes();
+
+	CHECK(full_transactions < 3);
+
+	for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		if (CHANNELS[joint_id] >= 0)
+		{
+			CHECK(registerPwm(CHANNELS[joint_id]) == expectedPwm(300 - joint_id * 25));
+		}
+	}
+
+	// An idle frame.
+	tick();
+	CHECK(Wire.transactions() == 0);
+
+	// A sparse frame, that has 2 runs of contiguous channels. (0, 1 and 5)
+	joint_ctrl.setAngle(8, -400);
+	joint_ctrl.setAngle(7, -410);
+	joint_ctrl.setAngle(3, 420);
+	tick();
+
+	CHECK(Wire.transactions() == 2);
+	CHECK(Wire.bytes() == (1 + 1 + 2 * 4) + (1 + 1 + 1 * 4));
+	CHECK(registerPwm(0) == expectedPwm(-400));
+	CHECK(registerPwm(1) == expectedPwm(-410));
+	CHECK(registerPwm(5) == expectedPwm(420));
+
+	// The former output wrote a channel by a transaction.
+	Adafruit_PWMServoDriver pwm;
+	Wire.resetCounters();
+
+	for (uint8_t channel = 0; channel < 16; channel++)
+	{
+		pwm.setPWM(channel, 0, expectedPwm(0));
+	}
+
+	const unsigned long former_transactions = Wire.transactions();
+	const unsigned long former_bytes        = Wire.bytes();
+
+	printf("full frame: %lu transactions, %lu bytes (setPWM() per channel: %lu transactions, %lu bytes)\n",
+		full_transactions, full_bytes, former_transactions, former_bytes);
+
+	return HostTest::finish();
+}
@@ -0,0 +1,163 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Channel settings that would take the output of another joint.
+	A channel used by another joint and a setting that leaves no profile for another joint must be refused
+	without changing anything, so the settings committed after them are loaded again as they are.
+*/
+
+#include "Arduino.h"
+
+#include "ExternalFs.h"
+#include "HostTest.h"
+#include "JointController.h"
+
+using namespace PLEN2;
+
+HOST_TEST_MAIN();
+
+
+namespace
+{
+	const unsigned char TARGET   = 0; //!< Joint set, on GPIO servo 0.
+	const unsigned char OWNER    = 1; //!< Joint that has PCA9685's channel 7.
+	const unsigned char FOLLOWER = 3; //!< Joint after them, on the default PCA9685's range.
+	const unsigned char CHECKED  = 5; //!< Joint whose calibration must be kept.
+
+	const int HOME_ANGLE = 123;
+
+	bool sameChannel(const JointController::ChannelSetting& lhs, const JointController::ChannelSetting& rhs)
+	{
+		return (lhs.KIND == rhs.KIND)
+			&& (lhs.CHANNEL == rhs.CHANNEL)
+			&& (lhs.DIRECTION == rhs.DIRECTION)
+			&& (lhs.PWM_MIN == rhs.PWM_MIN)
+			&& (lhs.PWM_MAX == rhs.PWM_MAX);
+	}
+
+	//! @brief Decide the channel map is the same as the map given
+	bool sameMap(JointController& joint_ctrl, const JointController::ChannelSetting channels[JointController::SUM])
+	{
+		for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+		{
+			if (!sameChannel(joint_ctrl.getChannel(joint_id), channels[joint_id]))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void copyMap(JointController& joint_ctrl, JointController::ChannelSetting channels[JointController::SUM])
+	{
+		for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+		{
+			channels[joint_id] = joint_ctrl.getChannel(joint_id);
+		}
+	}
+
+	//! @brief Setting of a PCA9685's channel with the range given
+	JointController::ChannelSetting pca9685(unsigned char channel, short pwm_min, short pwm_max)
+	{
+		JointController::ChannelSetting result;
+		result.KIND      = JointController::OUTPUT_PCA9685;
+		result.CHANNEL   = channel;
+		result.DIRECTION = 1;
+		result.RESERVED  = 0;
+		result.PWM_MIN   = pwm_min;
+		result.PWM_MAX   = pwm_max;
+
+		return result;
+	}
+}
+
+
+int main()
+{
+	ExternalFs::init();
+
+	JointController joint_ctrl;
+	joint_ctrl.Init();
+	joint_ctrl.loadSettings();
+
+	JointController::ChannelSetting channels[JointController::SUM];
+	copyMap(joint_ctrl, channels);
+
+	const unsigned char active_sum = JointController::activeJointSum();
+	CHECK(channels[OWNER].KIND == JointController::OUTPUT_PCA9685);
+	CHECK(channels[OWNER].CHANNEL == 7);
+
+	// The channel of a joint after the target is refused, and neither joint loses its output.
+	CHECK(!joint_ctrl.setChannel(TARGET, pca9685(7, JointController::PWM_MIN(), JointController::PWM_MAX())));
+	CHECK(sameMap(joint_ctrl, channels));
+	CHECK(JointController::activeJointSum() == active_sum);
+
+	// The settings committed after it are loaded again, and not reset as a broken file.
+	CHECK(joint_ctrl.setHomeAngle(CHECKED, HOME_ANGLE));
+	CHECK(joint_ctrl.commitSettings());
+
+	{
+		JointController rebooted;
+		rebooted.Init();
+		rebooted.loadSettings();
+
+		CHECK(rebooted.getHomeAngle(CHECKED) == HOME_ANGLE);
+		CHECK(sameMap(rebooted, channels));
+	}
+
+	// A free channel is taken after its owner leaves it.
+	JointController::ChannelSetting none = channels[OWNER];
+	none.KIND = JointController::OUTPUT_NONE;
+
+	CHECK(joint_ctrl.setChannel(OWNER, none));
+	CHECK(joint_ctrl.setChannel(TARGET, pca9685(7, JointController::PWM_MIN(), JointController::PWM_MAX())));
+	CHECK(JointController::activeJointSum() == active_sum - 1);
+	CHECK(joint_ctrl.setChannel(TARGET, channels[TARGET]));
+	CHECK(joint_ctrl.setChannel(OWNER, channels[OWNER]));
+	CHECK(sameMap(joint_ctrl, channels));
+	CHECK(JointController::activeJointSum() == active_sum);
+
+	// The default map uses 2 profiles, so a range of its own fills the pool.
+	JointController::ChannelSetting narrow = channels[OWNER];
+	narrow.PWM_MIN += 100;
+	narrow.PWM_MAX -= 100;
+
+	CHECK(joint_ctrl.setChannel(OWNER, narrow));
+	copyMap(joint_ctrl, channels);
+
+	// Another range is refused for a joint after it, that would have no profile left.
+	JointController::ChannelSetting narrower = channels[FOLLOWER];
+	narrower.PWM_MIN += 200;
+	narrower.PWM_MAX -= 200;
+
+	CHECK(!joint_ctrl.setChannel(FOLLOWER, narrower));
+	CHECK(sameMap(joint_ctrl, channels));
+
+	// And for a joint before it, that would take the last profile of the joints after it.
+	narrower.CHANNEL = channels[TARGET + 2].CHANNEL;
+
+	CHECK(!joint_ctrl.setChannel(TARGET + 2, narrower));
+	CHECK(sameMap(joint_ctrl, channels));
+	CHECK(JointController::activeJointSum() == active_sum);
+
+	CHECK(joint_ctrl.commitSettings());
+
+	{
+		JointController rebooted;
+		rebooted.Init();
+		rebooted.loadSettings();
+
+		CHECK(rebooted.getHomeAngle(CHECKED) == HOME_ANGLE);
+		CHECK(sameMap(rebooted, channels));
+	}
+
+	return HostTest::finish();
+}
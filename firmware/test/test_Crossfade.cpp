@@ -0,0 +1,256 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Crossfade between motions played in a row.
+	The next motion starts within the blend time before the playing one ends, and the joint velocity
+	must stay continuous across the overlap, while motions played after a stop turn at once.
+*/
+
+#include <math.h>
+#include <vector>
+
+#include "Arduino.h"
+#include <Ticker.h>
+#include <Wire.h>
+
+#include "ExternalFs.h"
+#include "HostTest.h"
+#include "JointController.h"
+#include "Motion.h"
+#include "MotionController.h"
+#include "MotionStore.h"
+
+using namespace PLEN2;
+
+HOST_TEST_MAIN();
+
+extern Ticker flipper_motion;
+
+
+namespace
+{
+	const uint8_t PCA9685_ADDRESS = 0x40;
+	const uint8_t LED0_ON_L       = 0x06;
+
+	const unsigned char JOINT   = 1; //!< Joint checked, on channel 7.
+	const unsigned char CHANNEL = 7;
+
+	const unsigned char SLOT_OUT = 50; //!< Motion playing.
+	const unsigned char SLOT_IN  = 51; //!< Motion queued after it.
+
+	enum {
+		BLEND_MS   = 200,
+		STEP_MS    = 5,  //!< Step of the differences.
+		MARGIN_MS  = 50, //!< Time checked around the overlap. (The motion queued turns at its own frame 100 msec after it.)
+		TIMEOUT_MS = 5000
+	};
+
+	int home_angle = 0;
+
+	int outputAngle()
+	{
+		const uint8_t* registers = Wire.registers(PCA9685_ADDRESS) + LED0_ON_L + 4 * CHANNEL;
+
+		return (registers[2] | (registers[3] << 8)) + JointController::ANGLE_MIN - home_angle;
+	}
+
+	bool install(unsigned char slot, const unsigned int transitions_ms[], const int angles[], unsigned short frame_length)
+	{
+		Motion::Header header;
+		header.init();
+		header.slot         = slot;
+		header.frame_length = frame_length;
+		strcpy(header.name, "crossfade");
+
+		if (!Motion::Installation::begin(header))
+		{
+			return false;
+		}
+
+		for (unsigned short index = 0; index < frame_length; index++)
+		{
+			Motion::Frame frame;
+			memset(&frame, 0, sizeof(frame));
+			frame.index              = index;
+			frame.transition_time_ms = transitions_ms[index];
+			frame.joint_angle[JOINT] = angles[index];
+
+			if (!Motion::Installation::append(frame))
+			{
+				return false;
+			}
+		}
+
+		return Motion::Installation::commit();
+	}
+
+	/*!
+		@brief Trajectory of the joint, sampled every millisecond from the beginning
+	*/
+	class Trajectory
+	{
+	public:
+		std::vector<int> angles;
+		long boundary_ms;  //!< Time the next motion was played.
+		long fade_end_ms;  //!< Time the crossfade ends, that the motion playing would end at.
+
+		//! @brief Velocity of the step before the time [angle / msec]
+		double velocityBefore(long time_ms) const
+		{
+			return static_cast<double>(angles[time_ms] - angles[time_ms - STEP_MS]) / STEP_MS;
+		}
+
+		//! @brief Velocity of the step after the time [angle / msec]
+		double velocityAfter(long time_ms) const
+		{
+			return static_cast<double>(angles[time_ms + STEP_MS] - angles[time_ms]) / STEP_MS;
+		}
+
+		/*!
+			@brief Largest second difference of the angles by a step, around the overlap
+
+			It is the change of the velocity over a step times the step: a continuous velocity
+			keeps it within the acceleration times the step squared, and a velocity that jumps makes it the jump times the step.
+			(The angles are rounded, so it has an error of 2 at most.)
+		*/
+		int maxSecondDifference() const
+		{
+			int result = 0;
+
+			for (long time_ms = boundary_ms - MARGIN_MS; time_ms <= fade_end_ms + MARGIN_MS; time_ms++)
+			{
+				result = max(result, abs(angles[time_ms + STEP_MS] - 2 * angles[time_ms] + angles[time_ms - STEP_MS]));
+			}
+
+			return result;
+		}
+	};
+
+	/*!
+		@brief Play the motions in a row by the main loop of firmware.ino
+
+		The loop runs every millisecond, and the interpreter plays the next motion
+		when the playing one is blendable, or after it stopped.
+	*/
+	Trajectory play(MotionController& motion_ctrl, long end_ms)
+	{
+		Trajectory result;
+		result.boundary_ms = -1;
+		result.fade_end_ms = end_ms;
+
+		bool queued = true;
+		const unsigned long begin_us = micros();
+		motion_ctrl.play(SLOT_OUT);
+		result.angles.push_back(outputAngle());
+
+		for (long time_ms = 0; (time_ms < TIMEOUT_MS) && motion_ctrl.playing(); time_ms++)
+		{
+			Host::advance(1000);
+			flipper_motion.fire();
+
+			if (motion_ctrl.frameUpdatable())
+			{
+				motion_ctrl.updateFrame();
+				JointController::updateAngle();
+			}
+
+			if (queued && motion_ctrl.blendable())
+			{
+				queued = false;
+				motion_ctrl.play(SLOT_IN);
+				result.boundary_ms = (micros() - begin_us) / 1000;
+			}
+
+			if (motion_ctrl.updatingFinished())
+			{
+				if (motion_ctrl.nextFrameLoadable())
+				{
+					motion_ctrl.loadNextFrame();
+				}
+				else
+				{
+					motion_ctrl.stop();
+
+					if (queued)
+					{
+						queued = false;
+						motion_ctrl.play(SLOT_IN);
+						result.boundary_ms = (micros() - begin_us) / 1000;
+					}
+				}
+			}
+
+			result.angles.push_back(outputAngle());
+		}
+
+		return result;
+	}
+}
+
+
+int main()
+{
+	ExternalFs::init();
+	MotionStore::init();
+
+	// Same as setup() of firmware.ino, that attaches the ticker of the motions.
+	JointController joint_ctrl;
+	joint_ctrl.Init();
+	joint_ctrl.loadSettings();
+
+	// PWM value of the channel equals angle - ANGLE_MIN, so the angles are read back as they are.
+	JointController::ChannelSetting channel = joint_ctrl.getChannel(JOINT);
+	channel.DIRECTION = 1;
+	channel.PWM_MIN   = 0;
+	channel.PWM_MAX   = JointController::ANGLE_MAX - JointController::ANGLE_MIN;
+	CHECK(joint_ctrl.setChannel(JOINT, channel));
+	home_angle = joint_ctrl.getHomeAngle(JOINT);
+
+	// The motion playing moves at 1 angle / msec from the home to its end, and the next one turns back.
+	const unsigned int out_transitions_ms[] = { 500 };
+	const int out_angles[]                  = { 500 };
+	const unsigned int in_transitions_ms[]  = { 300, 400 };
+	const int in_angles[]                   = { -100, 300 };
+
+	CHECK(install(SLOT_OUT, out_transitions_ms, out_angles, 1));
+	CHECK(install(SLOT_IN, in_transitions_ms, in_angles, 2));
+
+	MotionController motion_ctrl(joint_ctrl);
+
+	// Crossfade.
+	motion_ctrl.setBlendTime(BLEND_MS);
+	const Trajectory blended = play(motion_ctrl, out_transitions_ms[0]);
+
+	CHECK(blended.boundary_ms == out_transitions_ms[0] - BLEND_MS);
+
+	const double in_velocity = static_cast<double>(in_angles[0] - blended.angles[blended.boundary_ms]) / in_transitions_ms[0];
+
+	// Each motion moves at its own velocity outside the overlap, and the velocity changes smoothly inside it.
+	CHECK(fabs(blended.velocityBefore(blended.boundary_ms) - 1.0) <= 0.2);
+	CHECK(fabs(blended.velocityAfter(blended.fade_end_ms) - in_velocity) <= 0.2);
+	CHECK(blended.maxSecondDifference() <= 5);
+	CHECK(blended.angles.back() == in_angles[1]);
+
+	// Played after a stop, the next motion turns at once from its start.
+	motion_ctrl.setBlendTime(0);
+	const Trajectory stopped = play(motion_ctrl, out_transitions_ms[0]);
+
+	CHECK(stopped.boundary_ms == out_transitions_ms[0]);
+	CHECK(stopped.maxSecondDifference() > 8);
+	CHECK(stopped.angles.back() == in_angles[1]);
+
+	printf("second difference per %d msec around the boundary: crossfade %d, after a stop %d (velocity %.2f to %.2f angle / msec)\n",
+		STEP_MS, blended.maxSecondDifference(), stopped.maxSecondDifference(),
+		stopped.velocityBefore(stopped.boundary_ms), stopped.velocityAfter(stopped.boundary_ms));
+	printf("motions in a row: %lu msec with crossfade, %lu msec after a stop\n",
+		static_cast<unsigned long>(blended.angles.size()), static_cast<unsigned long>(stopped.angles.size()));
+
+	return HostTest::finish();
+}
@@ -0,0 +1,258 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Flash partition of the motions, on the RAM of the host build that behaves as NOR flash.
+	Programming only clears bits, erasing sets whole sectors, and unaligned accesses keep the bytes around them.
+	Reads at computed offsets are counted and timed against seeks and reads of a file, as the former motions were read.
+	A read of the partition must cost no seek and only the bursts of its bytes, and never program nor erase.
+	(The times are of the host, where the file is in RAM and has none of the page walks of SPIFFS.)
+*/
+
+#include <vector>
+
+#include "Arduino.h"
+#include <FS.h>
+
+#include "ExternalFs.h"
+#include "FlashPartition.h"
+#include "HostTest.h"
+
+using namespace PLEN2;
+
+HOST_TEST_MAIN();
+
+
+namespace
+{
+	enum {
+		SECTOR     = FlashPartition::SECTOR_SIZE,
+		RECORD     = 112,  //!< Bytes read at once, as a frame.
+		RECORD_SUM = 2048,
+		BURST      = 16 * FlashPartition::WORD_SIZE, //!< Bytes of a burst of FlashPartition::read().
+		READ_SUM   = 200000
+	};
+
+	const char* const BENCHMARK_FILE = "/records.bin";
+
+	bool filled(unsigned long offset, unsigned long size, unsigned char value)
+	{
+		std::vector<unsigned char> data(size);
+
+		if (!FlashPartition::read(offset, data.data(), size))
+		{
+			return false;
+		}
+
+		for (unsigned long index = 0; index < size; index++)
+		{
+			if (data[index] != value)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	unsigned char byteAt(unsigned long offset)
+	{
+		unsigned char value = 0;
+		FlashPartition::read(offset, &value, 1);
+
+		return value;
+	}
+
+	//! @brief Pattern of a byte, that differs from the bytes around it
+	unsigned char pattern(unsigned long offset)
+	{
+		return static_cast<unsigned char>(offset * 37 + 11);
+	}
+}
+
+
+int main()
+{
+	CHECK(FlashPartition::init());
+	CHECK(FlashPartition::available());
+	CHECK(FlashPartition::size() % SECTOR == 0);
+	CHECK(FlashPartition::erased(0, FlashPartition::size()));
+
+	// Programming clears bits, and never sets them.
+	const unsigned char high = 0xF0, low = 0x0F, cleared = 0x30;
+
+	CHECK(FlashPartition::program(10, &high, 1));
+	CHECK(byteAt(10) == high);
+	CHECK(FlashPartition::programs() == 1);
+	CHECK(!FlashPartition::program(10, &low, 1));
+	CHECK(byteAt(10) == high);
+	CHECK(FlashPartition::program(10, &cleared, 1));
+	CHECK(byteAt(10) == cleared);
+	CHECK(FlashPartition::erasures() == 0);
+	CHECK(filled(0, 10, 0xFF) && filled(11, SECTOR - 11, 0xFF));
+
+	// write() erases the sector for bits set, and keeps the other bytes of it.
+	const unsigned char set[] = { 0xFF, high };
+
+	CHECK(FlashPartition::write(9, set, sizeof(set)));
+	CHECK(byteAt(9) == 0xFF);
+	CHECK(byteAt(10) == high);
+	CHECK(FlashPartition::erasures() == 1);
+
+	// The same bytes are neither programmed nor erased again.
+	const unsigned long programs = FlashPartition::programs();
+
+	CHECK(FlashPartition::write(9, set, sizeof(set)));
+	CHECK(FlashPartition::erasures() == 1);
+	CHECK(FlashPartition::programs() == programs);
+
+	// Unaligned writes read, modify and write the words around them.
+	std::vector<unsigned char> expected(3 * SECTOR);
+
+	for (unsigned long offset = 0; offset < expected.size(); offset++)
+	{
+		expected[offset] = pattern(offset);
+	}
+
+	CHECK(FlashPartition::write(0, expected.data(), expected.size()));
+
+	const unsigned char piece[] = { 1, 2, 3, 4, 5, 6, 7 };
+	const unsigned long ends[] = { 1, 3, SECTOR - 3, 2 * SECTOR - 1 }; // In a word, over words, and over sectors.
+
+	for (size_t index = 0; index < sizeof(ends) / sizeof(ends[0]); index++)
+	{
+		CHECK(FlashPartition::write(ends[index], piece, sizeof(piece)));
+		memcpy(&expected[ends[index]], piece, sizeof(piece));
+	}
+
+	std::vector<unsigned char> actual(expected.size());
+	CHECK(FlashPartition::read(0, actual.data(), actual.size()));
+	CHECK(actual == expected);
+
+	// Unaligned reads of every length around a sector.
+	bool reads = true;
+
+	for (unsigned long offset = SECTOR - 9; offset < SECTOR + 9; offset++)
+	{
+		for (unsigned long size = 0; size < 9; size++)
+		{
+			unsigned char data[9];
+			reads &= FlashPartition::read(offset, data, size) && (memcmp(data, &expected[offset], size) == 0);
+		}
+	}
+
+	CHECK(reads);
+
+	// Erasing a range keeps the bytes out of it in its sectors, and skips the sectors erased already.
+	const unsigned long erasures = FlashPartition::erasures();
+
+	CHECK(FlashPartition::erase(SECTOR - 5, 2 * SECTOR + 5));
+	CHECK(FlashPartition::erasures() - erasures == 3);
+	CHECK(FlashPartition::erased(SECTOR - 5, 2 * SECTOR + 5));
+	CHECK(!FlashPartition::erased(SECTOR - 6, 2 * SECTOR + 5));
+	CHECK(byteAt(SECTOR - 6) == expected[SECTOR - 6]);
+	CHECK(byteAt(2 * SECTOR + 5) == expected[2 * SECTOR + 5]);
+
+	CHECK(FlashPartition::erase(SECTOR, 2 * SECTOR));
+	CHECK(FlashPartition::erasures() - erasures == 3);
+
+	// The bytes erased are programmed without erasing.
+	CHECK(FlashPartition::program(SECTOR + 1, piece, sizeof(piece)));
+	CHECK(FlashPartition::erasures() - erasures == 3);
+
+	// Moving toward the beginning erases a sector once.
+	CHECK(FlashPartition::move(SECTOR + 1, 1, sizeof(piece)));
+	CHECK(FlashPartition::read(1, actual.data(), sizeof(piece)));
+	CHECK(memcmp(actual.data(), piece, sizeof(piece)) == 0);
+	CHECK(byteAt(0) == expected[0]);
+	CHECK(FlashPartition::erasures() - erasures == 4);
+
+	// Accesses out of the partition are refused.
+	CHECK(!FlashPartition::read(FlashPartition::size() - 1, actual.data(), 2));
+	CHECK(!FlashPartition::write(FlashPartition::size(), piece, 1));
+	CHECK(!FlashPartition::program(FlashPartition::size() - 3, piece, 4));
+	CHECK(!FlashPartition::erase(0, FlashPartition::size() + 1));
+	CHECK(!FlashPartition::move(0, 1, 1));
+
+	// The bytes stay over a reboot, as the flash does.
+	CHECK(FlashPartition::init());
+	CHECK(FlashPartition::erasures() == 0);
+	CHECK(byteAt(0) == expected[0]);
+	CHECK(byteAt(3 * SECTOR - 1) == expected[3 * SECTOR - 1]);
+
+	// Records read at computed offsets, from the partition and from a file.
+	std::vector<unsigned char> records(RECORD_SUM * RECORD);
+
+	for (unsigned long offset = 0; offset < records.size(); offset++)
+	{
+		records[offset] = pattern(offset);
+	}
+
+	CHECK(FlashPartition::erase(0, FlashPartition::size()));
+	CHECK(FlashPartition::write(0, records.data(), records.size()));
+
+	ExternalFs::init();
+	File fp = SPIFFS.open(BENCHMARK_FILE, "w+");
+	CHECK(fp.write(records.data(), records.size()) == records.size());
+
+	std::vector<unsigned long> offsets(READ_SUM);
+	unsigned long seed = 1;
+
+	for (size_t index = 0; index < offsets.size(); index++)
+	{
+		seed = seed * 1103515245UL + 12345UL;
+		offsets[index] = ((seed >> 8) % RECORD_SUM) * RECORD;
+	}
+
+	unsigned char record[RECORD];
+	size_t matched = 0;
+	const unsigned long partition_seeks = fp.seeks();
+	const unsigned long flash_reads     = FlashPartition::reads();
+	const unsigned long flash_bytes     = FlashPartition::bytesRead();
+	const unsigned long record_programs = FlashPartition::programs();
+	const unsigned long record_erasures = FlashPartition::erasures();
+	HostTest::Stopwatch stopwatch;
+
+	for (size_t index = 0; index < offsets.size(); index++)
+	{
+		FlashPartition::read(offsets[index], record, RECORD);
+		matched += (record[index % RECORD] == records[offsets[index] + index % RECORD])? 1 : 0;
+	}
+
+	const double partition_ns = stopwatch.elapsedNs() / READ_SUM;
+	const double partition_reads = static_cast<double>(FlashPartition::reads() - flash_reads) / READ_SUM;
+
+	// A record is aligned to words, so its bytes are read as they are, by the bursts of read().
+	CHECK(fp.seeks() == partition_seeks);
+	CHECK(partition_reads == (RECORD + BURST - 1) / BURST);
+	CHECK(FlashPartition::bytesRead() - flash_bytes == static_cast<unsigned long>(RECORD) * READ_SUM);
+	CHECK(FlashPartition::programs() == record_programs);
+	CHECK(FlashPartition::erasures() == record_erasures);
+
+	const unsigned long seeks = fp.seeks();
+	stopwatch = HostTest::Stopwatch();
+
+	for (size_t index = 0; index < offsets.size(); index++)
+	{
+		ExternalFs::read(offsets[index], RECORD, record, fp);
+		matched += (record[index % RECORD] == records[offsets[index] + index % RECORD])? 1 : 0;
+	}
+
+	const double file_ns = stopwatch.elapsedNs() / READ_SUM;
+	const double file_seeks = static_cast<double>(fp.seeks() - seeks) / READ_SUM;
+	CHECK(matched == 2 * READ_SUM);
+	CHECK(file_seeks == 1.0);
+	fp.close();
+
+	printf("read of %d bytes at a computed offset: partition %.1f bursts and no seek, file %.1f seeks\n",
+		RECORD, partition_reads, file_seeks);
+	printf("on the host: partition %.1f ns, file %.1f ns\n", partition_ns, file_ns);
+
+	return HostTest::finish();
+}
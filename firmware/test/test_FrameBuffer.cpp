@@ -0,0 +1,183 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Handoff of frames between the main loop and the output vector.
+	publish() and updateAngle() run on threads at once, and every tick must output a whole frame.
+*/
+
+#include <atomic>
+#include <thread>
+
+#include "Arduino.h"
+#include <Servo.h>
+#include <Wire.h>
+
+#include "HostTest.h"
+#include "JointController.h"
+
+using namespace PLEN2;
+
+HOST_TEST_MAIN();
+
+extern Servo GPIO12SERVO;
+extern Servo GPIO14SERVO;
+
+
+namespace
+{
+	const uint8_t PCA9685_ADDRESS = 0x40;
+	const uint8_t LED0_ON_L       = 0x06;
+
+	enum {
+		FRAME_SUM  = 100000,
+		ANGLE_STEP = 10,
+		ANGLE_SUM  = (JointController::ANGLE_MAX - JointController::ANGLE_MIN) / ANGLE_STEP + 1
+	};
+
+	//! @brief Angle that all joints take in a frame
+	int frameAngle(unsigned long frame)
+	{
+		return JointController::ANGLE_MIN + static_cast<int>(frame % ANGLE_SUM) * ANGLE_STEP;
+	}
+
+	int channelPwm(int channel)
+	{
+		const uint8_t* registers = Wire.registers(PCA9685_ADDRESS) + LED0_ON_L + 4 * channel;
+
+		return registers[2] | (registers[3] << 8);
+	}
+
+	/*!
+		@brief Find the frame that the outputs belong to
+
+		@return Angle of the frame, or ANGLE_MAX + 1 if the outputs are torn
+	*/
+	int outputAngle()
+	{
+		for (int index = 0; index < ANGLE_SUM; index++)
+		{
+			const int angle = JointController::ANGLE_MIN + index * ANGLE_STEP;
+
+			#if CLOCK_WISE
+				const int pwm    = map(angle, JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::PWM_MIN(), JointController::PWM_MAX());
+				const int degree = 90 + angle / 10;
+			#else
+				const int pwm    = map(angle, JointController::ANGLE_MIN, JointController::ANGLE_MAX, JointController::PWM_MAX(), JointController::PWM_MIN());
+				const int degree = 90 - angle / 10;
+			#endif
+
+			if (channelPwm(0) != pwm)
+			{
+				continue;
+			}
+
+			for (int channel = 1; channel < 16; channel++)
+			{
+				if (channelPwm(channel) != pwm)
+				{
+					return JointController::ANGLE_MAX + 1;
+				}
+			}
+
+			if ((GPIO12SERVO.read() != degree) || (GPIO14SERVO.read() != degree))
+			{
+				return JointController::ANGLE_MAX + 1;
+			}
+
+			return angle;
+		}
+
+		return JointController::ANGLE_MAX + 1;
+	}
+}
+
+
+int main()
+{
+	JointController joint_ctrl;
+	joint_ctrl.Init();
+
+	// A whole frame, that differs from the last frame published, is on the outputs before the threads begin.
+	for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		joint_ctrl.setAngle(joint_id, JointController::ANGLE_MAX);
+	}
+
+	JointController::publish();
+	JointController::updateAngle();
+	CHECK(outputAngle() == JointController::ANGLE_MAX);
+	CHECK(frameAngle(FRAME_SUM - 1) != JointController::ANGLE_MAX);
+
+	std::atomic<bool> producing(true);
+	unsigned long ticks  = 0;
+	unsigned long frames = 0;
+	unsigned long torn   = 0;
+
+	std::thread consumer([&]()
+	{
+		int last_angle = outputAngle();
+
+		while (producing)
+		{
+			JointController::updateAngle();
+			ticks++;
+
+			// A core runs the other thread here, and the threads run at once on more cores.
+			std::this_thread::yield();
+
+			const int angle = outputAngle();
+
+			if (angle > JointController::ANGLE_MAX)
+			{
+				torn++;
+			}
+			else if (angle != last_angle)
+			{
+				frames++;
+				last_angle = angle;
+			}
+		}
+	});
+
+	std::thread producer([&]()
+	{
+		for (unsigned long frame = 0; frame < FRAME_SUM; frame++)
+		{
+			for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+			{
+				joint_ctrl.setAngle(joint_id, frameAngle(frame));
+
+				// The former firmware output a frame half written at the moment.
+				if (joint_id == JointController::SUM / 2)
+				{
+					std::this_thread::yield();
+				}
+			}
+
+			JointController::publish();
+		}
+
+		producing = false;
+	});
+
+	producer.join();
+	consumer.join();
+
+	// The last frame published is output by the next tick.
+	JointController::updateAngle();
+
+	CHECK(torn == 0);
+	CHECK(frames > 0);
+	CHECK(outputAngle() == frameAngle(FRAME_SUM - 1));
+
+	printf("%d frames published, %lu ticks, %lu frames output, %lu torn\n", FRAME_SUM, ticks, frames, torn);
+
+	return HostTest::finish();
+}
@@ -0,0 +1,293 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Encoding of the frames stored, over the motions shipped in data/.
+	Every frame must decode to itself, and the encoding must be several times smaller than a frame.
+	A frame read from the store must cost fewer bursts and bytes of the flash than the former reads
+	of 30 bytes pieces from the file, that sought the file for every piece.
+	The times are printed too, but the flash and the file are both in RAM on the host,
+	so they have neither the bursts nor the page walks of SPIFFS that the counts stand for.
+*/
+
+#include <vector>
+
+#include "Arduino.h"
+#include <FS.h>
+
+#include "ExternalFs.h"
+#include "FlashPartition.h"
+#include "HostTest.h"
+#include "Motion.h"
+#include "MotionJson.h"
+#include "MotionStore.h"
+
+using namespace PLEN2;
+
+HOST_TEST_MAIN();
+
+
+namespace
+{
+	enum {
+		FRAME_SUM = 617, //!< Frames of all the files.
+		REPEAT    = 200  //!< Passes over all the frames timed.
+	};
+
+	const char* const FORMER_FILE = "/frames.bin";
+
+	/*!
+		@brief Frame that the frame is encoded against, as MotionStore::writeFrame() takes it
+
+		A keyframe differs from home, and others differ from the frame before them.
+	*/
+	Motion::Frame base(const std::vector<Motion::Frame>& frames, size_t index)
+	{
+		Motion::Frame result;
+
+		if ((index % MotionStore::KEYFRAME_INTERVAL) == 0)
+		{
+			memset(&result, 0, sizeof(result));
+		}
+		else
+		{
+			result = frames[index - 1];
+		}
+
+		return result;
+	}
+
+	//! @brief Slots of a frame in the former file, that split it into pieces of ExternalFs::SLOT_SIZE() bytes
+	unsigned int frameSlots()
+	{
+		return (sizeof(Motion::Frame) + ExternalFs::SLOT_SIZE() - 1) / ExternalFs::SLOT_SIZE();
+	}
+
+	//! @brief Read a frame as Frame::get() of the former firmware did
+	bool readFormer(unsigned int frame_number, Motion::Frame& frame, File& fp)
+	{
+		unsigned char* filler = reinterpret_cast<unsigned char*>(&frame);
+
+		for (unsigned int piece = 0; piece < frameSlots(); piece++)
+		{
+			const unsigned int offset = piece * ExternalFs::SLOT_SIZE();
+			const unsigned char size  = static_cast<unsigned char>(min(sizeof(Motion::Frame) - offset, static_cast<size_t>(ExternalFs::SLOT_SIZE())));
+
+			if (ExternalFs::readSlot(frame_number * frameSlots() + piece, filler + offset, size, fp) != size)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool writeFormer(unsigned int frame_number, const Motion::Frame& frame, File& fp)
+	{
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(&frame);
+
+		for (unsigned int piece = 0; piece < frameSlots(); piece++)
+		{
+			const unsigned int offset = piece * ExternalFs::SLOT_SIZE();
+			const unsigned char size  = static_cast<unsigned char>(min(sizeof(Motion::Frame) - offset, static_cast<size_t>(ExternalFs::SLOT_SIZE())));
+
+			if (ExternalFs::writeSlot(frame_number * frameSlots() + piece, data + offset, size, fp) != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+
+int main()
+{
+	std::vector<MotionJson::MotionFile> motions;
+	const std::vector<std::string> paths = MotionJson::paths();
+
+	for (size_t index = 0; index < paths.size(); index++)
+	{
+		MotionJson::MotionFile motion;
+		CHECK(MotionJson::load(paths[index], motion));
+		motions.push_back(motion);
+	}
+
+	// Every frame decodes to itself, and the bytes encoded are counted.
+	std::vector<std::vector<unsigned char> > encoded;
+	size_t frames        = 0;
+	size_t encoded_size  = 0;
+	size_t largest       = 0;
+	size_t decoded       = 0;
+
+	for (size_t motion = 0; motion < motions.size(); motion++)
+	{
+		const std::vector<Motion::Frame>& source = motions[motion].frames;
+
+		for (size_t index = 0; index < source.size(); index++)
+		{
+			unsigned char data[MotionStore::ENCODED_SIZE_MAX];
+			const unsigned char size = MotionStore::encode(source[index], base(source, index), data);
+
+			Motion::Frame frame = base(source, index);
+			frame.index = source[index].index;
+
+			if (MotionStore::decode(data, size, frame) && MotionJson::sameFrame(frame, source[index]))
+			{
+				decoded++;
+			}
+
+			encoded.push_back(std::vector<unsigned char>(data, data + size));
+			frames++;
+			encoded_size += size;
+			largest = max(largest, static_cast<size_t>(size));
+		}
+	}
+
+	CHECK(frames == FRAME_SUM);
+	CHECK(decoded == frames);
+	CHECK(largest <= MotionStore::ENCODED_SIZE_MAX);
+
+	// The frames shrink several times, and the file read by the former firmware was larger still.
+	const size_t frame_size  = frames * sizeof(Motion::Frame);
+	const size_t former_size = frames * frameSlots() * ExternalFs::CHUNK_SIZE();
+	CHECK(encoded_size * 4 <= frame_size);
+
+	// Decoder only.
+	HostTest::Stopwatch stopwatch;
+	long checksum = 0;
+
+	for (int pass = 0; pass < REPEAT; pass++)
+	{
+		size_t frame_number = 0;
+
+		for (size_t motion = 0; motion < motions.size(); motion++)
+		{
+			Motion::Frame frame;
+
+			for (size_t index = 0; index < motions[motion].frames.size(); index++, frame_number++)
+			{
+				if ((index % MotionStore::KEYFRAME_INTERVAL) == 0)
+				{
+					memset(&frame, 0, sizeof(frame));
+				}
+
+				const std::vector<unsigned char>& data = encoded[frame_number];
+				MotionStore::decode(data.data(), static_cast<unsigned char>(data.size()), frame);
+				checksum += frame.joint_angle[frame_number % JointController::SUM];
+			}
+		}
+	}
+
+	const double decode_ns = static_cast<double>(stopwatch.elapsedNs()) / (static_cast<double>(REPEAT) * frames);
+
+	// Frames read in order from the store, as the prefetch of MotionController reads them.
+	ExternalFs::init();
+	MotionStore::init();
+	CHECK(MotionStore::mapped());
+
+	for (size_t motion = 0; motion < motions.size(); motion++)
+	{
+		const Motion::Header& header = motions[motion].header;
+		CHECK(MotionStore::writeHeader(header));
+
+		for (size_t index = 0; index < motions[motion].frames.size(); index++)
+		{
+			CHECK(MotionStore::writeFrame(header.slot, motions[motion].frames[index]));
+		}
+	}
+
+	size_t read = 0;
+	const unsigned long flash_reads = FlashPartition::reads();
+	const unsigned long flash_bytes = FlashPartition::bytesRead();
+	stopwatch = HostTest::Stopwatch();
+
+	for (int pass = 0; pass < REPEAT; pass++)
+	{
+		for (size_t motion = 0; motion < motions.size(); motion++)
+		{
+			const std::vector<Motion::Frame>& source = motions[motion].frames;
+
+			for (size_t index = 0; index < source.size(); index++)
+			{
+				Motion::Frame frame;
+				frame.index = static_cast<unsigned short>(index);
+
+				// A slot named by two files has the frames of the last one.
+				if (MotionStore::readFrame(motions[motion].header.slot, frame))
+				{
+					read++;
+				}
+
+				checksum += frame.joint_angle[index % JointController::SUM];
+			}
+		}
+	}
+
+	const double store_ns = static_cast<double>(stopwatch.elapsedNs()) / (static_cast<double>(REPEAT) * frames);
+	const double store_reads = static_cast<double>(FlashPartition::reads() - flash_reads) / (static_cast<double>(REPEAT) * frames);
+	const double store_bytes = static_cast<double>(FlashPartition::bytesRead() - flash_bytes) / (static_cast<double>(REPEAT) * frames);
+	CHECK(read == static_cast<size_t>(REPEAT) * frames);
+
+	// Frames read in pieces from the file, as Frame::get() of the former firmware did.
+	File fp = SPIFFS.open(FORMER_FILE, "w+");
+	std::vector<unsigned char> blank(former_size, 0xFF);
+	fp.write(blank.data(), blank.size());
+
+	for (size_t motion = 0, frame_number = 0; motion < motions.size(); motion++)
+	{
+		for (size_t index = 0; index < motions[motion].frames.size(); index++, frame_number++)
+		{
+			CHECK(writeFormer(frame_number, motions[motion].frames[index], fp));
+		}
+	}
+
+	size_t former_read = 0;
+	const unsigned long seeks = fp.seeks();
+	stopwatch = HostTest::Stopwatch();
+
+	for (int pass = 0; pass < REPEAT; pass++)
+	{
+		for (size_t frame_number = 0; frame_number < frames; frame_number++)
+		{
+			Motion::Frame frame;
+
+			if (readFormer(frame_number, frame, fp))
+			{
+				former_read++;
+			}
+
+			checksum += frame.joint_angle[frame_number % JointController::SUM];
+		}
+	}
+
+	const double former_ns = static_cast<double>(stopwatch.elapsedNs()) / (static_cast<double>(REPEAT) * frames);
+	CHECK(former_read == static_cast<size_t>(REPEAT) * frames);
+
+	// A seek of SPIFFS walks the pages of the file, and is followed by a read of its own.
+	const double former_seeks = static_cast<double>(fp.seeks() - seeks) / (static_cast<double>(REPEAT) * frames);
+	fp.close();
+
+	CHECK(former_seeks == frameSlots());
+	CHECK(store_reads * 2 < former_seeks);
+	CHECK(store_bytes * 2 < sizeof(Motion::Frame));
+
+	printf("%lu frames: %lu bytes encoded (%.1f bytes per frame, largest %lu), %lu bytes decoded, %lu bytes in the former file\n",
+		static_cast<unsigned long>(frames), static_cast<unsigned long>(encoded_size), static_cast<double>(encoded_size) / frames,
+		static_cast<unsigned long>(largest), static_cast<unsigned long>(frame_size), static_cast<unsigned long>(former_size));
+	printf("compression: %.1fx of the frames, %.1fx of the former file\n",
+		static_cast<double>(frame_size) / encoded_size, static_cast<double>(former_size) / encoded_size);
+	printf("per frame: readFrame() from the store %.2f bursts and %.1f bytes of the flash, former pieces from the file %.1f seeks and %lu bytes\n",
+		store_reads, store_bytes, former_seeks, static_cast<unsigned long>(sizeof(Motion::Frame)));
+	printf("per frame on the host: decode() %.1f ns, readFrame() from the store %.1f ns, former pieces from the file %.1f ns (checksum %ld)\n",
+		decode_ns, store_ns, former_ns, checksum);
+
+	return HostTest::finish();
+}
@@ -0,0 +1,287 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Round trip of the motions shipped in data/, through the store on the flash partition.
+	Every motion is installed, read back after a reboot, installed again until the partition is compacted,
+	and converted from the old "/motion.bin", and must come back as the file says.
+*/
+
+#include <map>
+#include <vector>
+
+#include "Arduino.h"
+#include <FS.h>
+
+#include "ExternalFs.h"
+#include "FlashPartition.h"
+#include "HostTest.h"
+#include "Motion.h"
+#include "MotionJson.h"
+#include "MotionStore.h"
+
+using namespace PLEN2;
+
+HOST_TEST_MAIN();
+
+
+namespace
+{
+	enum {
+		FILE_SUM  = 91,
+		FRAME_SUM = 617, //!< Frames of all the files.
+
+		LEGACY_SLOT_END        = 90,
+		LEGACY_FRAMELENGTH_MAX = 20,
+
+		PASS_MAX = 64 //!< Passes of installing all, that fill the partition more than once.
+	};
+
+	typedef std::map<unsigned char, const MotionJson::MotionFile*> Slots;
+
+	bool install(const MotionJson::MotionFile& motion)
+	{
+		if (!Motion::Installation::begin(motion.header))
+		{
+			return false;
+		}
+
+		for (size_t index = 0; index < motion.frames.size(); index++)
+		{
+			if (!Motion::Installation::append(motion.frames[index]))
+			{
+				return false;
+			}
+		}
+
+		return Motion::Installation::commit();
+	}
+
+	//! @brief Decide the store has the motion as the file says (It reads the store, not the cache.)
+	bool stored(const MotionJson::MotionFile& motion)
+	{
+		Motion::Header header;
+		header.slot = motion.header.slot;
+
+		if (!MotionStore::readHeader(header) || !MotionJson::sameHeader(header, motion.header))
+		{
+			return false;
+		}
+
+		for (size_t index = 0; index < motion.frames.size(); index++)
+		{
+			Motion::Frame frame;
+			frame.index = static_cast<unsigned short>(index);
+
+			if (!MotionStore::readFrame(header.slot, frame) || !MotionJson::sameFrame(frame, motion.frames[index]))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	int storedAll(const Slots& slots)
+	{
+		int result = 0;
+
+		for (Slots::const_iterator slot = slots.begin(); slot != slots.end(); ++slot)
+		{
+			result += stored(*slot->second)? 1 : 0;
+		}
+
+		return result;
+	}
+
+	/*!
+		@brief Write a value into the old "/motion.bin", split into pieces of ExternalFs::SLOT_SIZE() bytes
+	*/
+	bool writeLegacy(unsigned int first_slot, const void* value, unsigned int size, File& fp)
+	{
+		const unsigned char* data = static_cast<const unsigned char*>(value);
+
+		for (unsigned int written = 0, slot = first_slot; written < size; written += ExternalFs::SLOT_SIZE(), slot++)
+		{
+			const unsigned char piece = static_cast<unsigned char>(min(size - written, static_cast<unsigned int>(ExternalFs::SLOT_SIZE())));
+
+			if (ExternalFs::writeSlot(slot, data + written, piece, fp) != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	unsigned int slotCount(unsigned int size)
+	{
+		return (size + ExternalFs::SLOT_SIZE() - 1) / ExternalFs::SLOT_SIZE();
+	}
+
+	/*!
+		@brief Write the motions in the layout of the files before version 3
+
+		Every slot had a header of 30 bytes with 8 bit frame indexes, and 20 frames,
+		in a file filled with blank bytes.
+	*/
+	bool writeLegacyFile(const Slots& slots)
+	{
+		File fp = SPIFFS.open(MOTION_FILE, "w+");
+		std::vector<unsigned char> blank(4096, 0xFF);
+
+		for (long position = 0; position < MOTION_FILE_SIZE; position += blank.size())
+		{
+			fp.write(blank.data(), blank.size());
+		}
+
+		const unsigned int header_slots = slotCount(30);
+		const unsigned int frame_slots  = slotCount(sizeof(Motion::Frame));
+		const unsigned int motion_slots = header_slots + frame_slots * LEGACY_FRAMELENGTH_MAX;
+		bool result = true;
+
+		for (Slots::const_iterator slot = slots.begin(); slot != slots.end(); ++slot)
+		{
+			const Motion::Header& header = slot->second->header;
+			const unsigned int first_slot = slot->first * motion_slots;
+
+			// Slot, name, frame length, bit field, loop begin, loop end, loop count, jump slot and the stop flags.
+			unsigned char legacy[30];
+			memset(legacy, 0, sizeof(legacy));
+			legacy[0] = header.slot;
+			memcpy(legacy + 1, header.name, Motion::Header::NAME_LENGTH);
+			legacy[22] = static_cast<unsigned char>(header.frame_length);
+			legacy[23] = (header.interpolation << 3) | (header.use_extra << 5) | (header.use_jump << 6) | (header.use_loop << 7);
+			legacy[24] = static_cast<unsigned char>(header.loop_begin);
+			legacy[25] = static_cast<unsigned char>(header.loop_end);
+			legacy[26] = header.loop_count;
+			legacy[27] = header.jump_slot;
+
+			result = result && writeLegacy(first_slot, legacy, sizeof(legacy), fp);
+
+			for (size_t index = 0; index < slot->second->frames.size(); index++)
+			{
+				result = result && writeLegacy(first_slot + header_slots + index * frame_slots,
+					&slot->second->frames[index], sizeof(Motion::Frame), fp);
+			}
+		}
+
+		fp.close();
+
+		return result;
+	}
+}
+
+
+int main()
+{
+	std::vector<MotionJson::MotionFile> motions;
+	const std::vector<std::string> paths = MotionJson::paths();
+	size_t frames    = 0;
+	size_t text_size = 0;
+
+	for (size_t index = 0; index < paths.size(); index++)
+	{
+		MotionJson::MotionFile motion;
+
+		if (!MotionJson::load(paths[index], motion))
+		{
+			printf("  cannot read %s\n", paths[index].c_str());
+			CHECK(false);
+
+			continue;
+		}
+
+		motions.push_back(motion);
+		frames    += motion.frames.size();
+		text_size += motion.text_size;
+	}
+
+	CHECK(motions.size() == FILE_SUM);
+	CHECK(frames == FRAME_SUM);
+
+	// A slot has the motion of the last file that names it, as installing the files in order leaves.
+	Slots slots;
+
+	for (size_t index = 0; index < motions.size(); index++)
+	{
+		CHECK(motions[index].header.slot < LEGACY_SLOT_END);
+		CHECK(motions[index].frames.size() <= LEGACY_FRAMELENGTH_MAX);
+		slots[motions[index].header.slot] = &motions[index];
+	}
+
+	ExternalFs::init();
+	MotionStore::init();
+	CHECK(MotionStore::mapped());
+
+	// Installed, every motion is read back at once.
+	int installed = 0;
+	const unsigned long erasures = FlashPartition::erasures();
+
+	for (size_t index = 0; index < motions.size(); index++)
+	{
+		if (install(motions[index]) && stored(motions[index]))
+		{
+			installed++;
+		}
+		else
+		{
+			printf("  %s did not come back\n", motions[index].path.c_str());
+		}
+	}
+
+	CHECK(installed == FILE_SUM);
+
+	const unsigned long install_erasures = FlashPartition::erasures() - erasures;
+	const unsigned long used = MotionStore::used();
+
+	// After a reboot, the store loads the same motions from the partition.
+	MotionStore::init();
+	CHECK(MotionStore::mapped());
+	CHECK(storedAll(slots) == static_cast<int>(slots.size()));
+
+	// Installed again until the partition is compacted, the motions are kept over it and a reboot.
+	const unsigned long compactions = MotionStore::compactions();
+	int reinstalled = 0;
+
+	for (int pass = 0; (pass < PASS_MAX) && (MotionStore::compactions() == compactions); pass++)
+	{
+		for (size_t index = 0; index < motions.size(); index++)
+		{
+			reinstalled += install(motions[index])? 1 : 0;
+		}
+
+		CHECK(reinstalled % FILE_SUM == 0);
+	}
+
+	CHECK(MotionStore::compactions() > compactions);
+	CHECK(storedAll(slots) == static_cast<int>(slots.size()));
+
+	MotionStore::init();
+	CHECK(MotionStore::mapped());
+	CHECK(storedAll(slots) == static_cast<int>(slots.size()));
+
+	// The old file is converted at the boot, and removed after it.
+	CHECK(FlashPartition::erase(0, FlashPartition::size()));
+	SPIFFS.remove(MOTION_STORE_FILE);
+	CHECK(writeLegacyFile(slots));
+
+	MotionStore::init();
+	CHECK(MotionStore::mapped());
+	CHECK(!SPIFFS.exists(MOTION_FILE));
+	CHECK(storedAll(slots) == static_cast<int>(slots.size()));
+
+	printf("%lu files, %lu slots, %lu frames: %lu bytes of JSON, %lu bytes of frames\n",
+		static_cast<unsigned long>(motions.size()), static_cast<unsigned long>(slots.size()), static_cast<unsigned long>(frames),
+		static_cast<unsigned long>(text_size), static_cast<unsigned long>(frames * sizeof(Motion::Frame)));
+	printf("store: %lu bytes after installing all (%lu sector erasures), compacted after %d installations, %lu bytes after converting \"%s\" of %ld bytes\n",
+		used, install_erasures, reinstalled, MotionStore::used(), MOTION_FILE, MOTION_FILE_SIZE);
+
+	return HostTest::finish();
+}
@@ -0,0 +1,325 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Interpolation of motions by the time elapsed, under irregular ticks.
+	The main loop is run on late, jittered and missed ticks, and the motion must end within a tick
+	of its schedule, with the joints placed where the time says at every tick.
+*/
+
+#include <math.h>
+
+#include "Arduino.h"
+#include <Ticker.h>
+#include <Wire.h>
+
+#include "ExternalFs.h"
+#include "HostTest.h"
+#include "JointController.h"
+#include "Motion.h"
+#include "MotionController.h"
+#include "MotionStore.h"
+
+using namespace PLEN2;
+
+HOST_TEST_MAIN();
+
+extern Ticker flipper_motion;
+
+
+namespace
+{
+	const uint8_t PCA9685_ADDRESS = 0x40;
+	const uint8_t LED0_ON_L       = 0x06;
+
+	const unsigned char SLOT    = 42;
+	const unsigned char JOINT   = 1; //!< Joint checked, on channel 7.
+	const unsigned char CHANNEL = 7;
+
+	enum {
+		FRAME_SUM   = 5,
+		LOOP_PASSES = 8 //!< Passes of the main loop per tick.
+	};
+
+	//! @brief Transitions, that have one shorter than a tick and ones that are not multiples of a tick [msec]
+	const unsigned int TRANSITIONS_MS[FRAME_SUM] = { 100, 37, 250, 15, 180 };
+	const int ANGLES[FRAME_SUM] = { 300, -200, 450, 440, -100 }; //!< Differences from home.
+
+	int home_angle = 0;
+
+	int outputAngle()
+	{
+		const uint8_t* registers = Wire.registers(PCA9685_ADDRESS) + LED0_ON_L + 4 * CHANNEL;
+
+		return (registers[2] | (registers[3] << 8)) + JointController::ANGLE_MIN - home_angle;
+	}
+
+	unsigned long motionUs()
+	{
+		unsigned long result = 0;
+
+		for (int index = 0; index < FRAME_SUM; index++)
+		{
+			result += TRANSITIONS_MS[index] * 1000UL;
+		}
+
+		return result;
+	}
+
+	//! @brief Angle that the joint should take at the time from the beginning of the motion
+	double scheduledAngle(int begin_angle, unsigned long elapsed_us)
+	{
+		double from = begin_angle;
+
+		for (int index = 0; index < FRAME_SUM; index++)
+		{
+			const unsigned long transition_us = TRANSITIONS_MS[index] * 1000UL;
+
+			if (elapsed_us < transition_us)
+			{
+				return from + (ANGLES[index] - from) * elapsed_us / transition_us;
+			}
+
+			elapsed_us -= transition_us;
+			from = ANGLES[index];
+		}
+
+		return from;
+	}
+
+	bool install()
+	{
+		Motion::Header header;
+		header.init();
+		header.slot         = SLOT;
+		header.frame_length = FRAME_SUM;
+		strcpy(header.name, "timing");
+
+		if (!Motion::Installation::begin(header))
+		{
+			return false;
+		}
+
+		for (int index = 0; index < FRAME_SUM; index++)
+		{
+			Motion::Frame frame;
+			memset(&frame, 0, sizeof(frame));
+			frame.index              = index;
+			frame.transition_time_ms = TRANSITIONS_MS[index];
+			frame.joint_angle[JOINT] = ANGLES[index];
+
+			if (!Motion::Installation::append(frame))
+			{
+				return false;
+			}
+		}
+
+		return Motion::Installation::commit();
+	}
+
+	/*!
+		@brief Timing of the ticks
+
+		The ticker fires every interval() from the beginning, unless the tick is missed,
+		and the loop runs the tick late by lateness().
+	*/
+	class Schedule
+	{
+	public:
+		const char* name;
+		unsigned long interval_us;
+		unsigned long jitter_us;   //!< Max jitter of the interval.
+		unsigned long lateness_us; //!< Max lateness of the loop.
+		unsigned int  miss_every;  //!< A tick of every N ticks is missed, or 0.
+
+		Schedule(const char* name_, unsigned long interval_us_, unsigned long jitter_us_, unsigned long lateness_us_, unsigned int miss_every_)
+			: name(name_), interval_us(interval_us_), jitter_us(jitter_us_), lateness_us(lateness_us_), miss_every(miss_every_)
+		{
+			reset();
+		}
+
+		//! @brief Get time from the last tick to the next one
+		unsigned long next(unsigned long tick)
+		{
+			m_seed = m_seed * 1103515245UL + 12345UL;
+
+			unsigned long gap = interval_us;
+
+			if (jitter_us != 0)
+			{
+				gap = gap - jitter_us + (m_seed >> 8) % (2 * jitter_us + 1);
+			}
+
+			if ((miss_every != 0) && (tick % miss_every == miss_every - 1))
+			{
+				gap += interval_us;
+			}
+
+			const unsigned long lateness = (lateness_us == 0)? 0 : (m_seed >> 16) % (lateness_us + 1);
+			const unsigned long result = gap + lateness - m_lateness;
+			m_lateness = lateness;
+
+			return result;
+		}
+
+		void reset() { m_seed = 1; m_lateness = 0; }
+
+	private:
+		unsigned long m_seed;
+		unsigned long m_lateness;
+	};
+
+	/*!
+		@brief Result of a motion played on a schedule
+	*/
+	class Result
+	{
+	public:
+		unsigned long end_us;      //!< Time the motion stopped, from play().
+		unsigned long last_gap_us; //!< Time from the tick before the end.
+		unsigned long max_gap_us;
+		unsigned long ticks;
+		double        max_error;   //!< Largest difference from the angle scheduled, in transitions.
+		int           last_angle;
+	};
+
+	//! @brief Play the motion by the main loop of firmware.ino, on the schedule
+	Result play(MotionController& motion_ctrl, Schedule& schedule)
+	{
+		Result result = { 0, 0, 0, 0, 0, 0 };
+
+		schedule.reset();
+		Host::setMicros(1000000);
+
+		// The motion begins from the pose that the last one ended at.
+		const int begin_angle = outputAngle();
+		const unsigned long begin_us = micros();
+		motion_ctrl.play(SLOT);
+
+		while (motion_ctrl.playing() && (result.ticks < 1000))
+		{
+			const unsigned long gap_us = schedule.next(result.ticks);
+			Host::advance(gap_us);
+			flipper_motion.fire();
+			result.ticks++;
+			result.last_gap_us = gap_us;
+			result.max_gap_us  = max(result.max_gap_us, gap_us);
+
+			// The loop spins between the ticks, so it runs some times before the next one.
+			for (int pass = 0; (pass < LOOP_PASSES) && motion_ctrl.playing(); pass++)
+			{
+				if (motion_ctrl.frameUpdatable())
+				{
+					motion_ctrl.updateFrame();
+					JointController::updateAngle();
+
+					if (!motion_ctrl.updatingFinished())
+					{
+						// The joint is inside a transition, so it must be where the time says.
+						const double error = fabs(outputAngle() - scheduledAngle(begin_angle, micros() - begin_us));
+						result.max_error = (error > result.max_error)? error : result.max_error;
+					}
+				}
+
+				if (motion_ctrl.updatingFinished())
+				{
+					if (motion_ctrl.nextFrameLoadable())
+					{
+						motion_ctrl.loadNextFrame();
+					}
+					else
+					{
+						motion_ctrl.stop();
+						result.end_us = micros() - begin_us;
+					}
+				}
+
+				if (!motion_ctrl.frameUpdatable())
+				{
+					motion_ctrl.prefetch();
+				}
+			}
+		}
+
+		result.last_angle = outputAngle();
+
+		return result;
+	}
+}
+
+
+int main()
+{
+	ExternalFs::init();
+	MotionStore::init();
+
+	// Same as setup() of firmware.ino, that attaches the ticker of the motions.
+	JointController joint_ctrl;
+	joint_ctrl.Init();
+	joint_ctrl.loadSettings();
+
+	// PWM value of the channel equals angle - ANGLE_MIN, so the angles are read back as they are.
+	JointController::ChannelSetting channel = joint_ctrl.getChannel(JOINT);
+	channel.DIRECTION = 1;
+	channel.PWM_MIN   = 0;
+	channel.PWM_MAX   = JointController::ANGLE_MAX - JointController::ANGLE_MIN;
+	CHECK(joint_ctrl.setChannel(JOINT, channel));
+	JointController::publish();
+	JointController::updateAngle();
+	home_angle = joint_ctrl.getHomeAngle(JOINT);
+	CHECK(install());
+
+	MotionController motion_ctrl(joint_ctrl);
+	CHECK(flipper_motion.interval() == Motion::Frame::UPDATE_INTERVAL_MS);
+
+	const unsigned long interval_us = Motion::Frame::UPDATE_INTERVAL_MS * 1000UL;
+
+	Schedule schedules[] = {
+		Schedule("regular",      interval_us,     0,                   0,               0),
+		Schedule("jittered",     interval_us,     interval_us * 3 / 4, 0,               0),
+		Schedule("late loop",    interval_us,     0,                   interval_us - 1, 0),
+		Schedule("missed ticks", interval_us,     0,                   0,               3),
+		Schedule("all of them",  interval_us,     interval_us / 2,     interval_us / 2, 4),
+		Schedule("slow ticker",  interval_us * 3, 0,                   0,               0)
+	};
+
+	for (size_t index = 0; index < sizeof(schedules) / sizeof(schedules[0]); index++)
+	{
+		Schedule& schedule = schedules[index];
+		const Result result = play(motion_ctrl, schedule);
+
+		CHECK(!motion_ctrl.playing());
+		CHECK(result.end_us >= motionUs());
+		CHECK(result.end_us - motionUs() < result.last_gap_us);
+		CHECK(result.max_error <= 1);
+		CHECK(result.last_angle == ANGLES[FRAME_SUM - 1]);
+
+		// The former engine counted transition_time_ms / UPDATE_INTERVAL_MS ticks per frame, and divided by zero for 15 msec.
+		unsigned long former_ticks = 0;
+
+		for (int frame = 0; frame < FRAME_SUM; frame++)
+		{
+			former_ticks += max(1U, TRANSITIONS_MS[frame] / Motion::Frame::UPDATE_INTERVAL_MS);
+		}
+
+		unsigned long former_end_us = 0;
+		schedule.reset();
+
+		for (unsigned long tick = 0; tick < former_ticks; tick++)
+		{
+			former_end_us += schedule.next(tick);
+		}
+
+		printf("%-12s: %lu ticks (max gap %lu us), ended %lu us after the schedule, max error %.1f (former engine: %+ld us)\n",
+			schedule.name, result.ticks, result.max_gap_us, result.end_us - motionUs(), result.max_error,
+			static_cast<long>(former_end_us) - static_cast<long>(motionUs()));
+	}
+
+	return HostTest::finish();
+}
@@ -0,0 +1,270 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Slew limiter of the output tick.
+	Step inputs are fed to joints, and the trajectories output must keep the speed and the acceleration limits,
+	arrive at the targets in the time that the limits allow, and never overshoot.
+*/
+
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+#include "Arduino.h"
+#include <Wire.h>
+
+#include "HostTest.h"
+#include "JointController.h"
+
+using namespace PLEN2;
+
+HOST_TEST_MAIN();
+
+
+namespace
+{
+	const uint8_t PCA9685_ADDRESS = 0x40;
+	const uint8_t LED0_ON_L       = 0x06;
+
+	const unsigned char JOINT   = 1; //!< Joint tested, on channel 7.
+	const unsigned char CHANNEL = 7;
+
+	int outputAngle()
+	{
+		const uint8_t* registers = Wire.registers(PCA9685_ADDRESS) + LED0_ON_L + 4 * CHANNEL;
+
+		return (registers[2] | (registers[3] << 8)) + JointController::ANGLE_MIN;
+	}
+
+	/*!
+		@brief Output ticks until the joint stops
+
+		@return Angles output, from the angle before the first tick
+	*/
+	std::vector<int> trajectory(unsigned int tick_max)
+	{
+		std::vector<int> angles(1, outputAngle());
+
+		JointController::publish();
+
+		for (unsigned int tick = 0; tick < tick_max; tick++)
+		{
+			JointController::updateAngle();
+			angles.push_back(outputAngle());
+
+			if ((angles.size() > 2) && (angles[angles.size() - 1] == angles[angles.size() - 2]))
+			{
+				angles.pop_back();
+
+				break;
+			}
+		}
+
+		return angles;
+	}
+
+	//! @brief Largest change of the angle per tick
+	int maxStep(const std::vector<int>& angles)
+	{
+		int result = 0;
+
+		for (size_t index = 1; index < angles.size(); index++)
+		{
+			result = max(result, abs(angles[index] - angles[index - 1]));
+		}
+
+		return result;
+	}
+
+	/*!
+		@brief Largest change of the step per tick
+
+		The step into the target is shortened to the rest of the distance, so the change into it is left out,
+		and the change from it to the stop is counted instead.
+	*/
+	int maxStepChange(const std::vector<int>& angles)
+	{
+		int result = 0;
+
+		for (size_t index = 2; index + 1 < angles.size(); index++)
+		{
+			result = max(result, abs((angles[index] - angles[index - 1]) - (angles[index - 1] - angles[index - 2])));
+		}
+
+		if (angles.size() > 1)
+		{
+			result = max(result, abs(angles[angles.size() - 1] - angles[angles.size() - 2]));
+		}
+
+		return result;
+	}
+
+	//! @brief Decide the angles move toward the target monotonically, and end at it
+	bool monotonic(const std::vector<int>& angles, int target)
+	{
+		for (size_t index = 1; index < angles.size(); index++)
+		{
+			if (abs(target - angles[index]) > abs(target - angles[index - 1]))
+			{
+				return false;
+			}
+		}
+
+		return angles.back() == target;
+	}
+
+	//! @brief Time of a step by the trapezoidal profile [sec]
+	double stepTime(double distance, double speed, double accel)
+	{
+		if (accel == 0)
+		{
+			return distance / speed;
+		}
+
+		if (speed == 0 || (speed * speed / accel) > distance)
+		{
+			return 2 * sqrt(distance / accel);
+		}
+
+		return distance / speed + speed / accel;
+	}
+
+	//! @brief Move the joint to the angle without the limits
+	void place(JointController& joint_ctrl, int angle)
+	{
+		const int speed = joint_ctrl.getSpeedLimit(JOINT);
+		const int accel = joint_ctrl.getAccelLimit(JOINT);
+
+		joint_ctrl.setSpeedLimit(JOINT, 0);
+		joint_ctrl.setAccelLimit(JOINT, 0);
+		joint_ctrl.setAngle(JOINT, angle);
+		JointController::publish();
+		JointController::updateAngle();
+		joint_ctrl.setSpeedLimit(JOINT, speed);
+		joint_ctrl.setAccelLimit(JOINT, accel);
+	}
+}
+
+
+int main()
+{
+	JointController joint_ctrl;
+	joint_ctrl.Init();
+
+	// PWM value of the channel equals angle - ANGLE_MIN, so the indexes of the limiter are read back as they are.
+	JointController::ChannelSetting channel = joint_ctrl.getChannel(JOINT);
+	channel.DIRECTION = 1;
+	channel.PWM_MIN   = 0;
+	channel.PWM_MAX   = JointController::ANGLE_MAX - JointController::ANGLE_MIN;
+	CHECK(joint_ctrl.setChannel(JOINT, channel));
+	JointController::publish();
+	JointController::updateAngle();
+
+	// Unlimited joint jumps at once.
+	place(joint_ctrl, -600);
+	joint_ctrl.setAngle(JOINT, 600);
+	std::vector<int> angles = trajectory(100);
+	CHECK(angles.size() == 2);
+	CHECK(angles.back() == 600);
+
+	const int rates[] = { 25, 50 };
+
+	for (size_t rate_index = 0; rate_index < sizeof(rates) / sizeof(rates[0]); rate_index++)
+	{
+		const int rate = rates[rate_index];
+		CHECK(JointController::setOutputRate(rate));
+
+		// Speed limit only: constant velocity.
+		joint_ctrl.setSpeedLimit(JOINT, 2000);
+		joint_ctrl.setAccelLimit(JOINT, 0);
+		place(joint_ctrl, -600);
+		joint_ctrl.setAngle(JOINT, 600);
+		angles = trajectory(1000);
+
+		CHECK(monotonic(angles, 600));
+		CHECK(maxStep(angles) <= 2000 / rate + 1);
+		CHECK(fabs((angles.size() - 1) - stepTime(1200, 2000, 0) * rate) <= 1.5);
+
+		// Speed and acceleration limits: trapezoid, that stops at the target without overshooting.
+		joint_ctrl.setAccelLimit(JOINT, 8000);
+		place(joint_ctrl, -600);
+		joint_ctrl.setAngle(JOINT, 600);
+		angles = trajectory(1000);
+
+		CHECK(monotonic(angles, 600));
+		CHECK(maxStep(angles) <= 2000 / rate + 1);
+		CHECK(maxStepChange(angles) <= 8000.0 / (rate * rate) + 2);
+		CHECK(fabs((angles.size() - 1) - stepTime(1200, 2000, 8000) * rate) <= 2.5);
+		printf("%d Hz: step of 1200 in %u ticks (trapezoid %.1f), max step %d, max step change %d\n",
+			rate, static_cast<unsigned int>(angles.size() - 1), stepTime(1200, 2000, 8000) * rate, maxStep(angles), maxStepChange(angles));
+
+		// Acceleration limit only: triangle.
+		joint_ctrl.setSpeedLimit(JOINT, 0);
+		place(joint_ctrl, 400);
+		joint_ctrl.setAngle(JOINT, -400);
+		angles = trajectory(1000);
+
+		CHECK(monotonic(angles, -400));
+		CHECK(maxStepChange(angles) <= 8000.0 / (rate * rate) + 2);
+		CHECK(fabs((angles.size() - 1) - stepTime(800, 0, 8000) * rate) <= 2.5);
+
+		// Reversal while moving: the joint brakes instead of turning at once.
+		joint_ctrl.setSpeedLimit(JOINT, 2000);
+		place(joint_ctrl, -600);
+		joint_ctrl.setAngle(JOINT, 600);
+		JointController::publish();
+
+		for (int tick = 0; tick < rate / 2; tick++)
+		{
+			JointController::updateAngle();
+		}
+
+		const int turning_angle = outputAngle();
+		joint_ctrl.setAngle(JOINT, -600);
+		angles = trajectory(1000);
+		angles.insert(angles.begin(), turning_angle - 2000 / rate);
+
+		CHECK(maxStepChange(angles) <= 8000.0 / (rate * rate) + 2);
+		CHECK(angles.back() == -600);
+		CHECK(*std::max_element(angles.begin(), angles.end()) > turning_angle);
+	}
+
+	// Cost of a tick, that all joints are slewing in.
+	CHECK(JointController::setOutputRate(25));
+
+	for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		joint_ctrl.setSpeedLimit(joint_id, 1);
+		joint_ctrl.setAccelLimit(joint_id, 1000);
+	}
+
+	enum { TICKS = 10000 };
+
+	for (unsigned char joint_id = 0; joint_id < JointController::SUM; joint_id++)
+	{
+		joint_ctrl.setAngle(joint_id, JointController::ANGLE_MAX);
+	}
+
+	JointController::publish();
+
+	HostTest::Stopwatch watch;
+
+	for (int tick = 0; tick < TICKS; tick++)
+	{
+		JointController::updateAngle();
+	}
+
+	const double tick_ns = watch.elapsedNs() / TICKS;
+
+	CHECK(outputAngle() < JointController::ANGLE_MAX);
+	printf("tick with %d joints slewing: %.1f ns\n", JointController::activeJointSum(), tick_ns);
+
+	return HostTest::finish();
+}
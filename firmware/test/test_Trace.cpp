@@ -0,0 +1,255 @@
+/*
+	Copyright (c) 2015,
+	- Kazuyuki TAKASE - https://github.com/junbowu
+	- PLEN Project Company Inc. - https://plen.jp
+
+	This software is released under the MIT License.
+	(See also : http://opensource.org/licenses/mit-license.php)
+*/
+
+/*
+	Trace ring buffer and its overhead per event.
+	Events must keep their order, timestamps and depths through the wraparound, the dump must be Chrome's JSON,
+	and recording an event must cost far less than printing it as the former Profiler did.
+*/
+
+#include <string>
+
+#include "Arduino.h"
+
+#include "HostTest.h"
+#include "Trace.h"
+
+using namespace Utility;
+
+HOST_TEST_MAIN();
+
+
+namespace
+{
+	const long SERIAL_BAUDRATE = 115200L; //!< Same as System::SERIAL_BAUDRATE().
+
+	const char OUTER_NAME[] = "outer";
+	const char INNER_NAME[] = "inner";
+
+	//! @brief Output stream, that keeps all characters written
+	class StringPrint : public Print
+	{
+	public:
+		std::string text;
+
+		virtual size_t write(uint8_t value)
+		{
+			text += static_cast<char>(value);
+
+			return 1;
+		}
+
+		using Print::write;
+	};
+
+	//! @brief Output stream, that discards all characters as a fast serial would
+	class NullPrint : public Print
+	{
+	public:
+		unsigned long written;
+
+		NullPrint() : written(0) {}
+
+		virtual size_t write(uint8_t)
+		{
+			written++;
+
+			return 1;
+		}
+
+		using Print::write;
+	};
+
+	//! @brief Scope traced by the macro, that is removed unless DEBUG_TRACE is true
+	void macroScope()
+	{
+		TRACE_SCOPE("macroScope()");
+	}
+
+	unsigned long count(const std::string& text, const std::string& pattern)
+	{
+		unsigned long result = 0;
+
+		for (size_t position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + 1))
+		{
+			result++;
+		}
+
+		return result;
+	}
+
+	bool endsWith(const std::string& text, const std::string& suffix)
+	{
+		return (text.size() >= suffix.size()) && (text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0);
+	}
+
+	//! @brief Decide the brackets of the text are balanced, outside of the strings
+	bool balanced(const std::string& text)
+	{
+		int depth = 0;
+		bool quoted = false;
+
+		for (size_t index = 0; index < text.size(); index++)
+		{
+			const char c = text[index];
+
+			if (c == '"')
+			{
+				quoted = !quoted;
+			}
+			else if (!quoted && ((c == '{') || (c == '[')))
+			{
+				depth++;
+			}
+			else if (!quoted && ((c == '}') || (c == ']')))
+			{
+				if (--depth < 0)
+				{
+					return false;
+				}
+			}
+		}
+
+		return (depth == 0) && !quoted;
+	}
+}
+
+
+int main()
+{
+	// Nested scopes.
+	Trace::clear();
+	Host::setMicros(1000);
+
+	{
+		TraceScope outer(F(OUTER_NAME));
+		Host::advance(10);
+
+		{
+			TraceScope inner(F(INNER_NAME));
+			Host::advance(5);
+		}
+
+		Host::advance(20);
+	}
+
+	CHECK(Trace::size() == 4);
+	CHECK(Trace::dropped() == 0);
+
+	const char* const names[]  = { OUTER_NAME, INNER_NAME, INNER_NAME, OUTER_NAME };
+	const unsigned char phases[] = { Trace::PHASE_BEGIN, Trace::PHASE_BEGIN, Trace::PHASE_END, Trace::PHASE_END };
+	const unsigned long stamps[] = { 1000, 1010, 1015, 1035 };
+	const unsigned char depths[] = { 0, 1, 1, 0 };
+
+	for (unsigned int index = 0; index < 4; index++)
+	{
+		const Trace::Event& event = Trace::at(index);
+
+		CHECK(reinterpret_cast<const char*>(event.name) == names[index]);
+		CHECK(event.phase == phases[index]);
+		CHECK(event.timestamp_us == stamps[index]);
+		CHECK(event.depth == depths[index]);
+	}
+
+	// Dump of Chrome's trace event format.
+	StringPrint dump;
+	Trace::dump(dump);
+
+	CHECK(dump.text.find("{\"traceEvents\":[{\"name\":\"outer\",\"ph\":\"B\",\"ts\":1000,\"pid\":0,\"tid\":0,\"args\":{\"depth\":0}},") == 0);
+	CHECK(dump.text.find("{\"name\":\"inner\",\"ph\":\"E\",\"ts\":1015,\"pid\":0,\"tid\":0,\"args\":{\"depth\":1}}") != std::string::npos);
+	CHECK(count(dump.text, "\"ph\":") == 4);
+	CHECK(endsWith(dump.text, "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":0}}\r\n"));
+	CHECK(balanced(dump.text));
+
+	// Disabled while drained.
+	Trace::enable(false);
+	{
+		TraceScope ignored(F(OUTER_NAME));
+	}
+	Trace::enable(true);
+	CHECK(Trace::size() == 4);
+
+	// The macro costs nothing unless DEBUG_TRACE is true.
+	macroScope();
+	CHECK(Trace::size() == (DEBUG_TRACE? 6 : 4));
+
+	// Wraparound, that overwrites the oldest events.
+	enum { SCOPE_SUM = 300 };
+
+	Trace::clear();
+	Host::setMicros(0);
+
+	for (unsigned long scope = 0; scope < SCOPE_SUM; scope++)
+	{
+		TraceScope outer(F(OUTER_NAME));
+		Host::advance(1);
+	}
+
+	CHECK(Trace::size() == Trace::EVENT_SUM);
+	CHECK(Trace::dropped() == 2 * SCOPE_SUM - Trace::EVENT_SUM);
+
+	bool ordered = true;
+
+	for (unsigned int index = 0; index < Trace::size(); index++)
+	{
+		const Trace::Event& event = Trace::at(index);
+		const unsigned long recorded = Trace::dropped() + index;
+
+		ordered = ordered
+			&& (event.phase == ((recorded % 2 == 0)? Trace::PHASE_BEGIN : Trace::PHASE_END))
+			&& (event.timestamp_us == (recorded + 1) / 2)
+			&& (event.depth == 0);
+	}
+
+	CHECK(ordered);
+
+	dump.text.clear();
+	Trace::dump(dump);
+	CHECK(count(dump.text, "\"ph\":") == Trace::EVENT_SUM);
+	CHECK(dump.text.find("\"dropped\":344}") != std::string::npos);
+	CHECK(balanced(dump.text));
+
+	// Cost of an event, against printing it to a serial that costs nothing itself.
+	enum { ROUNDS = 1000000 };
+
+	HostTest::Stopwatch trace_watch;
+
+	for (unsigned long round = 0; round < ROUNDS; round++)
+	{
+		TraceScope scope(F(OUTER_NAME));
+	}
+
+	const double trace_ns = trace_watch.elapsedNs() / (2.0 * ROUNDS);
+
+	NullPrint serial;
+	HostTest::Stopwatch print_watch;
+
+	for (unsigned long round = 0; round < ROUNDS; round++)
+	{
+		serial.print(F(OUTER_NAME));
+		serial.print(F(" : begin : "));
+		serial.println(micros());
+		serial.print(F(OUTER_NAME));
+		serial.print(F(" : end : "));
+		serial.println(micros());
+	}
+
+	const double print_ns = print_watch.elapsedNs() / (2.0 * ROUNDS);
+
+	CHECK(serial.written > 0);
+	CHECK(trace_ns < print_ns);
+	CHECK(Trace::dropped() == 2 * SCOPE_SUM + 2UL * ROUNDS - Trace::EVENT_SUM);
+
+	// A character costs 10 bits on the wire of the serial.
+	const double wire_ns = 1e9 * 10.0 * serial.written / (2.0 * ROUNDS) / SERIAL_BAUDRATE;
+
+	printf("per event: Trace::record() %.2f ns, print to serial %.2f ns and %.0f ns on the wire\n", trace_ns, print_ns, wire_ns);
+
+	return HostTest::finish();
+}